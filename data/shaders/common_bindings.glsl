@@ -21,6 +21,20 @@ layout(std430,set = 0, binding = 2) readonly buffer Materials {
 layout(set = 0, binding = 3) uniform sampler2D textures[1024];
 
 layout(set = 0, binding = 4) uniform samplerCube cubemaps[16];
+
+// [ x, y | z, tangent ]
+layout(std430, set = 0, binding = 5) readonly buffer PositionsQ {
+    uvec2 positionsQ[];
+};
+
+// [ normal | uv | color, tangent sign ], 3 uints a vertex
+layout(std430, set = 0, binding = 6) readonly buffer AttributesQ {
+    uint attributesQ[];
+};
+
+layout(std430, set = 0, binding = 7) readonly buffer VertexDecodes {
+    VertexDecode vertexDecodes[];
+};
 #endif // SPR_GLOBAL_BINDINGS
 
 
@@ -48,4 +62,55 @@ layout(set = 1, binding = 3) readonly buffer Transforms {
 layout(set = 1, binding = 4) readonly buffer Draws {
     DrawData draws[];
 };
-#endif // SPR_FRAME_BINDINGS
\ No newline at end of file
+#endif // SPR_FRAME_BINDINGS
+
+
+// ╔══════════════════════════════════════════════════════════════════════════╗
+// ║     Vertex fetch (float or quantized, by draw)                           ║
+// ╚══════════════════════════════════════════════════════════════════════════╝
+
+#ifdef SPR_GLOBAL_BINDINGS
+// matches VertexQuantization::decodeOctahedral
+vec3 decodeOctahedral(vec2 encoded) {
+    vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+    float fold = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -fold : fold;
+    n.y += n.y >= 0.0 ? -fold : fold;
+    return normalize(n);
+}
+
+// vertex is relative to the draw's vertexOffset
+vec4 loadPosition(DrawData draw, uint vertex) {
+    if (draw.decodeIndex == FLOAT_VERTICES)
+        return positions[draw.vertexOffset + vertex].pos;
+
+    VertexDecode decode = vertexDecodes[draw.decodeIndex];
+    uvec2 q = positionsQ[draw.vertexOffset + vertex];
+    vec3 normalized = vec3(unpackUnorm2x16(q.x), unpackUnorm2x16(q.y).x);
+    return vec4(decode.positionOffset.xyz + normalized * decode.positionScale.xyz, 1.0);
+}
+
+VertexAttributes loadAttributes(DrawData draw, uint vertex) {
+    if (draw.decodeIndex == FLOAT_VERTICES)
+        return attributes[draw.vertexOffset + vertex];
+
+    VertexDecode decode = vertexDecodes[draw.decodeIndex];
+    uint index = (draw.vertexOffset + vertex) * 3;
+    vec3 normal = decodeOctahedral(unpackSnorm2x16(attributesQ[index]));
+    vec2 uv = decode.uvOffsetScale.xy + unpackUnorm2x16(attributesQ[index + 1]) * decode.uvOffsetScale.zw;
+    vec3 color = unpackUnorm4x8(attributesQ[index + 2]).rgb;
+    return VertexAttributes(vec4(normal, uv.x), vec4(color, uv.y));
+}
+
+// xyz tangent, w handedness. w is 0 for vertices without
+// tangents (float ones never have them)
+vec4 loadTangent(DrawData draw, uint vertex) {
+    if (draw.decodeIndex == FLOAT_VERTICES)
+        return vec4(0.0);
+
+    uint index = draw.vertexOffset + vertex;
+    float handedness = float(int(attributesQ[index * 3 + 2]) >> 24);
+    vec2 encoded = unpackSnorm4x8(positionsQ[index].y).zw;
+    return vec4(decodeOctahedral(encoded), handedness);
+}
+#endif // SPR_GLOBAL_BINDINGS
\ No newline at end of file
@@ -11,6 +11,14 @@ struct VertexAttributes {
     vec4 color_v;   // [  color.xyz  |  tex.v ]
 };
 
+// quantized vertices (see VertexPositionQ/VertexAttributesQ in Mesh.h)
+// are read as raw uints, a value q (0..1) decodes to offset + q * scale
+struct VertexDecode {
+    vec4 positionOffset;
+    vec4 positionScale;
+    vec4 uvOffsetScale;     // [ offset.uv | scale.uv ]
+};
+
 
 // ╔═══════════════════════════════════╗
 // ║     Material                      ║
@@ -50,11 +58,13 @@ struct Transform {
 // ╔═══════════════════════════════════╗
 // ║     Draw Data                     ║
 // ╚═══════════════════════════════════╝
+const uint FLOAT_VERTICES = 0xFFFFFFFFu;
+
 struct DrawData {
     uint vertexOffset;
     uint materialOffset;
     uint transformOffset;
-    uint padding; // unused
+    uint decodeIndex;   // FLOAT_VERTICES or into vertexDecodes
 };
 
 
@@ -36,6 +36,17 @@ vec3 perturb_normal( vec3 N, vec3 V, vec2 texcoord, vec3 mapNormal ){
     mat3 TBN = cotangent_frame( N, -V, texcoord );
     return normalize( TBN * mapNormal );
 }
+
+// with the vertex tangent (w is the bitangent's sign, as in glTF), the
+// derivative frame above is only used for vertices without tangents
+vec3 perturb_normal( vec3 N, vec4 T, vec3 V, vec2 texcoord, vec3 mapNormal ){
+    if (T.w == 0.0)
+        return perturb_normal( N, V, texcoord, mapNormal );
+    N = normalize( N );
+    vec3 t = normalize( T.xyz - N * dot( N, T.xyz ) );
+    vec3 b = ( T.w < 0.0 ? -1.0 : 1.0 ) * cross( N, t );
+    return normalize( mat3( t, b, N ) * mapNormal );
+}
 #endif // SPR_NORMALS
 
 
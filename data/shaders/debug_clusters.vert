@@ -16,9 +16,9 @@ void main() {
     Transform transform = transforms[draw.transformOffset];
     Scene scene = sceneData;
 
-    VertexAttributes att = attributes[gl_VertexIndex + draw.vertexOffset];
+    VertexAttributes att = loadAttributes(draw, gl_VertexIndex);
 
-    vec4 positionLocal = positions[gl_VertexIndex + draw.vertexOffset].pos;
+    vec4 positionLocal = loadPosition(draw, gl_VertexIndex);
 
     pos = transform.model * positionLocal;
     normal = normalize(mat3(transform.modelInvTranspose) * att.normal_u.xyz);
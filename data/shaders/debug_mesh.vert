@@ -10,7 +10,7 @@ void main() {
     Transform transform = transforms[draw.transformOffset];
     Scene scene = sceneData;
 
-    vec4 positionLocal = positions[gl_VertexIndex + draw.vertexOffset].pos;
+    vec4 positionLocal = loadPosition(draw, gl_VertexIndex);
     
     gl_Position = scene.viewProj * transform.model * positionLocal;
 }
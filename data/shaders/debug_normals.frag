@@ -13,6 +13,7 @@ layout(location = 1) in vec3 normal;
 layout(location = 2) in vec3 color;
 layout(location = 3) in vec2 texCoord;
 layout(location = 4) in flat uint drawId;
+layout(location = 5) in vec4 tangent;
 
 layout(location = 0) out vec4 FragColor;
 
@@ -26,7 +27,7 @@ void main() {
     mapNormal = normalize(mapNormal * 2.0 - 1.0);
     mapNormal *= vec3(material.normalScale, material.normalScale, 1.0);
     
-    vec3 N = perturb_normal(normal, camera.pos - pos.xyz, texCoord, mapNormal);
+    vec3 N = perturb_normal(normal, tangent, camera.pos - pos.xyz, texCoord, mapNormal);
     N = N * 0.5 + 0.5;
     // N = normal * 0.5 + 0.5;
 
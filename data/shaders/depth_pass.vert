@@ -12,11 +12,11 @@ void main() {
     Transform transform = transforms[draw.transformOffset];
     Scene scene = sceneData;
 
-    VertexAttributes att = attributes[gl_VertexIndex + draw.vertexOffset];
+    VertexAttributes att = loadAttributes(draw, gl_VertexIndex);
     texCoord = vec2(att.normal_u.w, att.color_v.w);
     drawId = gl_InstanceIndex;
 
-    vec4 positionLocal = positions[gl_VertexIndex + draw.vertexOffset].pos;
+    vec4 positionLocal = loadPosition(draw, gl_VertexIndex);
     vec4 pos = transform.model * positionLocal;
 
     gl_Position = scene.viewProj * pos;
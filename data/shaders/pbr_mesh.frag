@@ -37,6 +37,7 @@ layout(location = 2) in vec3 color;
 layout(location = 3) in vec2 texCoord;
 layout(location = 4) in flat uint drawId;
 layout(location = 5) in vec4 viewPos;
+layout(location = 6) in vec4 tangent;
 
 layout(location = 0) out vec4 FragColor;
 
@@ -171,7 +172,7 @@ LightingParams getLightingParams(MaterialData material){
 	vec3 V = normalize(camera.pos - pos.rgb);
 
 	// world normal, after applying normal map
-	vec3 N = perturb_normal(normal, camera.pos - pos.xyz, texCoord, mapNormal);
+	vec3 N = perturb_normal(normal, tangent, camera.pos - pos.xyz, texCoord, mapNormal);
 	
 	// Angle between surface normal and outgoing light direction.
 	float NdV = max(0.0, dot(N, V));
@@ -10,18 +10,21 @@ layout(location = 2) out vec3 color;
 layout(location = 3) out vec2 texCoord;
 layout(location = 4) out flat uint drawId;
 layout(location = 5) out vec4 viewPos;
+layout(location = 6) out vec4 tangent;
 
 void main() {
     DrawData draw = draws[gl_InstanceIndex];
     Transform transform = transforms[draw.transformOffset];
     Scene scene = sceneData;
 
-    VertexAttributes att = attributes[gl_VertexIndex + draw.vertexOffset];
+    VertexAttributes att = loadAttributes(draw, gl_VertexIndex);
 
-    vec4 positionLocal = positions[gl_VertexIndex + draw.vertexOffset].pos;
+    vec4 positionLocal = loadPosition(draw, gl_VertexIndex);
 
     pos = transform.model * positionLocal;
     normal = normalize(mat3(transform.modelInvTranspose) * att.normal_u.xyz);
+    vec4 tangentLocal = loadTangent(draw, gl_VertexIndex);
+    tangent = vec4(mat3(transform.model) * tangentLocal.xyz, tangentLocal.w);
     color = att.color_v.rgb;
     texCoord = vec2(att.normal_u.w, att.color_v.w);
     drawId = gl_InstanceIndex;
@@ -14,11 +14,11 @@ void main() {
     DrawData draw = draws[gl_InstanceIndex];
     Transform transform = transforms[draw.transformOffset];
 
-    VertexAttributes att = attributes[(gl_VertexIndex-gl_BaseVertex) + draw.vertexOffset];
+    VertexAttributes att = loadAttributes(draw, gl_VertexIndex-gl_BaseVertex);
     texCoord = vec2(att.normal_u.w, att.color_v.w);
     drawId = gl_InstanceIndex;
 
-    vec4 positionLocal = positions[(gl_VertexIndex-gl_BaseVertex) + draw.vertexOffset].pos;
+    vec4 positionLocal = loadPosition(draw, gl_VertexIndex-gl_BaseVertex);
     vec4 pos = transform.model * positionLocal;
 
     // use gl_BaseVertex to index into our light's viewProj array
@@ -12,9 +12,10 @@ void main() {
     Transform transform = transforms[draw.transformOffset];
     Scene scene = sceneData;
 
-    texCoord = vec2(attributes[gl_VertexIndex + draw.vertexOffset].normal_u.w, attributes[gl_VertexIndex + draw.vertexOffset].color_v.w);
+    VertexAttributes att = loadAttributes(draw, gl_VertexIndex);
+    texCoord = vec2(att.normal_u.w, att.color_v.w);
     drawId = gl_InstanceIndex;
 
-    vec4 positionLocal = positions[gl_VertexIndex + draw.vertexOffset].pos;
+    vec4 positionLocal = loadPosition(draw, gl_VertexIndex);
     gl_Position = scene.viewProj * transform.model * positionLocal;
 }
@@ -59,9 +59,10 @@ public:
             m_renderer.removeModel(entity.id, modelId);
         }
 
-        // update models with changed transform
-        std::vector<uint32>& dirtyModels = m_ecs->getDirtyEntityIds<TransformC>();
-        for(uint32 entityId : dirtyModels){
+        // update models with changed transform, once per entity
+        m_changedModels.clear();
+        m_transformTick = m_ecs->getChangedEntityIds<TransformC>(m_transformTick, m_changedModels);
+        for(uint32 entityId : m_changedModels){
             uint32 modelId = m_ecs->get<ModelC>(entityId);
             TransformInfo& transform = m_ecs->get<TransformC>(entityId);
             m_renderer.updateModel(entityId, modelId, transform);
@@ -69,18 +70,16 @@ public:
         }
 
         // lights
-        std::vector<Entity> lights;
-        m_ecs->getEntities<LightC>(lights);
-        for (Entity& entity : lights){
-            gfx::Light& light = m_ecs->get<LightC>(entity);
+        const std::vector<Entity>& lights = m_ecs->getEntities<LightC>();
+        for (const Entity& entity : lights){
+            gfx::Light& light = m_ecs->get<LightC>(entity.id);
             m_renderer.insertLight(entity.id, light);
         }
 
         // camera(s)
-        std::vector<Entity> cameras;
-        m_ecs->getEntities<CameraC>(cameras);
-        for (Entity& entity : cameras){
-            gfx::Camera& camera = m_ecs->get<CameraC>(entity);
+        const std::vector<Entity>& cameras = m_ecs->getEntities<CameraC>();
+        for (const Entity& entity : cameras){
+            gfx::Camera& camera = m_ecs->get<CameraC>(entity.id);
             m_renderer.updateCamera(camera);
         }
 
@@ -91,6 +90,9 @@ public:
     SprWindow* m_window;
     SprResourceManager* m_srm;
     SprRenderer m_renderer;
+
+    uint32 m_transformTick = 0;
+    std::vector<uint32> m_changedModels;
 };
 
 class InputSystem : public System {
@@ -105,9 +107,8 @@ public:
         InputManager& input = m_window->getInputManager();
 
         // camera
-        std::vector<Entity> cameras;
-        m_ecs->getEntities<CameraC>(cameras);
-        gfx::Camera& camera = m_ecs->get<CameraC>(cameras[0]);
+        const std::vector<Entity>& cameras = m_ecs->getEntities<CameraC>();
+        gfx::Camera& camera = m_ecs->get<CameraC>(cameras[0].id);
 
         if (input.isKeyDownEdge(SPR_TAB)){
             m_window->setRelativeMouse(!m_window->isRelativeMouse());
@@ -174,6 +175,12 @@ int main() {
 
     // assets
     SprResourceManager rm;
+#ifdef SPR_HOT_RELOAD
+    // before the renderer loads, so the loader keeps running
+    bool hotReload = rm.enableHotReload();
+    if (!hotReload)
+        SprLog::warn("[MAIN] hot reload unavailable");
+#endif
 
     // -- ecs --
     SprECS ecs;
@@ -194,6 +201,16 @@ int main() {
     ecs.createSystem(inputSystem);
     ecs.setRenderSystem(renderSystem);
 
+#ifdef SPR_HOT_RELOAD
+    // the renderer writes reloaded assets over what it uploaded
+    if (hotReload){
+        rm.setReloadCallback([&renderSystem](uint32 assetId){
+            renderSystem.m_renderer.reloadAsset(assetId);
+            SprLog::info("[MAIN] reloaded asset: ", assetId);
+        });
+    }
+#endif
+
     // timing
     auto start = std::chrono::high_resolution_clock::now();
     auto stop = std::chrono::high_resolution_clock::now();
@@ -340,6 +357,10 @@ int main() {
         // update ecs
         ecs.update(dt);
 
+        // nothing holds resource pointers between frames
+        rm.poll();
+        rm.releaseUnused();
+
         // timing
         stop = std::chrono::high_resolution_clock::now();
         auto printDur = (stop - printTime);
@@ -42,15 +42,24 @@ public:
         if (m_destroyed)
             return;
 
-        for (int i = 0 ; i < m_size; i++){
-            if (m_data + i)
-                (m_data + i)->~T();
-        }
+        destroyLive();
         free(m_data);
         m_data = nullptr;
     }
 
 private:
+    // removed slots were already destroyed, skip them
+    void destroyLive(){
+        std::vector<bool> live(m_capacity, true);
+        for (uint32 i = m_freeListIndex; i < m_capacity; i++){
+            live[m_freeList[i]] = false;
+        }
+        for (uint32 i = 0; i < m_capacity; i++){
+            if (live[i])
+                (m_data + i)->~T();
+        }
+    }
+
     void resize(){
         // allocate new memory
         uint32 newCapacity = m_capacity * 2;
@@ -147,10 +156,7 @@ public:
     }
 
     void destroy(){
-        for (int i = 0 ; i < m_size; i++){
-            if (m_data + i)
-                (m_data + i)->~T();
-        }
+        destroyLive();
         free(m_data);
         m_data = nullptr;
 
@@ -148,6 +148,25 @@ public:
         }
     }
 
+    // erase by moving the last element into index, O(1). meant for
+    // densely packed containers (not mixed with remove()'s free slots).
+    // returns the old index of the moved element, or -1 if none moved
+    int32 swapErase(uint32 index){
+        if (index >= m_data.size()){
+            return -1;
+        }
+
+        int32 last = m_data.size() - 1;
+        int32 moved = -1;
+        if ((int32)index != last){
+            m_data[index] = std::move(m_data[last]);
+            moved = last;
+        }
+        m_data.pop_back();
+
+        return moved;
+    }
+
     // append container to end of current
     void append(Container<T>& c2){
         int32 dataSize = m_data.size();
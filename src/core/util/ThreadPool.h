@@ -0,0 +1,184 @@
+#pragma once
+
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+#include "core/spruce_core.h"
+
+namespace spr {
+
+// work-stealing pool: each worker owns a deque, pushes/pops
+// its own tasks from the back, and steals from the front of
+// other workers' deques when it runs dry. threads outside the
+// pool submit to a shared queue and help out while waiting
+class ThreadPool {
+public:
+    ThreadPool(uint32 threadCount = 0){
+        if (threadCount == 0){
+            uint32 hardwareThreads = std::thread::hardware_concurrency();
+            threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+        }
+
+        // one queue per worker, plus one for external threads
+        for (uint32 i = 0; i < threadCount + 1; i++){
+            m_queues.push_back(std::make_unique<WorkQueue>());
+        }
+
+        for (uint32 i = 0; i < threadCount; i++){
+            m_threads.emplace_back(&ThreadPool::workerLoop, this, i);
+        }
+    }
+
+    ~ThreadPool(){
+        {
+            std::lock_guard<std::mutex> lock(m_sleepMutex);
+            m_stop = true;
+        }
+        m_wake.notify_all();
+
+        for (std::thread& thread : m_threads){
+            thread.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // queue a task, tasks may submit more tasks. if a group counter
+    // is given it's incremented now and decremented once the task ran
+    void submit(std::function<void()>&& task, std::atomic<uint32>* group = nullptr){
+        m_pending++;
+        if (group)
+            (*group)++;
+        {
+            WorkQueue& queue = *m_queues[getQueueIndex()];
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back({std::move(task), group});
+        }
+        m_queued++;
+
+        // lock so a worker can't miss the wake between check and wait
+        { std::lock_guard<std::mutex> lock(m_sleepMutex); }
+        m_wake.notify_one();
+    }
+
+    // run tasks on the calling thread until all submitted tasks are done
+    void wait(){
+        wait(m_pending);
+    }
+
+    // run tasks on the calling thread until the group's tasks are done,
+    // safe to call from within a task (unlike waiting on everything)
+    void wait(std::atomic<uint32>& group){
+        uint32 queueIndex = getQueueIndex();
+        while (group > 0){
+            if (tryRun(queueIndex))
+                continue;
+
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            m_wake.wait(lock, [this, &group]{ return group == 0 || m_queued > 0; });
+        }
+    }
+
+    uint32 getThreadCount(){
+        return m_threads.size();
+    }
+
+    // index of the calling worker in its pool, or -1 for external threads
+    static int32 getWorkerIndex(){
+        return t_workerIndex;
+    }
+
+private:
+    struct Task {
+        std::function<void()> function;
+        std::atomic<uint32>* group;
+    };
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::thread> m_threads;
+    std::vector<std::unique_ptr<WorkQueue>> m_queues;
+
+    std::atomic<uint32> m_pending = 0;
+    std::atomic<uint32> m_queued = 0;
+
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+    bool m_stop = false;
+
+    static inline thread_local ThreadPool* t_pool = nullptr;
+    static inline thread_local int32 t_workerIndex = -1;
+
+    uint32 getQueueIndex(){
+        if (t_pool == this)
+            return t_workerIndex;
+        return m_threads.size();
+    }
+
+    bool tryPop(uint32 queueIndex, bool back, Task& task){
+        WorkQueue& queue = *m_queues[queueIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty())
+            return false;
+
+        if (back){
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        m_queued--;
+        return true;
+    }
+
+    // run own work first (newest), otherwise steal (oldest)
+    bool tryRun(uint32 queueIndex){
+        Task task;
+        bool found = tryPop(queueIndex, true, task);
+
+        uint32 queueCount = m_queues.size();
+        for (uint32 i = 1; i < queueCount && !found; i++){
+            found = tryPop((queueIndex + i) % queueCount, false, task);
+        }
+
+        if (!found)
+            return false;
+
+        task.function();
+
+        // wake anyone waiting on the group or the whole pool
+        bool groupDone = task.group && --(*task.group) == 0;
+        if (--m_pending == 0 || groupDone){
+            { std::lock_guard<std::mutex> lock(m_sleepMutex); }
+            m_wake.notify_all();
+        }
+        return true;
+    }
+
+    void workerLoop(uint32 index){
+        t_pool = this;
+        t_workerIndex = index;
+
+        while (true){
+            if (tryRun(index))
+                continue;
+
+            std::unique_lock<std::mutex> lock(m_sleepMutex);
+            m_wake.wait(lock, [this]{ return m_stop || m_queued > 0; });
+            if (m_stop && m_queued == 0)
+                return;
+        }
+    }
+};
+
+}
@@ -14,6 +14,7 @@ EntityNode::EntityNode(uint32 height){
         m_nodeData = std::vector<EntityNode*>(16);
     } else {
         m_leafData = std::vector<Container<Entity>>(16);
+        m_leafIndices = std::vector<ska::flat_hash_map<uint32, uint32>>(16);
     }
     m_initialized = true;
     m_mask = 0;
@@ -95,10 +96,33 @@ void EntityNode::getAccum(uint64 key, std::vector<Entity>& out){
 }
 
 void EntityNode::addLeafData(uint32 key, Entity& entity){
-    m_leafData.at(key).add(entity);
+    // re-adding an entity (same mask) updates its entry in place
+    ska::flat_hash_map<uint32, uint32>& indices = m_leafIndices.at(key);
+    auto itr = indices.find(entity.id);
+    if (itr != indices.end()){
+        m_leafData.at(key).set(itr->second, entity);
+        return;
+    }
+
+    int32 index = m_leafData.at(key).add(entity);
+    indices[entity.id] = index;
 }
 void EntityNode::removeLeafData(uint32 key, Entity& entity){
-    m_leafData.at(key).eraseData(entity);
+    Container<Entity>& leaf = m_leafData.at(key);
+    ska::flat_hash_map<uint32, uint32>& indices = m_leafIndices.at(key);
+
+    auto itr = indices.find(entity.id);
+    if (itr == indices.end())
+        return;
+    uint32 index = itr->second;
+    if (!(leaf[index] == entity))
+        return;
+
+    // swap and pop, then point the moved entity at its new slot
+    int32 moved = leaf.swapErase(index);
+    if (moved >= 0)
+        indices[leaf[index].id] = index;
+    indices.erase(entity.id);
 }
 Container<Entity>& EntityNode::getLeafData(uint32 key){
     return m_leafData.at(key);
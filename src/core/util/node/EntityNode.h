@@ -3,6 +3,7 @@
 #include <vector>
 #include "../Container.h"
 #include "../../../ecs/Entity.h"
+#include "external/flat_hash_map/flat_hash_map.hpp"
 
 namespace spr {
 
@@ -25,6 +26,25 @@ public:
     //get_accum
     void getAccum(uint64 key, std::vector<Entity>& out);
 
+    // visit each non-empty leaf matching key, without copying
+    template <typename Func>
+    void forEachLeaf(uint64 key, Func&& func){
+        uint32 currIndex = subIndex(key, m_height);
+        for (uint32 i = 0; i < 16; i++){
+            if ((currIndex & i) != currIndex)
+                continue;
+
+            if (m_height > 0){
+                if (branchInitialized(i))
+                    getBranch(i)->forEachLeaf(key, func);
+            } else {
+                std::vector<Entity>& leaf = getLeafData(i).vector();
+                if (leaf.size() > 0)
+                    func(leaf);
+            }
+        }
+    }
+
     uint32 getHeight(){
         return m_height;
     }
@@ -34,6 +54,7 @@ private:
     uint32 m_mask;
     std::vector<EntityNode*> m_nodeData;
     std::vector<Container<Entity>> m_leafData;
+    std::vector<ska::flat_hash_map<uint32, uint32>> m_leafIndices;
     bool m_initialized;
 
     void addLeafData(uint32 key, Entity& entity);
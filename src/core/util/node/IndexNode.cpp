@@ -12,7 +12,7 @@ IndexNode::IndexNode(uint32 height){
     if (m_height > 0){
         m_nodeData = std::vector<IndexNode*>(16);
     } else {
-        m_leafData = std::vector<int32>(16);
+        m_leafData = std::vector<int32>(16, -1);
     }
 }
 
@@ -0,0 +1,197 @@
+#include "Archetype.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include "debug/SprLog.h"
+
+namespace spr {
+
+// ------------------------------------------------------------------------- //
+//    Archetype                                                              //
+// ------------------------------------------------------------------------- //
+Archetype::Archetype(uint64 mask, const uint32* elementSizes){
+    m_mask = mask;
+    m_size = 0;
+
+    // bytes per row, and worst case padding to keep columns 16B aligned
+    uint32 rowBytes = sizeof(uint32);
+    uint32 padding = 0;
+    for (uint32 i = 0; i < SPR_MAX_COMPONENTS; i++){
+        m_elementSizes[i] = hasComponent(i) ? elementSizes[i] : 0;
+        m_columnOffsets[i] = 0;
+        if (hasComponent(i)){
+            rowBytes += m_elementSizes[i];
+            padding += 16;
+        }
+    }
+
+    // fit as many rows as possible into a chunk, falling back
+    // to a single (oversized) row for very large components
+    m_chunkBytes = SPR_CHUNK_SIZE_BYTES;
+    m_capacity = (SPR_CHUNK_SIZE_BYTES - padding) / rowBytes;
+    if (m_capacity == 0){
+        m_capacity = 1;
+        m_chunkBytes = rowBytes + padding;
+    }
+
+    // place columns after the id array
+    uint32 offset = m_capacity * sizeof(uint32);
+    for (uint32 i = 0; i < SPR_MAX_COMPONENTS; i++){
+        if (!hasComponent(i))
+            continue;
+        offset = (offset + 15) & ~15u;
+        m_columnOffsets[i] = offset;
+        offset += m_capacity * m_elementSizes[i];
+    }
+    m_chunkBytes = (std::max(m_chunkBytes, offset) + 63) & ~63u;
+}
+
+Archetype::~Archetype(){
+    for (Chunk& chunk : m_chunks){
+        std::free(chunk.data);
+    }
+    m_chunks.clear();
+}
+
+void Archetype::addChunk(){
+    Chunk chunk;
+    chunk.data = (uint8*)std::aligned_alloc(64, m_chunkBytes);
+    chunk.count = 0;
+    m_chunks.push_back(chunk);
+}
+
+EntityLocation Archetype::addRow(uint32 entityId){
+    // rows are kept dense, so only the last chunk can have room
+    if (m_chunks.empty() || m_chunks.back().count == m_capacity)
+        addChunk();
+
+    uint32 chunkIndex = m_chunks.size() - 1;
+    Chunk& chunk = m_chunks.back();
+    uint32 row = chunk.count++;
+    ((uint32*)chunk.data)[row] = entityId;
+    m_size++;
+
+    return {this, chunkIndex, row};
+}
+
+int64 Archetype::removeRow(uint32 chunk, uint32 row){
+    uint32 lastChunk = m_chunks.size() - 1;
+    uint32 lastRow = m_chunks[lastChunk].count - 1;
+    int64 movedId = -1;
+
+    // swap last row into the hole
+    if (chunk != lastChunk || row != lastRow){
+        for (uint32 i = 0; i < SPR_MAX_COMPONENTS; i++){
+            if (!hasComponent(i))
+                continue;
+            memcpy(get(chunk, row, i), get(lastChunk, lastRow, i), m_elementSizes[i]);
+        }
+        movedId = getIds(lastChunk)[lastRow];
+        getIds(chunk)[row] = (uint32)movedId;
+    }
+
+    // pop
+    m_chunks[lastChunk].count--;
+    m_size--;
+    if (m_chunks[lastChunk].count == 0){
+        std::free(m_chunks[lastChunk].data);
+        m_chunks.pop_back();
+    }
+
+    return movedId;
+}
+
+
+// ------------------------------------------------------------------------- //
+//    ArchetypeStorage                                                       //
+// ------------------------------------------------------------------------- //
+ArchetypeStorage::ArchetypeStorage(){
+    for (uint32 i = 0; i < SPR_MAX_COMPONENTS; i++){
+        m_elementSizes[i] = 0;
+    }
+    m_locations = std::vector<EntityLocation>(512);
+}
+
+ArchetypeStorage::~ArchetypeStorage(){
+    for (Archetype* archetype : m_archetypes){
+        delete archetype;
+    }
+    m_archetypes.clear();
+    m_archetypeMap.clear();
+}
+
+void ArchetypeStorage::setElementSize(uint32 componentIndex, uint32 sizeBytes){
+    if (!m_archetypes.empty()){
+        SprLog::warn("[ArchetypeStorage] [setElementSize] components should be registered before entities are created");
+    }
+    m_elementSizes[componentIndex] = sizeBytes;
+}
+
+Archetype* ArchetypeStorage::getArchetype(uint64 mask){
+    if (m_archetypeMap.count(mask) > 0)
+        return m_archetypeMap[mask];
+
+    Archetype* archetype = new Archetype(mask, m_elementSizes);
+    m_archetypeMap[mask] = archetype;
+    m_archetypes.push_back(archetype);
+    return archetype;
+}
+
+void ArchetypeStorage::setLocation(uint32 entityId, EntityLocation location){
+    while (entityId >= m_locations.size()){
+        m_locations.resize(m_locations.size()*2);
+    }
+    m_locations[entityId] = location;
+}
+
+void ArchetypeStorage::removeLocation(EntityLocation& location){
+    int64 movedId = location.archetype->removeRow(location.chunk, location.row);
+    if (movedId >= 0){
+        m_locations[movedId].chunk = location.chunk;
+        m_locations[movedId].row = location.row;
+    }
+}
+
+void ArchetypeStorage::insert(Entity& entity){
+    Archetype* archetype = getArchetype(entity.components);
+    setLocation(entity.id, archetype->addRow(entity.id));
+}
+
+void ArchetypeStorage::remove(Entity& entity){
+    if (entity.id >= m_locations.size())
+        return;
+
+    EntityLocation location = m_locations[entity.id];
+    if (!location.archetype)
+        return;
+
+    removeLocation(location);
+    m_locations[entity.id] = EntityLocation();
+}
+
+void ArchetypeStorage::move(Entity& entity){
+    if (entity.id >= m_locations.size() || !m_locations[entity.id].archetype){
+        insert(entity);
+        return;
+    }
+
+    EntityLocation src = m_locations[entity.id];
+    if (src.archetype->getMask() == entity.components)
+        return;
+
+    Archetype* archetype = getArchetype(entity.components);
+    EntityLocation dst = archetype->addRow(entity.id);
+
+    // carry over shared components
+    uint64 shared = src.archetype->getMask() & entity.components;
+    for (uint32 i = 0; i < SPR_MAX_COMPONENTS; i++){
+        if (!((shared >> i) & 0b1))
+            continue;
+        memcpy(dst.archetype->get(dst.chunk, dst.row, i), src.archetype->get(src.chunk, src.row, i), m_elementSizes[i]);
+    }
+
+    removeLocation(src);
+    m_locations[entity.id] = dst;
+}
+
+}
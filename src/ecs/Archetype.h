@@ -0,0 +1,199 @@
+#pragma once
+
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#include "Entity.h"
+#include "external/flat_hash_map/flat_hash_map.hpp"
+
+namespace spr {
+
+typedef enum {
+    SPR_STORAGE_SPARSE,
+    SPR_STORAGE_ARCHETYPE
+} SprStorageType;
+
+static const uint32 SPR_CHUNK_SIZE_BYTES = 16384;
+// component type ids come from one process-wide counter (getComponentTypeId)
+// and index 64 bit masks, so at most this many types can be registered across
+// every ComponentManager. types past the cap are refused with a recoverable error
+static const uint32 SPR_MAX_COMPONENTS = 64;
+
+class Archetype;
+
+// where an entity's row lives in archetype storage
+struct EntityLocation {
+    Archetype* archetype = nullptr;
+    uint32 chunk = 0;
+    uint32 row = 0;
+};
+
+// fixed-size block of rows, laid out as one tightly
+// packed array per component (plus entity ids)
+struct Chunk {
+    uint8* data = nullptr;
+    uint32 count = 0;
+};
+
+// ╔═ CHUNK (16KB) ════════════════════╗<─ data
+// ║    uint32 ids[capacity]           ║
+// ╠═══════════════════════════════════╣<─ columnOffset[a]
+// ║    A[capacity]                    ║
+// ╠═══════════════════════════════════╣<─ columnOffset[b]
+// ║    B[capacity]                    ║
+// ║                .                  ║
+// ╚═══════════════════════════════════╝
+
+class Archetype {
+public:
+    Archetype(uint64 mask, const uint32* elementSizes);
+    ~Archetype();
+
+    uint64 getMask(){
+        return m_mask;
+    }
+
+    // rows per chunk
+    uint32 getCapacity(){
+        return m_capacity;
+    }
+
+    uint32 getChunkCount(){
+        return m_chunks.size();
+    }
+
+    uint32 getRowCount(uint32 chunk){
+        return m_chunks[chunk].count;
+    }
+
+    uint32 size(){
+        return m_size;
+    }
+
+    bool hasComponent(uint32 componentIndex){
+        return (m_mask >> componentIndex) & 0b1;
+    }
+
+    // start of a component's array within a chunk
+    uint8* getColumn(uint32 chunk, uint32 componentIndex){
+        return m_chunks[chunk].data + m_columnOffsets[componentIndex];
+    }
+
+    uint32* getIds(uint32 chunk){
+        return (uint32*)m_chunks[chunk].data;
+    }
+
+    uint8* get(uint32 chunk, uint32 row, uint32 componentIndex){
+        return getColumn(chunk, componentIndex) + row * m_elementSizes[componentIndex];
+    }
+
+    // append a row for entity, component data left uninitialized
+    EntityLocation addRow(uint32 entityId);
+
+    // swap last row into (chunk, row), returns id of the
+    // moved entity or -1 if no entity was moved
+    int64 removeRow(uint32 chunk, uint32 row);
+
+    // append rows for many entities, func(location, first, rows) is
+    // called per chunk filled so data can be copied a column at a time
+    template <typename Func>
+    void addRows(const uint32* ids, uint32 count, Func&& func){
+        uint32 done = 0;
+        while (done < count){
+            if (m_chunks.empty() || m_chunks.back().count == m_capacity)
+                addChunk();
+
+            uint32 chunkIndex = m_chunks.size() - 1;
+            Chunk& chunk = m_chunks.back();
+            uint32 rows = std::min(m_capacity - chunk.count, count - done);
+            memcpy(getIds(chunkIndex) + chunk.count, ids + done, rows * sizeof(uint32));
+
+            EntityLocation location = {this, chunkIndex, chunk.count};
+            chunk.count += rows;
+            m_size += rows;
+            func(location, done, rows);
+            done += rows;
+        }
+    }
+
+private:
+    uint64 m_mask;
+    uint32 m_capacity;
+    uint32 m_chunkBytes;
+    uint32 m_size;
+    uint32 m_columnOffsets[SPR_MAX_COMPONENTS];
+    uint32 m_elementSizes[SPR_MAX_COMPONENTS];
+    std::vector<Chunk> m_chunks;
+
+    void addChunk();
+};
+
+
+class ArchetypeStorage {
+public:
+    ArchetypeStorage();
+    ~ArchetypeStorage();
+
+    // register size of a component's data type
+    void setElementSize(uint32 componentIndex, uint32 sizeBytes);
+
+    // allocate a row in the archetype matching entity's mask
+    void insert(Entity& entity);
+
+    // allocate rows for many entities sharing a mask, see Archetype::addRows
+    template <typename Func>
+    void insert(uint64 mask, const uint32* ids, uint32 count, Func&& func){
+        Archetype* archetype = getArchetype(mask);
+        archetype->addRows(ids, count, [&](EntityLocation location, uint32 first, uint32 rows){
+            for (uint32 i = 0; i < rows; i++){
+                setLocation(ids[first + i], {archetype, location.chunk, location.row + i});
+            }
+            func(location, first, rows);
+        });
+    }
+
+    // free entity's row
+    void remove(Entity& entity);
+
+    // move entity into archetype matching its (updated) mask,
+    // carrying over the data of components present in both
+    void move(Entity& entity);
+
+    // get entity's data for component
+    uint8* get(uint32 entityId, uint32 componentIndex){
+        EntityLocation& location = m_locations[entityId];
+        return location.archetype->get(location.chunk, location.row, componentIndex);
+    }
+
+    // visit every non-empty chunk of archetypes containing mask
+    template <typename Func>
+    void forEachChunk(uint64 mask, Func&& func){
+        for (Archetype* archetype : m_archetypes){
+            if ((archetype->getMask() & mask) != mask)
+                continue;
+
+            for (uint32 chunk = 0; chunk < archetype->getChunkCount(); chunk++){
+                if (archetype->getRowCount(chunk) > 0)
+                    func(*archetype, chunk);
+            }
+        }
+    }
+
+    std::vector<Archetype*>& getArchetypes(){
+        return m_archetypes;
+    }
+
+private:
+    uint32 m_elementSizes[SPR_MAX_COMPONENTS];
+    ska::flat_hash_map<uint64, Archetype*> m_archetypeMap;
+    std::vector<Archetype*> m_archetypes;
+
+    // entity id -> row
+    std::vector<EntityLocation> m_locations;
+
+    Archetype* getArchetype(uint64 mask);
+    void setLocation(uint32 entityId, EntityLocation location);
+    void removeLocation(EntityLocation& location);
+};
+
+}
@@ -0,0 +1,13 @@
+#include "CommandBuffer.h"
+#include "SprECS.h"
+
+namespace spr {
+
+void CommandBuffer::destroyEntity(Entity entity){
+    push([entity](SprECS& ecs){
+        Entity target = entity;
+        ecs.destroyEntity(target);
+    });
+}
+
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <tuple>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <unordered_map>
+#include "Entity.h"
+
+namespace spr {
+
+class SprECS;
+
+// ordering of recorded commands: (system index + 1) in the high half,
+// (parallel range index + 1) in the low half. commands recorded
+// outside of systems (e.g. main loop) sort after everything else
+class CommandSortKey {
+public:
+    static const uint64 EXTERNAL = UINT64_MAX;
+
+    static uint64 get(){
+        return t_key;
+    }
+
+    // returns previous key, so callers can restore it
+    static uint64 set(uint64 key){
+        uint64 previous = t_key;
+        t_key = key;
+        return previous;
+    }
+
+    static uint64 system(uint32 systemIndex){
+        return ((uint64)systemIndex + 1) << 32;
+    }
+
+    static uint64 range(uint64 key, uint32 rangeIndex){
+        return (key & 0xffffffff00000000) | ((uint64)rangeIndex + 1);
+    }
+
+private:
+    static inline thread_local uint64 t_key = EXTERNAL;
+};
+
+
+// structural changes recorded by one thread, applied at the
+// start of the next SprECS::update. recording never locks
+class CommandBuffer {
+public:
+    CommandBuffer() {}
+    ~CommandBuffer() {}
+
+    // create entity with given component data
+    //   cmd.createEntity<TransformC, ModelC>(transform, modelId);
+    template <typename... Ts>
+    void createEntity(typename Ts::DataType... data){
+        push([values = std::make_tuple(data...)](auto& ecs){
+            std::apply([&ecs](auto&... value){
+                ecs.createEntity(ecs.template add<Ts>(value)...);
+            }, values);
+        });
+    }
+
+    void destroyEntity(Entity entity);
+
+    template <typename T>
+    void add(Entity entity, typename T::DataType data){
+        push([entity, data](auto& ecs){
+            Entity target = entity;
+            ecs.template add<T>(target, data);
+        });
+    }
+
+    template <typename T>
+    void remove(Entity entity){
+        push([entity](auto& ecs){
+            Entity target = entity;
+            ecs.template remove<T>(target);
+        });
+    }
+
+    // any other deferred call
+    void push(std::function<void(SprECS&)>&& function){
+        m_commands.push_back({CommandSortKey::get(), m_sequence++, std::move(function)});
+    }
+
+    uint32 size(){
+        return m_commands.size();
+    }
+
+private:
+    struct Command {
+        uint64 sortKey;
+        uint32 sequence;
+        std::function<void(SprECS&)> function;
+    };
+
+    std::vector<Command> m_commands;
+    uint32 m_sequence = 0;
+
+    friend class CommandQueue;
+};
+
+
+// one CommandBuffer per recording thread, merged deterministically
+class CommandQueue {
+public:
+    CommandQueue(){
+        m_serial = s_serial++;
+    }
+
+    ~CommandQueue() {}
+
+    // calling thread's buffer, registered on first use
+    CommandBuffer& get(){
+        if (t_cache.serial == m_serial)
+            return *t_cache.buffer;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        CommandBuffer*& buffer = m_threadBuffers[std::this_thread::get_id()];
+        if (!buffer){
+            m_buffers.push_back(std::make_unique<CommandBuffer>());
+            buffer = m_buffers.back().get();
+        }
+        t_cache = {m_serial, buffer};
+        return *buffer;
+    }
+
+    // apply all recorded commands ordered by (sort key, buffer, sequence).
+    // must not run concurrently with recording threads
+    void flush(SprECS& ecs){
+        // take commands first, commands may record new ones (next flush)
+        m_pending.clear();
+        m_order.clear();
+        for (uint32 i = 0; i < m_buffers.size(); i++){
+            CommandBuffer& buffer = *m_buffers[i];
+            for (CommandBuffer::Command& command : buffer.m_commands){
+                m_order.push_back({command.sortKey, i, command.sequence, (uint32)m_pending.size()});
+                m_pending.push_back(std::move(command.function));
+            }
+            buffer.m_commands.clear();
+            buffer.m_sequence = 0;
+        }
+        if (m_pending.size() == 0)
+            return;
+
+        std::sort(m_order.begin(), m_order.end(), [](const Order& a, const Order& b){
+            if (a.sortKey != b.sortKey)
+                return a.sortKey < b.sortKey;
+            if (a.buffer != b.buffer)
+                return a.buffer < b.buffer;
+            return a.sequence < b.sequence;
+        });
+
+        for (Order& order : m_order){
+            m_pending[order.command](ecs);
+        }
+        m_pending.clear();
+    }
+
+private:
+    struct Order {
+        uint64 sortKey;
+        uint32 buffer;
+        uint32 sequence;
+        uint32 command;
+    };
+
+    struct ThreadCache {
+        uint32 serial;
+        CommandBuffer* buffer;
+    };
+
+    uint32 m_serial;
+    std::mutex m_mutex;
+    std::vector<std::unique_ptr<CommandBuffer>> m_buffers;
+    std::unordered_map<std::thread::id, CommandBuffer*> m_threadBuffers;
+
+    std::vector<std::function<void(SprECS&)>> m_pending;
+    std::vector<Order> m_order;
+
+    static inline thread_local ThreadCache t_cache = {0, nullptr};
+    static inline std::atomic<uint32> s_serial = 1;
+};
+
+}
@@ -3,9 +3,37 @@
 #include "Registry.h"
 #include "../core/util/Container.h"
 #include <vector>
+#include <atomic>
+#include <cstring>
+#include <typeinfo>
+#include <algorithm>
+#include <type_traits>
 
 namespace spr {
 
+// change log entries older than this (in ticks) may be dropped
+static const uint32 SPR_CHANGE_LOG_TICKS = 256;
+
+// change ticks shared by a ComponentManager's components. writes are
+// stamped with tick, which advances every frame and whenever a consumer
+// reads changes, so "changed since" never misses or repeats a write
+typedef struct {
+    std::atomic<uint32> tick;
+    uint32 frameTick;       // changes after this happened this frame
+} ChangeClock;
+
+typedef struct {
+    uint32 id;
+    uint32 tick;
+} Change;
+
+// a tracked component's change state
+typedef struct {
+    std::vector<uint32> ticks;      // id -> last change tick
+    std::vector<Change> changes;    // change log, in tick order
+    uint32 logStart;                // log holds every change after this tick
+} ChangeLog;
+
 class Component {
 public:
     // get entity's component data
@@ -24,12 +52,80 @@ public:
     virtual void removeEntity(Entity& entity) = 0;
 
     virtual void update() = 0;
+
+    // forget entity's last change
+    virtual void clean(uint32 id) = 0;
+
+    // size of data for bulk copies (snapshots), 0 if not trivially copyable
+    virtual uint32 getElementSize() = 0;
+
+    // copy data of entities ids[0..count) into out, packed
+    virtual void readData(const uint32* ids, uint32 count, uint8* out) = 0;
+
+    // add entities ids[0..count) with packed data
+    virtual void appendData(const uint32* ids, const uint8* data, uint32 count) = 0;
+
+    // change tracking state, nullptr if not tracked
+    virtual ChangeLog* getChangeLog() = 0;
 };
 
 
+// ------------------------------------------------------------------------- //
+//    Component Type Ids                                                     //
+// ------------------------------------------------------------------------- //
+// each component type is assigned the next id on first use, which is
+// cached in a function-local static (no hashing or rtti afterwards)
+inline uint32 nextComponentTypeId(){
+    static std::atomic<uint32> counter = 0;
+    return counter++;
+}
+
+template <typename T>
+inline uint32 getComponentTypeId(){
+    // createEntity passes component pointers, T* shares T's id
+    if constexpr (std::is_pointer_v<T>){
+        return getComponentTypeId<std::remove_pointer_t<T>>();
+    } else {
+        static const uint32 id = nextComponentTypeId();
+        return id;
+    }
+}
+
+// stable (within a build) identifier of a component type, used
+// to match components up when loading snapshots
+template <typename T>
+inline uint64 getComponentTypeHash(){
+    static const uint64 hash = []{
+        uint64 value = 14695981039346656037ull;
+        for (const char* c = typeid(T).name(); *c; c++){
+            value ^= (uint8)*c;
+            value *= 1099511628211ull;
+        }
+        return value;
+    }();
+    return hash;
+}
+
+// bit of a component type in masks, 0 for ids past the cap (64)
+template <typename T>
+inline uint64 getComponentTypeBit(){
+    uint32 id = getComponentTypeId<T>();
+    return id < 64 ? 1ULL << id : 0;
+}
+
+// bit mask for a set of component types, folded once per set
+template <typename... Args>
+inline uint64 getComponentTypeMask(){
+    static const uint64 mask = (0ULL | ... | getComponentTypeBit<Args>());
+    return mask;
+}
+
+
 template <typename T>
 class TypedComponent : public Component{
 public:
+    typedef T DataType;
+
     TypedComponent() : m_container(512), m_reg(512){}
 
     ~TypedComponent(){}
@@ -53,6 +149,12 @@ public:
 
     // add a new piece of data to container
     void add(T data){
+        // archetype storage copies staged data into
+        // the entity's chunk once it's registered
+        if (m_archetypeStorage){
+            m_staged = data;
+            return;
+        }
         m_container.add(data);
     }
 
@@ -60,75 +162,170 @@ public:
     void addEntity(Entity& entity){
         m_reg.addItem(entity.id, m_container.lastWriteIndex);
 
+        if (m_ids.size() < m_container.getSize())
+            m_ids.resize(m_container.getSize());
+        m_ids[m_container.lastWriteIndex] = entity.id;
+
         // if (m_trackDirty)
         //     dirty(entity.id);
     }
 
     // remove entity from registry
     void removeEntity(Entity& entity){
-        // free container slot
-        m_container.erase(m_reg.getIndex(entity.id));
+        int32 index = m_reg.getIndex(entity.id);
+        if (index < 0)
+            return;
+
+        // swap last entity's data into the freed slot
+        int32 moved = m_container.swapErase(index);
+        if (moved >= 0){
+            uint32 movedId = m_ids[moved];
+            m_ids[index] = movedId;
+            m_reg.addItem(movedId, index);
+        }
+        m_ids.resize(m_container.getSize());
+        m_reg.removeItem(entity.id);
+        clean(entity.id);
     }
 
     uint32 size(){
         return m_reg.size();
     }
 
+    uint32 getElementSize(){
+        if constexpr (std::is_trivially_copyable_v<T>)
+            return sizeof(T);
+        return 0;
+    }
+
+    void readData(const uint32* ids, uint32 count, uint8* out){
+        if constexpr (std::is_trivially_copyable_v<T>){
+            for (uint32 i = 0; i < count; i++){
+                memcpy(out + i * sizeof(T), &get(ids[i]), sizeof(T));
+            }
+        }
+    }
+
+    void appendData(const uint32* ids, const uint8* data, uint32 count){
+        if (count == 0)
+            return;
+        if constexpr (std::is_trivially_copyable_v<T>){
+            std::vector<T>& container = m_container.vector();
+            uint32 start = container.size();
+            container.resize(start + count);
+            memcpy(container.data() + start, data, count * sizeof(T));
+
+            // only the registry needs per entity fixups
+            m_ids.resize(start + count);
+            memcpy(m_ids.data() + start, ids, count * sizeof(uint32));
+            for (uint32 i = 0; i < count; i++){
+                m_reg.addItem(ids[i], start + i);
+            }
+        }
+    }
+
+    ChangeLog* getChangeLog(){
+        return m_trackDirty ? &m_changeLog : nullptr;
+    }
+
+    // tick id's data last changed at, 0 if never (or cleaned)
+    uint32 getChangeTick(uint32 id){
+        if (!m_trackDirty || id >= m_changeLog.ticks.size())
+            return 0;
+        return m_changeLog.ticks[id];
+    }
+
+    // changed during the current frame
     bool isDirty(uint32 id){
         if (!m_trackDirty)
             return false;
+        return getChangeTick(id) > m_clock->frameTick;
+    }
 
-        while (id / 64 >= m_dirty.size()){
-            m_dirty.push_back(0);
+    // ids changed after sinceTick, each id once (latest change)
+    void getChangedIds(uint32 sinceTick, std::vector<uint32>& out){
+        if (!m_trackDirty)
+            return;
+
+        // older than the log, scan every id instead
+        if (sinceTick < m_changeLog.logStart){
+            for (uint32 id = 0; id < m_changeLog.ticks.size(); id++){
+                if (m_changeLog.ticks[id] > sinceTick)
+                    out.push_back(id);
+            }
+            return;
         }
 
-        uint64 dirtyMask = m_dirty[id / 64];
-        if (!dirtyMask)
-            return false;
-        return dirtyMask & (1LL << (id % 64));
+        auto first = std::upper_bound(m_changeLog.changes.begin(), m_changeLog.changes.end(), sinceTick,
+            [](uint32 tick, const Change& change){ return tick < change.tick; });
+        for (auto it = first; it != m_changeLog.changes.end(); it++){
+            // skip entries superseded by a later change
+            if (m_changeLog.ticks[it->id] == it->tick)
+                out.push_back(it->id);
+        }
     }
 
     std::vector<uint32>& getDirtyIds(){
+        m_dirtyIds.clear();
+        if (m_trackDirty)
+            getChangedIds(m_clock->frameTick, m_dirtyIds);
         return m_dirtyIds;
     }
 
+    // nothing to clear per frame, only drop log entries too old to be
+    // asked for (older requests fall back to a scan)
     void update(){
-        if (!m_trackDirty)
+        if (!m_trackDirty || m_changeLog.changes.size() == 0)
             return;
 
-        std::fill(m_dirty.begin(), m_dirty.end(), 0);
-        m_dirtyIds.clear();
+        uint32 tick = m_clock->tick;
+        if (tick <= SPR_CHANGE_LOG_TICKS)
+            return;
+
+        uint32 logStart = tick - SPR_CHANGE_LOG_TICKS;
+        auto keep = std::upper_bound(m_changeLog.changes.begin(), m_changeLog.changes.end(), logStart,
+            [](uint32 tick, const Change& change){ return tick < change.tick; });
+
+        // erase in bulk once at least half the log is stale
+        if ((uint32)(keep - m_changeLog.changes.begin()) * 2 >= m_changeLog.changes.size()){
+            m_changeLog.changes.erase(m_changeLog.changes.begin(), keep);
+            m_changeLog.logStart = logStart;
+        }
     }
 
     void clean(uint32 id){
-        if (!m_trackDirty)
+        if (!m_trackDirty || id >= m_changeLog.ticks.size())
             return;
 
-        while (id / 64 >= m_dirty.size()){
-            m_dirty.push_back(0);
-        }
-
-        m_dirty[id / 64] &= ~(1LL << (id % 64));
+        m_changeLog.ticks[id] = 0;
     }
 
     void dirty(uint32 id){
         if (!m_trackDirty)
             return;
 
-        while (id / 64 >= m_dirty.size()){
-            m_dirty.push_back(0);
-        }
+        if (id >= m_changeLog.ticks.size())
+            m_changeLog.ticks.resize(std::max((uint32)m_changeLog.ticks.size() * 2, id + 1), 0);
 
-        m_dirty[id / 64] |= (1LL << (id % 64));
+        // already logged this tick
+        uint32 tick = m_clock->tick;
+        if (m_changeLog.ticks[id] == tick)
+            return;
 
-        m_dirtyIds.push_back(id);
+        m_changeLog.ticks[id] = tick;
+        m_changeLog.changes.push_back({id, tick});
     }
     
 private:
-    void trackDirty(){
+    void trackDirty(ChangeClock* clock){
         m_trackDirty = true;
-        m_dirty = std::vector<uint64>(16);
-        m_dirtyIds.reserve(64);
+        m_clock = clock;
+        m_changeLog.ticks = std::vector<uint32>(1024, 0);
+        m_changeLog.changes.reserve(64);
+    }
+
+    void useArchetypeStorage(){
+        m_archetypeStorage = true;
     }
     friend class ComponentManager;
 
@@ -136,12 +333,20 @@ private:
     // per entity data
     Container<T> m_container;
 
+    // container index -> entity id
+    std::vector<uint32> m_ids;
+
+    // data waiting to be placed in archetype storage
+    bool m_archetypeStorage = false;
+    T m_staged;
+
     // entity -> index map
     Registry m_reg;
 
-    // dirty flags for new/edited components
+    // change tracking for new/edited components
     bool m_trackDirty = false;
-    std::vector<uint64> m_dirty;
+    ChangeClock* m_clock = nullptr;
+    ChangeLog m_changeLog = {{}, {}, 0};
     std::vector<uint32> m_dirtyIds;
 };
 
@@ -2,9 +2,15 @@
 
 namespace spr{
 
-ComponentManager::ComponentManager(){
-    m_componentIndex = 0;
+ComponentManager::ComponentManager(SprStorageType storageType){
+    m_components = std::vector<Component*>(SPR_MAX_COMPONENTS, nullptr);
+    m_typeHashes = std::vector<uint64>(SPR_MAX_COMPONENTS, 0);
+    m_componentMask = 0;
     m_trackingMask = 0;
+    m_storageType = storageType;
+    m_archetypeMask = 0;
+    m_clock.tick = 1;
+    m_clock.frameTick = 0;
 }
 
 uint64 ComponentManager::getMask(std::vector<Component*> components){
@@ -15,7 +21,7 @@ uint64 ComponentManager::getMask(std::vector<Component*> components){
         int32 j = 0;
         for (j = 0; j < m_components.size(); j++){
             // if components match, break
-            if (typeid(components.at(i)) == typeid(m_components.at(j)))
+            if (components.at(i) == m_components.at(j))
                 break;
             
         }
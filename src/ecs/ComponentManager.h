@@ -1,74 +1,114 @@
 #pragma once
 
 #include <algorithm> 
+#include <cassert>
+#include <cstring>
 #include <vector>
-#include <typeindex>
 #include <typeinfo>
-#include <unordered_map>
+#include <type_traits>
 #include "Component.h"
-
-
-typedef std::unordered_map<std::type_index, uint32> tmap;
+#include "Archetype.h"
+#include "debug/SprLog.h"
 
 namespace spr {
 class ComponentManager{
 public:
-    ComponentManager();
+    ComponentManager(SprStorageType storageType = SPR_STORAGE_SPARSE);
     ~ComponentManager() {}
 
     void update(){
-        for (uint32 i = 0; i < m_componentIndex; i++)
-            (m_components.at(i))->update();
+        for (uint32 i = 0; i < SPR_MAX_COMPONENTS; i++){
+            if ((m_componentMask >> i) & 0b1)
+                m_components[i]->update();
+        }
         
         for (Entity& entity : m_entitiesUnregister)
             unregisterEntityImmediate(entity);
         
         if (m_entitiesUnregister.size() > 0)
             m_entitiesUnregister.clear();
+
+        // later changes belong to the next frame
+        m_clock.frameTick = m_clock.tick++;
+    }
+
+    // tick to start consuming changes from, anything
+    // changed after this call is newer
+    uint32 getChangeTick(){
+        return m_clock.tick++;
+    }
+
+    // ids whose T changed after sinceTick, each once. returns the tick
+    // to pass next time, later changes get a newer tick
+    template <typename T>
+    uint32 getChangedEntityIds(uint32 sinceTick, std::vector<uint32>& out){
+        uint32 index = getComponentIndex<T>();
+        T* comp = static_cast<T*>(m_components[index]);
+
+        comp->getChangedIds(sinceTick, out);
+        return m_clock.tick++;
     }
 
     // add a component
     template <typename T>
     void addComponent(Component& component, bool enableDirtyFlagTracking = false){
-        m_components.push_back(&component);
-        m_typeMap[typeid(T)] = m_componentIndex;
-        m_typeMap[typeid(T*)] = m_componentIndex;
+        uint32 index = getComponentTypeId<T>();
+        if (index >= SPR_MAX_COMPONENTS){
+            SprLog::error("[ComponentManager] [addComponent] more than SPR_MAX_COMPONENTS component types, not added: " + std::string(typeid(T).name()), false);
+            return;
+        }
+        m_components[index] = &component;
+        m_componentMask |= 1LL << index;
+        m_typeHashes[index] = getComponentTypeHash<T>();
 
         if (enableDirtyFlagTracking){
-            T* comp = ((T*) dynamic_cast<T*>(m_components.at(m_componentIndex)));
-            comp->trackDirty();
-            m_trackingMask |= 1LL << m_componentIndex;
+            T* comp = static_cast<T*>(m_components[index]);
+            comp->trackDirty(&m_clock);
+            m_trackingMask |= 1LL << index;
         }
 
-        m_componentIndex++;
+        // only trivially copyable data can live in chunks,
+        // anything else stays in the component's container
+        if (m_storageType == SPR_STORAGE_ARCHETYPE){
+            typedef typename T::DataType DataType;
+            if constexpr (std::is_trivially_copyable_v<DataType>){
+                T* comp = static_cast<T*>(m_components[index]);
+                comp->useArchetypeStorage();
+                m_archetypes.setElementSize(index, sizeof(DataType));
+                m_archetypeMask |= 1LL << index;
+            } else {
+                SprLog::warn("[ComponentManager] [addComponent] data not trivially copyable, using sparse storage: " + std::string(typeid(T).name()));
+            }
+        }
     }
 
+    // component type ids are static, shared by all managers. only
+    // types addComponent accepted (ids below the cap) can be indexed
     template <typename T>
     uint32 getComponentIndex(){
-        uint32 index = m_typeMap[typeid(T)];
+        uint32 index = getComponentTypeId<T>();
+        assert(index < SPR_MAX_COMPONENTS && "component type past SPR_MAX_COMPONENTS");
         return index;
     }
 
     // get component object
     template <typename T>
     T* getComponent(){
-        uint32 index = m_typeMap[typeid(T)];
-        T* comp = ((T*) dynamic_cast<T*>(m_components.at(index)));
-        return comp;
+        return static_cast<T*>(m_components[getComponentIndex<T>()]);
     }
 
     // get entity data for component T
     template <typename T>
     auto& getEntityComponent(Entity& entity){
-        uint32 index = m_typeMap[typeid(T)];
-        T* comp = ((T*) dynamic_cast<T*>(m_components.at(index)));
-        return comp->get(entity);
+        return getEntityComponent<T>(entity.id);
     }
 
     template <typename T>
     auto& getEntityComponent(uint32 entityId){
-        uint32 index = m_typeMap[typeid(T)];
-        T* comp = ((T*) dynamic_cast<T*>(m_components.at(index)));
+        uint32 index = getComponentIndex<T>();
+        T* comp = static_cast<T*>(m_components[index]);
+        if (isArchetypeStored(1LL << index))
+            return *((typename T::DataType*) m_archetypes.get(entityId, index));
         return comp->get(entityId);
     }
 
@@ -76,7 +116,12 @@ public:
     template <typename T>
     void setEntityComponent(Entity& entity, auto data){
         uint32 index = getComponentIndex<T>();
-        T* comp = ((T*) dynamic_cast<T*>(m_components.at(index)));
+        T* comp = static_cast<T*>(m_components[index]);
+        if (isArchetypeStored(1LL << index)){
+            *((typename T::DataType*) m_archetypes.get(entity.id, index)) = data;
+            comp->dirty(entity.id);
+            return;
+        }
         comp->set(entity, data);
     }
 
@@ -84,7 +129,7 @@ public:
     template <typename T>
     T* addComponentData(auto data){
         uint32 index = getComponentIndex<T>();
-        T* comp = ((T*) dynamic_cast<T*>(m_components.at(index)));
+        T* comp = static_cast<T*>(m_components[index]);
         comp->add(data);
         return comp;
     }
@@ -94,33 +139,39 @@ public:
     void addComponentEntityData(Entity& entity, auto data){
         uint32 index = getComponentIndex<T>();
         // update components
-        T* comp = ((T*) dynamic_cast<T*>(m_components.at(index)));
+        T* comp = static_cast<T*>(m_components[index]);
         comp->add(data);
-        comp->addEntity(entity);
+
+        // entity's mask changed, so it moves to a new archetype
+        if (m_storageType == SPR_STORAGE_ARCHETYPE)
+            m_archetypes.move(entity);
+
+        if (isArchetypeStored(1LL << index))
+            *((typename T::DataType*) m_archetypes.get(entity.id, index)) = comp->m_staged;
+        else
+            comp->addEntity(entity);
     }
 
     // remove component T associated with entity
     template <typename T>
     void removeComponentEntity(Entity& entity){
         uint32 index = getComponentIndex<T>();
-        T* comp = ((T*) dynamic_cast<T*>(m_components.at(index)));
-        comp->removeEntity(entity);
+        T* comp = static_cast<T*>(m_components[index]);
+
+        if (m_storageType == SPR_STORAGE_ARCHETYPE)
+            m_archetypes.move(entity);
+
+        if (!isArchetypeStored(1LL << index))
+            comp->removeEntity(entity);
+        else
+            comp->clean(entity.id);
     }
     
 
     // get bit mask for arg components
     template <typename Arg, typename ...Args>
     uint64 getMask(){
-        uint64 mask = 0L;
-        uint32 index = getComponentIndex<Arg>();
-        
-        mask |= 1LL << index;
-        
-        if constexpr (sizeof...(Args) > 0){
-            return (mask | getMask<Args...>());
-        } else {
-            return mask | getMask();
-        }
+        return getComponentTypeMask<Arg, Args...>();
     }
 
      // get bit mask for arg components
@@ -135,14 +186,32 @@ public:
         return m_trackingMask;
     }
 
+    // check if all components in mask live in archetype chunks
+    bool isArchetypeStored(uint64 mask){
+        return mask && ((m_archetypeMask & mask) == mask);
+    }
+
+    // visit every chunk holding components Arg, Args..., passing
+    // the row count, entity ids, and each component's array
+    template <typename Arg, typename ...Args>
+    void forEachChunk(auto&& func){
+        uint64 mask = getMask<Arg, Args...>();
+        m_archetypes.forEachChunk(mask, [&](Archetype& archetype, uint32 chunk){
+            func(archetype.getRowCount(chunk),
+                 archetype.getIds(chunk),
+                 (typename Arg::DataType*) archetype.getColumn(chunk, getComponentIndex<Arg>()),
+                 ((typename Args::DataType*) archetype.getColumn(chunk, getComponentIndex<Args>()))...);
+        });
+    }
+
     // filter entities for those with a set dirty flag on given component
     template <typename T>
     void getDirtyEntities(std::vector<Entity>& in, std::vector<Entity>& out){
-        uint32 index = m_typeMap[typeid(T)];
-        T* comp = ((T*) dynamic_cast<T*>(m_components.at(index)));
+        uint32 index = getComponentIndex<T>();
+        T* comp = static_cast<T*>(m_components[index]);
 
         for (Entity& entity : in){
-            if (!comp->isDirty(entity.id))
+            if (comp->isDirty(entity.id))
                 out.push_back(entity);
         }
     }
@@ -150,8 +219,8 @@ public:
     // filter entities for those with a set dirty flag on given component
     template <typename T>
     std::vector<uint32>& getDirtyEntityIds(){
-        uint32 index = m_typeMap[typeid(T)];
-        T* comp = ((T*) dynamic_cast<T*>(m_components.at(index)));
+        uint32 index = getComponentIndex<T>();
+        T* comp = static_cast<T*>(m_components[index]);
 
         return comp->getDirtyIds();
     }
@@ -159,8 +228,8 @@ public:
     // check if an entity's component is dirty
     template <typename T>
     bool isDirty(Entity& entity){
-        uint32 index = m_typeMap[typeid(T)];
-        T* comp = ((T*) dynamic_cast<T*>(m_components.at(index)));
+        uint32 index = getComponentIndex<T>();
+        T* comp = static_cast<T*>(m_components[index]);
 
         if (comp->isDirty(entity.id))
             return true;
@@ -171,6 +240,9 @@ public:
     // register entity with set of components
     template<typename T, typename... Args>
     void registerEntity(Entity& entity, T* component, Args... args){
+        if (m_storageType == SPR_STORAGE_ARCHETYPE)
+            m_archetypes.insert(entity);
+
         registerEntityRecursive(entity, component, args...);
     }
 
@@ -180,16 +252,33 @@ public:
 
 
 private:
+    // indexed by component type id
     std::vector<Component*> m_components;
-    tmap m_typeMap;
-    uint32 m_componentIndex;
+    std::vector<uint64> m_typeHashes;
+    uint64 m_componentMask;
     uint64 m_trackingMask;
 
+    // chunked storage for trivially copyable components
+    SprStorageType m_storageType;
+    ArchetypeStorage m_archetypes;
+    uint64 m_archetypeMask;
+
     std::vector<Entity> m_entitiesUnregister;
 
+    // change ticks for dirty tracking
+    ChangeClock m_clock;
+
+    template <typename... Args>
+    friend class Query;
+    friend class WorldSnapshot;
+
     template<typename T, typename... Args>
     void registerEntityRecursive(Entity& entity, T* component, Args... args){
-        component->addEntity(entity);
+        uint32 index = getComponentIndex<T>();
+        if (isArchetypeStored(1LL << index))
+            memcpy(m_archetypes.get(entity.id, index), &component->m_staged, sizeof(typename T::DataType));
+        else
+            component->addEntity(entity);
         registerEntityRecursive(entity, args...);
     }
 
@@ -198,10 +287,21 @@ private:
     }
 
     void unregisterEntityImmediate(Entity& entity){
-        uint64 mask = entity.components;
+        if (m_storageType == SPR_STORAGE_ARCHETYPE)
+            m_archetypes.remove(entity);
+
+        uint64 mask = entity.components & ~m_archetypeMask;
+        for (uint32 i = 0; i < 64; i++){
+            if (((mask>>i)&0b1) == 1){
+                m_components[i]->removeEntity(entity);
+            }
+        }
+
+        // chunk stored components only need their change ticks reset
+        mask = entity.components & m_archetypeMask & m_trackingMask;
         for (uint32 i = 0; i < 64; i++){
             if (((mask>>i)&0b1) == 1){
-                m_components.at(i)->removeEntity(entity);
+                m_components[i]->clean(entity.id);
             }
         }
     }
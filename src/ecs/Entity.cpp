@@ -3,11 +3,19 @@
 namespace spr {
 Entity::Entity(){
     id = 0;
+    generation = 0;
     components = 0;
 }
 
 Entity::Entity(uint32 id, uint64 components){
     this->id = id;
+    this->generation = 0;
+    this->components = components;
+}
+
+Entity::Entity(uint32 id, uint32 generation, uint64 components){
+    this->id = id;
+    this->generation = generation;
     this->components = components;
 }
 
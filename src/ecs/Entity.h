@@ -7,9 +7,11 @@ class Entity {
 public:
     Entity();
     Entity(uint32 id, uint64 components);
+    Entity(uint32 id, uint32 generation, uint64 components);
     ~Entity() {}
     
     uint32 id;
+    uint32 generation;
     uint64 components;
 
     uint64 addComponents(uint64 components);
@@ -18,7 +20,7 @@ public:
     bool containsAny(uint64 components);
 
     bool operator==(const Entity &rhs) const {
-        return (rhs.id == id)&(rhs.components == components);
+        return (rhs.id == id)&(rhs.generation == generation)&(rhs.components == components);
     }
 
 private:
@@ -0,0 +1,47 @@
+#include "EntityAllocator.h"
+#include "debug/SprLog.h"
+
+namespace spr {
+
+EntityAllocator::EntityAllocator(){
+    m_generations.reserve(512);
+    m_components.reserve(512);
+}
+
+Entity EntityAllocator::allocate(uint64 components){
+    // reuse most recently freed slot, keeps ids (and everything
+    // indexed by them) dense
+    if (m_freeList.size() > 0){
+        uint32 id = m_freeList.back();
+        m_freeList.pop_back();
+        m_components[id] = components;
+        return Entity(id, m_generations[id], components);
+    }
+
+    uint32 id = m_generations.size();
+    m_generations.push_back(1);
+    m_components.push_back(components);
+    return Entity(id, 1, components);
+}
+
+bool EntityAllocator::destroy(Entity& entity){
+    if (!isAlive(entity)){
+        SprLog::warn("[EntityAllocator] [destroy] entity already destroyed, id: ", entity.id);
+        return false;
+    }
+
+    m_generations[entity.id]++;
+    m_components[entity.id] = 0;
+    m_pendingRelease.push_back(entity.id);
+    return true;
+}
+
+void EntityAllocator::release(){
+    if (m_pendingRelease.size() == 0)
+        return;
+
+    m_freeList.insert(m_freeList.end(), m_pendingRelease.begin(), m_pendingRelease.end());
+    m_pendingRelease.clear();
+}
+
+}
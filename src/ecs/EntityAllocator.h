@@ -0,0 +1,62 @@
+#pragma once
+
+#include <vector>
+#include "Entity.h"
+
+namespace spr {
+
+// hands out entity ids, recycling destroyed ones. each id slot
+// has a generation (same idea as Pool/Handle), bumped when the
+// entity is destroyed, so stale Entity copies can be detected
+class EntityAllocator {
+public:
+    EntityAllocator();
+    ~EntityAllocator() {}
+
+    // new entity with a recycled or fresh id
+    Entity allocate(uint64 components);
+
+    // invalidate entity, its id isn't reused until release()
+    bool destroy(Entity& entity);
+
+    // make ids of destroyed entities available again, called once
+    // their component data and registry entries have been removed
+    void release();
+
+    bool isAlive(const Entity& entity){
+        return entity.id < m_generations.size() && m_generations[entity.id] == entity.generation;
+    }
+
+    uint32 getGeneration(uint32 id){
+        return m_generations[id];
+    }
+
+    // current component mask of a live entity, Entity copies held
+    // elsewhere may be out of date after add/remove
+    uint64 getComponents(uint32 id){
+        return m_components[id];
+    }
+
+    void setComponents(uint32 id, uint64 components){
+        m_components[id] = components;
+    }
+
+    // highest id ever handed out + 1
+    uint32 getCapacity(){
+        return m_generations.size();
+    }
+
+    uint32 getAliveCount(){
+        return m_generations.size() - m_freeList.size() - m_pendingRelease.size();
+    }
+
+private:
+    friend class WorldSnapshot;
+
+    std::vector<uint32> m_generations;
+    std::vector<uint64> m_components;
+    std::vector<uint32> m_freeList;
+    std::vector<uint32> m_pendingRelease;
+};
+
+}
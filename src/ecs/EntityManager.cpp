@@ -2,7 +2,17 @@
 
 namespace spr {
 
-EntityManager::EntityManager() {}
+EntityManager::EntityManager() {
+    m_queryHits = 0;
+    m_queryMisses = 0;
+}
+
+EntityManager::~EntityManager() {
+    for (auto& [mask, cache] : m_queryCache){
+        delete cache;
+    }
+    m_queryCache.clear();
+}
 
 void EntityManager::update(){
     if (m_entitiesAdd.size() > 0 || m_entitiesRemove.size() > 0){
@@ -12,6 +22,18 @@ void EntityManager::update(){
         for (Entity& entity : m_entitiesRemove){
             m_entities.remove(entity);
         }
+
+        // apply the same changes to cached queries, in the same order
+        for (auto& [mask, cache] : m_queryCache){
+            for (Entity& entity : m_entitiesAdd){
+                if (entity.contains(mask))
+                    cacheAdd(*cache, entity);
+            }
+            for (Entity& entity : m_entitiesRemove){
+                if (entity.contains(mask))
+                    cacheRemove(*cache, entity);
+            }
+        }
     }
 }
 
@@ -34,4 +56,67 @@ void EntityManager::getEntities(uint64 components, std::vector<Entity>& out){
     m_entities.getAccum(components, out);
 }
 
-}
\ No newline at end of file
+const std::vector<Entity>& EntityManager::getEntities(uint64 components){
+    {
+        std::shared_lock<std::shared_mutex> lock(m_queryMutex);
+        auto itr = m_queryCache.find(components);
+        if (itr != m_queryCache.end()){
+            m_queryHits++;
+            return itr->second->entities;
+        }
+    }
+
+    // another system may have built it while we waited
+    std::unique_lock<std::shared_mutex> lock(m_queryMutex);
+    auto itr = m_queryCache.find(components);
+    if (itr != m_queryCache.end()){
+        m_queryHits++;
+        return itr->second->entities;
+    }
+
+    // first request for this mask, build from the trie
+    m_queryMisses++;
+    QueryCache* cache = new QueryCache();
+    m_entities.getAccum(components, cache->entities);
+    for (uint32 i = 0; i < cache->entities.size(); i++){
+        cache->indices[cache->entities[i].id] = i;
+    }
+    m_queryCache[components] = cache;
+    return cache->entities;
+}
+
+QueryCacheStats EntityManager::getQueryCacheStats(){
+    return {m_queryHits.load(), m_queryMisses.load(), (uint32)m_queryCache.size()};
+}
+
+void EntityManager::cacheAdd(QueryCache& cache, Entity& entity){
+    // entity changing components is queued as remove(old) + add(new),
+    // overwrite so the stale remove below no longer matches
+    auto itr = cache.indices.find(entity.id);
+    if (itr != cache.indices.end()){
+        cache.entities[itr->second] = entity;
+        return;
+    }
+
+    cache.indices[entity.id] = cache.entities.size();
+    cache.entities.push_back(entity);
+}
+
+void EntityManager::cacheRemove(QueryCache& cache, Entity& entity){
+    auto itr = cache.indices.find(entity.id);
+    if (itr == cache.indices.end())
+        return;
+
+    uint32 index = itr->second;
+    if (!(cache.entities[index] == entity))
+        return;
+
+    // swap last into the hole
+    Entity& last = cache.entities.back();
+    cache.entities[index] = last;
+    cache.indices[last.id] = index;
+    cache.entities.pop_back();
+    cache.indices.erase(entity.id);
+}
+
+}
@@ -1,14 +1,24 @@
 #pragma once
 
 #include <vector>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
 #include "../core/util/node/EntityNode.h"
+#include "external/flat_hash_map/flat_hash_map.hpp"
 
 namespace spr {
 
+typedef struct {
+    uint32 hits;
+    uint32 misses;
+    uint32 queries;
+} QueryCacheStats;
+
 class EntityManager {
 public:
     EntityManager();
-    ~EntityManager() {}
+    ~EntityManager();
 
     void addEntity(Entity& entity);
     void removeEntity(Entity& entity);
@@ -16,6 +26,19 @@ public:
     void update();
 
     void getEntities(uint64 components, std::vector<Entity>& out);
+
+    // cached list of entities that have all components, kept up to
+    // date by update(). valid until the next update(). safe to call
+    // from parallel systems, not alongside update()
+    const std::vector<Entity>& getEntities(uint64 components);
+
+    QueryCacheStats getQueryCacheStats();
+
+    // visit groups of entities that have all components
+    template <typename Func>
+    void forEachMatch(uint64 components, Func&& func){
+        m_entities.forEachLeaf(components, func);
+    }
     
 private:
     // entity storage
@@ -25,6 +48,19 @@ private:
     std::vector<Entity> m_entitiesAdd;
     std::vector<Entity> m_entitiesRemove;
 
+    // persistent query results, keyed by component mask
+    struct QueryCache {
+        std::vector<Entity> entities;
+        ska::flat_hash_map<uint32, uint32> indices;
+    };
+    ska::flat_hash_map<uint64, QueryCache*> m_queryCache;
+    std::shared_mutex m_queryMutex;     // lookups shared, misses exclusive
+    std::atomic<uint32> m_queryHits;
+    std::atomic<uint32> m_queryMisses;
+
+    void cacheAdd(QueryCache& cache, Entity& entity);
+    void cacheRemove(QueryCache& cache, Entity& entity);
+
     void getEntities(){}
     void cleanUp();
 
@@ -0,0 +1,224 @@
+#pragma once
+
+#include <array>
+#include <tuple>
+#include <atomic>
+#include <vector>
+#include <cstring>
+#include <utility>
+#include <type_traits>
+#include "ComponentManager.h"
+#include "EntityManager.h"
+#include "SystemManager.h"
+#include "EntityAllocator.h"
+
+namespace spr {
+
+// target bytes of component data touched per parallel range
+static const uint32 SPR_QUERY_RANGE_BYTES = 16384;
+
+// iterate entities with components Args..., passing component
+// data directly (no entity vector, no per-entity type lookups):
+//
+//   ecs.query<const TransformC, ModelC>().forEach(
+//       [](Entity& entity, const TransformInfo& transform, uint32& model){ ... });
+//
+// const components are read-only. writes to non-const components
+// with dirty tracking are detected (by comparing against a copy)
+// and flag the entity dirty, same as set() would
+template <typename... Args>
+class Query {
+public:
+    Query(ComponentManager& componentManager, EntityManager& entityManager, SystemManager& systemManager, EntityAllocator& entityAllocator)
+        : m_componentManager(componentManager), m_entityManager(entityManager), m_systemManager(systemManager), m_entityAllocator(entityAllocator) {
+        m_mask = getComponentTypeMask<std::remove_const_t<Args>...>();
+        m_components = std::make_tuple(componentManager.getComponent<std::remove_const_t<Args>>()...);
+        m_chunked = componentManager.isArchetypeStored(m_mask);
+
+        // which writable components need change detection
+        uint32 i = 0;
+        m_anyTracked = false;
+        ((m_tracked[i++] = !std::is_const_v<Args> && ((componentManager.getTrackingMask() >> getComponentTypeId<std::remove_const_t<Args>>()) & 0b1)), ...);
+        for (bool tracked : m_tracked)
+            m_anyTracked |= tracked;
+    }
+
+    ~Query() {}
+
+    // visit every match on the calling thread
+    template <typename Func>
+    void forEach(Func&& func){
+        DirtyIds dirty;
+        gatherRanges(UINT32_MAX);
+        for (Range& range : m_ranges){
+            runRange(range, func, dirty);
+        }
+        flushDirty(dirty);
+    }
+
+    // visit matches in ranges spread over the thread pool, func must be
+    // safe to call concurrently. rangeSize = 0 picks a cache-sized range
+    template <typename Func>
+    void parallelForEach(Func&& func, uint32 rangeSize = 0){
+        if (rangeSize == 0){
+            uint32 rowBytes = sizeof(Entity) + (sizeof(Data<Args>) + ...);
+            rangeSize = std::max(SPR_QUERY_RANGE_BYTES / rowBytes, 64u);
+        }
+        gatherRanges(rangeSize);
+
+        // dirty ids are buffered per range and merged in range order
+        std::vector<DirtyIds> dirty(m_ranges.size());
+        if (m_ranges.size() == 1){
+            runRange(m_ranges[0], func, dirty[0]);
+        } else if (m_ranges.size() > 1){
+            ThreadPool& pool = m_systemManager.getThreadPool();
+            std::atomic<uint32> group = 0;
+            uint64 sortKey = CommandSortKey::get();
+            for (uint32 i = 0; i < m_ranges.size(); i++){
+                pool.submit([this, &func, &dirty, i, sortKey]{
+                    // commands recorded per range merge in range order
+                    uint64 previousKey = CommandSortKey::set(CommandSortKey::range(sortKey, i));
+                    runRange(m_ranges[i], func, dirty[i]);
+                    CommandSortKey::set(previousKey);
+                }, &group);
+            }
+            pool.wait(group);
+        }
+
+        for (DirtyIds& ids : dirty){
+            flushDirty(ids);
+        }
+    }
+
+private:
+    template <typename T>
+    using Data = std::conditional_t<std::is_const_v<T>,
+        const typename std::remove_const_t<T>::DataType,
+        typename std::remove_const_t<T>::DataType>;
+
+    // copy kept for change detection (placeholder if not needed)
+    template <typename T>
+    using Snapshot = std::conditional_t<!std::is_const_v<T> && std::is_trivially_copyable_v<Data<T>>, Data<T>, char>;
+
+    typedef std::array<std::vector<uint32>, sizeof...(Args)> DirtyIds;
+
+    // contiguous run of matches: a slice of a trie leaf, or an archetype chunk
+    struct Range {
+        Entity* entities;
+        uint32 count;
+        Archetype* archetype;
+        uint32 chunk;
+    };
+
+    ComponentManager& m_componentManager;
+    EntityManager& m_entityManager;
+    SystemManager& m_systemManager;
+    EntityAllocator& m_entityAllocator;
+
+    uint64 m_mask;
+    bool m_chunked;
+    std::tuple<std::remove_const_t<Args>*...> m_components;
+    std::array<bool, sizeof...(Args)> m_tracked;
+    bool m_anyTracked;
+    std::vector<Range> m_ranges;
+
+    void gatherRanges(uint32 rangeSize){
+        m_ranges.clear();
+
+        if (m_chunked){
+            m_componentManager.m_archetypes.forEachChunk(m_mask, [&](Archetype& archetype, uint32 chunk){
+                m_ranges.push_back({nullptr, archetype.getRowCount(chunk), &archetype, chunk});
+            });
+            return;
+        }
+
+        m_entityManager.forEachMatch(m_mask, [&](std::vector<Entity>& leaf){
+            uint32 size = leaf.size();
+            for (uint32 start = 0; start < size; start += rangeSize){
+                uint32 count = std::min(rangeSize, size - start);
+                m_ranges.push_back({leaf.data() + start, count, nullptr, 0});
+            }
+        });
+    }
+
+    template <typename Func>
+    void runRange(Range& range, Func& func, DirtyIds& dirty){
+        runRange(range, func, dirty, std::index_sequence_for<Args...>{});
+    }
+
+    template <typename Func, size_t... I>
+    void runRange(Range& range, Func& func, DirtyIds& dirty, std::index_sequence<I...>){
+        if (!range.archetype){
+            for (uint32 i = 0; i < range.count; i++){
+                Entity& entity = range.entities[i];
+                visit<I...>(entity, func, dirty, &m_componentManager.template getEntityComponent<std::remove_const_t<Args>>(entity.id)...);
+            }
+            return;
+        }
+
+        // chunk columns
+        Archetype& archetype = *range.archetype;
+        uint32* ids = archetype.getIds(range.chunk);
+        std::tuple<Data<Args>*...> columns = std::make_tuple(
+            (Data<Args>*) archetype.getColumn(range.chunk, getComponentTypeId<std::remove_const_t<Args>>())...);
+
+        Entity entity(0, archetype.getMask());
+        for (uint32 i = 0; i < range.count; i++){
+            entity.id = ids[i];
+            entity.generation = m_entityAllocator.getGeneration(ids[i]);
+            visit<I...>(entity, func, dirty, (std::get<I>(columns) + i)...);
+        }
+    }
+
+    template <size_t... I, typename Func>
+    void visit(Entity& entity, Func& func, DirtyIds& dirty, Data<Args>*... data){
+        if (!m_anyTracked){
+            func(entity, *data...);
+            return;
+        }
+
+        std::tuple<Snapshot<Args>...> before;
+        (snapshot<I, Args>(std::get<I>(before), data), ...);
+        func(entity, *data...);
+        (detectChange<I, Args>(entity.id, std::get<I>(before), data, dirty), ...);
+    }
+
+    template <size_t I, typename T>
+    void snapshot(Snapshot<T>& before, Data<T>* data){
+        if constexpr (!std::is_const_v<T> && std::is_trivially_copyable_v<Data<T>>){
+            if (m_tracked[I])
+                memcpy(&before, data, sizeof(Data<T>));
+        }
+    }
+
+    template <size_t I, typename T>
+    void detectChange(uint32 id, Snapshot<T>& before, Data<T>* data, DirtyIds& dirty){
+        if constexpr (!std::is_const_v<T>){
+            if (!m_tracked[I])
+                return;
+
+            // without a copy, assume writable means written
+            if constexpr (std::is_trivially_copyable_v<Data<T>>){
+                if (memcmp(&before, data, sizeof(Data<T>)) == 0)
+                    return;
+            }
+            dirty[I].push_back(id);
+        }
+    }
+
+    void flushDirty(DirtyIds& dirty){
+        flushDirty(dirty, std::index_sequence_for<Args...>{});
+    }
+
+    template <size_t... I>
+    void flushDirty(DirtyIds& dirty, std::index_sequence<I...>){
+        auto flush = [](auto* component, std::vector<uint32>& ids){
+            for (uint32 id : ids){
+                component->dirty(id);
+            }
+        };
+        (flush(std::get<I>(m_components), dirty[I]), ...);
+    }
+};
+
+}
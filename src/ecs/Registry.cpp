@@ -21,19 +21,17 @@ namespace spr {
     }
 
     int32 Registry::getIndex(Entity& entity){
-        if (m_regType == SPR_REG_DENSE){
-            return m_indicesDense.get(entity.id);
-        } else {
-            return m_indicesSparse.at(entity.id);
-        }
+        return getIndex(entity.id);
     }
 
+    // -1 if id has no item
     int32 Registry::getIndex(uint32 id){
         if (m_regType == SPR_REG_DENSE){
             return m_indicesDense.get(id);
-        } else {
+        } else if (id < m_indicesSparse.size()){
             return m_indicesSparse.at(id);
         }
+        return -1;
     }
 
     void Registry::addItem(Entity& entity, int32 index){ 
@@ -41,7 +39,7 @@ namespace spr {
             m_indicesDense.add(entity.id, index);
         } else {
             while (entity.id >= m_indicesSparse.size()){
-                m_indicesSparse.resize(m_indicesSparse.size()*2);
+                m_indicesSparse.resize(m_indicesSparse.size()*2, -1);
             }
             m_indicesSparse.at(entity.id) = index;
         }
@@ -52,9 +50,17 @@ namespace spr {
             m_indicesDense.add(id, index);
         } else {
             while (id >= m_indicesSparse.size()){
-                m_indicesSparse.resize(m_indicesSparse.size()*2);
+                m_indicesSparse.resize(m_indicesSparse.size()*2, -1);
             }
             m_indicesSparse.at(id) = index;
         }
     }
+
+    void Registry::removeItem(uint32 id){
+        if (m_regType == SPR_REG_DENSE){
+            m_indicesDense.remove(id);
+        } else if (id < m_indicesSparse.size()){
+            m_indicesSparse.at(id) = -1;
+        }
+    }
 }
\ No newline at end of file
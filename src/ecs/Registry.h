@@ -23,6 +23,7 @@ public:
     int getIndex(uint32 id);
     void addItem(Entity& entity, int32 index);
     void addItem(uint32 id, int32 index);
+    void removeItem(uint32 id);
 
     uint32 size();
 private:
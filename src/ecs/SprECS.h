@@ -2,19 +2,24 @@
 #include "SystemManager.h"
 #include "EntityManager.h"
 #include "ComponentManager.h"
+#include "Query.h"
+#include "EntityAllocator.h"
+#include "CommandBuffer.h"
+#include "WorldSnapshot.h"
 #include "Entity.h"
 
 namespace spr {
 class SprECS {
 public:
     // ---------------- sprecs ------------------ 
-    SprECS() {
-        m_entityId = 0;
-    }
+    SprECS(SprStorageType storageType = SPR_STORAGE_SPARSE) : componentManager(storageType) {}
     
     ~SprECS() {}
 
     void update(float dt){
+        // apply structural changes recorded through commands()
+        m_commandQueue.flush(*this);
+
         // create/destroy queued entities from last frame
         entityManager.update();
 
@@ -24,6 +29,9 @@ public:
         // unregister queued entities from last frame
         componentManager.update();
 
+        // destroyed entities' ids can be reused now
+        m_entityAllocator.release();
+
         // remove tracked created/destryed entites from last frame
         entityManager.cleanUp();
     }
@@ -38,20 +46,27 @@ public:
         uint64 mask = componentManager.getMask<T,Args...>();
         
         // create entity
-        Entity entity{m_entityId, mask};
+        Entity entity = m_entityAllocator.allocate(mask);
         
         // register entity 
         entityManager.addEntity(entity);
 
         // register entity with components
         componentManager.registerEntity(entity, t, args...);
-        m_entityId++;
 
         return entity;
     }
 
     // destroy entity and remove it from components and registries
     void destroyEntity(Entity& entity){
+        // ignore stale copies of already destroyed entities
+        if (!m_entityAllocator.isAlive(entity)){
+            SprLog::warn("[SprECS] [destroyEntity] entity not alive, id: ", entity.id);
+            return;
+        }
+        entity.components = m_entityAllocator.getComponents(entity.id);
+        m_entityAllocator.destroy(entity);
+
         // remove entity 
         entityManager.removeEntity(entity);
 
@@ -59,6 +74,18 @@ public:
         componentManager.unregisterEntity(entity);
     }
 
+    // check if entity hasn't been destroyed (and its id not recycled)
+    bool isAlive(const Entity& entity){
+        return m_entityAllocator.isAlive(entity);
+    }
+
+    // calling thread's command buffer. create/destroy/add/remove recorded
+    // here are safe from any thread (e.g. inside systems or parallelForEach)
+    // and are applied in a deterministic order at the start of next update
+    CommandBuffer& commands(){
+        return m_commandQueue.get();
+    }
+
     // get a collection of entities with given templated components
     template <typename Arg, typename ...Args>
     void getEntities(std::vector<Entity>& out){
@@ -69,6 +96,46 @@ public:
         entityManager.getEntities(mask, out);
     }
 
+    // get cached collection of entities with given templated components,
+    // valid until the next update (no copy, no trie walk once cached)
+    template <typename Arg, typename ...Args>
+    const std::vector<Entity>& getEntities(){
+        uint64 mask = componentManager.getMask<Arg, Args...>();
+        return entityManager.getEntities(mask);
+    }
+
+    QueryCacheStats getQueryCacheStats(){
+        return entityManager.getQueryCacheStats();
+    }
+
+    // query entities with given components, see Query.h
+    //   ecs.query<const TransformC, ModelC>().forEach(...)
+    template <typename Arg, typename ...Args>
+    Query<Arg, Args...> query(){
+        return Query<Arg, Args...>(componentManager, entityManager, systemManager, m_entityAllocator);
+    }
+
+    // iterate entities with given components one chunk at a time:
+    //   func(uint32 count, uint32* ids, Arg::DataType*, Args::DataType*...)
+    // sparse storage falls back to one call per entity (count = 1)
+    template <typename Arg, typename ...Args>
+    void forEachChunk(auto&& func){
+        uint64 mask = componentManager.getMask<Arg, Args...>();
+
+        if (componentManager.isArchetypeStored(mask)){
+            componentManager.forEachChunk<Arg, Args...>(func);
+            return;
+        }
+
+        std::vector<Entity> entities;
+        entityManager.getEntities(mask, entities);
+        for (Entity& entity : entities){
+            func(1u, &entity.id,
+                 &componentManager.getEntityComponent<Arg>(entity),
+                 &componentManager.getEntityComponent<Args>(entity)...);
+        }
+    }
+
     // filter entities queued for removal/deletion for those with given components
     template <typename Arg, typename ...Args>
     void getDeletedEntities(std::vector<Entity>& out){
@@ -107,7 +174,7 @@ public:
         componentManager.getDirtyEntities<Arg>(in, out);
     }
 
-    // filter entities queued for removal/deletion for those with given component
+    // ids changed during the current frame
     template <typename Arg>
     std::vector<uint32>& getDirtyEntityIds(){
         // get dirty entities
@@ -120,6 +187,19 @@ public:
         return componentManager.isDirty<Arg>(entity);
     }
 
+    // ids whose component changed since the consumer last asked, each once:
+    //   m_lastTick = ecs.getChangedEntityIds<TransformC>(m_lastTick, ids);
+    // consumers keep their own tick, so they can run at any rate
+    template <typename Arg>
+    uint32 getChangedEntityIds(uint32 sinceTick, std::vector<uint32>& out){
+        return componentManager.getChangedEntityIds<Arg>(sinceTick, out);
+    }
+
+    // starting tick for a consumer that only wants changes from now on
+    uint32 getChangeTick(){
+        return componentManager.getChangeTick();
+    }
+
 
     // ---------------- component ---------------
 
@@ -132,9 +212,21 @@ public:
     // add new component to entity directly
     template <typename T>
     void add(Entity& entity, auto data){
-        entityManager.removeEntity(entity);
+        if (!m_entityAllocator.isAlive(entity)){
+            SprLog::warn("[SprECS] [add] entity not alive, id: ", entity.id);
+            return;
+        }
+        // start from the current mask, the given copy may be out of date
+        entity.components = m_entityAllocator.getComponents(entity.id);
         uint64 mask = componentManager.getMask<T>();
+        // already has T, only its data changes
+        if (entity.contains(mask)){
+            componentManager.setEntityComponent<T>(entity, data);
+            return;
+        }
+        entityManager.removeEntity(entity);
         entity.addComponents(mask);
+        m_entityAllocator.setComponents(entity.id, entity.components);
         entityManager.addEntity(entity);
         componentManager.addComponentEntityData<T>(entity, data);
     }
@@ -142,9 +234,18 @@ public:
     // remove component from entity directly
     template <typename T>
     void remove(Entity& entity){
-        entityManager.removeEntity(entity);
+        if (!m_entityAllocator.isAlive(entity)){
+            SprLog::warn("[SprECS] [remove] entity not alive, id: ", entity.id);
+            return;
+        }
+        // start from the current mask, the given copy may be out of date
+        entity.components = m_entityAllocator.getComponents(entity.id);
         uint64 mask = componentManager.getMask<T>();
+        if (!entity.contains(mask))
+            return;
+        entityManager.removeEntity(entity);
         entity.removeComponents(mask);
+        m_entityAllocator.setComponents(entity.id, entity.components);
         entityManager.addEntity(entity);
         componentManager.removeComponentEntity<T>(entity);
     }
@@ -188,12 +289,42 @@ public:
         systemManager.setAudioSystem(system);
     }
 
+    // choose sequential (deterministic) or parallel system scheduling
+    void setScheduleMode(SprScheduleMode mode, uint32 threadCount = 0){
+        systemManager.setScheduleMode(mode, threadCount);
+    }
+
+    // last frame's update time per system (ms), in registration order
+    std::vector<float>& getSystemTimings(){
+        return systemManager.getSystemTimings();
+    }
+
+    ThreadPool& getThreadPool(){
+        return systemManager.getThreadPool();
+    }
+
+
+    // ---------------- snapshot ----------------
+
+    // write all entities, component data and change state to one file
+    bool saveSnapshot(const std::string& path){
+        return WorldSnapshot::save(*this, path);
+    }
+
+    // load a snapshot into this (entity-less) world, see WorldSnapshot.h
+    bool loadSnapshot(const std::string& path){
+        return WorldSnapshot::load(*this, path);
+    }
+
 private:
+    friend class WorldSnapshot;
+
     // ecs managers
     EntityManager entityManager;
     ComponentManager componentManager;
     SystemManager systemManager;
 
-    uint32 m_entityId;
+    EntityAllocator m_entityAllocator;
+    CommandQueue m_commandQueue;
 };
 }
\ No newline at end of file
@@ -1,15 +1,53 @@
 #pragma once
 
 #include <vector>
+#include "Component.h"
 
 namespace spr {
+
+// components a system reads/writes during update, used by the
+// scheduler to run non-conflicting systems concurrently.
+// systems that don't declare access (or that create/destroy
+// entities) are exclusive and never overlap with other systems
+//   e.g. return SystemAccess().reads<CameraC>().writes<TransformC>();
+struct SystemAccess {
+    uint64 read = 0;
+    uint64 write = 0;
+    bool exclusive = true;
+
+    template <typename... Args>
+    SystemAccess& reads(){
+        read |= getComponentTypeMask<Args...>();
+        exclusive = false;
+        return *this;
+    }
+
+    template <typename... Args>
+    SystemAccess& writes(){
+        write |= getComponentTypeMask<Args...>();
+        exclusive = false;
+        return *this;
+    }
+
+    bool conflicts(const SystemAccess& other) const {
+        if (exclusive || other.exclusive)
+            return true;
+        return (write & (other.read | other.write)) || (other.write & read);
+    }
+};
+
 class System {
 public:
     System() {}
     ~System() {}
 
     virtual void update(float dt) = 0;
+
+    // declared component access, exclusive by default
+    virtual SystemAccess access(){
+        return SystemAccess();
+    }
 private:
 };
 
-}
\ No newline at end of file
+}
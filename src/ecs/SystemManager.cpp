@@ -1,11 +1,20 @@
 #include "SystemManager.h"
+#include <chrono>
 
 namespace spr {
     
-SystemManager::SystemManager() {}
+SystemManager::SystemManager() {
+    m_renderSystem = nullptr;
+    m_audioSystem = nullptr;
+    m_mode = SPR_SCHEDULE_PARALLEL;
+    m_threadCount = 0;
+    m_waitCountsSize = 0;
+    m_renderTiming = 0.f;
+}
 
 void SystemManager::addSystem(System& system){
     m_systems.push_back(&system);
+    m_timings.push_back(0.f);
 }
 
 void SystemManager::setRenderSystem(System& renderSystem){
@@ -16,18 +25,127 @@ void SystemManager::setAudioSystem(System& audioSystem){
     m_audioSystem = &audioSystem;
 }
 
+void SystemManager::setScheduleMode(SprScheduleMode mode, uint32 threadCount){
+    m_mode = mode;
+    if (threadCount != m_threadCount){
+        m_threadCount = threadCount;
+        m_threadPool.reset();
+    }
+}
+
+ThreadPool& SystemManager::getThreadPool(){
+    if (!m_threadPool)
+        m_threadPool = std::make_unique<ThreadPool>(m_threadCount);
+    return *m_threadPool;
+}
+
 void SystemManager::update(float dt){
     // update systems
-    for(System* system : m_systems){
-        system->update(dt);
-    }
+    if (m_mode == SPR_SCHEDULE_SEQUENTIAL || m_systems.size() < 2)
+        updateSequential(dt);
+    else
+        updateParallel(dt);
 
     // update render system
-    m_renderSystem->update(dt);
+    if (m_renderSystem){
+        uint64 previousKey = CommandSortKey::set(CommandSortKey::system(m_systems.size()));
+        auto start = std::chrono::high_resolution_clock::now();
+        m_renderSystem->update(dt);
+        CommandSortKey::set(previousKey);
+        auto end = std::chrono::high_resolution_clock::now();
+        m_renderTiming = std::chrono::duration<float, std::milli>(end - start).count();
+    }
 
     // // update audio system
     // m_audioSystem->update(dt);
     
 }
 
+void SystemManager::updateSequential(float dt){
+    for (uint32 i = 0; i < m_systems.size(); i++){
+        runSystem(i, dt);
+    }
+}
+
+void SystemManager::updateParallel(float dt){
+    uint32 systemCount = m_systems.size();
+
+    // gather declared access
+    m_access.resize(systemCount);
+    for (uint32 i = 0; i < systemCount; i++){
+        m_access[i] = m_systems[i]->access();
+    }
+
+    if (m_waitCountsSize < systemCount){
+        m_waitCounts = std::make_unique<std::atomic<uint32>[]>(systemCount);
+        m_waitCountsSize = systemCount;
+    }
+    m_dependents.resize(systemCount);
+
+    // exclusive systems act as barriers and run on the calling thread
+    // (they may touch window/input state), everything in between is
+    // scheduled as a batch
+    uint32 batchStart = 0;
+    for (uint32 i = 0; i <= systemCount; i++){
+        if (i < systemCount && !m_access[i].exclusive)
+            continue;
+
+        runBatch(batchStart, i, dt);
+        if (i < systemCount)
+            runSystem(i, dt);
+        batchStart = i + 1;
+    }
+}
+
+void SystemManager::runBatch(uint32 begin, uint32 end, float dt){
+    if (end - begin == 0)
+        return;
+    if (end - begin == 1){
+        runSystem(begin, dt);
+        return;
+    }
+
+    // build dag, keeping registration order between conflicting systems
+    for (uint32 i = begin; i < end; i++){
+        m_dependents[i].clear();
+        m_waitCounts[i] = 0;
+    }
+    for (uint32 i = begin; i < end; i++){
+        for (uint32 j = begin; j < i; j++){
+            if (m_access[j].conflicts(m_access[i])){
+                m_dependents[j].push_back(i);
+                m_waitCounts[i]++;
+            }
+        }
+    }
+
+    // kick off roots, dependents are submitted as their inputs finish
+    ThreadPool& pool = getThreadPool();
+    for (uint32 i = begin; i < end; i++){
+        if (m_waitCounts[i] == 0)
+            pool.submit([this, i, dt]{ runScheduled(i, dt); }, &m_running);
+    }
+    pool.wait(m_running);
+}
+
+void SystemManager::runScheduled(uint32 index, float dt){
+    runSystem(index, dt);
+
+    for (uint32 dependent : m_dependents[index]){
+        if (--m_waitCounts[dependent] == 0)
+            m_threadPool->submit([this, dependent, dt]{ runScheduled(dependent, dt); }, &m_running);
+    }
+}
+
+void SystemManager::runSystem(uint32 index, float dt){
+    // commands recorded by the system are applied in system order,
+    // regardless of which thread it ran on
+    uint64 previousKey = CommandSortKey::set(CommandSortKey::system(index));
+    auto start = std::chrono::high_resolution_clock::now();
+    m_systems[index]->update(dt);
+    auto end = std::chrono::high_resolution_clock::now();
+    CommandSortKey::set(previousKey);
+    m_timings[index] = std::chrono::duration<float, std::milli>(end - start).count();
+}
+
 } // namespace spr
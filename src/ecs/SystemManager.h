@@ -1,10 +1,20 @@
 #pragma once
 
 #include <vector>
+#include <memory>
+#include <atomic>
 #include "System.h"
+#include "CommandBuffer.h"
+#include "../core/util/ThreadPool.h"
 
 
 namespace spr {
+
+typedef enum {
+    SPR_SCHEDULE_SEQUENTIAL,
+    SPR_SCHEDULE_PARALLEL
+} SprScheduleMode;
+
 class SystemManager{
 public:
     SystemManager();
@@ -19,12 +29,52 @@ public:
     // set the audio system
     void setAudioSystem(System& audioSystem);
 
-    // update all systems sequentially
+    // sequential runs systems in registration order on the calling
+    // thread, parallel runs non-conflicting systems on the pool
+    // (exclusive systems still run on the calling thread)
+    void setScheduleMode(SprScheduleMode mode, uint32 threadCount = 0);
+
+    // update systems, then the render system on the calling thread
     void update(float dt);
 
+    // worker pool, created on first use
+    ThreadPool& getThreadPool();
+
+    // last frame's update time per system (ms), in registration order
+    std::vector<float>& getSystemTimings(){
+        return m_timings;
+    }
+
+    float getRenderSystemTiming(){
+        return m_renderTiming;
+    }
+
 private:
     std::vector<System*> m_systems;
     System* m_renderSystem;
     System* m_audioSystem;
+
+    // scheduling
+    SprScheduleMode m_mode;
+    uint32 m_threadCount;
+    std::unique_ptr<ThreadPool> m_threadPool;
+
+    // per-frame dependency graph: system i waits on every
+    // earlier system whose access conflicts with its own
+    std::vector<SystemAccess> m_access;
+    std::vector<std::vector<uint32>> m_dependents;
+    std::unique_ptr<std::atomic<uint32>[]> m_waitCounts;
+    uint32 m_waitCountsSize;
+    std::atomic<uint32> m_running = 0;
+
+    // timing
+    std::vector<float> m_timings;
+    float m_renderTiming;
+
+    void updateSequential(float dt);
+    void updateParallel(float dt);
+    void runBatch(uint32 begin, uint32 end, float dt);
+    void runSystem(uint32 index, float dt);
+    void runScheduled(uint32 index, float dt);
 };
-}
\ No newline at end of file
+}
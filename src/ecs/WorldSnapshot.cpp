@@ -0,0 +1,388 @@
+#include "WorldSnapshot.h"
+#include <fstream>
+#include <cstring>
+#include <vector>
+#include "SprECS.h"
+#include "external/mio/mio.h"
+#include "debug/SprLog.h"
+
+namespace spr {
+
+// ------------------------------------------------------------------------- //
+//    Helpers                                                                //
+// ------------------------------------------------------------------------- //
+static uint64 align16(uint64 offset){
+    return (offset + 15) & ~15ull;
+}
+
+// append a 16B aligned section, returns where to write it
+static uint8* reserve(std::vector<uint8>& out, uint64 size){
+    uint64 offset = align16(out.size());
+    out.resize(offset + size);
+    return out.data() + offset;
+}
+
+// copy size bytes into the next aligned section. empty sections
+// copy nothing (their source may be a null vector data())
+static void append(std::vector<uint8>& out, const void* data, uint64 size){
+    uint8* section = reserve(out, size);
+    if (size > 0)
+        memcpy(section, data, size);
+}
+
+// next 16B aligned section, nullptr if the file is too short
+static const uint8* consume(const uint8* data, uint64 size, uint64& offset, uint64 sectionSize){
+    uint64 start = align16(offset);
+    if (start + sectionSize > size)
+        return nullptr;
+    offset = start + sectionSize;
+    return data + start;
+}
+
+// a group's sections in the mapped file, found while validating
+typedef struct {
+    const SnapshotGroup* header = nullptr;
+    const uint32* ids = nullptr;
+    const uint8* columns[SPR_MAX_COMPONENTS];
+} LoadGroup;
+
+// a tracked component's change sections
+typedef struct {
+    uint32 slot;
+    const SnapshotChanges* header;
+    const uint32* ticks;
+    const Change* log;
+} LoadChanges;
+
+// swap mask bits from one index space to another
+static uint64 remapMask(uint64 mask, const uint32* indices){
+    uint64 out = 0;
+    while (mask){
+        uint32 bit = __builtin_ctzll(mask);
+        out |= 1ull << indices[bit];
+        mask &= mask - 1;
+    }
+    return out;
+}
+
+
+// ------------------------------------------------------------------------- //
+//    Save                                                                   //
+// ------------------------------------------------------------------------- //
+bool WorldSnapshot::save(SprECS& ecs, const std::string& path){
+    EntityAllocator& allocator = ecs.m_entityAllocator;
+    ComponentManager& components = ecs.componentManager;
+
+    if (allocator.m_pendingRelease.size() > 0){
+        SprLog::error("[WorldSnapshot] [save] destroyed entities pending, save after update", false);
+        return false;
+    }
+
+    // component table, runtime index -> table slot
+    std::vector<SnapshotComponent> table;
+    std::vector<uint32> indices;
+    uint32 slots[SPR_MAX_COMPONENTS];
+    uint64 savedMask = 0;
+    for (uint32 i = 0; i < SPR_MAX_COMPONENTS; i++){
+        slots[i] = 0;
+        if (!((components.m_componentMask >> i) & 0b1))
+            continue;
+
+        Component* component = components.m_components[i];
+        uint32 elementSize = component->getElementSize();
+        if (elementSize == 0){
+            SprLog::warn("[WorldSnapshot] [save] component not trivially copyable, skipped, type id: ", i);
+            continue;
+        }
+        slots[i] = table.size();
+        savedMask |= 1ull << i;
+        table.push_back({components.m_typeHashes[i], elementSize, component->getChangeLog() != nullptr});
+        indices.push_back(i);
+    }
+
+    // group live entities by mask, ids ascending within a group
+    uint32 capacity = allocator.getCapacity();
+    std::vector<uint8> dead(capacity, 0);
+    for (uint32 id : allocator.m_freeList){
+        dead[id] = 1;
+    }
+
+    std::vector<uint64> masks(capacity);
+    std::vector<uint64> groupMasks;
+    std::vector<std::vector<uint32>> groupIds;
+    ska::flat_hash_map<uint64, uint32> groupIndices;
+    for (uint32 id = 0; id < capacity; id++){
+        uint64 mask = allocator.m_components[id] & savedMask;
+        masks[id] = remapMask(mask, slots);
+        if (dead[id])
+            continue;
+
+        auto it = groupIndices.find(mask);
+        if (it == groupIndices.end()){
+            it = groupIndices.emplace(mask, groupMasks.size()).first;
+            groupMasks.push_back(mask);
+            groupIds.emplace_back();
+        }
+        groupIds[it->second].push_back(id);
+    }
+
+    std::vector<uint8> out;
+    SnapshotHeader header = {
+        .magic = SPR_SNAPSHOT_MAGIC,
+        .version = SPR_SNAPSHOT_VERSION,
+        .entityCapacity = capacity,
+        .freeCount = (uint32)allocator.m_freeList.size(),
+        .componentCount = (uint32)table.size(),
+        .groupCount = (uint32)groupMasks.size(),
+        .tick = components.m_clock.tick,
+        .frameTick = components.m_clock.frameTick};
+    append(out, &header, sizeof(SnapshotHeader));
+    append(out, table.data(), table.size() * sizeof(SnapshotComponent));
+    append(out, allocator.m_generations.data(), capacity * sizeof(uint32));
+    append(out, masks.data(), capacity * sizeof(uint64));
+    append(out, allocator.m_freeList.data(), header.freeCount * sizeof(uint32));
+
+    // groups, one packed column per component
+    for (uint32 g = 0; g < groupMasks.size(); g++){
+        std::vector<uint32>& ids = groupIds[g];
+        uint32 count = ids.size();
+        SnapshotGroup group = {remapMask(groupMasks[g], slots), count, 0};
+        append(out, &group, sizeof(SnapshotGroup));
+        append(out, ids.data(), count * sizeof(uint32));
+
+        for (uint32 slot = 0; slot < table.size(); slot++){
+            uint32 index = indices[slot];
+            if (!((groupMasks[g] >> index) & 0b1))
+                continue;
+
+            uint32 elementSize = table[slot].elementSize;
+            uint8* column = reserve(out, (uint64)count * elementSize);
+            if (components.isArchetypeStored(1ull << index)){
+                for (uint32 i = 0; i < count; i++){
+                    memcpy(column + (uint64)i * elementSize, components.m_archetypes.get(ids[i], index), elementSize);
+                }
+            } else {
+                components.m_components[index]->readData(ids.data(), count, column);
+            }
+        }
+    }
+
+    // change tracking state
+    for (uint32 slot = 0; slot < table.size(); slot++){
+        ChangeLog* log = components.m_components[indices[slot]]->getChangeLog();
+        if (!log)
+            continue;
+
+        SnapshotChanges changes = {log->logStart, (uint32)log->ticks.size(), (uint32)log->changes.size(), 0};
+        append(out, &changes, sizeof(SnapshotChanges));
+        append(out, log->ticks.data(), changes.tickCount * sizeof(uint32));
+        append(out, log->changes.data(), changes.changeCount * sizeof(Change));
+    }
+
+    std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file.is_open()){
+        SprLog::error("[WorldSnapshot] [save] failed to open: " + path, false);
+        return false;
+    }
+    file.write((const char*)out.data(), out.size());
+    file.close();
+    return true;
+}
+
+
+// ------------------------------------------------------------------------- //
+//    Load                                                                   //
+// ------------------------------------------------------------------------- //
+bool WorldSnapshot::load(SprECS& ecs, const std::string& path){
+    EntityAllocator& allocator = ecs.m_entityAllocator;
+    ComponentManager& components = ecs.componentManager;
+
+    if (allocator.getCapacity() > 0){
+        SprLog::error("[WorldSnapshot] [load] world already has entities: " + path, false);
+        return false;
+    }
+
+    std::error_code error;
+    mio::mmap_source file;
+    file.map(path, error);
+    if (error){
+        SprLog::error("[WorldSnapshot] [load] failed to map: " + path, false);
+        return false;
+    }
+
+    const uint8* data = (const uint8*)file.data();
+    uint64 size = file.size();
+    uint64 offset = 0;
+
+    const SnapshotHeader* header = (const SnapshotHeader*)consume(data, size, offset, sizeof(SnapshotHeader));
+    if (!header || header->magic != SPR_SNAPSHOT_MAGIC || header->version != SPR_SNAPSHOT_VERSION){
+        SprLog::error("[WorldSnapshot] [load] not a snapshot (or wrong version): " + path, false);
+        return false;
+    }
+
+    // match table slots to registered components
+    uint32 capacity = header->entityCapacity;
+    const SnapshotComponent* table = (const SnapshotComponent*)consume(data, size, offset, header->componentCount * sizeof(SnapshotComponent));
+    if (!table || header->componentCount > SPR_MAX_COMPONENTS){
+        SprLog::error("[WorldSnapshot] [load] truncated: " + path, false);
+        return false;
+    }
+    uint32 indices[SPR_MAX_COMPONENTS];
+    for (uint32 slot = 0; slot < header->componentCount; slot++){
+        bool found = false;
+        for (uint32 i = 0; i < SPR_MAX_COMPONENTS && !found; i++){
+            if (!((components.m_componentMask >> i) & 0b1) || components.m_typeHashes[i] != table[slot].typeHash)
+                continue;
+            if (components.m_components[i]->getElementSize() != table[slot].elementSize)
+                break;
+            indices[slot] = i;
+            found = true;
+        }
+        if (!found){
+            SprLog::error("[WorldSnapshot] [load] component missing or changed size, slot: " + std::to_string(slot), false);
+            return false;
+        }
+    }
+
+    const uint32* generations = (const uint32*)consume(data, size, offset, capacity * sizeof(uint32));
+    const uint64* masks = (const uint64*)consume(data, size, offset, capacity * sizeof(uint64));
+    const uint32* freeList = (const uint32*)consume(data, size, offset, header->freeCount * sizeof(uint32));
+    if (!generations || !masks || !freeList){
+        SprLog::error("[WorldSnapshot] [load] truncated: " + path, false);
+        return false;
+    }
+
+    // validate every section before touching the world, so a bad
+    // file leaves it as it was. ids index the allocator's arrays
+    uint64 slotMask = header->componentCount < 64 ? (1ull << header->componentCount) - 1 : ~0ull;
+    std::vector<uint8> used(capacity, 0);
+    for (uint32 i = 0; i < header->freeCount; i++){
+        if (freeList[i] >= capacity || used[freeList[i]]){
+            SprLog::error("[WorldSnapshot] [load] bad free list: " + path, false);
+            return false;
+        }
+        used[freeList[i]] = 1;
+    }
+    for (uint32 id = 0; id < capacity; id++){
+        if (masks[id] & ~slotMask){
+            SprLog::error("[WorldSnapshot] [load] bad entity mask: " + path, false);
+            return false;
+        }
+    }
+
+    std::vector<LoadGroup> groups(header->groupCount);
+    for (LoadGroup& group : groups){
+        group.header = (const SnapshotGroup*)consume(data, size, offset, sizeof(SnapshotGroup));
+        group.ids = group.header ? (const uint32*)consume(data, size, offset, group.header->count * sizeof(uint32)) : nullptr;
+        if (!group.ids){
+            SprLog::error("[WorldSnapshot] [load] truncated: " + path, false);
+            return false;
+        }
+        if (group.header->mask & ~slotMask){
+            SprLog::error("[WorldSnapshot] [load] bad group mask: " + path, false);
+            return false;
+        }
+        for (uint32 i = 0; i < group.header->count; i++){
+            uint32 id = group.ids[i];
+            if (id >= capacity || used[id]){
+                SprLog::error("[WorldSnapshot] [load] bad entity id: " + path, false);
+                return false;
+            }
+            used[id] = 1;
+        }
+        for (uint32 slot = 0; slot < header->componentCount; slot++){
+            if (!((group.header->mask >> slot) & 0b1))
+                continue;
+            group.columns[slot] = consume(data, size, offset, (uint64)group.header->count * table[slot].elementSize);
+            if (!group.columns[slot]){
+                SprLog::error("[WorldSnapshot] [load] truncated: " + path, false);
+                return false;
+            }
+        }
+    }
+
+    std::vector<LoadChanges> changeLogs;
+    for (uint32 slot = 0; slot < header->componentCount; slot++){
+        if (!table[slot].tracked)
+            continue;
+
+        LoadChanges changes = {slot, nullptr, nullptr, nullptr};
+        changes.header = (const SnapshotChanges*)consume(data, size, offset, sizeof(SnapshotChanges));
+        changes.ticks = changes.header ? (const uint32*)consume(data, size, offset, changes.header->tickCount * sizeof(uint32)) : nullptr;
+        changes.log = changes.ticks ? (const Change*)consume(data, size, offset, changes.header->changeCount * sizeof(Change)) : nullptr;
+        if (!changes.log){
+            SprLog::error("[WorldSnapshot] [load] truncated: " + path, false);
+            return false;
+        }
+        for (uint32 i = 0; i < changes.header->changeCount; i++){
+            if (changes.log[i].id >= changes.header->tickCount){
+                SprLog::error("[WorldSnapshot] [load] bad change log: " + path, false);
+                return false;
+            }
+        }
+        changeLogs.push_back(changes);
+    }
+
+    // allocator
+    allocator.m_generations.assign(generations, generations + capacity);
+    allocator.m_freeList.assign(freeList, freeList + header->freeCount);
+    allocator.m_components.resize(capacity);
+    for (uint32 id = 0; id < capacity; id++){
+        allocator.m_components[id] = remapMask(masks[id], indices);
+    }
+
+    // groups: trie entries are queued, columns copied in bulk
+    for (LoadGroup& group : groups){
+        const uint32* ids = group.ids;
+        uint32 count = group.header->count;
+        uint64 slots = group.header->mask;
+        uint64 mask = remapMask(slots, indices);
+
+        // only unsaved components, nothing to place
+        if (mask == 0)
+            continue;
+
+        for (uint32 i = 0; i < count; i++){
+            Entity entity(ids[i], generations[ids[i]], mask);
+            ecs.entityManager.addEntity(entity);
+        }
+
+        if (components.m_storageType == SPR_STORAGE_ARCHETYPE){
+            components.m_archetypes.insert(mask, ids, count, [&](EntityLocation location, uint32 first, uint32 rows){
+                for (uint32 slot = 0; slot < header->componentCount; slot++){
+                    uint32 index = indices[slot];
+                    if (!((slots >> slot) & 0b1) || !components.isArchetypeStored(1ull << index))
+                        continue;
+                    uint32 elementSize = table[slot].elementSize;
+                    memcpy(location.archetype->get(location.chunk, location.row, index),
+                           group.columns[slot] + (uint64)first * elementSize, (uint64)rows * elementSize);
+                }
+            });
+        }
+
+        for (uint32 slot = 0; slot < header->componentCount; slot++){
+            uint32 index = indices[slot];
+            if (!((slots >> slot) & 0b1) || components.isArchetypeStored(1ull << index))
+                continue;
+            components.m_components[index]->appendData(ids, group.columns[slot], count);
+        }
+    }
+
+    // change tracking state
+    for (LoadChanges& changes : changeLogs){
+        ChangeLog* changeLog = components.m_components[indices[changes.slot]]->getChangeLog();
+        if (!changeLog)
+            continue;
+        changeLog->ticks.assign(changes.ticks, changes.ticks + changes.header->tickCount);
+        changeLog->changes.assign(changes.log, changes.log + changes.header->changeCount);
+        changeLog->logStart = changes.header->logStart;
+    }
+
+    // keep ticks moving forward
+    if (header->tick > components.m_clock.tick)
+        components.m_clock.tick = header->tick;
+    components.m_clock.frameTick = header->frameTick;
+    return true;
+}
+
+}
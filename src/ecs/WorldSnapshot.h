@@ -0,0 +1,78 @@
+#pragma once
+
+#include <string>
+#include "Entity.h"
+
+namespace spr {
+
+class SprECS;
+
+static const uint32 SPR_SNAPSHOT_MAGIC = 0x57525053; // "SPRW"
+static const uint32 SPR_SNAPSHOT_VERSION = 1;
+
+// ╔═ SNAPSHOT ════════════════════════╗
+// ║    SnapshotHeader                 ║
+// ║    SnapshotComponent[components]  ║
+// ║    uint32 generations[capacity]   ║
+// ║    uint64 masks[capacity]         ║
+// ║    uint32 freeList[free]          ║
+// ╠═ GROUP (per distinct mask) ═══════╣
+// ║    SnapshotGroup                  ║
+// ║    uint32 ids[count]              ║
+// ║    A[count], B[count], ...        ║
+// ╠═ CHANGES (per tracked comp) ══════╣
+// ║    SnapshotChanges                ║
+// ║    uint32 ticks[tickCount]        ║
+// ║    Change changes[changeCount]    ║
+// ╚═══════════════════════════════════╝
+// every section starts 16B aligned. masks index the component
+// table, not the runtime component type ids
+
+typedef struct {
+    uint32 magic;
+    uint32 version;
+    uint32 entityCapacity;
+    uint32 freeCount;
+    uint32 componentCount;
+    uint32 groupCount;
+    uint32 tick;
+    uint32 frameTick;
+} SnapshotHeader;
+
+typedef struct {
+    uint64 typeHash;
+    uint32 elementSize;
+    uint32 tracked;
+} SnapshotComponent;
+
+typedef struct {
+    uint64 mask;
+    uint32 count;
+    uint32 padding;
+} SnapshotGroup;
+
+typedef struct {
+    uint32 logStart;
+    uint32 tickCount;
+    uint32 changeCount;
+    uint32 padding;
+} SnapshotChanges;
+
+// whole world to/from one flat file. component data is stored
+// column-wise per group of entities with the same mask, so loading
+// is a memcpy per column straight from the mapped file (trie and
+// sparse registries are the only per entity fixups).
+// only trivially copyable components are saved
+class WorldSnapshot {
+public:
+    // save at a sync point (after update), so no destroyed
+    // entities are waiting to be released
+    static bool save(SprECS& ecs, const std::string& path);
+
+    // load into a world with no entities and the same components
+    // registered. entities show up in queries after the next update,
+    // same as after createEntity
+    static bool load(SprECS& ecs, const std::string& path);
+};
+
+}
@@ -16,6 +16,8 @@
 #include "debug/SprLog.h"
 #include <iostream>
 #include <string>
+#include <cmath>
+#include <algorithm>
 #include<unistd.h>  
 
 
@@ -47,53 +49,85 @@ void SceneManager::init(VulkanResourceManager& rm){
 
 
 void SceneManager::insertDraws(uint32 frame, uint32 id, Span<uint32> meshIds, Span<uint32> materialsFlags, uint32 transformIndex, bool sharedMaterial){
+    InstanceDraws& instance = m_instances[frame % MAX_FRAME_COUNT][id];
+    instance.transformIndex = transformIndex;
+    const Transform& transform = m_transforms[frame % MAX_FRAME_COUNT][transformIndex];
+
     for (uint32 i = 0; i < meshIds.size(); i++){
         // get mesh data and fill draw
         MeshInfo& meshInfo = m_meshInfo[meshIds[i]];
         DrawData draw = {
             .vertexOffset   = meshInfo.vertexOffset,  
             .materialIndex  = meshInfo.materialIndex, 
-            .transformIndex = transformIndex
+            .transformIndex = transformIndex,
+            .decodeIndex    = meshInfo.decodeIndex
         };
 
         // fill out batch info, which will either initialize
         // a new batch or update an existing one
+        uint32 lod = selectLod(meshInfo, transform);
         Batch batchInfo = {
             .meshId         = meshIds[i],
             .materialFlags  = !sharedMaterial ? materialsFlags[i] : materialsFlags[0],
-            .indexCount     = meshInfo.indexCount,
-            .firstIndex     = meshInfo.firstIndex,
+            .indexCount     = meshInfo.lods[lod].indexCount,
+            .firstIndex     = meshInfo.lods[lod].firstIndex,
             .drawDataOffset = 0,
-            .drawCount      = 1
+            .drawCount      = 1,
+            .lod            = lod
         };
 
         m_batchManagers[frame % MAX_FRAME_COUNT].addDraw(draw, batchInfo);
+        instance.meshIds.push_back(batchInfo.meshId);
+        instance.materialFlags.push_back(batchInfo.materialFlags);
+        instance.lods.push_back(lod);
     }
 }
 
 void SceneManager::removeDraws(uint32 frame, uint32 id, Span<uint32> meshIds, Span<uint32> materialsFlags, uint32 transformIndex){
+    auto instance = m_instances[frame % MAX_FRAME_COUNT].find(id);
+
     for (uint32 i = 0; i < meshIds.size(); i++){
         // get mesh data and fill draw
         MeshInfo& meshInfo = m_meshInfo[meshIds[i]];
         DrawData draw = {
             .vertexOffset   = meshInfo.vertexOffset,  
             .materialIndex  = meshInfo.materialIndex, 
-            .transformIndex = transformIndex
+            .transformIndex = transformIndex,
+            .decodeIndex    = meshInfo.decodeIndex
         };
 
+        // the draw is in the batch of the lod it was last given
+        uint32 lod = 0;
+        if (instance != m_instances[frame % MAX_FRAME_COUNT].end()){
+            InstanceDraws& draws = instance->second;
+            for (uint32 j = 0; j < draws.meshIds.size(); j++){
+                if (draws.meshIds[j] != meshIds[i])
+                    continue;
+                lod = draws.lods[j];
+                draws.meshIds.erase(draws.meshIds.begin() + j);
+                draws.materialFlags.erase(draws.materialFlags.begin() + j);
+                draws.lods.erase(draws.lods.begin() + j);
+                break;
+            }
+        }
+
         // fill out batch info, which will either initialize
         // a new batch or update an existing one
         Batch batchInfo = {
             .meshId         = meshIds[i],
             .materialFlags  = materialsFlags[i],
-            .indexCount     = meshInfo.indexCount,
-            .firstIndex     = meshInfo.firstIndex,
+            .indexCount     = meshInfo.lods[lod].indexCount,
+            .firstIndex     = meshInfo.lods[lod].firstIndex,
             .drawDataOffset = 0,
-            .drawCount      = 1
+            .drawCount      = 1,
+            .lod            = lod
         };
 
         m_batchManagers[frame % MAX_FRAME_COUNT].removeDraw(draw, batchInfo);
     }
+
+    if (instance != m_instances[frame % MAX_FRAME_COUNT].end() && instance->second.meshIds.empty())
+        m_instances[frame % MAX_FRAME_COUNT].erase(instance);
 }
 
 
@@ -191,6 +225,83 @@ void SceneManager::updateCamera(uint32 frame, glm::vec2 screenDim, const Camera&
     scene.screenDimX = screenDim.x;
     scene.screenDimY = screenDim.y;
     scene.time = SDL_GetTicks();
+
+    // pixels per unit at distance 1, lods are picked against it
+    m_lodCameraPos = camera.pos;
+    m_lodProjScale = screenDim.y * 0.5f * std::abs(proj[1][1]);
+    updateLods(frame);
+}
+
+void SceneManager::getViewDistance(const MeshInfo& meshInfo, const Transform& transform, float& distance, float& scale){
+    // error and bounds are in object space, scaled by the largest axis.
+    // the distance is to the nearest point of the bounding sphere
+    scale = std::max({glm::length(glm::vec3(transform.model[0])),
+                      glm::length(glm::vec3(transform.model[1])),
+                      glm::length(glm::vec3(transform.model[2]))});
+    glm::vec3 center = glm::vec3(transform.model * glm::vec4(glm::vec3(meshInfo.bounds), 1.f));
+    distance = glm::length(center - m_lodCameraPos) - meshInfo.bounds.w * scale;
+}
+
+uint32 SceneManager::selectLod(const MeshInfo& meshInfo, const Transform& transform){
+    if (meshInfo.lodCount < 2 || m_lodProjScale <= 0.f)
+        return 0;
+
+    float distance, scale;
+    getViewDistance(meshInfo, transform, distance, scale);
+    return selectLod(meshInfo, distance, scale);
+}
+
+uint32 SceneManager::selectLod(const MeshInfo& meshInfo, float distance, float scale){
+    if (meshInfo.lodCount < 2 || m_lodProjScale <= 0.f)
+        return 0;
+    return spr::selectLod(meshInfo.lods, meshInfo.lodCount, distance, m_lodProjScale * scale, SPR_LOD_ERROR_PIXELS);
+}
+
+void SceneManager::updateLods(uint32 frame){
+    BatchManager& batchManager = m_batchManagers[frame % MAX_FRAME_COUNT];
+    TempBuffer<Transform>& transforms = m_transforms[frame % MAX_FRAME_COUNT];
+
+    // move draws whose lod changed to that lod's batch
+    for (auto& [id, instance] : m_instances[frame % MAX_FRAME_COUNT]){
+        const Transform& transform = transforms[instance.transformIndex];
+        for (uint32 i = 0; i < instance.meshIds.size(); i++){
+            MeshInfo& meshInfo = m_meshInfo[instance.meshIds[i]];
+            float distance, scale;
+            getViewDistance(meshInfo, transform, distance, scale);
+
+            // texture mips by the pixels the bounds cover, the
+            // finest if the camera is inside them
+            float pixels = distance > 0.f ? 2.f * meshInfo.bounds.w * scale * m_lodProjScale / distance : 0.f;
+            m_assetLoader.requestTextures(meshInfo.materialIndex, pixels);
+
+            uint32 lod = selectLod(meshInfo, distance, scale);
+            if (lod == instance.lods[i])
+                continue;
+
+            DrawData draw = {
+                .vertexOffset   = meshInfo.vertexOffset,
+                .materialIndex  = meshInfo.materialIndex,
+                .transformIndex = instance.transformIndex,
+                .decodeIndex    = meshInfo.decodeIndex
+            };
+            Batch batchInfo = {
+                .meshId         = instance.meshIds[i],
+                .materialFlags  = instance.materialFlags[i],
+                .indexCount     = meshInfo.lods[instance.lods[i]].indexCount,
+                .firstIndex     = meshInfo.lods[instance.lods[i]].firstIndex,
+                .drawDataOffset = 0,
+                .drawCount      = 1,
+                .lod            = instance.lods[i]
+            };
+            batchManager.removeDraw(draw, batchInfo);
+
+            batchInfo.indexCount = meshInfo.lods[lod].indexCount;
+            batchInfo.firstIndex = meshInfo.lods[lod].firstIndex;
+            batchInfo.lod = lod;
+            batchManager.addDraw(draw, batchInfo);
+            instance.lods[i] = lod;
+        }
+    }
 }
 
 
@@ -207,6 +318,11 @@ void SceneManager::uploadGlobalResources(UploadHandler& uploadHandler){
     
     uploadHandler.uploadManagedBuffer<VertexAttributes>(m_assetLoader.getVertexAttributeData(), m_attributesBuffer);
     uploadHandler.uploadManagedBuffer<VertexPosition>(m_assetLoader.getVertexPositionData(), m_positionsBuffer);
+    if (m_assetLoader.getPrimitiveCounts().quantizedVertexCount > 0){
+        uploadHandler.uploadManagedBuffer<VertexPositionQ>(m_assetLoader.getQuantizedPositionData(), m_positionsQBuffer);
+        uploadHandler.uploadManagedBuffer<VertexAttributesQ>(m_assetLoader.getQuantizedAttributeData(), m_attributesQBuffer);
+        uploadHandler.uploadManagedBuffer<VertexDecode>(m_assetLoader.getVertexDecodeData(), m_vertexDecodesBuffer);
+    }
     uploadHandler.uploadManagedBuffer<uint32>(m_assetLoader.getVertexIndicesData(), m_indexBuffer);
     uploadHandler.uploadManagedBuffer<MaterialData>(m_assetLoader.getMaterialData(), m_materialsBuffer);
 }
@@ -229,6 +345,60 @@ void SceneManager::uploadPerFrameResources(UploadHandler& uploadHandler, uint32
     
     m_batchManagers[frame % MAX_FRAME_COUNT].getDrawData(m_drawData[frame % MAX_FRAME_COUNT]);
     uploadHandler.uploadDyanmicBuffer<DrawData>({m_drawData[frame % MAX_FRAME_COUNT]}, m_drawDataBuffer);
+
+    // streamed textures whose resident mips changed get an image of just
+    // those, each frame's set is moved to it before the old one goes
+    m_assetLoader.updateStreaming(m_streamedMips);
+    for (TextureMipUpload& upload : m_streamedMips){
+        Handle<Texture> texture = m_textures[upload.texture];
+        m_textures[upload.texture] = createTexture(m_assetLoader.getTextureData()[upload.texture], upload.firstMip);
+        uploadHandler.uploadTexture<uint8>(upload.data, m_textures[upload.texture]);
+        m_textureSwaps.push_back({.index = upload.texture, .texture = texture});
+    }
+    for (TextureSwap& swap : m_textureSwaps){
+        m_rm->updateTexture(m_globalDescriptorSet, 3, swap.index, m_textures[swap.index], frame);
+        if (--swap.budget == 0)
+            m_rm->remove<Texture>(swap.texture);
+    }
+    std::erase_if(m_textureSwaps, [](TextureSwap& swap){ return swap.budget == 0; });
+
+    // hot reloads, over what was uploaded for the asset
+    m_assetLoader.getReloads(m_reloads);
+    for (ReloadUpload& reload : m_reloads){
+        switch (reload.target){
+            case RELOAD_INDICES:
+                uploadHandler.uploadBufferRange<uint8>(reload.data, m_indexBuffer, reload.offset);
+                break;
+            case RELOAD_POSITIONS:
+                uploadHandler.uploadBufferRange<uint8>(reload.data, m_positionsBuffer, reload.offset);
+                break;
+            case RELOAD_ATTRIBUTES:
+                uploadHandler.uploadBufferRange<uint8>(reload.data, m_attributesBuffer, reload.offset);
+                break;
+            case RELOAD_POSITIONS_Q:
+                uploadHandler.uploadBufferRange<uint8>(reload.data, m_positionsQBuffer, reload.offset);
+                break;
+            case RELOAD_ATTRIBUTES_Q:
+                uploadHandler.uploadBufferRange<uint8>(reload.data, m_attributesQBuffer, reload.offset);
+                break;
+            case RELOAD_DECODES:
+                uploadHandler.uploadBufferRange<uint8>(reload.data, m_vertexDecodesBuffer, reload.offset);
+                break;
+            case RELOAD_MATERIALS:
+                uploadHandler.uploadBufferRange<uint8>(reload.data, m_materialsBuffer, reload.offset);
+                break;
+            case RELOAD_TEXTURE: {
+                uint32 lastMip = m_assetLoader.getTextureData()[reload.offset].mipCount - 1;
+                uploadHandler.uploadTextureMips<uint8>(reload.data, m_textures[reload.offset], reload.firstMip, lastMip);
+                break;
+            }
+            case RELOAD_CUBEMAP: {
+                uint32 lastMip = m_assetLoader.getCubemapData()[reload.offset].mipCount - 1;
+                uploadHandler.uploadTextureMips<uint8>(reload.data, m_cubemaps[reload.offset], reload.firstMip, lastMip);
+                break;
+            }
+        }
+    }
 }
 
 
@@ -328,6 +498,10 @@ void SceneManager::initializeAssets(SprResourceManager &rm, VulkanDevice* device
     }
 }
 
+void SceneManager::reloadAsset(SprResourceManager& rm, uint32 assetId){
+    m_assetLoader.reloadAsset(rm, assetId, m_meshInfo);
+}
+
 void SceneManager::initBuffers(PrimitiveCounts counts, VulkanDevice* device){
     // per frame resource handles
     m_lightsBuffer = m_rm->create<Buffer>({
@@ -380,6 +554,29 @@ void SceneManager::initBuffers(PrimitiveCounts counts, VulkanDevice* device){
         .memType = DEVICE
     });
     
+    // quantized meshes, decoded in the vertex shaders. a scene may
+    // have none, the buffers still need a size to be bound
+    m_positionsQBuffer = m_rm->create<Buffer>({
+        .byteSize = (uint32) (std::max(counts.quantizedVertexCount, 1u) * sizeof(VertexPositionQ)),
+        .usage = Flags::BufferUsage::BU_STORAGE_BUFFER |
+                 Flags::BufferUsage::BU_TRANSFER_DST,
+        .memType = DEVICE
+    });
+
+    m_attributesQBuffer = m_rm->create<Buffer>({
+        .byteSize = (uint32) (std::max(counts.quantizedVertexCount, 1u) * sizeof(VertexAttributesQ)),
+        .usage = Flags::BufferUsage::BU_STORAGE_BUFFER |
+                 Flags::BufferUsage::BU_TRANSFER_DST,
+        .memType = DEVICE
+    });
+
+    m_vertexDecodesBuffer = m_rm->create<Buffer>({
+        .byteSize = (uint32) (std::max(counts.decodeCount, 1u) * sizeof(VertexDecode)),
+        .usage = Flags::BufferUsage::BU_STORAGE_BUFFER |
+                 Flags::BufferUsage::BU_TRANSFER_DST,
+        .memType = DEVICE
+    });
+    
     m_indexBuffer = m_rm->create<Buffer>({
         .byteSize = (uint32) (counts.indexCount * sizeof(uint32)),
         .usage = Flags::BufferUsage::BU_INDEX_BUFFER   |
@@ -399,22 +596,7 @@ void SceneManager::initTextures(PrimitiveCounts counts, VulkanDevice* device){
     m_textures.resize(counts.textureCount);
     std::vector<TextureInfo>& textureData = m_assetLoader.getTextureData();
     for (uint32 i = 0; i < counts.textureCount; i++){
-        TextureInfo& info = textureData[i];
-
-        m_textures[i] = m_rm->create<Texture>({
-            .dimensions = {
-                info.width,
-                info.height,
-                1
-            },
-            .format = info.format,
-            .usage = Flags::ImageUsage::IU_SAMPLED |
-                     Flags::ImageUsage::IU_TRANSFER_DST,
-            .view = { 
-                .mips = info.mipCount,
-                .layers = info.layerCount
-            }
-        });
+        m_textures[i] = createTexture(textureData[i], textureData[i].firstMip);
     }
 
     m_cubemaps.resize(counts.cubemapCount);
@@ -439,6 +621,24 @@ void SceneManager::initTextures(PrimitiveCounts counts, VulkanDevice* device){
     }
 }
 
+Handle<Texture> SceneManager::createTexture(const TextureInfo& info, uint32 firstMip){
+    // streamed textures' images start at their finest resident mip
+    return m_rm->create<Texture>({
+        .dimensions = {
+            std::max(info.width >> firstMip, 1u),
+            std::max(info.height >> firstMip, 1u),
+            1
+        },
+        .format = info.format,
+        .usage = Flags::ImageUsage::IU_SAMPLED |
+                 Flags::ImageUsage::IU_TRANSFER_DST,
+        .view = { 
+            .mips = info.mipCount - firstMip,
+            .layers = info.layerCount
+        }
+    });
+}
+
 void SceneManager::initDescriptorSets(VulkanDevice* device){
     // global (set = 0)
     m_globalDescriptorSetLayout = m_rm->create<DescriptorSetLayout>({
@@ -449,7 +649,10 @@ void SceneManager::initDescriptorSets(VulkanDevice* device){
         .buffers = {
             {.binding = 0, .type = Flags::DescriptorType::STORAGE_BUFFER},
             {.binding = 1, .type = Flags::DescriptorType::STORAGE_BUFFER},
-            {.binding = 2, .type = Flags::DescriptorType::STORAGE_BUFFER}
+            {.binding = 2, .type = Flags::DescriptorType::STORAGE_BUFFER},
+            {.binding = 5, .type = Flags::DescriptorType::STORAGE_BUFFER},
+            {.binding = 6, .type = Flags::DescriptorType::STORAGE_BUFFER},
+            {.binding = 7, .type = Flags::DescriptorType::STORAGE_BUFFER}
         }
     });
     m_globalDescriptorSet = m_rm->create<DescriptorSet>({
@@ -460,9 +663,13 @@ void SceneManager::initDescriptorSets(VulkanDevice* device){
         .buffers = {
             {.buffer = m_positionsBuffer},
             {.buffer = m_attributesBuffer},
-            {.buffer = m_materialsBuffer}
+            {.buffer = m_materialsBuffer},
+            {.buffer = m_positionsQBuffer},
+            {.buffer = m_attributesQBuffer},
+            {.buffer = m_vertexDecodesBuffer}
         },
-        .layout = m_globalDescriptorSetLayout
+        .layout = m_globalDescriptorSetLayout,
+        .perFrame = true    // streamed textures are swapped a frame at a time
     });
 
     // per-frame (set = 1)
@@ -506,6 +713,8 @@ void SceneManager::reset(uint32 frame) {
 }
 
 void SceneManager::destroy(){
+    m_assetLoader.stopStreaming();
+
     // destroy per-frame batch managers
     for (uint32 i = 0; i < MAX_FRAME_COUNT; i++)
         m_batchManagers[i].destroy();
@@ -531,10 +740,15 @@ void SceneManager::destroy(){
     // destroy global resources
     m_rm->remove<Buffer>(m_positionsBuffer);
     m_rm->remove<Buffer>(m_attributesBuffer);
+    m_rm->remove<Buffer>(m_positionsQBuffer);
+    m_rm->remove<Buffer>(m_attributesQBuffer);
+    m_rm->remove<Buffer>(m_vertexDecodesBuffer);
     m_rm->remove<Buffer>(m_indexBuffer);
     m_rm->remove<Buffer>(m_materialsBuffer);
     for (Handle<Texture> texture : m_textures)
         m_rm->remove<Texture>(texture);
+    for (TextureSwap& swap : m_textureSwaps)
+        m_rm->remove<Texture>(swap.texture);
     for (Handle<Texture> cubemap : m_cubemaps)
         m_rm->remove<Texture>(cubemap);
     m_rm->remove<DescriptorSet>(m_globalDescriptorSet);
@@ -23,11 +23,27 @@ struct DescriptorSetLayout;
 struct Buffer;
 struct Texture;
 
+// an instance's draws, their lods follow the camera
+typedef struct InstanceDraws {
+    uint32 transformIndex = 0;
+    std::vector<uint32> meshIds;
+    std::vector<uint32> materialFlags;
+    std::vector<uint32> lods;
+} InstanceDraws;
+
 typedef struct TransformUpdate {
     uint32 index = 0;
     uint32 budget = MAX_FRAME_COUNT;
 } TransformUpdate;
 
+// a streamed texture's replaced image, removed once
+// every frame's descriptor set has the new one
+typedef struct TextureSwap {
+    uint32 index = 0;
+    Handle<Texture> texture;
+    uint32 budget = MAX_FRAME_COUNT;
+} TextureSwap;
+
 class SceneManager {
 public:
     SceneManager();
@@ -56,6 +72,9 @@ public:
 
     void initializeAssets(SprResourceManager& rm, VulkanDevice* device);
 
+    // a hot reloaded asset, its data is uploaded with the next frame
+    void reloadAsset(SprResourceManager& rm, uint32 assetId);
+
     Handle<DescriptorSet> getGlobalDescriptorSet();
     Handle<DescriptorSetLayout> getGlobalDescriptorSetLayout();
     Handle<DescriptorSet> getPerFrameDescriptorSet();
@@ -82,15 +101,36 @@ private:
     bool m_destroyed = false;
 
     ska::flat_hash_map<uint32, uint32> m_idTransformIndexMap;
+
+    // per frame, by instance id. lods are picked against the last camera
+    ska::flat_hash_map<uint32, InstanceDraws> m_instances[MAX_FRAME_COUNT];
+    glm::vec3 m_lodCameraPos = glm::vec3(0.f);
+    float m_lodProjScale = 0.f;
     std::vector<TransformUpdate> m_transformUpdates;
     std::deque<uint32> m_updatesFreelist;
 
+    // streamed textures' new mips, alive until the next frame
+    std::vector<TextureMipUpload> m_streamedMips;
+    std::vector<TextureSwap> m_textureSwaps;
+
+    // hot reloaded data, alive until the next frame
+    std::vector<ReloadUpload> m_reloads;
+
     void initBuffers(PrimitiveCounts counts, VulkanDevice* device);
     void initTextures(PrimitiveCounts counts, VulkanDevice* device);
+    Handle<Texture> createTexture(const TextureInfo& info, uint32 firstMip);
     void initDescriptorSets(VulkanDevice* device);
 
     void queueTransformUpdate(uint32 index);
 
+    // lod by the screen error at the mesh's bounds, 0 without a camera
+    uint32 selectLod(const MeshInfo& meshInfo, const Transform& transform);
+    uint32 selectLod(const MeshInfo& meshInfo, float distance, float scale);
+    void getViewDistance(const MeshInfo& meshInfo, const Transform& transform, float& distance, float& scale);
+
+    // lods and streamed texture mips, by the last camera
+    void updateLods(uint32 frame);
+
 private: // owning
     // per frame resource handles
     Handle<Buffer> m_lightsBuffer;
@@ -104,6 +144,9 @@ private: // owning
     // global resource handles
     Handle<Buffer> m_positionsBuffer;  
     Handle<Buffer> m_attributesBuffer;
+    Handle<Buffer> m_positionsQBuffer;
+    Handle<Buffer> m_attributesQBuffer;
+    Handle<Buffer> m_vertexDecodesBuffer;
     Handle<Buffer> m_indexBuffer;
     Handle<Buffer> m_materialsBuffer;
     std::vector<Handle<Texture>> m_textures;
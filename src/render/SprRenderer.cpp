@@ -46,6 +46,12 @@ void SprRenderer::loadAssets(SprResourceManager& rm){
     m_renderCoordinator.initRenderers(m_sceneManager);
 }
 
+void SprRenderer::reloadAsset(uint32 assetId){
+    // frames in flight still read the data being written over
+    m_renderer.wait();
+    m_sceneManager.reloadAsset(*m_srm, assetId);
+}
+
 
 // ╔══════════════════════════════════════════════════════════════════════════╗
 // ║     render                                                               ║
@@ -110,8 +116,7 @@ void SprRenderer::insertModel(uint32 id, uint32 modelId, const gfx::Transform& t
     Span<uint32> meshIds = model->meshIds;
     
     uint32 materialsFlags[meshIds.size()];
-    for(uint32 i = 0; i < meshIds.size(); i++)
-        materialsFlags[i] = m_srm->getData<Mesh>(meshIds[i])->materialFlags;
+    getMaterialFlags(meshIds, materialsFlags);
     
     for (uint32 i = 0; i < gfx::MAX_FRAME_COUNT; i++){
         m_sceneManager.insertMeshes(m_frameId+i, id, meshIds, {materialsFlags, meshIds.size()}, transform);
@@ -131,8 +136,7 @@ void SprRenderer::insertModel(uint32 id, uint32 modelId){
     Span<uint32> meshIds = model->meshIds;
     
     uint32 materialsFlags[meshIds.size()];
-    for(uint32 i = 0; i < meshIds.size(); i++)
-        materialsFlags[i] = m_srm->getData<Mesh>(meshIds[i])->materialFlags;
+    getMaterialFlags(meshIds, materialsFlags);
 
     m_sceneManager.insertMeshes(m_frameId, id, meshIds, {materialsFlags, meshIds.size()});
 }
@@ -149,8 +153,7 @@ void SprRenderer::removeModel(uint32 id, uint32 modelId){
     Span<uint32> meshIds = model->meshIds;
     
     uint32 materialsFlags[meshIds.size()];
-    for(uint32 i = 0; i < meshIds.size(); i++)
-        materialsFlags[i] = m_srm->getData<Mesh>(meshIds[i])->materialFlags;
+    getMaterialFlags(meshIds, materialsFlags);
 
     m_sceneManager.removeMeshes(m_frameId, id, meshIds, {materialsFlags, meshIds.size()});
 }
@@ -165,13 +168,19 @@ void SprRenderer::updateModel(uint32 id, uint32 modelId, const gfx::Transform& t
     Span<uint32> meshIds = model->meshIds;
     
     uint32 materialsFlags[meshIds.size()];
-    for(uint32 i = 0; i < meshIds.size(); i++)
-        materialsFlags[i] = m_srm->getData<Mesh>(meshIds[i])->materialFlags;
+    getMaterialFlags(meshIds, materialsFlags);
 
     m_sceneManager.updateMeshes(m_frameId, id, meshIds, {materialsFlags, meshIds.size()}, transform);
 }
 
 
+void SprRenderer::getMaterialFlags(Span<uint32> meshIds, uint32* materialFlags){
+    spr::Mesh* meshes[meshIds.size()];
+    m_srm->getData<Mesh>(meshIds, meshes);
+    for (uint32 i = 0; i < meshIds.size(); i++)
+        materialFlags[i] = meshes[i]->materialFlags;
+}
+
 gfx::Transform SprRenderer::buildTransform(const TransformInfo &info){
     mat4 translation = translate(mat4(1.f), info.position);
     mat4 rotation = glm::mat4_cast(info.rotation);
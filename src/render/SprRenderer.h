@@ -30,6 +30,9 @@ public:
     ~SprRenderer();
     void loadAssets(SprResourceManager& rm);
 
+    // re-upload a hot reloaded asset, see SprResourceManager::setReloadCallback
+    void reloadAsset(uint32 assetId);
+
     // render accumulated scene
     void render();
 
@@ -74,5 +77,8 @@ private:
     // non-owning
     SprWindow* m_window;
     SprResourceManager* m_srm;
+
+    // material flags of every mesh, one batched lookup
+    void getMaterialFlags(Span<uint32> meshIds, uint32* materialFlags);
 };
 }
\ No newline at end of file
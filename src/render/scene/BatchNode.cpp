@@ -17,7 +17,7 @@ BatchNode::BatchNode(uint32 height){
     if (m_height > 0){
         m_nodeData = std::vector<BatchNode*>(16);
     } else {
-        m_leafData = std::vector<ska::flat_hash_map<uint32, DrawBatch>>(16);
+        m_leafData = std::vector<ska::flat_hash_map<uint64, DrawBatch>>(16);
     }
 }
 BatchNode::~BatchNode() {
@@ -202,47 +202,49 @@ void BatchNode::getDrawsRec(MaterialQuery query, TempBuffer<DrawData>& result, Q
 
 
 void BatchNode::addLeafData(uint32 branchIndex, DrawData draw, Batch batchInfo){
-    ska::flat_hash_map<uint32, DrawBatch>& leafNode = m_leafData.at(branchIndex);
+    ska::flat_hash_map<uint64, DrawBatch>& leafNode = m_leafData.at(branchIndex);
     setBit(branchIndex, 1);
+    uint64 key = batchKey(batchInfo);
 
-    // insert a new drawbatch if none exists for this material/mesh pair
-    if (!leafNode.count(batchInfo.meshId)) {
-        leafNode[batchInfo.meshId] = DrawBatch();
-        leafNode[batchInfo.meshId].batch = batchInfo;
+    // insert a new drawbatch if none exists for this mesh/lod pair
+    if (!leafNode.count(key)) {
+        leafNode[key] = DrawBatch();
+        leafNode[key].batch = batchInfo;
     } else {
-        leafNode[batchInfo.meshId].batch.drawCount++;
+        leafNode[key].batch.drawCount++;
     }
 
     // add draw to existing draw batch 
-    leafNode[batchInfo.meshId].draws.push_back(draw);
+    leafNode[key].draws.push_back(draw);
 }
 
 void BatchNode::removeLeafData(uint32 branchIndex, DrawData draw, Batch batchInfo){
-    ska::flat_hash_map<uint32, DrawBatch>& leafNode = m_leafData.at(branchIndex);
+    ska::flat_hash_map<uint64, DrawBatch>& leafNode = m_leafData.at(branchIndex);
+    uint64 key = batchKey(batchInfo);
 
     if (leafNode.empty()){
         return;
     }
-    // insert a new drawbatch if none exists for this material/mesh pair
-    if (!leafNode.count(batchInfo.meshId)) {
+    // insert a new drawbatch if none exists for this mesh/lod pair
+    if (!leafNode.count(key)) {
         return;
     } else {
-        //leafNode[batchInfo.meshId].draws.erase(leafNode[batchInfo.meshId].draws.);
+        //leafNode[key].draws.erase(leafNode[key].draws.);
         uint32 index = 0;
-        for (DrawData& drawItem : leafNode[batchInfo.meshId].draws){
+        for (DrawData& drawItem : leafNode[key].draws){
             if (drawItem.transformIndex == draw.transformIndex){
-                leafNode[batchInfo.meshId].draws.erase(leafNode[batchInfo.meshId].draws.begin()+index);
+                leafNode[key].draws.erase(leafNode[key].draws.begin()+index);
                 break;
             }
             index++;
         }
-        leafNode[batchInfo.meshId].batch.drawCount--;
+        leafNode[key].batch.drawCount--;
     }
 }
 
 void BatchNode::removeLeafData(uint32 branchIndex){
     setBit(branchIndex, 0);
-    m_leafData.at(branchIndex) = ska::flat_hash_map<uint32, DrawBatch>();
+    m_leafData.at(branchIndex) = ska::flat_hash_map<uint64, DrawBatch>();
 }
 
 void BatchNode::getLeafBatches(uint32 branchIndex, std::vector<Batch>& dst){
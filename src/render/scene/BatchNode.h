@@ -31,7 +31,7 @@ private:
     uint32 m_height;
     uint32 m_mask;
     std::vector<BatchNode*> m_nodeData;
-    std::vector<ska::flat_hash_map<uint32, DrawBatch>> m_leafData;
+    std::vector<ska::flat_hash_map<uint64, DrawBatch>> m_leafData;     // by batchKey
     bool m_initialized;
 
     typedef struct QueryType {
@@ -45,6 +45,11 @@ private:
     void getBatchesRec(MaterialQuery query, std::vector<Batch>& result, QueryType queryType);
     void getDrawsRec(MaterialQuery query, TempBuffer<DrawData>& result, QueryType queryType);
 
+    // a mesh's lods are batched apart
+    static uint64 batchKey(const Batch& batchInfo){
+        return ((uint64)batchInfo.meshId << 32) | batchInfo.lod;
+    }
+
     void addLeafData(uint32 branchIndex, DrawData draw, Batch batchInfo);
     void removeLeafData(uint32 branchIndex, DrawData draw, Batch batchInfo);
     void removeLeafData(uint32 branchIndex);
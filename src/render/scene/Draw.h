@@ -6,11 +6,14 @@
 
 namespace spr::gfx {
 
+// decodeIndex of meshes with float vertices
+static const uint32 SPR_FLOAT_VERTICES = UINT32_MAX;
+
 typedef struct DrawData {
     uint32 vertexOffset;
     uint32 materialIndex;
     uint32 transformIndex;
-    uint32 padding;
+    uint32 decodeIndex;     // VertexDecode of quantized vertices
 } DrawData;
 
 typedef struct Batch {
@@ -20,6 +23,7 @@ typedef struct Batch {
     uint32 firstIndex;
     uint32 drawDataOffset;
     uint32 drawCount;
+    uint32 lod = 0;     // of the mesh, indexCount/firstIndex are its range
 } Batch;
 
 typedef struct DrawBatch {
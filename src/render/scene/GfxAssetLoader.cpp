@@ -4,14 +4,22 @@
 #include "resource/SprResourceManager.h"
 #include "debug/SprLog.h"
 #include "vulkan/TextureTranscoder.h"
+#include "vulkan/VulkanDevice.h"
 #include "vulkan/resource/VulkanResourceManager.h"
 #include <string>
+#include <memory>
+#include <thread>
+#include <cstring>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
 
 namespace spr::gfx {
 
-GfxAssetLoader::GfxAssetLoader() {}
+GfxAssetLoader::GfxAssetLoader() : m_streamer(this, SPR_STREAM_BUDGET_BYTES) {}
 
 GfxAssetLoader::~GfxAssetLoader(){
+    stopStreaming();
     if (!m_cleared)
         clear();
 }
@@ -19,6 +27,9 @@ GfxAssetLoader::~GfxAssetLoader(){
 MeshInfoMap GfxAssetLoader::loadAssets(SprResourceManager& rm, VulkanResourceManager* vrm, VulkanDevice* device){
     m_vertexPositions = {vrm, 4000000*sizeof(VertexPosition)};
     m_vertexAttributes = {vrm, 4000000*sizeof(VertexAttributes)};
+    m_vertexPositionsQ = {vrm, 4000000*sizeof(VertexPositionQ)};
+    m_vertexAttributesQ = {vrm, 4000000*sizeof(VertexAttributesQ)};
+    m_vertexDecodes = {vrm, 4096*sizeof(VertexDecode)};
     m_vertexIndices = {vrm, 4000000*sizeof(uint32)};
     m_materials = {vrm, 4096*sizeof(MaterialData)};
 
@@ -27,6 +38,21 @@ MeshInfoMap GfxAssetLoader::loadAssets(SprResourceManager& rm, VulkanResourceMan
     m_transcoder = TextureTranscoder(device);
     m_rm = vrm;
 
+    // streamed mips share device memory with everything else
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    vkGetPhysicalDeviceMemoryProperties(device->getPhysicalDevice(), &memoryProperties);
+    uint64 heapBytes = 0;
+    for (uint32 i = 0; i < memoryProperties.memoryHeapCount; i++){
+        if (memoryProperties.memoryHeaps[i].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT)
+            heapBytes = std::max(heapBytes, (uint64)memoryProperties.memoryHeaps[i].size);
+    }
+    if (heapBytes > 0)
+        m_streamer.setBudget(std::min(SPR_STREAM_BUDGET_BYTES, heapBytes / 4));
+
+    // vertex data is copied out right away, older buffers
+    // are unloaded once they pass the budget
+    rm.setBudget<spr::Buffer>(MAX_STORED_BUFFER_BYTES);
+
     MeshInfoMap map;
 
     // built-in assets
@@ -67,7 +93,12 @@ MeshInfoMap GfxAssetLoader::loadAssets(SprResourceManager& rm, VulkanResourceMan
         loadTexture(rm, texId, true);
     }
 
-    rm.disableLoader();
+    transcodeTextures(rm);
+    m_loaded = true;
+
+    // hot reload keeps loading in the background
+    if (!rm.isHotReloadEnabled())
+        rm.disableLoader();
 
     return map;
 }
@@ -87,13 +118,18 @@ void GfxAssetLoader::loadVertexData(SprResourceManager& rm, Mesh* mesh, MeshInfo
             .size = indicesBuffer->byteLength
         });
 
-        info.indexCount = alloc.size;
-        info.firstIndex = alloc.offset;
-        m_counts.indexCount += info.indexCount;
+        // every lod is in the buffer, lod 0 is drawn by default
+        info.lodCount = mesh->lodCount;
+        for (uint32 lod = 0; lod < mesh->lodCount; lod++){
+            info.lods[lod] = mesh->lods[lod];
+            info.lods[lod].firstIndex += alloc.offset;
+        }
+        info.indexCount = info.lods[0].indexCount;
+        info.firstIndex = info.lods[0].firstIndex;
+        m_counts.indexCount += alloc.size;
         m_counts.bytes += alloc.byteSize;
         m_bufferHandles.push_back(indicesHandle);
-        m_storedBuffersBytes += alloc.byteSize;
-        m_indexBufferIds[mesh->indexBufferId] = 1;
+        m_indexBufferIds[mesh->indexBufferId] = {alloc.byteOffset, indicesBuffer->byteLength};
     }
 
     // positions
@@ -105,17 +141,37 @@ void GfxAssetLoader::loadVertexData(SprResourceManager& rm, Mesh* mesh, MeshInfo
         }
         
         spr::Buffer* positionBuffer = rm.getData<spr::Buffer>(positionHandle);
-        auto alloc = m_vertexPositions.allocateAndInsert<VertexPosition>({
-            .data = positionBuffer->data.data(),
-            .size = positionBuffer->byteLength
-        });
+        BufferSlot slot = {0, positionBuffer->byteLength, mesh->vertexFormat == SPR_VERTEX_FORMAT_QUANTIZED};
+        if (slot.quantized){
+            // quantized vertices stay quantized, the vertex shader decodes them
+            auto alloc = m_vertexPositionsQ.allocateAndInsert<VertexPositionQ>({
+                .data = positionBuffer->data.data(),
+                .size = positionBuffer->byteLength
+            });
+            info.decode = {mesh->positionOffset, mesh->positionScale, mesh->uvOffsetScale};
+            auto decodeAlloc = m_vertexDecodes.allocateAndInsert<VertexDecode>(info.decode);
+            info.vertexOffset = alloc.offset;
+            info.vertexFormat = SPR_VERTEX_FORMAT_QUANTIZED;
+            info.decodeIndex = decodeAlloc.offset;
+            info.bounds = getBounds(mesh, positionBuffer);
+            slot.byteOffset = alloc.byteOffset;
+            m_counts.quantizedVertexCount += alloc.size;
+            m_counts.decodeCount++;
+            m_counts.bytes += alloc.byteSize + decodeAlloc.byteSize;
+        } else {
+            auto alloc = m_vertexPositions.allocateAndInsert<VertexPosition>({
+                .data = positionBuffer->data.data(),
+                .size = positionBuffer->byteLength
+            });
+            info.vertexOffset = alloc.offset;
+            info.bounds = getBounds(mesh, positionBuffer);
+            slot.byteOffset = alloc.byteOffset;
+            m_counts.vertexCount += alloc.size;
+            m_counts.bytes += alloc.byteSize;
+        }
 
-        info.vertexOffset = alloc.offset;
-        m_counts.vertexCount += alloc.size;
-        m_counts.bytes += alloc.byteSize;
         m_bufferHandles.push_back(positionHandle);
-        m_storedBuffersBytes += alloc.byteSize;
-        m_positionBufferIds[mesh->positionBufferId] = 1;
+        m_positionBufferIds[mesh->positionBufferId] = slot;
     }
 
     // attributes
@@ -127,24 +183,47 @@ void GfxAssetLoader::loadVertexData(SprResourceManager& rm, Mesh* mesh, MeshInfo
         }
         
         spr::Buffer* attributesBuffer = rm.getData<spr::Buffer>(attributesHandle);
-        auto alloc = m_vertexAttributes.allocateAndInsert<VertexAttributes>({
-            .data = attributesBuffer->data.data(),
-            .size = attributesBuffer->byteLength
-        });
+        BufferSlot slot = {0, attributesBuffer->byteLength, mesh->vertexFormat == SPR_VERTEX_FORMAT_QUANTIZED};
+        if (slot.quantized){
+            auto alloc = m_vertexAttributesQ.allocateAndInsert<VertexAttributesQ>({
+                .data = attributesBuffer->data.data(),
+                .size = attributesBuffer->byteLength
+            });
+            slot.byteOffset = alloc.byteOffset;
+            m_counts.bytes += alloc.byteSize;
+        } else {
+            auto alloc = m_vertexAttributes.allocateAndInsert<VertexAttributes>({
+                .data = attributesBuffer->data.data(),
+                .size = attributesBuffer->byteLength
+            });
+            slot.byteOffset = alloc.byteOffset;
+            m_counts.bytes += alloc.byteSize;
+        }
 
-        m_counts.bytes += alloc.byteSize;
         m_bufferHandles.push_back(attributesHandle);
-        m_storedBuffersBytes += alloc.byteSize;
-        m_attributeBufferIds[mesh->attributesBufferId] = 1;
+        m_attributeBufferIds[mesh->attributesBufferId] = slot;
     } 
+}
 
-    if (m_storedBuffersBytes >= MAX_STORED_BUFFER_BYTES){
-        for (Handle<spr::Buffer> handle : m_bufferHandles){
-            rm.deleteData(handle);
-        }
-        m_storedBuffersBytes = 0;
-        m_bufferHandles.clear();
+glm::vec4 GfxAssetLoader::getBounds(Mesh* mesh, spr::Buffer* positions){
+    // quantized positions span the decode's box
+    if (mesh->vertexFormat == SPR_VERTEX_FORMAT_QUANTIZED){
+        glm::vec3 extent = glm::vec3(mesh->positionScale);
+        return glm::vec4(glm::vec3(mesh->positionOffset) + extent * 0.5f, glm::length(extent) * 0.5f);
+    }
+
+    const VertexPosition* vertices = (const VertexPosition*)positions->data.data();
+    uint32 vertexCount = positions->byteLength / sizeof(VertexPosition);
+    if (vertexCount == 0)
+        return glm::vec4(0.f);
+
+    glm::vec3 minPosition = glm::vec3(FLT_MAX);
+    glm::vec3 maxPosition = glm::vec3(-FLT_MAX);
+    for (uint32 i = 0; i < vertexCount; i++){
+        minPosition = glm::min(minPosition, glm::vec3(vertices[i].vertexPos));
+        maxPosition = glm::max(maxPosition, glm::vec3(vertices[i].vertexPos));
     }
+    return glm::vec4((minPosition + maxPosition) * 0.5f, glm::length(maxPosition - minPosition) * 0.5f);
 }
 
 void GfxAssetLoader::loadMaterial(SprResourceManager& rm, Mesh* mesh, MeshInfo& info){
@@ -157,7 +236,19 @@ void GfxAssetLoader::loadMaterial(SprResourceManager& rm, Mesh* mesh, MeshInfo&
 
     spr::Material* material = rm.getData(materialHandle);
     mesh->materialFlags = material->materialFlags;
+    info.materialFlags = material->materialFlags;
+
+    MaterialData materialData = buildMaterial(rm, material);
+    auto alloc = m_materials.allocateAndInsert<MaterialData>(materialData);
+    m_materialData.resize(std::max((uint32)m_materialData.size(), alloc.offset + 1));
+    m_materialData[alloc.offset] = materialData;
+    
+    info.materialIndex = alloc.offset;
+    m_counts.materialCount++;
+    m_counts.bytes += alloc.byteSize;
+}
 
+MaterialData GfxAssetLoader::buildMaterial(SprResourceManager& rm, spr::Material* material){
     MaterialData materialData;
 
     if (material->baseColorTexId > 0){
@@ -192,12 +283,7 @@ void GfxAssetLoader::loadMaterial(SprResourceManager& rm, Mesh* mesh, MeshInfo&
     if (material->doubleSided){
         materialData.flags |= MTL_DOUBLE_SIDED;
     }
-
-    auto alloc = m_materials.allocateAndInsert<MaterialData>(materialData);
-    
-    info.materialIndex = alloc.offset;
-    m_counts.materialCount++;
-    m_counts.bytes += alloc.byteSize;
+    return materialData;
 }
 
 uint32 GfxAssetLoader::loadTexture(SprResourceManager& rm, uint32 textureId, bool srgb){
@@ -223,32 +309,31 @@ uint32 GfxAssetLoader::loadTexture(SprResourceManager& rm, uint32 textureId, boo
         return m_cubemapIds[texture->bufferId];
     }
 
-    // texture buffer data
+    // a texture a reloaded material added, there's no slot for it
+    if (m_loaded){
+        SprLog::warn("[GfxAssetLoader] [loadTexture] new texture " + std::to_string(textureId) + ", restart to see it");
+        return 0;
+    }
+
+    // texture buffer data, pinned until transcoded
     spr::Buffer* texBuffer = rm.getData<spr::Buffer>(texBufferHandle);
-    m_bufferHandles.push_back(texBufferHandle);
-    m_storedBuffersBytes += texBuffer->byteLength;
-       
-    // transcode from ktx2 to relevant format // TODO!!
-    TranscodeResult result; 
-    m_transcoder.transcode(result, m_rm, (unsigned char*)texBuffer->data.data(), texBuffer->byteLength, texture->width, texture->height);
-    result.transcodedData = {m_rm, result.sizeBytes};
-    m_transcoder.destroyActiveTexture(result, result.sizeBytes);
-    
+    rm.pin(texBufferHandle);
+    const uint8* data = texBuffer->data.data();
+    bool cubemap = TextureTranscoder::getFaceCount(data, texBuffer->byteLength) == 6;
+    if (!cubemap)
+        mapStreamFile(rm, texBuffer);
+
+    // reserve the texture's slot now so indices follow load
+    // order, transcodeTextures fills in the data
     TextureInfo textureInfo = {
-        .data = result.transcodedData,
         .height = texture->height,
         .width = texture->width,
         .components = texture->components,
-        .format = result.format,
-        .mipCount = result.mips,
-        .layerCount = result.layers,
         .srgb = srgb
     };
 
-    m_counts.bytes += result.sizeBytes;
-    
     uint32 index = 0;
-    if (result.layers == 6){
+    if (cubemap){
         index = m_cubemaps.size();
         m_cubemapIds[texture->bufferId] = index;
 
@@ -262,17 +347,543 @@ uint32 GfxAssetLoader::loadTexture(SprResourceManager& rm, uint32 textureId, boo
         m_counts.textureCount++;
     }
 
+    PendingTexture pending = {texBufferHandle, index, cubemap, texBuffer->parentId, texBuffer->byteOffset, texBuffer->byteLength};
+    uint32 size = texBuffer->byteLength;
+    if (!cubemap && extractTail(pending, texBuffer)){
+        data = pending.tail.data();
+        size = pending.tail.size();
+    }
+
+    m_transcodeJobs.push_back({data, size, {}});
+    m_pendingTextures.push_back(std::move(pending));
+
+    return index;
+}
+
+bool GfxAssetLoader::extractTail(PendingTexture& pending, spr::Buffer* texBuffer){
+    const uint8* data = texBuffer->data.data();
+    uint32 size = texBuffer->byteLength;
+
+    // the file has to hold what was loaded (not an older copy of an archived one)
+    auto file = m_streamFiles.find(pending.assetId);
+    if (file == m_streamFiles.end() || !file->second)
+        return false;
+    mio::mmap_source& mapping = *file->second;
+    if ((uint64)pending.byteOffset + size > mapping.size() ||
+        memcmp(mapping.data() + pending.byteOffset, data, std::min(size, 256u)) != 0){
+        SprLog::warn("[GfxAssetLoader] [extractTail] file doesn't match texture " + std::to_string(pending.index) + ", loading every mip");
+        return false;
+    }
+
+    // transcoded sizes aren't known before transcoding, the 4x4 block
+    // targets take about a byte a texel (uncompressed levels say theirs)
+    std::vector<MipLevel> levels;
+    if (!TextureStreamer::readMipLevels(data, size, levels) || levels.size() < 2)
+        return false;
+    TextureInfo& textureInfo = m_textures[pending.index];
+    std::vector<uint64> mipBytes(levels.size());
+    for (uint32 mip = 0; mip < levels.size(); mip++){
+        mipBytes[mip] = levels[mip].uncompressedByteLength ? levels[mip].uncompressedByteLength :
+                        (uint64)std::max(textureInfo.width >> mip, 1u) * std::max(textureInfo.height >> mip, 1u);
+    }
+
+    // small enough to load whole, or not a 2d texture
+    uint32 tailMip = TextureStreamer::getTailMip(mipBytes);
+    if (tailMip == 0 || !TextureStreamer::extractMips(data, size, tailMip, levels.size() - 1, pending.tail))
+        return false;
+
+    pending.firstMip = tailMip;
+    return true;
+}
+
+void GfxAssetLoader::transcodeTextures(SprResourceManager& rm){
+    m_streamIds.assign(m_textures.size(), UINT32_MAX);
+
+    // the loading thread helps, so one less worker
+    std::unique_ptr<ThreadPool> pool;
+    uint32 hardwareThreads = std::thread::hardware_concurrency();
+    if (hardwareThreads > 1)
+        pool = std::make_unique<ThreadPool>(hardwareThreads - 1);
+
+    for (uint32 first = 0; first < m_transcodeJobs.size(); first += SPR_TRANSCODE_BATCH){
+        uint32 count = std::min(SPR_TRANSCODE_BATCH, (uint32)m_transcodeJobs.size() - first);
+        m_transcoder.transcode(m_transcodeJobs.data() + first, count, pool.get());
+
+        // gather into the reserved slots, in order since
+        // staging allocations aren't thread safe
+        for (uint32 i = first; i < first + count; i++){
+            TranscodeResult& result = m_transcodeJobs[i].result;
+            PendingTexture& pending = m_pendingTextures[i];
+
+            TextureInfo& textureInfo = pending.cubemap ? m_cubemaps[pending.index] : m_textures[pending.index];
+            if (result.error != KTX_SUCCESS){
+                // keep the slot usable with a 1x1 magenta texel per layer
+                SprLog::error("[GfxAssetLoader] [transcodeTextures] failed to transcode texture " + std::to_string(pending.index) +
+                              ", code: " + std::string(ktxErrorString(result.error)), false);
+                std::vector<uint32> texels(pending.cubemap ? 6 : 1, 0xFFFF00FF);
+                textureInfo.data = {m_rm, (uint32)(texels.size() * sizeof(uint32))};
+                textureInfo.data.allocateAndInsert<uint32>({
+                    .data = texels.data(),
+                    .size = (uint32)texels.size()
+                });
+                textureInfo.height = 1;
+                textureInfo.width = 1;
+                textureInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+                textureInfo.mipCount = 1;
+                textureInfo.layerCount = texels.size();
+                m_counts.bytes += texels.size() * sizeof(uint32);
+            } else if (pending.firstMip > 0){
+                streamTexture(result, pending, textureInfo);
+                m_transcoder.destroyTexture(result);
+            } else {
+                result.transcodedData = {m_rm, result.sizeBytes};
+                m_transcoder.copyTexture(result);
+
+                textureInfo.data = result.transcodedData;
+                textureInfo.format = result.format;
+                textureInfo.mipCount = result.mips;
+                textureInfo.layerCount = result.layers;
+                m_counts.bytes += result.sizeBytes;
+            }
+
+            rm.unpin(pending.buffer);
+            rm.deleteData(pending.buffer);
+            pending.tail = {};
+        }
+    }
+
+    m_transcodeJobs.clear();
+    m_pendingTextures.clear();
     m_transcoder.reset();
 
-    if (m_storedBuffersBytes >= MAX_STORED_BUFFER_BYTES){
-        for (Handle<spr::Buffer> handle : m_bufferHandles){
-            rm.deleteData(handle);
+    // keep only the files streamed textures are read from
+    ska::flat_hash_map<uint32, std::unique_ptr<mio::mmap_source>> streamFiles;
+    for (StreamSource& source : m_streamSources){
+        auto file = m_streamFiles.find(source.assetId);
+        if (file != m_streamFiles.end() && file->second)
+            streamFiles[source.assetId] = std::move(file->second);
+    }
+    m_streamFiles = std::move(streamFiles);
+
+    // finer mips are transcoded in the background, one texture at a time
+    if (!m_streamSources.empty())
+        m_streamPool = std::make_unique<ThreadPool>(1);
+}
+
+void GfxAssetLoader::mapStreamFile(SprResourceManager& rm, spr::Buffer* texBuffer){
+    if (m_streamFiles.count(texBuffer->parentId) > 0)
+        return;
+
+    // a mapping of our own, the resource manager's are released after
+    // loading. textures only in the archive (no file) aren't streamed
+    std::unique_ptr<mio::mmap_source> file;
+    std::string path = rm.getPath(texBuffer->parentId);
+    if (!path.empty()){
+        std::error_code error;
+        file = std::make_unique<mio::mmap_source>();
+        file->map(path, error);
+        if (error)
+            file = nullptr;
+    }
+    m_streamFiles[texBuffer->parentId] = std::move(file);
+}
+
+void GfxAssetLoader::streamTexture(TranscodeResult& result, PendingTexture& pending, TextureInfo& textureInfo){
+    // result holds the tail, the texture has every mip
+    textureInfo.format = result.format;
+    textureInfo.mipCount = pending.firstMip + result.mips;
+    textureInfo.layerCount = result.layers;
+
+    std::vector<uint64> mipBytes(textureInfo.mipCount);
+    for (uint32 mip = 0; mip < textureInfo.mipCount; mip++){
+        mipBytes[mip] = TextureTranscoder::getImageBytes(result.format, std::max(textureInfo.width >> mip, 1u),
+                                                                        std::max(textureInfo.height >> mip, 1u));
+    }
+
+    m_streamSources.push_back({pending.index, pending.assetId, pending.byteOffset, pending.byteLength, mipBytes, textureInfo.mipCount, {}});
+    m_streamIds[pending.index] = m_streamSources.size() - 1;
+
+    // uploads the tail right away, see upload()
+    m_tail = &result;
+    m_streamer.addTexture(mipBytes, pending.firstMip);
+    m_tail = nullptr;
+}
+
+void GfxAssetLoader::upload(uint32 texture, uint32 firstMip, uint32 lastMip){
+    StreamSource& source = m_streamSources[texture];
+
+    // the tail, transcoded from its first mip with the rest of the loaded data
+    if (m_tail){
+        TextureInfo& textureInfo = m_textures[source.texture];
+        copyMips(m_tail->texture, 0, lastMip - firstMip, source.resident);
+        source.firstMip = firstMip;
+
+        textureInfo.data = {m_rm, (uint32)source.resident.size()};
+        textureInfo.data.allocateAndInsert<uint8>({
+            .data = source.resident.data(),
+            .size = (uint32)source.resident.size()
+        });
+        textureInfo.firstMip = firstMip;
+        m_counts.bytes += source.resident.size();
+        m_streamer.completeUpload(texture, firstMip);
+        return;
+    }
+
+    // finer mips, only they are transcoded from the mapping. the
+    // streamer has one upload per texture in flight at most
+    uint32 byteOffset = source.byteOffset;
+    uint32 byteLength = source.byteLength;
+    const uint8* file = (const uint8*)m_streamFiles.find(source.assetId)->second->data();
+    m_streamPool->submit([this, texture = source.texture, file, byteOffset, byteLength, firstMip, lastMip]{
+        if (m_streamStop)
+            return;
+
+        TextureMipUpload upload = {texture, firstMip, lastMip, {}};
+        std::vector<uint8> mips;
+        if (TextureStreamer::extractMips(file + byteOffset, byteLength, firstMip, lastMip, mips)){
+            TranscodeResult result;
+            m_transcoder.transcode(result, mips.data(), mips.size());
+            if (result.texture)
+                copyMips(result.texture, 0, result.mips - 1, upload.data);
+            m_transcoder.destroyTexture(result);
+        }
+
+        std::lock_guard<std::mutex> lock(m_streamMutex);
+        m_streamedMips.push_back(std::move(upload));
+    }, &m_streamGroup);
+}
+
+void GfxAssetLoader::evict(uint32 texture, uint32 firstMip, uint32 lastMip){
+    // the finest mips are last
+    StreamSource& source = m_streamSources[texture];
+    uint64 bytes = 0;
+    for (uint32 mip = firstMip; mip <= lastMip; mip++){
+        bytes += source.mipBytes[mip];
+    }
+    source.resident.resize(source.resident.size() - std::min(bytes, (uint64)source.resident.size()));
+    source.firstMip = lastMip + 1;
+    queueStreamUpload(source);
+}
+
+void GfxAssetLoader::queueStreamUpload(StreamSource& source){
+    // one new image per texture a frame, the latest mips win
+    TextureMipUpload upload = {source.texture, source.firstMip, m_textures[source.texture].mipCount - 1, source.resident};
+    for (TextureMipUpload& queued : m_streamUploads){
+        if (queued.texture == source.texture){
+            queued = std::move(upload);
+            return;
         }
-        m_storedBuffersBytes = 0;
-        m_bufferHandles.clear();
     }
+    m_streamUploads.push_back(std::move(upload));
+}
 
-    return index;
+void GfxAssetLoader::copyMips(ktxTexture2* texture, uint32 firstMip, uint32 lastMip, std::vector<uint8>& out){
+    const uint8* data = ktxTexture_GetData(ktxTexture(texture));
+    for (uint32 i = 0; i <= lastMip - firstMip; i++){
+        uint32 mip = lastMip - i;
+        ktx_size_t offset = 0;
+        ktxTexture_GetImageOffset(ktxTexture(texture), mip, 0, 0, &offset);
+        ktx_size_t size = ktxTexture_GetImageSize(ktxTexture(texture), mip);
+        out.insert(out.end(), data + offset, data + offset + size);
+    }
+}
+
+void GfxAssetLoader::requestTextures(uint32 materialIndex, float pixels){
+    if (!m_streamPool || materialIndex >= m_materialData.size())
+        return;
+
+    // about a texel a pixel, taking the uvs to span the mesh once
+    MaterialData& material = m_materialData[materialIndex];
+    for (uint32 index : {material.baseColorTexIdx, material.metalRoughTexIdx, material.normalTexIdx,
+                         material.occlusionTexIdx, material.emissiveTexIdx}){
+        uint32 streamId = index < m_streamIds.size() ? m_streamIds[index] : UINT32_MAX;
+        if (streamId == UINT32_MAX)
+            continue;
+
+        TextureInfo& textureInfo = m_textures[index];
+        float texels = std::max(textureInfo.width, textureInfo.height);
+        uint32 mip = pixels > 0.f ? (uint32)std::max(std::floor(std::log2(texels / pixels)), 0.f) : 0;
+        m_streamer.request(streamId, mip);
+    }
+}
+
+void GfxAssetLoader::updateStreaming(std::vector<TextureMipUpload>& uploads){
+    uploads.clear();
+    if (!m_streamPool)
+        return;
+
+    // evictions queue their smaller images right away
+    m_streamer.update();
+
+    m_transcodedMips.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_streamMutex);
+        m_transcodedMips.swap(m_streamedMips);
+    }
+
+    for (TextureMipUpload& transcoded : m_transcodedMips){
+        if (transcoded.data.empty()){
+            SprLog::error("[GfxAssetLoader] [updateStreaming] failed to transcode mips of texture " + std::to_string(transcoded.texture), false);
+            continue;
+        }
+
+        uint32 streamId = m_streamIds[transcoded.texture];
+        StreamSource& source = m_streamSources[streamId];
+        source.resident.insert(source.resident.end(), transcoded.data.begin(), transcoded.data.end());
+        source.firstMip = transcoded.firstMip;
+        queueStreamUpload(source);
+
+        // the new image is uploaded ahead of this frame's draws
+        m_streamer.completeUpload(streamId, transcoded.firstMip);
+    }
+
+    uploads.swap(m_streamUploads);
+}
+
+void GfxAssetLoader::stopStreaming(){
+    if (m_streamPool){
+        m_streamStop = true;
+        m_streamPool->wait(m_streamGroup);
+        m_streamPool = nullptr;
+    }
+    m_streamFiles.clear();
+}
+
+void GfxAssetLoader::reloadAsset(SprResourceManager& rm, uint32 assetId, MeshInfoMap& meshes){
+    if (!m_loaded)
+        return;
+
+    // a texture file
+    for (uint32 texId : rm.getTextureIds()){
+        Handle<spr::Texture> handle = rm.getHandle<spr::Texture>(texId);
+        if (handle.isValid() && rm.getData<spr::Texture>(handle)->parentId == assetId)
+            reloadTexture(rm, texId);
+    }
+
+    // a model file, its meshes, their materials and textures
+    for (uint32 modelId : rm.getModelIds()){
+        Handle<spr::Model> modelHandle = rm.getHandle<spr::Model>(modelId);
+        if (!modelHandle.isValid())
+            continue;
+        spr::Model* model = rm.getData<spr::Model>(modelHandle);
+        if (model->parentId != assetId)
+            continue;
+
+        // textures are shared between materials, reload each once
+        ska::flat_hash_set<uint32> textureIds;
+        std::vector<uint32> meshIds = model->meshIds;
+        for (uint32 meshId : meshIds){
+            Handle<spr::Mesh> meshHandle = rm.getHandle<spr::Mesh>(meshId);
+            auto info = meshes.find(meshId);
+            if (!meshHandle.isValid() || info == meshes.end()){
+                SprLog::warn("[GfxAssetLoader] [reloadAsset] new mesh " + std::to_string(meshId) + ", restart to see it");
+                continue;
+            }
+            spr::Mesh* mesh = rm.getData<spr::Mesh>(meshHandle);
+            reloadVertexData(rm, mesh, info->second);
+
+            Handle<spr::Material> materialHandle = rm.getHandle<spr::Material>(mesh->materialId);
+            if (!materialHandle.isValid()){
+                SprLog::warn("[GfxAssetLoader] [reloadAsset] invalid material");
+                continue;
+            }
+            // draws already in batches are found by their flags
+            spr::Material* material = rm.getData(materialHandle);
+            if (material->materialFlags != info->second.materialFlags)
+                SprLog::warn("[GfxAssetLoader] [reloadAsset] material " + std::to_string(mesh->materialId) + " changed pipeline, restart to see it");
+            mesh->materialFlags = info->second.materialFlags;
+
+            MaterialData materialData = buildMaterial(rm, material);
+            m_materialData[info->second.materialIndex] = materialData;
+            const uint8* bytes = (const uint8*)&materialData;
+            m_reloads.push_back({RELOAD_MATERIALS, (uint32)(info->second.materialIndex * sizeof(MaterialData)), 0,
+                                 std::vector<uint8>(bytes, bytes + sizeof(MaterialData))});
+
+            for (uint32 texId : {material->baseColorTexId, material->metalRoughTexId, material->normalTexId,
+                                 material->occlusionTexId, material->emissiveTexId}){
+                if (texId > 0)
+                    textureIds.insert(texId);
+            }
+        }
+
+        for (uint32 texId : textureIds){
+            Handle<spr::Texture> handle = rm.getHandle<spr::Texture>(texId);
+            if (handle.isValid() && rm.getData<spr::Texture>(handle)->parentId == assetId)
+                reloadTexture(rm, texId);
+        }
+    }
+}
+
+void GfxAssetLoader::reloadVertexData(SprResourceManager& rm, Mesh* mesh, MeshInfo& info){
+    // indices, the lods have to keep their ranges. only the first mesh
+    // of shared buffers has them, the others are skipped like at load
+    auto indices = m_indexBufferIds.find(mesh->indexBufferId);
+    if (mesh->indexBufferId && indices == m_indexBufferIds.end()){
+        SprLog::warn("[GfxAssetLoader] [reloadVertexData] new indices, restart to see them");
+    } else if (indices != m_indexBufferIds.end() && info.lodCount > 0){
+        uint32 baseIndex = info.lods[0].firstIndex - mesh->lods[0].firstIndex;
+        bool sameLods = mesh->lodCount == info.lodCount;
+        for (uint32 lod = 0; sameLods && lod < mesh->lodCount; lod++){
+            sameLods = mesh->lods[lod].indexCount == info.lods[lod].indexCount &&
+                       mesh->lods[lod].firstIndex + baseIndex == info.lods[lod].firstIndex;
+        }
+
+        if (!sameLods){
+            SprLog::warn("[GfxAssetLoader] [reloadVertexData] lods changed, restart to see them");
+        } else if (reloadBuffer(rm, mesh->indexBufferId, indices->second, RELOAD_INDICES)){
+            for (uint32 lod = 0; lod < mesh->lodCount; lod++){
+                info.lods[lod].error = mesh->lods[lod].error;
+            }
+        }
+    }
+
+    bool quantized = mesh->vertexFormat == SPR_VERTEX_FORMAT_QUANTIZED;
+
+    // positions
+    auto positions = m_positionBufferIds.find(mesh->positionBufferId);
+    if (positions != m_positionBufferIds.end() && positions->second.quantized != quantized){
+        SprLog::warn("[GfxAssetLoader] [reloadVertexData] vertex format changed, restart to see it");
+    } else if (positions != m_positionBufferIds.end()){
+        ReloadTarget target = quantized ? RELOAD_POSITIONS_Q : RELOAD_POSITIONS;
+        Handle<spr::Buffer> positionHandle = rm.getHandle<spr::Buffer>(mesh->positionBufferId);
+        if (positionHandle.isValid())
+            info.bounds = getBounds(mesh, rm.getData<spr::Buffer>(positionHandle));
+        if (reloadBuffer(rm, mesh->positionBufferId, positions->second, target) && quantized){
+            // requantized against new bounds
+            info.decode = {mesh->positionOffset, mesh->positionScale, mesh->uvOffsetScale};
+            const uint8* bytes = (const uint8*)&info.decode;
+            m_reloads.push_back({RELOAD_DECODES, (uint32)(info.decodeIndex * sizeof(VertexDecode)), 0,
+                                 std::vector<uint8>(bytes, bytes + sizeof(VertexDecode))});
+        }
+    } else if (mesh->positionBufferId){
+        SprLog::warn("[GfxAssetLoader] [reloadVertexData] new positions, restart to see them");
+    }
+
+    // attributes
+    auto attributes = m_attributeBufferIds.find(mesh->attributesBufferId);
+    if (attributes != m_attributeBufferIds.end() && attributes->second.quantized != quantized){
+        SprLog::warn("[GfxAssetLoader] [reloadVertexData] vertex format changed, restart to see it");
+    } else if (attributes != m_attributeBufferIds.end()){
+        reloadBuffer(rm, mesh->attributesBufferId, attributes->second, quantized ? RELOAD_ATTRIBUTES_Q : RELOAD_ATTRIBUTES);
+    } else if (mesh->attributesBufferId){
+        SprLog::warn("[GfxAssetLoader] [reloadVertexData] new attributes, restart to see them");
+    }
+}
+
+bool GfxAssetLoader::reloadBuffer(SprResourceManager& rm, uint32 bufferId, BufferSlot& slot, ReloadTarget target){
+    Handle<spr::Buffer> handle = rm.getHandle<spr::Buffer>(bufferId);
+    if (!handle.isValid()){
+        SprLog::warn("[GfxAssetLoader] [reloadBuffer] invalid buffer");
+        return false;
+    }
+
+    // the slot was sized at load, everything after it is another mesh's
+    spr::Buffer* buffer = rm.getData<spr::Buffer>(handle);
+    bool fits = buffer->byteLength == slot.byteSize;
+    if (fits){
+        const uint8* data = buffer->data.data();
+        m_reloads.push_back({target, slot.byteOffset, 0, std::vector<uint8>(data, data + buffer->byteLength)});
+    } else {
+        SprLog::warn("[GfxAssetLoader] [reloadBuffer] buffer " + std::to_string(bufferId) + " changed size, restart to see it");
+    }
+
+    rm.deleteData(handle);
+    return fits;
+}
+
+void GfxAssetLoader::reloadTexture(SprResourceManager& rm, uint32 textureId){
+    Handle<spr::Texture> handle = rm.getHandle<spr::Texture>(textureId);
+    if (!handle.isValid())
+        return;
+    spr::Texture* texture = rm.getData<spr::Texture>(handle);
+
+    bool cubemap = false;
+    uint32 index = 0;
+    if (m_textureIds.count(texture->bufferId) > 0){
+        index = m_textureIds[texture->bufferId];
+    } else if (m_cubemapIds.count(texture->bufferId) > 0){
+        index = m_cubemapIds[texture->bufferId];
+        cubemap = true;
+    } else {
+        SprLog::warn("[GfxAssetLoader] [reloadTexture] new texture " + std::to_string(textureId) + ", restart to see it");
+        return;
+    }
+
+    Handle<spr::Buffer> bufferHandle = rm.getHandle<spr::Buffer>(texture->bufferId);
+    if (!bufferHandle.isValid()){
+        SprLog::warn("[GfxAssetLoader] [reloadTexture] invalid buffer");
+        return;
+    }
+    spr::Buffer* buffer = rm.getData<spr::Buffer>(bufferHandle);
+
+    TranscodeResult result;
+    m_transcoder.transcode(result, buffer->data.data(), buffer->byteLength);
+
+    // the image was created for the old one
+    TextureInfo& textureInfo = cubemap ? m_cubemaps[index] : m_textures[index];
+    if (result.error != KTX_SUCCESS){
+        SprLog::error("[GfxAssetLoader] [reloadTexture] failed to transcode texture " + std::to_string(index) +
+                      ", code: " + std::string(ktxErrorString(result.error)), false);
+    } else if (result.format != textureInfo.format || result.mips != textureInfo.mipCount || result.layers != textureInfo.layerCount ||
+               texture->width != textureInfo.width || texture->height != textureInfo.height){
+        SprLog::warn("[GfxAssetLoader] [reloadTexture] texture " + std::to_string(index) + " changed size or format, restart to see it");
+    } else {
+        uint32 streamId = cubemap ? UINT32_MAX : m_streamIds[index];
+        if (streamId != UINT32_MAX){
+            if (m_streamPool)
+                m_streamPool->wait(m_streamGroup);
+
+            StreamSource& source = m_streamSources[streamId];
+            source.byteOffset = buffer->byteOffset;
+            source.byteLength = buffer->byteLength;
+            remapStreamFile(rm, source.assetId);
+
+            // transcoded from the old file, not uploaded yet
+            {
+                std::lock_guard<std::mutex> lock(m_streamMutex);
+                for (TextureMipUpload& upload : m_streamedMips){
+                    if (upload.texture != index || upload.data.empty())
+                        continue;
+                    upload.data.clear();
+                    copyMips(result.texture, upload.firstMip, upload.lastMip, upload.data);
+                }
+            }
+
+            // a new image of the mips it has now, finer ones
+            // are read from the new file as they come in
+            source.resident.clear();
+            copyMips(result.texture, source.firstMip, result.mips - 1, source.resident);
+            queueStreamUpload(source);
+        } else {
+            ReloadUpload upload = {cubemap ? RELOAD_CUBEMAP : RELOAD_TEXTURE, index, 0, {}};
+            copyMips(result.texture, 0, result.mips - 1, upload.data);
+            m_reloads.push_back(std::move(upload));
+        }
+    }
+
+    m_transcoder.destroyTexture(result);
+    rm.deleteData(bufferHandle);
+}
+
+void GfxAssetLoader::remapStreamFile(SprResourceManager& rm, uint32 assetId){
+    // saves replace the file, the old mapping still reads the old one
+    std::unique_ptr<mio::mmap_source> file;
+    std::string path = rm.getPath(assetId);
+    if (!path.empty()){
+        std::error_code error;
+        file = std::make_unique<mio::mmap_source>();
+        file->map(path, error);
+        if (error){
+            SprLog::warn("[GfxAssetLoader] [remapStreamFile] couldn't map " + path + ", keeping the old mapping");
+            return;
+        }
+    }
+    m_streamFiles[assetId] = std::move(file);
+}
+
+void GfxAssetLoader::getReloads(std::vector<ReloadUpload>& uploads){
+    uploads.clear();
+    uploads.swap(m_reloads);
 }
 
 void GfxAssetLoader::loadBuiltinAssets(SprResourceManager& rm, MeshInfoMap& meshes){
@@ -336,6 +947,8 @@ void GfxAssetLoader::loadBuiltinAssets(SprResourceManager& rm, MeshInfoMap& mesh
     MeshInfo quadInfo;
     quadInfo.firstIndex = quadIdxAlloc.offset;
     quadInfo.indexCount = quadIdxAlloc.size;
+    quadInfo.lodCount = 1;
+    quadInfo.lods[0] = {quadInfo.firstIndex, quadInfo.indexCount, 0.f};
     m_counts.indexCount += quadInfo.indexCount;
     quadInfo.vertexOffset = quadPosAlloc.offset;
     m_counts.vertexCount += quadPosAlloc.size;
@@ -435,6 +1048,8 @@ void GfxAssetLoader::loadBuiltinAssets(SprResourceManager& rm, MeshInfoMap& mesh
     MeshInfo cubeInfo;
     cubeInfo.firstIndex = cubeIdxAlloc.offset;
     cubeInfo.indexCount = cubeIdxAlloc.size;
+    cubeInfo.lodCount = 1;
+    cubeInfo.lods[0] = {cubeInfo.firstIndex, cubeInfo.indexCount, 0.f};
     m_counts.indexCount += cubeInfo.indexCount;
     cubeInfo.vertexOffset = cubePosAlloc.offset;
     m_counts.vertexCount += cubePosAlloc.size;
@@ -447,7 +1062,6 @@ void GfxAssetLoader::unloadBuffers(SprResourceManager& rm){
         rm.deleteData(handle);
     }
     m_bufferHandles.clear();
-    m_storedBuffersBytes = 0;
 }
 
 void GfxAssetLoader::clearCubemaps(){
@@ -486,16 +1100,21 @@ void GfxAssetLoader::clear(){
         return;
     m_vertexPositions.destroy();
     m_vertexAttributes.destroy();
+    m_vertexPositionsQ.destroy();
+    m_vertexAttributesQ.destroy();
+    m_vertexDecodes.destroy();
     m_vertexIndices.destroy();
     m_materials.destroy();
+
+    // the infos stay, hot reloads check against them
     for (TextureInfo& textureInfo : m_textures){
         m_rm->remove(textureInfo.data.handle());
+        textureInfo.data = {};
     }
-    m_textures.clear();
     for (TextureInfo& textureInfo : m_cubemaps){
         m_rm->remove(textureInfo.data.handle());
+        textureInfo.data = {};
     }
-    m_cubemaps.clear();
     m_cleared = true;
 }
 
@@ -511,6 +1130,18 @@ Handle<Buffer> GfxAssetLoader::getVertexAttributeData(){
     return m_vertexAttributes.handle();
 }
 
+Handle<Buffer> GfxAssetLoader::getQuantizedPositionData(){
+    return m_vertexPositionsQ.handle();
+}
+
+Handle<Buffer> GfxAssetLoader::getQuantizedAttributeData(){
+    return m_vertexAttributesQ.handle();
+}
+
+Handle<Buffer> GfxAssetLoader::getVertexDecodeData(){
+    return m_vertexDecodes.handle();
+}
+
 Handle<Buffer> GfxAssetLoader::getVertexIndicesData(){
     return m_vertexIndices.handle();
 }
@@ -1,15 +1,22 @@
 #pragma once
 
+#include <mutex>
+#include <memory>
+#include <atomic>
 #include "core/memory/TempBuffer.h"
 #include "core/util/Span.h"
 #include "external/flat_hash_map/flat_hash_map.hpp"
+#include "external/mio/mio.h"
+#include "render/scene/Material.h"
 #include "render/scene/Mesh.h"
+#include "render/scene/TextureStreamer.h"
 #include "vulkan/TextureTranscoder.h"
 #include "vulkan/resource/OffsetBuffer.h"
 
 namespace spr {
     class SprResourceManager;
     struct Mesh;
+    struct Material;
     struct Buffer;
     template <class T = Buffer>
     class Handle;
@@ -17,6 +24,13 @@ namespace spr {
 
 namespace spr::gfx {
 
+// textures transcoded (and held) at once while loading
+static const uint32 SPR_TRANSCODE_BATCH = 64;
+
+// device memory streamed textures' mips may take, at
+// most a quarter of the largest device local heap
+static const uint64 SPR_STREAM_BUDGET_BYTES = 512 * 1024 * 1024;
+
 struct MeshInfo;
 struct VertexPosition;
 struct VertexAttributes;
@@ -33,10 +47,62 @@ struct TextureInfo {
     uint32 mipCount;
     uint32 layerCount;
     bool srgb;
+    uint32 firstMip = 0;    // image and data start here, finer mips are streamed
+};
+
+// texture waiting to be transcoded into its reserved slot
+struct PendingTexture {
+    Handle<spr::Buffer> buffer;
+    uint32 index;
+    bool cubemap;
+    uint32 assetId;     // file the texture is in, and where
+    uint32 byteOffset;
+    uint32 byteLength;
+    uint32 firstMip = 0;        // streamed, only the tail from here on is transcoded
+    std::vector<uint8> tail;    // ktx2 file of the tail, what the job reads
+};
+
+// new resident mips of a streamed texture, its image is
+// replaced by one of just these
+struct TextureMipUpload {
+    uint32 texture;         // index into getTextureData()
+    uint32 firstMip;
+    uint32 lastMip;
+    std::vector<uint8> data;    // coarse to fine
+};
+
+// where a loaded buffer's data went, hot reloads write over it
+struct BufferSlot {
+    uint32 byteOffset;
+    uint32 byteSize;
+    bool quantized = false;
+};
+
+// what a hot reloaded upload writes over
+enum ReloadTarget : uint32 {
+    RELOAD_INDICES,
+    RELOAD_POSITIONS,
+    RELOAD_ATTRIBUTES,
+    RELOAD_POSITIONS_Q,
+    RELOAD_ATTRIBUTES_Q,
+    RELOAD_DECODES,
+    RELOAD_MATERIALS,
+    RELOAD_TEXTURE,
+    RELOAD_CUBEMAP
+};
+
+// data of a changed asset, for the slot it was loaded into
+struct ReloadUpload {
+    ReloadTarget target;
+    uint32 offset;          // bytes into the target buffer, or the texture index
+    uint32 firstMip;        // textures, data holds [firstMip, last] coarse to fine
+    std::vector<uint8> data;
 };
 
 struct PrimitiveCounts {
     uint32 vertexCount   = 0;
+    uint32 quantizedVertexCount = 0;
+    uint32 decodeCount   = 0;
     uint32 indexCount    = 0;
     uint32 materialCount = 0;
     uint32 textureCount  = 0;
@@ -44,7 +110,11 @@ struct PrimitiveCounts {
     uint64 bytes         = 0;
 };
 
-class GfxAssetLoader {
+// textures past their tail mips are streamed: only the tail is transcoded
+// with the rest, finer mips are transcoded from the (own) file mapping on a
+// worker thread as they're requested. their images hold just the resident
+// mips, updateStreaming hands out the new ones when that changes
+class GfxAssetLoader : private TextureUploader {
 public:
     GfxAssetLoader();
     ~GfxAssetLoader();
@@ -57,11 +127,32 @@ public:
 
     Handle<Buffer> getVertexPositionData();
     Handle<Buffer> getVertexAttributeData();
+    Handle<Buffer> getQuantizedPositionData();
+    Handle<Buffer> getQuantizedAttributeData();
+    Handle<Buffer> getVertexDecodeData();
     Handle<Buffer> getVertexIndicesData();
     Handle<Buffer> getMaterialData();
     std::vector<TextureInfo>& getTextureData();
     std::vector<TextureInfo>& getCubemapData();
 
+    // mips for a material drawn pixels tall (or wide) on screen,
+    // its textures are streamed in (or out) to about that
+    void requestTextures(uint32 materialIndex, float pixels);
+
+    // streamed textures whose resident mips changed, to recreate this frame
+    void updateStreaming(std::vector<TextureMipUpload>& uploads);
+
+    // wait for in-flight mips and drop the mappings
+    void stopStreaming();
+
+    // hot reload, rereads a changed asset into the slots it was loaded
+    // into. data that no longer fits them (more vertices, another texture
+    // size or format) and resources added since loading need a restart
+    void reloadAsset(SprResourceManager& rm, uint32 assetId, MeshInfoMap& meshes);
+
+    // reloaded data to upload this frame
+    void getReloads(std::vector<ReloadUpload>& uploads);
+
     void clearCubemaps();
     void clearTextures();
     void clearMaterials();
@@ -77,25 +168,80 @@ private:
     // copy of asset data for upload to GPU
     OffsetBuffer m_vertexPositions;
     OffsetBuffer m_vertexAttributes;
+    OffsetBuffer m_vertexPositionsQ;    // SPR_VERTEX_FORMAT_QUANTIZED meshes
+    OffsetBuffer m_vertexAttributesQ;
+    OffsetBuffer m_vertexDecodes;
     OffsetBuffer m_vertexIndices;
     OffsetBuffer m_materials;
+    std::vector<MaterialData> m_materialData;   // kept for requestTextures
     std::vector<TextureInfo> m_textures;
     std::vector<TextureInfo> m_cubemaps;
     bool m_cleared = false;
+    bool m_loaded = false;      // slots are fixed, see reloadAsset
+    std::vector<ReloadUpload> m_reloads;
+
+    // textures in load order, transcoded after every asset is walked
+    std::vector<TranscodeJob> m_transcodeJobs;
+    std::vector<PendingTexture> m_pendingTextures;
 
     std::vector<Handle<spr::Buffer>> m_bufferHandles;
-    uint32 m_storedBuffersBytes = 0;
-    uint32 MAX_STORED_BUFFER_BYTES = 1 << 29;
+    uint64 MAX_STORED_BUFFER_BYTES = 1 << 29;
 
     void loadVertexData(SprResourceManager& rm, Mesh* mesh, MeshInfo& info);
     void loadMaterial(SprResourceManager& rm, Mesh* mesh, MeshInfo& info);
+    static glm::vec4 getBounds(Mesh* mesh, spr::Buffer* positions);
+    MaterialData buildMaterial(SprResourceManager& rm, spr::Material* material);
     uint32 loadTexture(SprResourceManager& rm, uint32 texId, bool srgb);
+    bool extractTail(PendingTexture& pending, spr::Buffer* texBuffer);
+    void transcodeTextures(SprResourceManager& rm);
     void loadBuiltinAssets(SprResourceManager& rm, MeshInfoMap& meshes);
 
+    // texture streaming, sources are indexed by streamer texture
+    struct StreamSource {
+        uint32 texture;
+        uint32 assetId;
+        uint32 byteOffset;
+        uint32 byteLength;
+        std::vector<uint64> mipBytes;
+        uint32 firstMip;                // of resident
+        std::vector<uint8> resident;    // transcoded mips in the image, coarse to
+                                        // fine. new images are built from it, so
+                                        // only mips that come in are transcoded
+    };
+
+    TextureStreamer m_streamer;
+    std::vector<StreamSource> m_streamSources;
+    std::vector<uint32> m_streamIds;    // per texture, UINT32_MAX if it isn't streamed
+    ska::flat_hash_map<uint32, std::unique_ptr<mio::mmap_source>> m_streamFiles;
+    std::unique_ptr<ThreadPool> m_streamPool;
+    std::atomic<uint32> m_streamGroup = 0;
+    std::atomic<bool> m_streamStop = false;
+    std::mutex m_streamMutex;
+    std::vector<TextureMipUpload> m_streamedMips;   // transcoded by the worker
+    std::vector<TextureMipUpload> m_transcodedMips; // taken from it, reused
+    std::vector<TextureMipUpload> m_streamUploads;  // for updateStreaming
+
+    // set while the tail of a texture is added
+    TranscodeResult* m_tail = nullptr;
+
+    void streamTexture(TranscodeResult& result, PendingTexture& pending, TextureInfo& textureInfo);
+    void mapStreamFile(SprResourceManager& rm, spr::Buffer* texBuffer);
+    void upload(uint32 texture, uint32 firstMip, uint32 lastMip) override;
+    void evict(uint32 texture, uint32 firstMip, uint32 lastMip) override;
+    void queueStreamUpload(StreamSource& source);
+    static void copyMips(ktxTexture2* texture, uint32 firstMip, uint32 lastMip, std::vector<uint8>& out);
+
+    // hot reload
+    void reloadVertexData(SprResourceManager& rm, Mesh* mesh, MeshInfo& info);
+    bool reloadBuffer(SprResourceManager& rm, uint32 bufferId, BufferSlot& slot, ReloadTarget target);
+    void reloadTexture(SprResourceManager& rm, uint32 textureId);
+    void remapStreamFile(SprResourceManager& rm, uint32 assetId);
+
+    // by buffer id, textures' to their slot index
     ska::flat_hash_map<uint32, uint32> m_textureIds;
     ska::flat_hash_map<uint32, uint32> m_cubemapIds;
-    ska::flat_hash_map<uint32, uint32> m_indexBufferIds;
-    ska::flat_hash_map<uint32, uint32> m_positionBufferIds;
-    ska::flat_hash_map<uint32, uint32> m_attributeBufferIds;
+    ska::flat_hash_map<uint32, BufferSlot> m_indexBufferIds;
+    ska::flat_hash_map<uint32, BufferSlot> m_positionBufferIds;
+    ska::flat_hash_map<uint32, BufferSlot> m_attributeBufferIds;
 };
 }
\ No newline at end of file
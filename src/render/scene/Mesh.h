@@ -1,16 +1,43 @@
 #pragma once
 
 #include "spruce_core.h"
+#include "resource/ResourceTypes.h"
+#include "Draw.h"
 
 namespace spr::gfx {
 
+// quantized value q (0..1) decodes to offset + q * scale
+typedef struct VertexDecode {
+    glm::vec4 positionOffset = glm::vec4(0.f);          // xyz
+    glm::vec4 positionScale  = glm::vec4(1.f);          // xyz
+    glm::vec4 uvOffsetScale  = glm::vec4(0.f, 0.f, 1.f, 1.f);  // [ offset.uv | scale.uv ]
+} VertexDecode;
+
 typedef struct MeshInfo {
     uint32 vertexOffset;
     uint32 indexCount;
     uint32 firstIndex;
     uint32 materialIndex;
+    uint32 materialFlags = 0;   // pipeline the batches are keyed by
+
+    // lod 0 is indexCount/firstIndex, firstIndex
+    // is into the global index buffer
+    uint32 lodCount = 0;
+    MeshLod lods[SPR_MAX_MESH_LODS];
+
+    // quantized meshes' vertexOffset is into the quantized vertex buffers,
+    // the vertex shader decodes them with VertexDecode[decodeIndex]
+    uint32 vertexFormat = SPR_VERTEX_FORMAT_FLOAT;
+    uint32 decodeIndex  = SPR_FLOAT_VERTICES;
+    VertexDecode decode;
+
+    // object space bounding sphere, xyz center | w radius
+    glm::vec4 bounds = glm::vec4(0.f);
 } MeshInfo;
 
+// screen space error a lod may have, in pixels
+static const float SPR_LOD_ERROR_PIXELS = 1.f;
+
 typedef struct VertexPosition {
     glm::vec4 vertexPos;
 } VertexPosition;
@@ -20,4 +47,18 @@ typedef struct VertexAttributes {
     glm::vec4 color3_v1;  // [  color.xyz   | tex.v ]
 } VertexAttributes;
 
+// SPR_VERTEX_FORMAT_QUANTIZED on disk and on the gpu, 20 bytes a vertex
+// instead of 48, with tangents float vertices don't have
+typedef struct VertexPositionQ {
+    uint16 x, y, z;       // unorm within the mesh's bounds
+    int8 tangent[2];      // snorm octahedral, in what would be padding
+} VertexPositionQ;
+
+typedef struct VertexAttributesQ {
+    int16 normal[2];      // snorm octahedral
+    uint16 uv[2];         // unorm within the mesh's uv bounds
+    uint8 color[3];       // unorm
+    int8 tangentSign;     // bitangent = sign * cross(normal, tangent), 0 without tangents
+} VertexAttributesQ;
+
 }
\ No newline at end of file
@@ -16,6 +16,14 @@ typedef struct Transform {
 } Transform;
 
 
+// --------------------------------------------------------- //
+//                 Texture Info                              // 
+// --------------------------------------------------------- //
+
+// size of the bindless texture array (common_bindings.glsl)
+static const uint32 MAX_TEXTURES = 1024;
+
+
 // --------------------------------------------------------- //
 //                 Light Info                                // 
 // --------------------------------------------------------- //
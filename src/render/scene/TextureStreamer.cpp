@@ -0,0 +1,290 @@
+#include "TextureStreamer.h"
+#include "debug/SprLog.h"
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+
+namespace spr::gfx {
+
+TextureStreamer::TextureStreamer(TextureUploader* uploader, uint64 budgetBytes, uint64 uploadBytes){
+    m_uploader = uploader;
+    m_budgetBytes = budgetBytes;
+    m_uploadBytes = uploadBytes;
+}
+
+uint32 TextureStreamer::addTexture(Span<uint64> mipBytes, uint32 tailMip){
+    uint32 mipCount = mipBytes.size();
+    if (mipCount == 0)
+        SprLog::error("[TextureStreamer] [addTexture] texture without mips");
+
+    if (tailMip == UINT32_MAX)
+        tailMip = getTailMip(mipBytes);
+    tailMip = std::min(tailMip, mipCount - 1);
+
+    StreamedTexture texture = {
+        .mipBytes = std::vector<uint64>(mipBytes.begin(), mipBytes.end()),
+        .tailMip = tailMip,
+        .residentMip = mipCount,
+        .pendingMip = tailMip,
+        .requestedMip = tailMip,
+        .lastRequest = 0
+    };
+
+    // the tail goes over the budget if it has to
+    for (uint32 mip = tailMip; mip < mipCount; mip++){
+        m_pendingBytes += texture.mipBytes[mip];
+    }
+    m_textures.push_back(texture);
+
+    uint32 index = m_textures.size() - 1;
+    m_uploadCount++;
+    m_uploader->upload(index, tailMip, mipCount - 1);
+    return index;
+}
+
+void TextureStreamer::request(uint32 texture, uint32 mip){
+    StreamedTexture& streamed = m_textures[texture];
+    mip = std::min(mip, streamed.tailMip);
+
+    if (streamed.lastRequest != m_update)
+        streamed.requestedMip = mip;
+    else
+        streamed.requestedMip = std::min(streamed.requestedMip, mip);
+    streamed.lastRequest = m_update;
+}
+
+void TextureStreamer::update(){
+    // budget lowered, or tails pushed past it
+    while (m_residentBytes + m_pendingBytes > m_budgetBytes && evictOne(UINT32_MAX));
+
+    // textures requested this update that want finer
+    // mips, furthest from what they want first
+    m_candidates.clear();
+    for (uint32 i = 0; i < m_textures.size(); i++){
+        StreamedTexture& texture = m_textures[i];
+        if (texture.lastRequest == m_update && texture.requestedMip < texture.pendingMip && !isUploading(texture))
+            m_candidates.push_back(i);
+    }
+    std::sort(m_candidates.begin(), m_candidates.end(), [this](uint32 a, uint32 b){
+        StreamedTexture& textureA = m_textures[a];
+        StreamedTexture& textureB = m_textures[b];
+        return (textureA.pendingMip - textureA.requestedMip) > (textureB.pendingMip - textureB.requestedMip);
+    });
+
+    // one mip per texture per update, coarse to fine
+    uint64 uploadBytes = m_uploadBytes;
+    for (uint32 index : m_candidates){
+        StreamedTexture& texture = m_textures[index];
+        uint32 mip = texture.pendingMip - 1;
+        uint64 bytes = texture.mipBytes[mip];
+        // the first upload of an update goes regardless, so mips
+        // bigger than the bandwidth still make it eventually
+        if (bytes > uploadBytes && uploadBytes != m_uploadBytes)
+            continue;
+
+        bool room = true;
+        while (room && m_residentBytes + m_pendingBytes + bytes > m_budgetBytes){
+            room = evictOne(index);
+        }
+        if (!room)
+            continue;
+
+        texture.pendingMip = mip;
+        m_pendingBytes += bytes;
+        uploadBytes -= std::min(bytes, uploadBytes);
+        m_uploadCount++;
+        m_uploader->upload(index, mip, mip);
+    }
+
+    m_update++;
+}
+
+void TextureStreamer::completeUpload(uint32 texture, uint32 firstMip){
+    StreamedTexture& streamed = m_textures[texture];
+    if (firstMip != streamed.pendingMip){
+        SprLog::warn("[TextureStreamer] [completeUpload] unexpected mip");
+        return;
+    }
+
+    for (uint32 mip = firstMip; mip < std::min(streamed.residentMip, (uint32)streamed.mipBytes.size()); mip++){
+        m_pendingBytes -= streamed.mipBytes[mip];
+        m_residentBytes += streamed.mipBytes[mip];
+    }
+    streamed.residentMip = firstMip;
+}
+
+bool TextureStreamer::evictOne(uint32 keep){
+    uint64 keepRequest = keep == UINT32_MAX ? UINT64_MAX : m_textures[keep].lastRequest;
+
+    // mips finer than requested go first, then those of the least
+    // recently requested textures, finest first
+    uint32 victim = UINT32_MAX;
+    bool victimExcess = false;
+    for (uint32 i = 0; i < m_textures.size(); i++){
+        StreamedTexture& texture = m_textures[i];
+        if (i == keep || texture.residentMip >= texture.tailMip || isUploading(texture))
+            continue;
+
+        bool excess = texture.residentMip < texture.requestedMip;
+        if (!excess && texture.lastRequest >= keepRequest)
+            continue;
+
+        if (victim == UINT32_MAX){
+            victim = i;
+            victimExcess = excess;
+            continue;
+        }
+
+        StreamedTexture& current = m_textures[victim];
+        bool better = excess != victimExcess ? excess :
+                      texture.lastRequest != current.lastRequest ? texture.lastRequest < current.lastRequest :
+                      texture.residentMip < current.residentMip;
+        if (better){
+            victim = i;
+            victimExcess = excess;
+        }
+    }
+
+    if (victim == UINT32_MAX)
+        return false;
+
+    StreamedTexture& texture = m_textures[victim];
+    uint32 mip = texture.residentMip;
+    m_residentBytes -= texture.mipBytes[mip];
+    texture.residentMip++;
+    texture.pendingMip++;
+    m_evictionCount++;
+    m_uploader->evict(victim, mip, mip);
+    return true;
+}
+
+StreamingStats TextureStreamer::getStats(){
+    return {
+        .residentBytes = m_residentBytes,
+        .pendingBytes = m_pendingBytes,
+        .budgetBytes = m_budgetBytes,
+        .uploads = m_uploadCount,
+        .evictions = m_evictionCount
+    };
+}
+
+uint32 TextureStreamer::getTailMip(Span<uint64> mipBytes){
+    if (mipBytes.size() == 0)
+        return 0;
+
+    uint32 tailMip = mipBytes.size() - 1;
+    while (tailMip > 0 && mipBytes.data()[tailMip - 1] <= SPR_TAIL_MIP_BYTES){
+        tailMip--;
+    }
+    return tailMip;
+}
+
+bool TextureStreamer::readMipLevels(const uint8* data, uint32 size, std::vector<MipLevel>& levels){
+    static const uint8 identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+    // identifier[12], vkFormat, typeSize, pixelWidth, pixelHeight,
+    // pixelDepth, layerCount, faceCount, levelCount, supercompressionScheme,
+    // dfd/kvd offsets and lengths (uint32), sgd offset and length (uint64)
+    const uint32 levelCountOffset = 12 + 7 * sizeof(uint32);
+    const uint32 levelIndexOffset = 12 + 13 * sizeof(uint32) + 2 * sizeof(uint64);
+    if (size < levelIndexOffset || memcmp(data, identifier, sizeof(identifier)) != 0)
+        return false;
+
+    uint32 levelCount;
+    memcpy(&levelCount, data + levelCountOffset, sizeof(uint32));
+    levelCount = std::max(levelCount, 1u);
+    if (levelIndexOffset + (uint64)levelCount * sizeof(MipLevel) > size)
+        return false;
+
+    levels.resize(levelCount);
+    memcpy(levels.data(), data + levelIndexOffset, levelCount * sizeof(MipLevel));
+    return true;
+}
+
+bool TextureStreamer::extractMips(const uint8* data, uint32 size, uint32 firstMip, uint32 lastMip, std::vector<uint8>& out){
+    std::vector<MipLevel> levels;
+    if (!readMipLevels(data, size, levels))
+        return false;
+
+    // the uint32 header fields after the identifier, then the sgd's offset and length
+    enum { FORMAT, TYPE_SIZE, WIDTH, HEIGHT, DEPTH, LAYERS, FACES, LEVELS, SCHEME,
+           DFD_OFFSET, DFD_LENGTH, KVD_OFFSET, KVD_LENGTH, HEADER_FIELDS };
+    uint32 header[HEADER_FIELDS];
+    uint64 sgd[2];
+    memcpy(header, data + 12, sizeof(header));
+    memcpy(sgd, data + 12 + sizeof(header), sizeof(sgd));
+
+    if (header[DEPTH] > 1 || header[LAYERS] > 1 || header[FACES] != 1)
+        return false;
+    if (firstMip > lastMip || lastMip >= levels.size())
+        return false;
+    if ((uint64)header[DFD_OFFSET] + header[DFD_LENGTH] > size || (uint64)header[KVD_OFFSET] + header[KVD_LENGTH] > size ||
+        sgd[0] + sgd[1] > size)
+        return false;
+    for (uint32 mip = firstMip; mip <= lastMip; mip++){
+        if (levels[mip].byteOffset + levels[mip].byteLength > size)
+            return false;
+    }
+
+    // basis lz keeps an image desc per level (finest first) between the
+    // sgd's header and its codebooks, the dropped levels' go
+    const uint32 SCHEME_BASIS_LZ = 1;
+    const uint32 sgdHeaderBytes = 20;
+    const uint32 imageDescBytes = 20;
+    const uint8* sgdData = data + sgd[0];
+    std::vector<uint8> sgdOut(sgdData, sgdData + sgd[1]);
+    if (header[SCHEME] == SCHEME_BASIS_LZ){
+        uint64 imageDescsEnd = sgdHeaderBytes + levels.size() * imageDescBytes;
+        if (sgd[1] < imageDescsEnd)
+            return false;
+        sgdOut.assign(sgdData, sgdData + sgdHeaderBytes);
+        sgdOut.insert(sgdOut.end(), sgdData + sgdHeaderBytes + firstMip * imageDescBytes,
+                                    sgdData + sgdHeaderBytes + (lastMip + 1) * imageDescBytes);
+        sgdOut.insert(sgdOut.end(), sgdData + imageDescsEnd, sgdData + sgd[1]);
+    }
+
+    // levels are aligned to the texel block (and 4), or not at all if supercompressed
+    uint32 levelAlignment = 1;
+    if (header[SCHEME] == 0){
+        const uint32 bytesPlane0Offset = 20;
+        uint32 bytesPlane0 = header[DFD_LENGTH] > bytesPlane0Offset ? data[header[DFD_OFFSET] + bytesPlane0Offset] : 1;
+        levelAlignment = std::lcm(std::max(bytesPlane0, 1u), 4u);
+    }
+
+    // header and level index are written last, the rest follows them
+    uint32 levelCount = lastMip - firstMip + 1;
+    const uint32 levelIndexOffset = 12 + sizeof(header) + sizeof(sgd);
+    out.assign(levelIndexOffset + levelCount * sizeof(MipLevel), 0);
+    auto append = [&out](const uint8* src, uint64 bytes, uint32 alignment){
+        out.resize((out.size() + alignment - 1) / alignment * alignment, 0);
+        uint64 offset = out.size();
+        out.insert(out.end(), src, src + bytes);
+        return offset;
+    };
+
+    header[DFD_OFFSET] = header[DFD_LENGTH] ? append(data + header[DFD_OFFSET], header[DFD_LENGTH], 4) : 0;
+    header[KVD_OFFSET] = header[KVD_LENGTH] ? append(data + header[KVD_OFFSET], header[KVD_LENGTH], 4) : 0;
+    sgd[0] = sgdOut.size() ? append(sgdOut.data(), sgdOut.size(), 8) : 0;
+    sgd[1] = sgdOut.size();
+
+    // level data goes coarsest first
+    std::vector<MipLevel> levelsOut(levelCount);
+    for (uint32 mip = lastMip + 1; mip-- > firstMip;){
+        MipLevel& level = levelsOut[mip - firstMip];
+        level = levels[mip];
+        level.byteOffset = append(data + levels[mip].byteOffset, levels[mip].byteLength, levelAlignment);
+    }
+
+    header[WIDTH] = std::max(header[WIDTH] >> firstMip, 1u);
+    if (header[HEIGHT] > 0)
+        header[HEIGHT] = std::max(header[HEIGHT] >> firstMip, 1u);
+    header[LEVELS] = levelCount;
+
+    memcpy(out.data(), data, 12);
+    memcpy(out.data() + 12, header, sizeof(header));
+    memcpy(out.data() + 12 + sizeof(header), sgd, sizeof(sgd));
+    memcpy(out.data() + levelIndexOffset, levelsOut.data(), levelCount * sizeof(MipLevel));
+    return true;
+}
+
+}
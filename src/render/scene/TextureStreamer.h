@@ -0,0 +1,129 @@
+#pragma once
+
+#include <vector>
+#include "core/spruce_core.h"
+#include "core/util/Span.h"
+
+namespace spr::gfx {
+
+// mips this small (and everything coarser) are uploaded with
+// the texture and never evicted, so there's always something to sample
+static const uint64 SPR_TAIL_MIP_BYTES = 64 * 1024;
+
+// upload bandwidth handed out per update
+static const uint64 SPR_STREAM_UPLOAD_BYTES = 16 * 1024 * 1024;
+
+// one level of a ktx2 file's level index, 0 is the finest
+typedef struct {
+    uint64 byteOffset;
+    uint64 byteLength;
+    uint64 uncompressedByteLength;  // 0 if supercompressed (basis lz)
+} MipLevel;
+
+// moves mip data to the gpu for TextureStreamer. uploads may finish
+// later (on another queue etc.), evictions take effect right away
+class TextureUploader {
+public:
+    virtual ~TextureUploader() = default;
+
+    // make mips [firstMip, lastMip] of texture resident, then
+    // call TextureStreamer::completeUpload (on the streamer's thread)
+    virtual void upload(uint32 texture, uint32 firstMip, uint32 lastMip) = 0;
+
+    // mips [firstMip, lastMip] of texture aren't sampled anymore
+    virtual void evict(uint32 texture, uint32 firstMip, uint32 lastMip) = 0;
+};
+
+typedef struct {
+    uint64 residentBytes;
+    uint64 pendingBytes;    // uploads in flight
+    uint64 budgetBytes;
+    uint32 uploads;
+    uint32 evictions;
+} StreamingStats;
+
+// mip residency of streamed textures. textures start with their tail
+// mips, each update() moves those requested since the last one a mip
+// closer to what they asked for, furthest behind first. past the budget,
+// mips finer than requested, then those requested longest ago, are evicted
+class TextureStreamer {
+public:
+    TextureStreamer(TextureUploader* uploader, uint64 budgetBytes, uint64 uploadBytes = SPR_STREAM_UPLOAD_BYTES);
+
+    // gpu size of every mip, finest first. the tail is uploaded right
+    // away, tailMip overrides getTailMip's (for tails picked before)
+    uint32 addTexture(Span<uint64> mipBytes, uint32 tailMip = UINT32_MAX);
+
+    // finest mip wanted, for the next update. the finest of an update's
+    // requests wins, unrequested textures keep what they have
+    void request(uint32 texture, uint32 mip);
+
+    // issue uploads and evictions, once per frame
+    void update();
+
+    // an upload of texture finished, firstMip is usable now
+    void completeUpload(uint32 texture, uint32 firstMip);
+
+    // finest usable mip, clamp sampling (min lod) to it
+    uint32 getResidentMip(uint32 texture){
+        return m_textures[texture].residentMip;
+    }
+
+    uint32 getTailMip(uint32 texture){
+        return m_textures[texture].tailMip;
+    }
+
+    uint32 getTextureCount(){
+        return m_textures.size();
+    }
+
+    void setBudget(uint64 budgetBytes){
+        m_budgetBytes = budgetBytes;
+    }
+
+    StreamingStats getStats();
+
+    // first mip whose finer neighbour is bigger than SPR_TAIL_MIP_BYTES
+    static uint32 getTailMip(Span<uint64> mipBytes);
+
+    // level index of a ktx2 file, false if it isn't one
+    static bool readMipLevels(const uint8* data, uint32 size, std::vector<MipLevel>& levels);
+
+    // a ktx2 file of mips [firstMip, lastMip] of a 2d one, so only those are
+    // transcoded. false if it isn't a (non array, non cube) 2d ktx2 file
+    static bool extractMips(const uint8* data, uint32 size, uint32 firstMip, uint32 lastMip, std::vector<uint8>& out);
+
+private:
+    typedef struct {
+        std::vector<uint64> mipBytes;
+        uint32 tailMip;         // first mip that's always resident
+        uint32 residentMip;     // finest usable mip
+        uint32 pendingMip;      // finest uploaded or uploading
+        uint32 requestedMip;
+        uint64 lastRequest;     // update of the latest request
+    } StreamedTexture;
+
+    TextureUploader* m_uploader;
+    std::vector<StreamedTexture> m_textures;
+
+    uint64 m_budgetBytes;
+    uint64 m_uploadBytes;
+    uint64 m_residentBytes = 0;
+    uint64 m_pendingBytes = 0;
+    uint64 m_update = 1;
+    uint32 m_uploadCount = 0;
+    uint32 m_evictionCount = 0;
+
+    // reused by update
+    std::vector<uint32> m_candidates;
+
+    bool isUploading(StreamedTexture& texture){
+        return texture.pendingMip != texture.residentMip;
+    }
+
+    // evict one mip of the least needed texture that's less needed
+    // than (or the same as) keep, false if there's none
+    bool evictOne(uint32 keep);
+};
+
+}
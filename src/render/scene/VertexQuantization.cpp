@@ -0,0 +1,134 @@
+#include "VertexQuantization.h"
+#include <cmath>
+#include <cfloat>
+#include <algorithm>
+
+namespace spr::gfx {
+
+static uint16 quantizeUnorm(float value, float offset, float scale){
+    float normalized = scale > 0.f ? (value - offset) / scale : 0.f;
+    return (uint16)std::lround(std::clamp(normalized, 0.f, 1.f) * 65535.f);
+}
+
+static int16 quantizeSnorm(float value){
+    return (int16)std::lround(std::clamp(value, -1.f, 1.f) * 32767.f);
+}
+
+static int8 quantizeSnorm8(float value){
+    return (int8)std::lround(std::clamp(value, -1.f, 1.f) * 127.f);
+}
+
+VertexDecode VertexQuantization::computeDecode(const VertexPosition* positions, const VertexAttributes* attributes, uint32 vertexCount){
+    glm::vec3 minPosition = glm::vec3(FLT_MAX);
+    glm::vec3 maxPosition = glm::vec3(-FLT_MAX);
+    glm::vec2 minUV = glm::vec2(FLT_MAX);
+    glm::vec2 maxUV = glm::vec2(-FLT_MAX);
+    for (uint32 i = 0; i < vertexCount; i++){
+        minPosition = glm::min(minPosition, glm::vec3(positions[i].vertexPos));
+        maxPosition = glm::max(maxPosition, glm::vec3(positions[i].vertexPos));
+        glm::vec2 uv = glm::vec2(attributes[i].normal3_u1.w, attributes[i].color3_v1.w);
+        minUV = glm::min(minUV, uv);
+        maxUV = glm::max(maxUV, uv);
+    }
+    if (vertexCount == 0){
+        minPosition = maxPosition = glm::vec3(0.f);
+        minUV = maxUV = glm::vec2(0.f);
+    }
+
+    return {
+        .positionOffset = glm::vec4(minPosition, 0.f),
+        .positionScale = glm::vec4(maxPosition - minPosition, 0.f),
+        .uvOffsetScale = glm::vec4(minUV, maxUV - minUV)
+    };
+}
+
+void VertexQuantization::quantizePositions(const VertexPosition* positions, uint32 vertexCount, const VertexDecode& decode, VertexPositionQ* out){
+    for (uint32 i = 0; i < vertexCount; i++){
+        const glm::vec4& position = positions[i].vertexPos;
+        out[i] = {
+            .x = quantizeUnorm(position.x, decode.positionOffset.x, decode.positionScale.x),
+            .y = quantizeUnorm(position.y, decode.positionOffset.y, decode.positionScale.y),
+            .z = quantizeUnorm(position.z, decode.positionOffset.z, decode.positionScale.z),
+            .tangent = {0, 0}
+        };
+    }
+}
+
+void VertexQuantization::quantizeAttributes(const VertexAttributes* attributes, uint32 vertexCount, const VertexDecode& decode, VertexAttributesQ* out){
+    for (uint32 i = 0; i < vertexCount; i++){
+        const VertexAttributes& attribute = attributes[i];
+        glm::vec2 normal = encodeOctahedral(glm::vec3(attribute.normal3_u1));
+        VertexAttributesQ& quantized = out[i];
+        quantized.normal[0] = quantizeSnorm(normal.x);
+        quantized.normal[1] = quantizeSnorm(normal.y);
+        quantized.uv[0] = quantizeUnorm(attribute.normal3_u1.w, decode.uvOffsetScale.x, decode.uvOffsetScale.z);
+        quantized.uv[1] = quantizeUnorm(attribute.color3_v1.w, decode.uvOffsetScale.y, decode.uvOffsetScale.w);
+        for (uint32 c = 0; c < 3; c++){
+            quantized.color[c] = (uint8)std::lround(std::clamp(attribute.color3_v1[c], 0.f, 1.f) * 255.f);
+        }
+        quantized.tangentSign = 0;
+    }
+}
+
+void VertexQuantization::quantizeTangents(const glm::vec4* tangents, uint32 vertexCount, VertexPositionQ* positions, VertexAttributesQ* attributes){
+    for (uint32 i = 0; i < vertexCount; i++){
+        glm::vec2 tangent = encodeOctahedral(glm::vec3(tangents[i]));
+        positions[i].tangent[0] = quantizeSnorm8(tangent.x);
+        positions[i].tangent[1] = quantizeSnorm8(tangent.y);
+        attributes[i].tangentSign = tangents[i].w < 0.f ? -1 : 1;
+    }
+}
+
+void VertexQuantization::dequantizePositions(const VertexPositionQ* positions, uint32 vertexCount, const VertexDecode& decode, VertexPosition* out){
+    for (uint32 i = 0; i < vertexCount; i++){
+        glm::vec3 normalized = glm::vec3(positions[i].x, positions[i].y, positions[i].z) / 65535.f;
+        glm::vec3 position = glm::vec3(decode.positionOffset) + normalized * glm::vec3(decode.positionScale);
+        out[i].vertexPos = glm::vec4(position, 1.f);
+    }
+}
+
+void VertexQuantization::dequantizeAttributes(const VertexAttributesQ* attributes, uint32 vertexCount, const VertexDecode& decode, VertexAttributes* out){
+    for (uint32 i = 0; i < vertexCount; i++){
+        const VertexAttributesQ& quantized = attributes[i];
+        glm::vec3 normal = decodeOctahedral(glm::vec2(quantized.normal[0], quantized.normal[1]) / 32767.f);
+        glm::vec2 uv = glm::vec2(decode.uvOffsetScale) + glm::vec2(quantized.uv[0], quantized.uv[1]) / 65535.f * glm::vec2(decode.uvOffsetScale.z, decode.uvOffsetScale.w);
+        glm::vec3 color = glm::vec3(quantized.color[0], quantized.color[1], quantized.color[2]) / 255.f;
+        out[i] = {
+            .normal3_u1 = glm::vec4(normal, uv.x),
+            .color3_v1 = glm::vec4(color, uv.y)
+        };
+    }
+}
+
+void VertexQuantization::dequantizeTangents(const VertexPositionQ* positions, const VertexAttributesQ* attributes, uint32 vertexCount, glm::vec4* out){
+    for (uint32 i = 0; i < vertexCount; i++){
+        glm::vec2 encoded = glm::max(glm::vec2(positions[i].tangent[0], positions[i].tangent[1]) / 127.f, glm::vec2(-1.f));
+        out[i] = glm::vec4(decodeOctahedral(encoded), (float)attributes[i].tangentSign);
+    }
+}
+
+glm::vec2 VertexQuantization::encodeOctahedral(glm::vec3 normal){
+    float length = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+    if (length == 0.f)
+        return glm::vec2(0.f);
+
+    // project onto the octahedron, fold the lower half over the diagonals
+    glm::vec2 encoded = glm::vec2(normal.x, normal.y) / length;
+    if (normal.z < 0.f){
+        encoded = glm::vec2(
+            (1.f - std::fabs(encoded.y)) * (encoded.x >= 0.f ? 1.f : -1.f),
+            (1.f - std::fabs(encoded.x)) * (encoded.y >= 0.f ? 1.f : -1.f)
+        );
+    }
+    return encoded;
+}
+
+glm::vec3 VertexQuantization::decodeOctahedral(glm::vec2 encoded){
+    glm::vec3 normal = glm::vec3(encoded.x, encoded.y, 1.f - std::fabs(encoded.x) - std::fabs(encoded.y));
+    float fold = std::max(-normal.z, 0.f);
+    normal.x += normal.x >= 0.f ? -fold : fold;
+    normal.y += normal.y >= 0.f ? -fold : fold;
+    return glm::normalize(normal);
+}
+
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Mesh.h"
+
+namespace spr::gfx {
+
+// packs float vertices (VertexPosition/VertexAttributes) into the quantized
+// format and back. positions and uvs are 16 bit within the mesh's bounds,
+// normals 16 bit octahedral, tangents 8 bit octahedral, colors 8 bit.
+// the vertex shaders decode the same way (loadPosition in common_bindings.glsl)
+class VertexQuantization {
+public:
+    // bounds of the positions and uvs, what 0..65535 maps to
+    static VertexDecode computeDecode(const VertexPosition* positions, const VertexAttributes* attributes, uint32 vertexCount);
+
+    static void quantizePositions(const VertexPosition* positions, uint32 vertexCount, const VertexDecode& decode, VertexPositionQ* out);
+    static void quantizeAttributes(const VertexAttributes* attributes, uint32 vertexCount, const VertexDecode& decode, VertexAttributesQ* out);
+
+    // glTF tangents (xyz, w handedness) into already quantized vertices,
+    // without this call the vertices have none
+    static void quantizeTangents(const glm::vec4* tangents, uint32 vertexCount, VertexPositionQ* positions, VertexAttributesQ* attributes);
+
+    // w is 1, normals and tangents come back unit length, tangents'
+    // w is 0 for vertices without one
+    static void dequantizePositions(const VertexPositionQ* positions, uint32 vertexCount, const VertexDecode& decode, VertexPosition* out);
+    static void dequantizeAttributes(const VertexAttributesQ* attributes, uint32 vertexCount, const VertexDecode& decode, VertexAttributes* out);
+    static void dequantizeTangents(const VertexPositionQ* positions, const VertexAttributesQ* attributes, uint32 vertexCount, glm::vec4* out);
+
+    // unit vector to the [-1, 1] square, (0, 0, 1) for zero vectors
+    static glm::vec2 encodeOctahedral(glm::vec3 normal);
+    static glm::vec3 decodeOctahedral(glm::vec2 encoded);
+};
+
+}
@@ -1,8 +1,10 @@
 #include "GPUStreamer.h"
 
 #include "StagingBufferBatch.h"
+#include "TextureTranscoder.h"
 #include "VulkanDevice.h"
 #include "resource/VulkanResourceManager.h"
+#include <algorithm>
 #include <cstddef>
 #include <vulkan/vulkan_core.h>
 #include "external/volk/volk.h"
@@ -58,14 +60,15 @@ void GPUStreamer::transfer(BufferTransfer data, bool managed) {
 
     // shared, just upload
     if (data.memType == (HOST|DEVICE)) {
-        std::memcpy(data.dst->allocInfo.pMappedData, managed ? data.src->allocInfo.pMappedData : data.pSrc, data.size);
+        std::memcpy((unsigned char*)data.dst->allocInfo.pMappedData + data.dstOffset, managed ? data.src->allocInfo.pMappedData : data.pSrc, data.size);
 
-        // build staging range and flush cache
+        // build staging range and flush cache, offset
+        // writes flush everything (offsets have to be aligned)
         VkMappedMemoryRange stagingRange = {
             .sType  = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
             .memory = data.dst->allocInfo.deviceMemory,
             .offset = 0,
-            .size   = alignedSize
+            .size   = data.dstOffset ? VK_WHOLE_SIZE : alignedSize
         };
         vkFlushMappedMemoryRanges(m_device->getDevice(), 1, &stagingRange);
         return;
@@ -73,7 +76,7 @@ void GPUStreamer::transfer(BufferTransfer data, bool managed) {
 
     // host local, just copy
     if (data.memType == HOST) {
-        std::memcpy(data.dst->allocInfo.pMappedData, managed ? data.src->allocInfo.pMappedData : data.pSrc, data.size);
+        std::memcpy((unsigned char*)data.dst->allocInfo.pMappedData + data.dstOffset, managed ? data.src->allocInfo.pMappedData : data.pSrc, data.size);
         return;
     }
 
@@ -104,7 +107,7 @@ void GPUStreamer::transfer(BufferTransfer data, bool managed) {
         uint32 dataSize = data.size;
         VkBufferCopy copyRegion = {
             .srcOffset = 0,
-            .dstOffset = 0,
+            .dstOffset = data.dstOffset,
             .size      = dataSize
         };
         vkCmdCopyBuffer(m_transferCommandBuffer->getCommandBuffer(), stageBuffer, dstBuffer, 1, &copyRegion);
@@ -122,7 +125,7 @@ void GPUStreamer::transfer(BufferTransfer data, bool managed) {
             .srcQueueFamilyIndex = m_transferFamilyIndex,
             .dstQueueFamilyIndex = m_graphicsFamilyIndex,
             .buffer = dstBuffer,
-            .offset = 0,
+            .offset = data.dstOffset,
             .size   = dataSize
         };
         return transferBarrier;
@@ -139,7 +142,7 @@ void GPUStreamer::transfer(BufferTransfer data, bool managed) {
             .srcQueueFamilyIndex = m_transferFamilyIndex,
             .dstQueueFamilyIndex = m_graphicsFamilyIndex,
             .buffer = dstBuffer,
-            .offset = 0,
+            .offset = data.dstOffset,
             .size   = dataSize
         };
         return graphicsBarrier;
@@ -171,13 +174,16 @@ void GPUStreamer::transfer(TextureTransfer data, bool managed) {
     };
     vkFlushMappedMemoryRanges(m_device->getDevice(), 1, &stagingRange);
 
+    // mips [firstMip, lastMip] are in the data, coarse to fine
+    uint32 lastMip = std::min(data.lastMip, data.dst->mips-1);
+    uint32 firstMip = std::min(data.firstMip, lastMip);
+
     // build buffer image copy and perform copy command
-    // TODO: compensate for block formats
     uint32 offset = 0;
     for (uint32 i = 0; i < data.dst->layers; i++){ // for each layer
-        for (uint32 j = 0; j < data.dst->mips; j++){ // for each mip level
+        for (uint32 j = 0; j <= lastMip-firstMip; j++){ // for each mip level
 
-            uint32 mipLevel = (data.dst->mips-1-j);
+            uint32 mipLevel = (lastMip-j);
             uint32 width = std::max(1u, data.dst->dimensions.x / (1 << mipLevel));
             uint32 height = std::max(1u, data.dst->dimensions.y / (1 << mipLevel));
 
@@ -205,14 +211,22 @@ void GPUStreamer::transfer(TextureTransfer data, bool managed) {
                 vkCmdCopyBufferToImage(m_transferCommandBuffer->getCommandBuffer(), stageBuffer, dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &imageRegion);
             });
 
-            offset += 4 * width * height;
+            offset += TextureTranscoder::getImageBytes(data.dst->format, width, height);
         }
     }
 
+    // an image in use only has the copied mips transitioned (their old
+    // contents weren't sampled), a new one is transitioned whole
+    VkImageSubresourceRange range = data.dst->subresourceRange;
+    if (data.partial){
+        range.baseMipLevel = firstMip;
+        range.levelCount = lastMip-firstMip+1;
+    }
+
     // build barriers (transfer/graphics)
     m_imageLayoutBarriers.push_back([=](){
         VkImage dstImage = data.dst->image;
-        VkImageSubresourceRange subResourceRange = data.dst->subresourceRange;
+        VkImageSubresourceRange subResourceRange = range;
         VkImageMemoryBarrier2KHR layoutTransitionBarrier = {
             .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR,
             .pNext = NULL,
@@ -231,7 +245,7 @@ void GPUStreamer::transfer(TextureTransfer data, bool managed) {
     
     m_transferImageBarriers.push_back([=](){
         VkImage dstImage = data.dst->image;
-        VkImageSubresourceRange subResourceRange = data.dst->subresourceRange;
+        VkImageSubresourceRange subResourceRange = range;
         VkImageMemoryBarrier2KHR transferImageBarrier = {
             .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR,
             .pNext = NULL,
@@ -250,7 +264,7 @@ void GPUStreamer::transfer(TextureTransfer data, bool managed) {
     
     m_graphicsImageBarriers.push_back([=](){
         VkImage dstImage = data.dst->image;
-        VkImageSubresourceRange subResourceRange = data.dst->subresourceRange;
+        VkImageSubresourceRange subResourceRange = range;
         VkImageMemoryBarrier2KHR graphicsImageBarrier = {
             .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2_KHR,
             .pNext = NULL,
@@ -35,6 +35,7 @@ private:
         Buffer* dst;
         uint32 size = 0;
         MemoryType memType = DEVICE;
+        uint32 dstOffset = 0;   // bytes, the rest of dst is left be
     };
 
     struct TextureTransfer {
@@ -42,6 +43,9 @@ private:
         Buffer* src;
         Texture* dst;
         uint32 size = 0;
+        uint32 firstMip = 0;
+        uint32 lastMip = UINT32_MAX;
+        bool partial = false;   // dst is in use, leave the other mips be
     };
 
     struct SparseBufferTransfer {
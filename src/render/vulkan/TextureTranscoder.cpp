@@ -4,6 +4,7 @@
 #include "ktx.h"
 #include "ktxvulkan.h"
 #include <cstring>
+#include <mutex>
 
 namespace spr::gfx {
 
@@ -27,7 +28,36 @@ TextureTranscoder::TextureTranscoder(VulkanDevice* device){
                       formatSupported(VK_FORMAT_BC1_RGBA_UNORM_BLOCK);
     m_supported.ASTC = formatSupported(VK_FORMAT_ASTC_4x4_UNORM_BLOCK) || 
                        formatSupported(VK_FORMAT_ASTC_4x4_SRGB_BLOCK);
-    
+
+    // choose optimal transcode targets
+    //https://github.com/KhronosGroup/3D-Formats-Guidelines/blob/main/KTXDeveloperGuide.md
+    if (m_supported.ASTC) {
+        m_uastcTarget = KTX_TTF_ASTC_4x4_RGBA;
+    } else if (m_supported.BC7) {
+        m_uastcTarget = KTX_TTF_BC7_RGBA;
+    } else if (m_supported.ETC2) {
+        m_uastcTarget = KTX_TTF_ETC2_RGBA;
+    } else if (m_supported.BC3) {
+        m_uastcTarget = KTX_TTF_BC3_RGBA;
+    } else if (m_supported.BC1) {
+        m_uastcTarget = KTX_TTF_BC1_RGB;
+    }
+
+    if (m_supported.ETC2){
+        m_etc1sTarget = KTX_TTF_ETC2_RGBA;
+    } else if (m_supported.BC7) {
+        m_etc1sTarget = KTX_TTF_BC7_RGBA;
+    } else if (m_supported.BC3) {
+        m_etc1sTarget = KTX_TTF_BC3_RGBA;
+    } else if (m_supported.BC1) {
+        m_etc1sTarget = KTX_TTF_BC1_RGB;
+    }
+}
+
+TextureTranscoder::TextureTranscoder(ktx_texture_transcode_fmt_e uastcTarget, ktx_texture_transcode_fmt_e etc1sTarget){
+    m_device = nullptr;
+    m_uastcTarget = uastcTarget;
+    m_etc1sTarget = etc1sTarget;
 }
 
 TextureTranscoder::~TextureTranscoder(){
@@ -35,82 +65,133 @@ TextureTranscoder::~TextureTranscoder(){
 }
 
 
-void TextureTranscoder::transcode(TranscodeResult& out, VulkanResourceManager* vrm, uint8* data, uint32 size, uint32 width, uint32 height){
-    ktxTexture2* texture;
+void TextureTranscoder::transcode(TranscodeResult& out, const uint8* data, uint32 size) const {
+    // basis initializes its tables on first use, let one decode finish first
+    static std::once_flag initFlag;
+    bool decoded = false;
+    std::call_once(initFlag, [&]{
+        decode(out, data, size);
+        decoded = true;
+    });
+    if (!decoded)
+        decode(out, data, size);
+}
+
+void TextureTranscoder::decode(TranscodeResult& out, const uint8* data, uint32 size) const {
+    ktxTexture2* texture = nullptr;
     KTX_error_code result;
 
+    out.texture = nullptr;
+    out.sizeBytes = 0;
+
     result = ktxTexture2_CreateFromMemory(data, size, KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &texture);
     if (result != KTX_SUCCESS){
-        SprLog::error("[TextureTranscoder] Failed to load KTX2 texture, code: " + std::string(ktxErrorString(result)));
+        out.error = result;
+        return;
     }
 
-    // choose optimal transcode target and transcode
-    //https://github.com/KhronosGroup/3D-Formats-Guidelines/blob/main/KTXDeveloperGuide.md
     if (ktxTexture2_NeedsTranscoding(texture)){
         ktx_texture_transcode_fmt_e tf;
         khr_df_model_e colorModel = ktxTexture2_GetColorModel_e(texture);
 
         if (colorModel == KHR_DF_MODEL_UASTC){
-            if (m_supported.ASTC) {
-                tf = KTX_TTF_ASTC_4x4_RGBA;
-            } else if (m_supported.BC7) {
-                tf = KTX_TTF_BC7_RGBA;
-            } else if (m_supported.ETC2) {
-                tf = KTX_TTF_ETC2_RGBA;
-            } else if (m_supported.BC3) {
-                tf = KTX_TTF_BC3_RGBA;
-            } else if (m_supported.BC1) {
-                tf = KTX_TTF_BC1_RGB;
-            } else {
-                tf = KTX_TTF_NOSELECTION;
-            }
+            tf = m_uastcTarget;
         } else if (colorModel == KHR_DF_MODEL_ETC1S){
-            if (m_supported.ETC2){
-                tf = KTX_TTF_ETC2_RGBA;
-            } else if (m_supported.BC7) {
-                tf = KTX_TTF_BC7_RGBA;
-            } else if (m_supported.BC3) {
-                tf = KTX_TTF_BC3_RGBA;
-            } else if (m_supported.BC1) {
-                tf = KTX_TTF_BC1_RGB;
-            } else {
-                tf = KTX_TTF_NOSELECTION;
-            }
+            tf = m_etc1sTarget;
         } else {
-            SprLog::warn("[TextureTranscoder] Texture needs transcode, but none applicable");
             tf = KTX_TTF_NOSELECTION;
         }
 
         // transcode to target format
         result = ktxTexture2_TranscodeBasis(texture, tf, 0);
-        if (result){
-            SprLog::error("[TextureTranscoder] Failed to transcode texture, code: " + std::string(ktxErrorString(result)));
+        if (result != KTX_SUCCESS){
+            ktxTexture_Destroy(ktxTexture(texture));
+            out.error = result;
+            return;
         }
     }
 
-    uint32 mipLevels = texture->numLevels;
-    uint32 layers = texture->numFaces;
+    out.format = ktxTexture2_GetVkFormat(texture);
+    out.mips = texture->numLevels;
+    out.layers = texture->numFaces;
+    out.sizeBytes = ktxTexture_GetDataSize(ktxTexture(texture));
+    out.texture = texture;
+    out.error = KTX_SUCCESS;
+}
 
-    VkFormat format = ktxTexture2_GetVkFormat(texture);
-    uint32 sizeBytes = ktxTexture_GetDataSize(ktxTexture(texture));
-    
-    out.format = format;
-    out.mips = mipLevels;
-    out.layers = layers;
-    out.sizeBytes = sizeBytes;
+void TextureTranscoder::transcode(TranscodeJob* jobs, uint32 count, ThreadPool* pool) const {
+    if (!pool){
+        for (uint32 i = 0; i < count; i++){
+            transcode(jobs[i].result, jobs[i].data, jobs[i].size);
+        }
+        return;
+    }
 
-    m_activeTexture = texture;
+    std::atomic<uint32> group = 0;
+    for (uint32 i = 0; i < count; i++){
+        pool->submit([this, jobs, i]{
+            transcode(jobs[i].result, jobs[i].data, jobs[i].size);
+        }, &group);
+    }
+    pool->wait(group);
 }
 
-void TextureTranscoder::destroyActiveTexture(TranscodeResult& out, uint32 sizeBytes){
-    ktx_uint8_t* transcodedData = ktxTexture_GetData(ktxTexture(m_activeTexture));
+void TextureTranscoder::copyTexture(TranscodeResult& out){
+    ktx_uint8_t* transcodedData = ktxTexture_GetData(ktxTexture(out.texture));
 
     out.transcodedData.allocateAndInsert<ktx_uint8_t>({
         .data = transcodedData,
-        .size = sizeBytes
+        .size = out.sizeBytes
     });
 
-    ktxTexture_Destroy(ktxTexture(m_activeTexture));
+    destroyTexture(out);
+}
+
+void TextureTranscoder::destroyTexture(TranscodeResult& out){
+    if (!out.texture)
+        return;
+    ktxTexture_Destroy(ktxTexture(out.texture));
+    out.texture = nullptr;
+}
+
+uint32 TextureTranscoder::getFaceCount(const uint8* data, uint32 size){
+    // identifier[12], vkFormat, typeSize, pixelWidth,
+    // pixelHeight, pixelDepth, layerCount, faceCount
+    const uint32 faceCountOffset = 12 + 6 * sizeof(uint32);
+    if (size < faceCountOffset + sizeof(uint32))
+        return 1;
+
+    uint32 faceCount;
+    memcpy(&faceCount, data + faceCountOffset, sizeof(uint32));
+    return faceCount;
+}
+
+uint32 TextureTranscoder::getImageBytes(VkFormat format, uint32 width, uint32 height){
+    uint32 blocks = ((width + 3) / 4) * ((height + 3) / 4);
+    switch (format){
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        case VK_FORMAT_BC4_UNORM_BLOCK:
+        case VK_FORMAT_BC4_SNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+            return 8 * blocks;
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+        case VK_FORMAT_BC5_UNORM_BLOCK:
+        case VK_FORMAT_BC5_SNORM_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+        case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+        case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+            return 16 * blocks;
+        default:
+            return 4 * width * height;
+    }
 }
 
 bool TextureTranscoder::formatSupported(VkFormat format){
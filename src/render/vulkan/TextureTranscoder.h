@@ -3,6 +3,7 @@
 #include "gfx_vulkan_core.h"
 #include "core/util/FunctionQueue.h"
 #include "core/memory/TempBuffer.h"
+#include "core/util/ThreadPool.h"
 #include "ktx.h"
 #include "vulkan/resource/OffsetBuffer.h"
 
@@ -21,23 +22,62 @@ struct TranscodeResult {
     uint32 layers;
     uint32 sizeBytes;
     OffsetBuffer transcodedData;
+
+    // transcoded texture, owned until destroyTexture
+    ktxTexture2* texture = nullptr;
+
+    // KTX_SUCCESS, or why texture is null. reported by the caller
+    KTX_error_code error = KTX_SUCCESS;
+};
+
+// one texture of a batch, results land in the job's own slot
+struct TranscodeJob {
+    const uint8* data;
+    uint32 size;
+    TranscodeResult result;
 };
 
 class TextureTranscoder{
 public:
     TextureTranscoder();
     TextureTranscoder(VulkanDevice* device);
+
+    // cpu only (no device), transcode every uastc/etc1s texture to the given formats
+    TextureTranscoder(ktx_texture_transcode_fmt_e uastcTarget, ktx_texture_transcode_fmt_e etc1sTarget);
     ~TextureTranscoder();
 
-    void transcode(TranscodeResult& out, VulkanResourceManager* vrm, uint8* data, uint32 size, uint32 width, uint32 height);
-    void destroyActiveTexture(TranscodeResult& out, uint32 sizeBytes);
+    // decode (and transcode) a ktx2 texture into out.texture, failures are
+    // left in out.error. safe on any thread, the first call in the process
+    // is serialized so basis' one-time init isn't raced
+    void transcode(TranscodeResult& out, const uint8* data, uint32 size) const;
+
+    // transcode jobs across pool (serially without one), the
+    // calling thread helps drain the pool until all are done
+    void transcode(TranscodeJob* jobs, uint32 count, ThreadPool* pool) const;
+
+    // copy transcoded data into out.transcodedData and free the texture
+    void copyTexture(TranscodeResult& out);
+    void destroyTexture(TranscodeResult& out);
+
     void reset();
     bool formatSupported(VkFormat format);
 
+    // faces (6 for cubemaps) from a ktx2 header, without decoding
+    static uint32 getFaceCount(const uint8* data, uint32 size);
+
+    // bytes of one width x height image, block compressed
+    // formats are stored as 4x4 blocks of 8 or 16 bytes
+    static uint32 getImageBytes(VkFormat format, uint32 width, uint32 height);
+
 private:
+    void decode(TranscodeResult& out, const uint8* data, uint32 size) const;
+
     VulkanDevice* m_device;
     VkPhysicalDeviceFeatures m_features;
-    ktxTexture2* m_activeTexture;
+
+    // transcode targets, picked once from what the device supports
+    ktx_texture_transcode_fmt_e m_uastcTarget = KTX_TTF_NOSELECTION;
+    ktx_texture_transcode_fmt_e m_etc1sTarget = KTX_TTF_NOSELECTION;
 
     FunctionQueue m_deletionQueue;
 
@@ -31,6 +31,22 @@ public:
         m_streamer.transfer(transfer, false);
     }
 
+    // writes src dstOffset bytes into a buffer already in use
+    template <typename T>
+    void uploadBufferRange(Span<T> src, Handle<Buffer> dst, uint32 dstOffset) {
+        if (src.size() == 0)
+            return;
+        Buffer* dstBuffer = m_rm->get<Buffer>(dst);
+        GPUStreamer::BufferTransfer transfer = {
+            .pSrc = (unsigned char*)src.data(),
+            .dst = dstBuffer,
+            .size = (uint32)(src.size() * sizeof(T)),
+            .memType = (MemoryType)dstBuffer->memType,
+            .dstOffset = dstOffset
+        };
+        m_streamer.transfer(transfer, false);
+    }
+
     template <typename T>
     void uploadManagedBuffer(Handle<Buffer> src, Handle<Buffer> dst) {
         Buffer* dstBuffer = m_rm->get<Buffer>(dst);
@@ -98,6 +114,23 @@ public:
         m_streamer.transfer(transfer, true);
     }
 
+    // streams mips [firstMip, lastMip] into a texture already in use
+    template <typename T>
+    void uploadTextureMips(Span<T> src, Handle<Texture> dst, uint32 firstMip, uint32 lastMip) {
+        if (src.size() == 0)
+            return;
+        Texture* dstTexture = m_rm->get<Texture>(dst);
+        GPUStreamer::TextureTransfer transfer = {
+            .pSrc = (unsigned char*)src.data(),
+            .dst = dstTexture,
+            .size = (uint32)(src.size() * sizeof(T)),
+            .firstMip = firstMip,
+            .lastMip = lastMip,
+            .partial = true
+        };
+        m_streamer.transfer(transfer, false);
+    }
+
     void submit();
 
 private:
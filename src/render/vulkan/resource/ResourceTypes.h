@@ -110,6 +110,7 @@ typedef struct DescriptorSet {
     // !global ==> (size == MAX_FRAME_COUNT)
     std::vector<VkDescriptorSet> descriptorSets{};
     bool global = false;
+    Handle<DescriptorSetLayout> layout{};
     struct Desc;
 } DescriptorSet;
 
@@ -319,6 +320,10 @@ typedef struct DescriptorSet::Desc {
     spr::Span<TextureBinding> textures{};
     spr::Span<BufferBinding> buffers{};
     Handle<DescriptorSetLayout> layout{};
+
+    // global descriptors, written to a set per frame so they
+    // can be replaced while others are in flight (updateTexture)
+    bool perFrame = false;
 } DescriptorSetDesc;
 
 
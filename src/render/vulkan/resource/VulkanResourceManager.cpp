@@ -494,7 +494,7 @@ Handle<DescriptorSet> VulkanResourceManager::create<DescriptorSet>(DescriptorSet
     if (globalDescriptorCount == 0 && perFrameDescriptorCount == 0){
         SprLog::error("[VulkanResourceManager] [create<DescriptorSet>] Cannot manually create descriptor set with no descriptors");
     }
-    bool globalDescriptors = globalDescriptorCount > 0;
+    bool globalDescriptors = globalDescriptorCount > 0 && !desc.perFrame;
 
     // allocate and write descriptor set(s)
     //      will run once if using global descriptors (shared over frames)
@@ -668,11 +668,45 @@ Handle<DescriptorSet> VulkanResourceManager::create<DescriptorSet>(DescriptorSet
     // create descriptor set resource, return handle
     DescriptorSet descriptorSet {
         .descriptorSets = vulkanDescriptorSets,
-        .global = globalDescriptors
+        .global = globalDescriptors,
+        .layout = desc.layout
     };
     return descriptorSetCache->insert(descriptorSet);
 }
 
+void VulkanResourceManager::updateTexture(Handle<DescriptorSet> handle, uint32 binding, uint32 element, Handle<Texture> textureHandle, uint32 frame){
+    DescriptorSet* descriptorSet = get<DescriptorSet>(handle);
+    DescriptorSetLayout* layout = get<DescriptorSetLayout>(descriptorSet->layout);
+    if (descriptorSet->global){
+        SprLog::warn("[VulkanResourceManager] [updateTexture] set is shared by every frame, create it with perFrame");
+        return;
+    }
+
+    for (auto& textureLayout : layout->textureLayouts){
+        if (textureLayout.binding != binding)
+            continue;
+
+        Texture* texture = get<Texture>(textureHandle);
+        VkDescriptorImageInfo textureInfo {
+            .sampler      = texture->sampler,
+            .imageView    = texture->view,
+            .imageLayout  = (VkImageLayout)Flags::ImageLayout::READ_ONLY
+        };
+        VkWriteDescriptorSet descriptorSetWrite {
+            .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet          = descriptorSet->descriptorSets.at(frame % MAX_FRAME_COUNT),
+            .dstBinding      = binding,
+            .dstArrayElement = element,
+            .descriptorCount = 1,
+            .descriptorType  = (VkDescriptorType)textureLayout.type,
+            .pImageInfo      = &textureInfo
+        };
+        vkUpdateDescriptorSets(m_device, 1, &descriptorSetWrite, 0, NULL);
+        return;
+    }
+    SprLog::warn("[VulkanResourceManager] [updateTexture] no texture binding ", binding);
+}
+
 
 
 // ------------------------------------------------------------------------- //
@@ -66,6 +66,10 @@ public:
         return Handle<U>();
     }
 
+    // point element of a perFrame set's texture binding at texture, in the
+    // frame's set only. that frame's previous use has to be done with it
+    void updateTexture(Handle<DescriptorSet> handle, uint32 binding, uint32 element, Handle<Texture> texture, uint32 frame);
+
     uint32 alignedSize(size_t typeSize){
         size_t alignedSize = typeSize;
         if (m_minUBOAlignment > 0) {
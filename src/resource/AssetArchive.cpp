@@ -0,0 +1,175 @@
+#include "AssetArchive.h"
+#include "debug/SprLog.h"
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <filesystem>
+
+namespace spr {
+
+static uint64 alignArchive(uint64 offset){
+    return (offset + SPR_ARCHIVE_ALIGNMENT - 1) & ~(uint64)(SPR_ARCHIVE_ALIGNMENT - 1);
+}
+
+// last write time of a file, 0 if it can't be read
+static int64 writeTime(const std::string& path){
+    std::error_code error;
+    auto time = std::filesystem::last_write_time(path, error);
+    return error ? 0 : (int64)time.time_since_epoch().count();
+}
+
+bool AssetArchive::pack(const PathMap& paths, const std::string& archivePath, uint64 manifestHash){
+    std::vector<ArchiveEntry> entries;
+    entries.reserve(paths.size());
+    for (auto& [id, path] : paths){
+        entries.push_back({id, 0, 0, 0, 0});
+    }
+    std::sort(entries.begin(), entries.end(),
+        [](const ArchiveEntry& a, const ArchiveEntry& b){ return a.id < b.id; });
+
+    std::ofstream out(archivePath, std::ios::binary | std::ios::trunc);
+    if (!out){
+        SprLog::error("[AssetArchive] [pack] can't write: " + archivePath, false);
+        return false;
+    }
+
+    // header and toc are written last, once offsets are known
+    uint64 tocOffset = sizeof(ArchiveHeader);
+    uint64 offset = alignArchive(tocOffset + entries.size() * sizeof(ArchiveEntry));
+    std::vector<char> file;
+    std::vector<char> padding(SPR_ARCHIVE_ALIGNMENT, 0);
+
+    out.seekp(offset);
+    for (ArchiveEntry& entry : entries){
+        std::ifstream in(paths.at(entry.id), std::ios::binary | std::ios::ate);
+        if (!in){
+            SprLog::error("[AssetArchive] [pack] can't read: " + paths.at(entry.id), false);
+            return false;
+        }
+        file.resize(in.tellg());
+        in.seekg(0);
+        in.read(file.data(), file.size());
+
+        entry.offset = offset;
+        entry.sizeBytes = file.size();
+        entry.sourceTime = writeTime(paths.at(entry.id));
+        out.write(file.data(), file.size());
+
+        uint64 next = alignArchive(offset + file.size());
+        out.write(padding.data(), next - offset - file.size());
+        offset = next;
+    }
+
+    ArchiveHeader header = {
+        .magic = SPR_ARCHIVE_MAGIC,
+        .version = SPR_ARCHIVE_VERSION,
+        .entryCount = (uint32)entries.size(),
+        .alignment = SPR_ARCHIVE_ALIGNMENT,
+        .tocOffset = tocOffset,
+        .sizeBytes = offset,
+        .manifestHash = manifestHash
+    };
+    out.seekp(0);
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)entries.data(), entries.size() * sizeof(ArchiveEntry));
+
+    // toc padding, in case there were no assets to write past it
+    out.seekp(0, std::ios::end);
+    if ((uint64)out.tellp() < offset)
+        out.write(padding.data(), offset - out.tellp());
+    return out.good();
+}
+
+uint64 AssetArchive::hashFile(const std::string& path){
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        return 0;
+
+    uint64 hash = 14695981039346656037ull;
+    char buffer[4096];
+    while (in.read(buffer, sizeof(buffer)) || in.gcount() > 0){
+        for (std::streamsize i = 0; i < in.gcount(); i++){
+            hash ^= (uint8)buffer[i];
+            hash *= 1099511628211ull;
+        }
+    }
+    return hash;
+}
+
+bool AssetArchive::open(const std::string& path, uint64 manifestHash){
+    close();
+
+    std::error_code error;
+    m_mmap.map(path, error);
+    if (error){
+        SprLog::error("[AssetArchive] [open] failed to map: " + path, false);
+        return false;
+    }
+
+    const ArchiveHeader* header = (const ArchiveHeader*)m_mmap.data();
+    uint64 size = m_mmap.size();
+    if (size < sizeof(ArchiveHeader) ||
+        header->magic != SPR_ARCHIVE_MAGIC || header->version != SPR_ARCHIVE_VERSION ||
+        header->tocOffset > size || header->entryCount > (size - header->tocOffset) / sizeof(ArchiveEntry)){
+        SprLog::error("[AssetArchive] [open] not a valid archive: " + path, false);
+        close();
+        return false;
+    }
+
+    // every entry has to be inside the mapping, getData doesn't check
+    const ArchiveEntry* entries = (const ArchiveEntry*)(m_mmap.data() + header->tocOffset);
+    for (uint32 i = 0; i < header->entryCount; i++){
+        if (entries[i].offset > size || entries[i].sizeBytes > size - entries[i].offset){
+            SprLog::error("[AssetArchive] [open] entry " + std::to_string(entries[i].id) + " out of bounds: " + path, false);
+            close();
+            return false;
+        }
+    }
+
+    if (header->manifestHash != manifestHash){
+        SprLog::warn("[AssetArchive] [open] packed from another manifest, run pack_assets: " + path);
+        close();
+        return false;
+    }
+
+    m_entries = entries;
+    m_entryCount = header->entryCount;
+    return true;
+}
+
+bool AssetArchive::isCurrent(const PathMap& paths){
+    for (uint32 i = 0; i < m_entryCount; i++){
+        auto itr = paths.find(m_entries[i].id);
+        if (itr == paths.end())
+            continue;
+
+        std::error_code error;
+        uint64 size = std::filesystem::file_size(itr->second, error);
+        if (error)
+            continue;
+        if (size != m_entries[i].sizeBytes || writeTime(itr->second) != m_entries[i].sourceTime){
+            SprLog::warn("[AssetArchive] [isCurrent] " + itr->second + " changed since it was packed, run pack_assets");
+            return false;
+        }
+    }
+    return true;
+}
+
+void AssetArchive::close(){
+    if (m_mmap.is_open())
+        m_mmap.unmap();
+    m_entries = nullptr;
+    m_entryCount = 0;
+}
+
+const ArchiveEntry* AssetArchive::find(uint32 id){
+    const ArchiveEntry* end = m_entries + m_entryCount;
+    const ArchiveEntry* entry = std::lower_bound(m_entries, end, id,
+        [](const ArchiveEntry& entry, uint32 id){ return entry.id < id; });
+
+    if (entry == end || entry->id != id)
+        return nullptr;
+    return entry;
+}
+
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <string>
+#include "core/spruce_core.h"
+#include "external/mio/mio.h"
+#include "ResourceLoader.h"
+
+namespace spr {
+
+static const uint32 SPR_ARCHIVE_MAGIC = 0x4b415053; // "SPAK"
+static const uint32 SPR_ARCHIVE_VERSION = 3;
+static const uint32 SPR_ARCHIVE_ALIGNMENT = 4096;
+
+// default archive, used instead of loose files when present
+static const std::string SPR_ASSET_ARCHIVE = "../data/assets.spak";
+
+// manifest the archive is packed from. its hash is stored in the header,
+// an archive packed from an older manifest isn't mounted. neither is one
+// whose loose files were reconverted since (size or write time changed)
+static const std::string SPR_ARCHIVE_MANIFEST = "../data/asset_manifest.json";
+
+// ╔═ ARCHIVE (.spak) ═════════════════╗<─ .spak begin
+// ║    ArchiveHeader                  ║
+// ╠═══ TOC ═══════════════════════════╣<─ tocOffset
+// ║    ArchiveEntry[entryCount]       ║   sorted by id
+// ╠═══ DATA ══════════════════════════╣<─ 4KB aligned
+// ║    .smdl / .stex                  ║
+// ╠───────────────────────────────────╣<─ 4KB aligned
+// ║    .smdl / .stex                  ║
+// ║                .                  ║
+// ╚═══════════════════════════════════╝
+// assets are stored byte for byte, so offsets within
+// an asset (metadata byteOffset) don't change
+
+typedef struct {
+    uint32 magic;
+    uint32 version;
+    uint32 entryCount;
+    uint32 alignment;
+    uint64 tocOffset;
+    uint64 sizeBytes;
+    uint64 manifestHash;
+} ArchiveHeader;
+
+typedef struct {
+    uint32 id;          // asset (parent) id
+    uint32 padding;
+    uint64 offset;      // from start of archive
+    uint64 sizeBytes;
+    int64 sourceTime;   // last write time of the packed file
+} ArchiveEntry;
+
+// read-only view of a packed archive, one mapping for every asset in it
+class AssetArchive {
+public:
+    AssetArchive(){}
+    ~AssetArchive(){
+        close();
+    }
+
+    // write every file in paths (asset id -> path) into one archive
+    static bool pack(const PathMap& paths, const std::string& archivePath, uint64 manifestHash);
+
+    // fnv-1a of a file's bytes, 0 if it can't be read
+    static uint64 hashFile(const std::string& path);
+
+    // false if the archive is malformed (any entry outside the file) or
+    // was packed from a different manifest than manifestHash
+    bool open(const std::string& path, uint64 manifestHash);
+    void close();
+
+    // false if any packed asset's loose file (asset id -> path) changed
+    // since it was packed. assets without a loose file are current
+    bool isCurrent(const PathMap& paths);
+
+    bool isOpen(){
+        return m_mmap.is_open();
+    }
+
+    // asset's entry, nullptr if it isn't packed. binary search of the toc
+    const ArchiveEntry* find(uint32 id);
+
+    // start of asset's data, nullptr if it isn't packed
+    const char* getData(uint32 id){
+        const ArchiveEntry* entry = find(id);
+        return entry ? m_mmap.data() + entry->offset : nullptr;
+    }
+
+    uint32 getEntryCount(){
+        return m_entryCount;
+    }
+
+private:
+    mio::mmap_source m_mmap;
+    const ArchiveEntry* m_entries = nullptr;
+    uint32 m_entryCount = 0;
+};
+
+}
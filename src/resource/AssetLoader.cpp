@@ -1,4 +1,7 @@
+#include <filesystem>
+#include <algorithm>
 #include "AssetLoader.h"
+#include "AssetManifest.h"
 #include "debug/SprLog.h"
 #include "external/json/json.hpp"
 
@@ -20,7 +23,23 @@ std::vector<ResourceMetadata> AssetLoader::loadMetadata(
         std::vector<uint32>& modelIds,
         std::vector<uint32>& textureIds){
 
-    std::ifstream f("../data/asset_manifest.json");
+    // binary manifest if register_assets wrote one, json otherwise
+    if (!loadBinaryManifest(SPR_ASSET_MANIFEST, resourceMetadata, modelIds, textureIds) &&
+        !loadJsonManifest("../data/asset_manifest.json", resourceMetadata, modelIds, textureIds))
+        SprLog::error("[AssetLoader] [loadMetadata] no asset manifest, run register_assets", false);
+
+    return resourceMetadata;
+}
+
+bool AssetLoader::loadJsonManifest(
+        const std::string& path,
+        std::vector<ResourceMetadata>& resourceMetadata,
+        std::vector<uint32>& modelIds,
+        std::vector<uint32>& textureIds){
+
+    std::ifstream f(path);
+    if (!f)
+        return false;
     nlohmann::json manifest = nlohmann::json::parse(f);
 
     // load models
@@ -60,7 +79,83 @@ std::vector<ResourceMetadata> AssetLoader::loadMetadata(
 
     f.close();
 
-    return resourceMetadata;
+    return true;
 }
 
-}
\ No newline at end of file
+bool AssetLoader::loadBinaryManifest(
+        const std::string& path,
+        std::vector<ResourceMetadata>& resourceMetadata,
+        std::vector<uint32>& modelIds,
+        std::vector<uint32>& textureIds){
+
+    AssetManifest manifest;
+    if (!manifest.open(path))
+        return false;
+
+    // records are models, then non-subresource textures
+    uint32 recordCount = manifest.getRecordCount();
+    uint32 modelCount = manifest.getModelCount();
+    resourceMetadata.reserve(resourceMetadata.size() + recordCount);
+    for (uint32 i = 0; i < recordCount; i++){
+        const ManifestRecord& record = manifest.getRecord(i);
+        std::string name(manifest.getName(record));
+
+        ResourceMetadata metadata;
+        metadata.sizeTotal    = record.sizeTotal;
+        metadata.resourceId   = record.resourceId;
+        metadata.parentId     = record.parentId;
+        metadata.resourceType = (ResourceType)record.resourceType;
+        metadata.sub = 0;
+
+        resourceMetadata.push_back(metadata);
+        if (i < modelCount)
+            modelIds.push_back(metadata.resourceId);
+        else
+            textureIds.push_back(metadata.resourceId);
+        m_paths[metadata.parentId] = ResourceTypes::path(metadata.resourceType, name, metadata.sub);
+        m_names[metadata.parentId] = name;
+    }
+
+    return true;
+}
+
+
+void AssetLoader::loadDirectory(
+        const std::string& directory,
+        std::vector<ResourceMetadata>& resourceMetadata,
+        std::vector<uint32>& modelIds,
+        std::vector<uint32>& textureIds){
+
+    std::error_code error;
+    std::vector<std::filesystem::path> files;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)){
+        std::string extension = entry.path().extension().string();
+        if (entry.is_regular_file() && (extension == ".smdl" || extension == ".stex"))
+            files.push_back(entry.path());
+    }
+    if (error)
+        SprLog::error("[AssetLoader] [loadDirectory] can't read directory: " + directory, false);
+
+    // stable ids across runs
+    std::sort(files.begin(), files.end());
+
+    uint32 id = 0;
+    for (const auto& file : files){
+        ResourceMetadata metadata;
+        metadata.resourceId   = ++id;
+        metadata.parentId     = id;
+        metadata.sizeTotal    = std::filesystem::file_size(file, error);
+        metadata.resourceType = file.extension() == ".smdl" ? SPR_MODEL : SPR_TEXTURE;
+        metadata.sub = 0;
+
+        resourceMetadata.push_back(metadata);
+        if (metadata.resourceType == SPR_MODEL)
+            modelIds.push_back(metadata.resourceId);
+        else
+            textureIds.push_back(metadata.resourceId);
+        m_paths[metadata.parentId] = file.string();
+        m_names[metadata.parentId] = file.stem().string();
+    }
+}
+
+}
@@ -17,6 +17,20 @@ public:
     PathMap getPaths();
     NameMap getNames();
 
+    // manifest written by register_assets, either form gives the same
+    // metadata. false if the manifest can't be read
+    bool loadJsonManifest(
+        const std::string& path,
+        std::vector<ResourceMetadata>& resourceMetadata,
+        std::vector<uint32>& modelIds,
+        std::vector<uint32>& textureIds);
+
+    bool loadBinaryManifest(
+        const std::string& path,
+        std::vector<ResourceMetadata>& resourceMetadata,
+        std::vector<uint32>& modelIds,
+        std::vector<uint32>& textureIds);
+
     friend class SprResourceManager;
 private:
     PathMap m_paths;
@@ -27,5 +41,12 @@ private:
         std::vector<uint32>& modelIds,
         std::vector<uint32>& textureIds);
 
+    // every .smdl (model) and .stex (texture) in directory, with
+    // ids assigned in file name order
+    void loadDirectory(
+        const std::string& directory,
+        std::vector<ResourceMetadata>& resourceMetadata,
+        std::vector<uint32>& modelIds,
+        std::vector<uint32>& textureIds);
 };
 }
\ No newline at end of file
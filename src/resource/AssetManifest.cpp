@@ -0,0 +1,144 @@
+#include "AssetManifest.h"
+#include "debug/SprLog.h"
+#include <fstream>
+
+namespace spr {
+
+bool AssetManifest::write(const std::string& path, const std::vector<ManifestEntry>& models,
+                          const std::vector<ManifestEntry>& textures){
+    std::vector<ManifestRecord> records;
+    std::string strings;
+    records.reserve(models.size() + textures.size());
+
+    for (const std::vector<ManifestEntry>* entries : {&models, &textures}){
+        for (const ManifestEntry& entry : *entries){
+            records.push_back({
+                .resourceId = entry.resourceId,
+                .parentId = entry.parentId,
+                .sizeTotal = entry.sizeTotal,
+                .resourceType = entry.resourceType,
+                .nameOffset = (uint32)strings.size(),
+                .nameLength = (uint32)entry.name.size()
+            });
+            strings += entry.name;
+            strings += '\0';
+        }
+    }
+
+    // at most half full
+    uint32 slotCount = 16;
+    while (slotCount < records.size() * 2){
+        slotCount *= 2;
+    }
+    std::vector<ManifestSlot> slots(slotCount, {0, 0});
+    for (uint32 i = 0; i < records.size(); i++){
+        uint32 slot = hashId(records[i].resourceId, slotCount);
+        while (slots[slot].id != 0){
+            slot = (slot + 1) & (slotCount - 1);
+        }
+        slots[slot] = {records[i].resourceId, i};
+    }
+
+    ManifestHeader header = {
+        .magic = SPR_MANIFEST_MAGIC,
+        .version = SPR_MANIFEST_VERSION,
+        .recordCount = (uint32)records.size(),
+        .modelCount = (uint32)models.size(),
+        .slotCount = slotCount,
+        .stringBytes = (uint32)strings.size(),
+        .recordOffset = sizeof(ManifestHeader),
+        .slotOffset = (uint32)(sizeof(ManifestHeader) + records.size() * sizeof(ManifestRecord)),
+        .stringOffset = (uint32)(sizeof(ManifestHeader) + records.size() * sizeof(ManifestRecord) + slotCount * sizeof(ManifestSlot)),
+        .padding = {0, 0, 0}
+    };
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out){
+        SprLog::error("[AssetManifest] [write] can't write: " + path, false);
+        return false;
+    }
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)records.data(), records.size() * sizeof(ManifestRecord));
+    out.write((const char*)slots.data(), slots.size() * sizeof(ManifestSlot));
+    out.write(strings.data(), strings.size());
+    return out.good();
+}
+
+// every section inside the file, and every slot and name inside its
+// section, so records can be used without further checks
+static bool isValid(const char* data, uint64 size){
+    const ManifestHeader* header = (const ManifestHeader*)data;
+    if (size < sizeof(ManifestHeader) ||
+        header->magic != SPR_MANIFEST_MAGIC || header->version != SPR_MANIFEST_VERSION)
+        return false;
+
+    // sections hold uint32s, slotCount is a power of two for hashId
+    if (header->recordOffset % 4 || header->slotOffset % 4 ||
+        header->slotCount == 0 || (header->slotCount & (header->slotCount - 1)) ||
+        (uint64)header->recordOffset + (uint64)header->recordCount * sizeof(ManifestRecord) > size ||
+        (uint64)header->slotOffset + (uint64)header->slotCount * sizeof(ManifestSlot) > size ||
+        (uint64)header->stringOffset + header->stringBytes > size ||
+        header->modelCount > header->recordCount)
+        return false;
+
+    const ManifestSlot* slots = (const ManifestSlot*)(data + header->slotOffset);
+    for (uint32 i = 0; i < header->slotCount; i++){
+        if (slots[i].id != 0 && slots[i].record >= header->recordCount)
+            return false;
+    }
+
+    const ManifestRecord* records = (const ManifestRecord*)(data + header->recordOffset);
+    for (uint32 i = 0; i < header->recordCount; i++){
+        if ((uint64)records[i].nameOffset + records[i].nameLength > header->stringBytes)
+            return false;
+    }
+    return true;
+}
+
+bool AssetManifest::open(const std::string& path){
+    close();
+
+    std::error_code error;
+    m_mmap.map(path, error);
+    if (error)
+        return false;
+
+    const ManifestHeader* header = (const ManifestHeader*)m_mmap.data();
+    if (!isValid(m_mmap.data(), m_mmap.size())){
+        SprLog::error("[AssetManifest] [open] not a valid manifest: " + path, false);
+        close();
+        return false;
+    }
+
+    m_header = header;
+    m_records = (const ManifestRecord*)(m_mmap.data() + header->recordOffset);
+    m_slots = (const ManifestSlot*)(m_mmap.data() + header->slotOffset);
+    m_strings = m_mmap.data() + header->stringOffset;
+    return true;
+}
+
+void AssetManifest::close(){
+    if (m_mmap.is_open())
+        m_mmap.unmap();
+    m_header = nullptr;
+    m_records = nullptr;
+    m_slots = nullptr;
+    m_strings = nullptr;
+}
+
+const ManifestRecord* AssetManifest::find(uint32 id){
+    if (!m_header || id == 0)
+        return nullptr;
+
+    uint32 slotCount = m_header->slotCount;
+    uint32 slot = hashId(id, slotCount);
+    // a table with no empty slot would never stop probing
+    for (uint32 probe = 0; probe < slotCount && m_slots[slot].id != 0; probe++){
+        if (m_slots[slot].id == id)
+            return &m_records[m_slots[slot].record];
+        slot = (slot + 1) & (slotCount - 1);
+    }
+    return nullptr;
+}
+
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <string_view>
+#include "core/spruce_core.h"
+#include "external/mio/mio.h"
+
+namespace spr {
+
+static const uint32 SPR_MANIFEST_MAGIC = 0x4e414d53; // "SMAN"
+static const uint32 SPR_MANIFEST_VERSION = 1;
+
+// written next to asset_manifest.json by register_assets, read instead of it
+static const std::string SPR_ASSET_MANIFEST = "../data/asset_manifest.bin";
+
+// ╔═ MANIFEST (.bin) ═════════════════╗<─ begin
+// ║    ManifestHeader                 ║
+// ╠═══════════════════════════════════╣<─ recordOffset
+// ║    ManifestRecord[recordCount]    ║   models, then textures
+// ╠═══════════════════════════════════╣<─ slotOffset
+// ║    ManifestSlot[slotCount]        ║   id -> record hash index
+// ╠═══════════════════════════════════╣<─ stringOffset
+// ║    char names[stringBytes]        ║   null terminated
+// ╚═══════════════════════════════════╝
+
+typedef struct {
+    uint32 magic;
+    uint32 version;
+    uint32 recordCount;
+    uint32 modelCount;
+    uint32 slotCount;       // power of two, nonzero
+    uint32 stringBytes;
+    uint32 recordOffset;
+    uint32 slotOffset;
+    uint32 stringOffset;
+    uint32 padding[3];
+} ManifestHeader;
+
+typedef struct {
+    uint32 resourceId;
+    uint32 parentId;
+    uint32 sizeTotal;
+    uint32 resourceType;
+    uint32 nameOffset;      // into names
+    uint32 nameLength;
+} ManifestRecord;
+
+// open addressing, linear probing. id 0 (null resource) marks empty slots
+typedef struct {
+    uint32 id;
+    uint32 record;
+} ManifestSlot;
+
+// writer input, one per model / non-subresource texture
+typedef struct {
+    std::string name;
+    uint32 resourceId;
+    uint32 parentId;
+    uint32 sizeTotal;
+    uint32 resourceType;
+} ManifestEntry;
+
+// flat, mmapped asset manifest. records are used in
+// place, nothing is parsed or allocated to read them
+class AssetManifest {
+public:
+    AssetManifest(){}
+    ~AssetManifest(){
+        close();
+    }
+
+    static bool write(const std::string& path, const std::vector<ManifestEntry>& models,
+                      const std::vector<ManifestEntry>& textures);
+
+    bool open(const std::string& path);
+    void close();
+
+    bool isOpen(){
+        return m_mmap.is_open();
+    }
+
+    uint32 getRecordCount(){
+        return m_header ? m_header->recordCount : 0;
+    }
+
+    uint32 getModelCount(){
+        return m_header ? m_header->modelCount : 0;
+    }
+
+    const ManifestRecord& getRecord(uint32 index){
+        return m_records[index];
+    }
+
+    // record with resource id, nullptr if there isn't one
+    const ManifestRecord* find(uint32 id);
+
+    std::string_view getName(const ManifestRecord& record){
+        return std::string_view(m_strings + record.nameOffset, record.nameLength);
+    }
+
+private:
+    mio::mmap_source m_mmap;
+    const ManifestHeader* m_header = nullptr;
+    const ManifestRecord* m_records = nullptr;
+    const ManifestSlot* m_slots = nullptr;
+    const char* m_strings = nullptr;
+
+    static uint32 hashId(uint32 id, uint32 slotCount){
+        return (id * 2654435761u) & (slotCount - 1);
+    }
+};
+
+}
@@ -0,0 +1,103 @@
+#include "AsyncLoader.h"
+#include <algorithm>
+
+namespace spr {
+
+AsyncLoader::AsyncLoader(uint32 threadCount){
+    m_threadCount = threadCount > 0 ? threadCount : 1;
+}
+
+AsyncLoader::~AsyncLoader(){
+    stop();
+}
+
+void AsyncLoader::submit(SprLoadPriority priority, std::function<void(bool)>&& job){
+    if (m_threads.empty()){
+        m_stop = false;
+        for (uint32 i = 0; i < m_threadCount; i++){
+            m_threads.emplace_back(&AsyncLoader::workerLoop, this);
+        }
+    }
+
+    m_pending++;
+    {
+        std::lock_guard<std::mutex> lock(m_jobMutex);
+        m_jobs.push_back({(uint32)priority, m_sequence++, std::move(job)});
+        std::push_heap(m_jobs.begin(), m_jobs.end(), jobOrder);
+    }
+    m_wake.notify_one();
+}
+
+void AsyncLoader::complete(std::function<void()>&& completion){
+    std::lock_guard<std::mutex> lock(m_completionMutex);
+    m_completions.push_back(std::move(completion));
+}
+
+uint32 AsyncLoader::poll(){
+    {
+        std::lock_guard<std::mutex> lock(m_completionMutex);
+        if (m_completions.empty())
+            return 0;
+        m_polled.swap(m_completions);
+    }
+
+    // completions may submit more requests, so run them unlocked
+    uint32 count = m_polled.size();
+    for (std::function<void()>& completion : m_polled){
+        completion();
+    }
+    m_polled.clear();
+    m_pending -= count;
+    return count;
+}
+
+void AsyncLoader::stop(){
+    std::vector<Job> dropped;
+    {
+        std::lock_guard<std::mutex> lock(m_jobMutex);
+        m_stop = true;
+        dropped.swap(m_jobs);
+    }
+    m_wake.notify_all();
+
+    for (std::thread& thread : m_threads){
+        thread.join();
+    }
+    m_threads.clear();
+
+    // requesters are waiting on these, fail them rather than forget them
+    for (Job& job : dropped){
+        job.function(false);
+    }
+    poll();
+}
+
+bool AsyncLoader::isStopped(){
+    std::lock_guard<std::mutex> lock(m_jobMutex);
+    return m_stop;
+}
+
+bool AsyncLoader::jobOrder(const Job& a, const Job& b){
+    if (a.priority != b.priority)
+        return a.priority < b.priority;
+    return a.sequence > b.sequence;
+}
+
+void AsyncLoader::workerLoop(){
+    while (true){
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_jobMutex);
+            m_wake.wait(lock, [this]{ return m_stop || !m_jobs.empty(); });
+            if (m_stop)
+                return;
+
+            std::pop_heap(m_jobs.begin(), m_jobs.end(), jobOrder);
+            job = std::move(m_jobs.back());
+            m_jobs.pop_back();
+        }
+        job.function(true);
+    }
+}
+
+}
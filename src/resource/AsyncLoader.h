@@ -0,0 +1,141 @@
+#pragma once
+
+#include <mutex>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+#include "core/spruce_core.h"
+#include "core/memory/Handle.h"
+
+namespace spr {
+
+// loads are mostly waiting on the disk, so more
+// threads than cores left over from the frame is fine
+static const uint32 SPR_ASYNC_LOAD_THREADS = 4;
+
+typedef enum {
+    SPR_LOAD_PENDING,
+    SPR_LOAD_READY,
+    SPR_LOAD_FAILED,
+    SPR_LOAD_CANCELLED
+} SprLoadState;
+
+typedef enum {
+    SPR_LOAD_PRIORITY_LOW,
+    SPR_LOAD_PRIORITY_NORMAL,
+    SPR_LOAD_PRIORITY_HIGH
+} SprLoadPriority;
+
+// state of one request, shared by the requester, the worker
+// loading it and the main thread completing it
+template <typename T>
+struct AsyncLoad {
+    uint32 id = 0;
+    std::atomic<SprLoadState> state = SPR_LOAD_PENDING;
+    std::atomic<bool> cancelled = false;
+    Handle<T> handle;   // set before state becomes ready
+};
+
+// future-like result of SprResourceManager::requestAsync, state
+// only changes while the main thread polls
+template <typename T>
+class AsyncHandle {
+public:
+    AsyncHandle() = default;
+    AsyncHandle(std::shared_ptr<AsyncLoad<T>> load) : m_load(load) {}
+
+    SprLoadState getState() const {
+        return m_load ? m_load->state.load() : SPR_LOAD_FAILED;
+    }
+
+    bool isPending() const { return getState() == SPR_LOAD_PENDING; }
+    bool isReady() const { return getState() == SPR_LOAD_READY; }
+    bool isFailed() const { return getState() == SPR_LOAD_FAILED; }
+    bool isCancelled() const { return getState() == SPR_LOAD_CANCELLED; }
+
+    // cache handle, invalid until ready
+    Handle<T> get() const {
+        return isReady() ? m_load->handle : Handle<T>();
+    }
+
+    uint32 getId() const {
+        return m_load ? m_load->id : 0;
+    }
+
+    friend class SprResourceManager;
+
+private:
+    std::shared_ptr<AsyncLoad<T>> m_load;
+};
+
+
+// worker threads servicing load jobs, highest priority first
+// (oldest first within a priority). workers never touch the
+// resource caches, they hand completions back to be run on
+// the main thread by poll()
+class AsyncLoader {
+public:
+    AsyncLoader(uint32 threadCount = SPR_ASYNC_LOAD_THREADS);
+    ~AsyncLoader();
+
+    AsyncLoader(const AsyncLoader&) = delete;
+    AsyncLoader& operator=(const AsyncLoader&) = delete;
+
+    // queue a job, workers are started on first use. every job must
+    // call complete() exactly once. run is false if the job was dropped
+    // by stop(), it should complete with a failure without loading
+    void submit(SprLoadPriority priority, std::function<void(bool run)>&& job);
+
+    // queue a completion to run on the next poll (worker side)
+    void complete(std::function<void()>&& completion);
+
+    // run finished jobs' completions on the calling
+    // thread, returns how many ran
+    uint32 poll();
+
+    // submitted jobs not completed by poll yet
+    uint32 getPendingCount(){
+        return m_pending;
+    }
+
+    // drop queued jobs (they complete as failed), wait for running
+    // ones and join workers. every completion left, including those of
+    // the dropped jobs, runs on the calling thread before returning
+    void stop();
+
+    // stopped and not restarted by a submit since. jobs submitted
+    // now would restart the workers
+    bool isStopped();
+
+private:
+    struct Job {
+        uint32 priority;
+        uint64 sequence;
+        std::function<void(bool)> function;
+    };
+
+    uint32 m_threadCount;
+    std::vector<std::thread> m_threads;
+
+    // heap ordered by (priority, -sequence)
+    std::vector<Job> m_jobs;
+    uint64 m_sequence = 0;
+    std::mutex m_jobMutex;
+    std::condition_variable m_wake;
+    bool m_stop = false;
+
+    std::mutex m_completionMutex;
+    std::vector<std::function<void()>> m_completions;
+    std::vector<std::function<void()>> m_polled;
+
+    // main thread only
+    uint32 m_pending = 0;
+
+    static bool jobOrder(const Job& a, const Job& b);
+    void workerLoop();
+};
+
+}
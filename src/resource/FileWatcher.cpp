@@ -0,0 +1,80 @@
+#include "FileWatcher.h"
+#include "debug/SprLog.h"
+#include <algorithm>
+#include <filesystem>
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+namespace spr {
+
+#if defined(__linux__)
+
+FileWatcher::FileWatcher(){
+    m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (m_fd < 0)
+        SprLog::error("[FileWatcher] inotify unavailable", false);
+}
+
+FileWatcher::~FileWatcher(){
+    if (m_fd >= 0)
+        close(m_fd);
+}
+
+bool FileWatcher::watch(const std::string& directory){
+    if (m_fd < 0)
+        return false;
+
+    // finished writes and atomic saves (write temp, rename over)
+    int wd = inotify_add_watch(m_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (wd < 0){
+        SprLog::error("[FileWatcher] [watch] can't watch: " + directory, false);
+        return false;
+    }
+    m_directories[wd] = directory;
+    return true;
+}
+
+void FileWatcher::poll(std::vector<std::string>& changed){
+    if (m_fd < 0)
+        return;
+
+    alignas(inotify_event) char events[4096];
+    size_t first = changed.size();
+    while (true){
+        ssize_t size = read(m_fd, events, sizeof(events));
+        if (size <= 0)
+            break;
+
+        for (char* ptr = events; ptr < events + size; ptr += sizeof(inotify_event) + ((inotify_event*)ptr)->len){
+            inotify_event* event = (inotify_event*)ptr;
+            auto directory = m_directories.find(event->wd);
+            if (event->len == 0 || directory == m_directories.end())
+                continue;
+
+            std::string path = (std::filesystem::path(directory->second) / event->name).string();
+            if (std::find(changed.begin() + first, changed.end(), path) == changed.end())
+                changed.push_back(path);
+        }
+    }
+}
+
+#else
+
+FileWatcher::FileWatcher(){
+    SprLog::warn("[FileWatcher] file watching is only supported on linux");
+}
+
+FileWatcher::~FileWatcher(){}
+
+bool FileWatcher::watch(const std::string& directory){
+    return false;
+}
+
+void FileWatcher::poll(std::vector<std::string>& changed){}
+
+#endif
+
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "external/flat_hash_map/flat_hash_map.hpp"
+#include "core/spruce_core.h"
+
+namespace spr {
+
+// reports files written or moved into watched directories (not
+// recursive). inotify backed, unsupported on other platforms
+class FileWatcher {
+public:
+    FileWatcher();
+    ~FileWatcher();
+
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    bool watch(const std::string& directory);
+
+    // paths of files finished changing since the last call, never blocks.
+    // a file saved several times in between is reported once
+    void poll(std::vector<std::string>& changed);
+
+    bool isOpen(){
+        return m_fd >= 0;
+    }
+
+private:
+    int m_fd = -1;
+
+    // watch descriptor -> directory
+    ska::flat_hash_map<int, std::string> m_directories;
+};
+
+}
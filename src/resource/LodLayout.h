@@ -0,0 +1,29 @@
+#pragma once
+
+#include "../core/spruce_core.h"
+
+namespace spr {
+
+// .smdl lod layout, written by gltfparser and read by ResourceLoader
+
+static const uint32 SPR_MAX_MESH_LODS = 8;
+
+// index range of one lod (in indices) relative to the mesh's index data,
+// every lod of a mesh shares its vertices
+struct LodLayout {
+    uint32 firstIndex;
+    uint32 indexCount;
+    float error;        // object space deviation from lod 0
+    uint32 pad0;
+};
+
+// MeshLayout extension (version 1), MeshLodLayout[i] belongs to MeshLayout[i]
+struct MeshLodLayout {
+    uint32 lodCount;
+    uint32 pad0;
+    uint32 pad1;
+    uint32 pad2;
+    LodLayout lods[SPR_MAX_MESH_LODS];
+};
+
+}
@@ -3,9 +3,38 @@
 #include "external/flat_hash_map/flat_hash_map.hpp"
 #include "core/memory/Pool.h"
 #include "ResourceLoader.h"
+#include "AsyncLoader.h"
+#include "ResourceRef.h"
 
 namespace spr {
 
+typedef struct {
+    uint64 residentBytes;
+    uint64 budgetBytes;     // 0 if unlimited
+    uint32 resident;
+    uint32 loads;
+    uint32 evictions;
+    uint32 reloads;         // loads of previously evicted ids
+} CacheStats;
+
+// cpu memory a loaded resource accounts for
+template <typename T>
+inline uint32 resourceBytes(T&){
+    return sizeof(T);
+}
+
+// buffers point into their mapped file, which stays
+// resident (and mapped) as long as they're loaded
+template <>
+inline uint32 resourceBytes<Buffer>(Buffer& buffer){
+    return sizeof(Buffer) + buffer.byteLength;
+}
+
+template <>
+inline uint32 resourceBytes<Model>(Model& model){
+    return sizeof(Model) + model.meshIds.capacity() * sizeof(uint32);
+}
+
 class ResourceCache {
 public:
     virtual ~ResourceCache() = default;
@@ -22,6 +51,21 @@ public:
     virtual uint32 getSize() = 0;
 
     virtual void destroy() = 0;
+
+    virtual CacheStats getStats() = 0;
+
+    // least recent use of an evictable entry, UINT64_MAX if there's none
+    virtual uint64 getOldestUse() = 0;
+
+    // unload the least recently used unpinned entry
+    virtual bool evictOldest(ResourceLoader& resourceLoader) = 0;
+
+    // unload entries whose last ResourceRef dropped, returns how many
+    virtual uint32 releaseUnused(ResourceLoader& resourceLoader) = 0;
+
+protected:
+    // shared by every cache, so the global budget can compare their entries
+    static inline uint64 s_useClock = 0;
 };
 
 template <typename T>
@@ -39,48 +83,300 @@ public:
         Handle<T> handle;
 
         // verify handle exists
-        if (m_handles.count(id) > 0)
-            handle = m_handles[id];
+        auto itr = m_handles.find(id);
+        if (itr != m_handles.end())
+            handle = itr->second;
         
         // valid handle, up-to-date in pool
-        if (handle.isValid() && m_data.isValidHandle(handle))
+        if (handle.isValid() && m_data.isValidHandle(handle)){
+            touch(handle.m_index);
             return handle;
+        }
         
-        // handle isn't valid or isn't up-to-date in pool, 
-        // load data and update
+        // handle isn't valid or isn't up-to-date in pool (never
+        // loaded or evicted), load data and update. loading adds
+        // child metadata, so pass a copy rather than a reference
         T data;
-        resourceLoader.loadFromMetadata<T>(metadataMap, metadataMap[id], data);
-        handle = m_data.insert(data);
+        ResourceMetadata metadata = metadataMap[id];
+        resourceLoader.loadFromMetadata<T>(metadataMap, metadata, data);
+        return insert(id, data, resourceLoader);
+    }
+
+    // handle of id if it's loaded, invalid otherwise
+    inline Handle<T> findHandle(uint32 id){
+        auto itr = m_handles.find(id);
+        if (itr == m_handles.end() || !itr->second.isValid() || !m_data.isValidHandle(itr->second))
+            return Handle<T>();
+        return itr->second;
+    }
+
+    // add loaded data, evicting down to the budget
+    inline Handle<T> insert(uint32 id, T& data, ResourceLoader& resourceLoader){
+        Handle<T> handle = m_data.insert(data);
         m_handles[id] = handle;
 
+        if (handle.m_index >= m_entries.size())
+            m_entries.resize(std::max((uint32)m_entries.size() * 2, handle.m_index + 1));
+        CacheEntry& entry = m_entries[handle.m_index];
+        entry = {id, resourceBytes<T>(data), 0, 0, -1, -1, handle};
+        m_residentBytes += entry.bytes;
+        m_stats.loads++;
+        if (m_evictedIds.erase(id) > 0)
+            m_stats.reloads++;
+
+        link(handle.m_index);
+        touch(handle.m_index);
+
+        while (m_budgetBytes > 0 && m_residentBytes > m_budgetBytes && evictOldest(resourceLoader));
         return handle;
     }
 
-    // get data from pool with handle
+    // data of every id, loading what isn't loaded. entries resolved earlier
+    // in the batch are pinned so the budget can't evict them underneath
+    inline void getData(Span<uint32> ids, T** out, ResourceLoader& resourceLoader, MetadataMap& metadataMap){
+        if (m_budgetBytes == 0){
+            for (uint32 i = 0; i < ids.size(); i++){
+                out[i] = m_data.get(getHandle(ids.data()[i], resourceLoader, metadataMap));
+            }
+            return;
+        }
+
+        m_batch.resize(ids.size());
+        for (uint32 i = 0; i < ids.size(); i++){
+            m_batch[i] = getHandle(ids.data()[i], resourceLoader, metadataMap);
+            pin(m_batch[i]);
+        }
+        for (uint32 i = 0; i < ids.size(); i++){
+            unpin(m_batch[i]);
+            out[i] = m_data.get(m_batch[i]);
+        }
+    }
+
+    // get data from pool with handle, nullptr if
+    // it was deleted or evicted (reload by id)
     inline T* getData(Handle<T> handle){
-        return m_data.get(handle);    
+        T* data = m_data.get(handle);
+        if (data)
+            touch(handle.m_index);
+        return data;
     }
 
     inline void deleteData(Handle<T> handle){
         if (!handle.isValid() || !m_data.isValidHandle(handle)){
             return;
         }
+        if (isTracked(handle)){
+            CacheEntry& entry = m_entries[handle.m_index];
+            if (entry.pins == 0)
+                unlink(handle.m_index);
+            m_residentBytes -= entry.bytes;
+        }
         m_data.remove(handle);
     }
+
+    // swap in reloaded data, the handle stays valid
+    inline void replace(Handle<T> handle, T& data, ResourceLoader& resourceLoader){
+        T* current = m_data.get(handle);
+        resourceLoader.unload<T>(*current);
+        *current = data;
+
+        if (isTracked(handle)){
+            CacheEntry& entry = m_entries[handle.m_index];
+            m_residentBytes -= entry.bytes;
+            entry.bytes = resourceBytes<T>(data);
+            m_residentBytes += entry.bytes;
+        }
+    }
+
+    // pinned data is never evicted, pins nest
+    inline void pin(Handle<T> handle){
+        if (!isTracked(handle))
+            return;
+        if (m_entries[handle.m_index].pins++ == 0)
+            unlink(handle.m_index);
+    }
+
+    inline void unpin(Handle<T> handle){
+        if (!isTracked(handle) || m_entries[handle.m_index].pins == 0)
+            return;
+        if (--m_entries[handle.m_index].pins == 0){
+            link(handle.m_index);
+            touch(handle.m_index);
+        }
+    }
+
+    // counted reference to loaded id, pins it until the last ref drops
+    inline ResourceRef<T> acquire(uint32 id, Handle<T> handle){
+        std::unique_ptr<RefCount<T>>& refs = m_refs[id];
+        if (!refs){
+            refs = std::make_unique<RefCount<T>>();
+            refs->id = id;
+            refs->queue = &m_releases;
+        }
+
+        // first ref, or deleted by hand and loaded again since
+        if (refs->handle != handle){
+            refs->handle = handle;
+            pin(handle);
+        }
+        return ResourceRef<T>(refs.get());
+    }
+
+    uint32 releaseUnused(ResourceLoader& resourceLoader){
+        m_releaseBatch.clear();
+        m_releases.take(m_releaseBatch);
+
+        uint32 released = 0;
+        for (RefCount<T>* refs : m_releaseBatch){
+            // acquired again before this safe point, or its last
+            // ref dropped again after take() and it's queued for the next
+            if (!m_releases.isUnused(refs))
+                continue;
+
+            T* data = m_data.get(refs->handle);
+            if (data){
+                unpin(refs->handle);
+
+                // still pinned by hand, stays loaded until that's unpinned
+                if (m_entries[refs->handle.m_index].pins > 0){
+                    m_refs.erase(refs->id);
+                    continue;
+                }
+
+                resourceLoader.unload<T>(*data);
+                m_handles.erase(refs->id);
+                deleteData(refs->handle);
+                released++;
+            }
+            m_refs.erase(refs->id);
+        }
+        return released;
+    }
+
+    // 0 for unlimited
+    void setBudget(uint64 bytes){
+        m_budgetBytes = bytes;
+    }
     
     void destroy(){
         m_data.destroy();
+        m_entries.clear();
+        m_lruHead = -1;
+        m_lruTail = -1;
+        m_residentBytes = 0;
     }
 
     uint32 getSize(){
         return m_data.getSize();
     }
 
+    CacheStats getStats(){
+        CacheStats stats = m_stats;
+        stats.residentBytes = m_residentBytes;
+        stats.budgetBytes = m_budgetBytes;
+        stats.resident = m_data.getSize();
+        return stats;
+    }
+
+    uint64 getOldestUse(){
+        if (m_lruTail < 0 || m_lruTail == m_lruHead)
+            return UINT64_MAX;
+        return m_entries[m_lruTail].lastUse;
+    }
+
+    // the most recently used entry is never evicted, it's
+    // typically the one that was just loaded or fetched
+    bool evictOldest(ResourceLoader& resourceLoader){
+        if (m_lruTail < 0 || m_lruTail == m_lruHead)
+            return false;
+
+        CacheEntry& entry = m_entries[m_lruTail];
+        Handle<T> handle = entry.handle;
+        resourceLoader.unload<T>(*m_data.get(handle));
+        m_evictedIds.insert(entry.id);
+        m_handles.erase(entry.id);
+        deleteData(handle);
+        m_stats.evictions++;
+        return true;
+    }
+
     friend class SprResourceManager;
 
 private:
+    // per pool slot, unpinned entries form a
+    // doubly linked list, most recently used first
+    typedef struct {
+        uint32 id;
+        uint32 bytes;
+        uint64 lastUse;
+        uint32 pins;
+        int32 prev;
+        int32 next;
+        Handle<T> handle;
+    } CacheEntry;
+
     ska::flat_hash_map<uint32, Handle<T>> m_handles;
     Pool<T> m_data;
+
+    std::vector<CacheEntry> m_entries;
+    int32 m_lruHead = -1;
+    int32 m_lruTail = -1;
+    uint64 m_residentBytes = 0;
+    uint64 m_budgetBytes = 0;
+    CacheStats m_stats = {0, 0, 0, 0, 0, 0};
+    ska::flat_hash_set<uint32> m_evictedIds;
+    std::vector<Handle<T>> m_batch;
+
+    // counts of acquired ids, and those whose last ref dropped
+    ska::flat_hash_map<uint32, std::unique_ptr<RefCount<T>>> m_refs;
+    ReleaseQueue<T> m_releases;
+    std::vector<RefCount<T>*> m_releaseBatch;
+
+    // async loads in flight, so repeated requests share one
+    ska::flat_hash_map<uint32, std::shared_ptr<AsyncLoad<T>>> m_requests;
+
+    // live and loaded since the last destroy
+    bool isTracked(Handle<T> handle){
+        return handle.isValid() && m_data.get(handle) && handle.m_index < m_entries.size();
+    }
+
+    // move to the front of the lru list
+    void touch(uint32 index){
+        if (index >= m_entries.size())
+            return;
+        CacheEntry& entry = m_entries[index];
+        entry.lastUse = ++s_useClock;
+        if (entry.pins > 0 || m_lruHead == (int32)index)
+            return;
+        unlink(index);
+        link(index);
+    }
+
+    // insert at the front
+    void link(uint32 index){
+        CacheEntry& entry = m_entries[index];
+        entry.prev = -1;
+        entry.next = m_lruHead;
+        if (m_lruHead >= 0)
+            m_entries[m_lruHead].prev = index;
+        m_lruHead = index;
+        if (m_lruTail < 0)
+            m_lruTail = index;
+    }
+
+    void unlink(uint32 index){
+        CacheEntry& entry = m_entries[index];
+        if (entry.prev >= 0)
+            m_entries[entry.prev].next = entry.next;
+        else
+            m_lruHead = entry.next;
+        if (entry.next >= 0)
+            m_entries[entry.next].prev = entry.prev;
+        else
+            m_lruTail = entry.prev;
+        entry.prev = -1;
+        entry.next = -1;
+    }
 };
 
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "ResourceLoader.h"
+#include "AssetArchive.h"
 #include "debug/SprLog.h"
 #include "ResourceTypes.h"
 #include "SprResourceManager.h"
@@ -6,8 +7,13 @@
 
 namespace spr{
 
-ResourceLoader::ResourceLoader(){
+ResourceLoader::ResourceLoader(uint32 maxMappings){
+    m_maxMappings = maxMappings;
+    m_archive = std::make_unique<AssetArchive>();
+}
 
+ResourceLoader::~ResourceLoader(){
+    disable();
 }
 
 template <typename T>
@@ -15,25 +21,224 @@ void ResourceLoader::loadFromMetadata(MetadataMap& metadataMap, ResourceMetadata
     SprLog::error("[ResourceLoader] Unkown resource");
 }
 
-void ResourceLoader::checkMapping(uint32 id){
-    if (!m_mmap.is_mapped()){
-        m_mmap.map(m_pathMap[id], m_error);
-        m_mappedId = id;
+const char* ResourceLoader::getFile(uint32 id, Mapping*& mapping){
+    mapping = nullptr;
+    std::string path;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_archive->isOpen() && m_unpacked.count(id) == 0){
+            const char* data = m_archive->getData(id);
+            if (data)
+                return data;
+        }
+
+        auto itr = m_mappings.find(id);
+        if (itr != m_mappings.end()){
+            mapping = itr->second;
+            mapping->lastUse = ++m_useCounter;
+            mapping->refCount++;
+            m_stats.hits++;
+            return mapping->mmap.data();
+        }
+        path = m_pathMap[id];
+    }
+
+    // map without the lock, other loads go on meanwhile
+    std::error_code error;
+    Mapping* mapped = new Mapping();
+    mapped->mmap.map(path, error);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (error){
+        SprLog::error("[ResourceLoader] [getFile] failed to map: " + path, false);
+        delete mapped;
+        return nullptr;
+    }
+
+    // another thread mapped it first
+    auto itr = m_mappings.find(id);
+    if (itr != m_mappings.end()){
+        mapped->mmap.unmap();
+        delete mapped;
+        mapping = itr->second;
+        mapping->lastUse = ++m_useCounter;
+        mapping->refCount++;
+        m_stats.hits++;
+        return mapping->mmap.data();
+    }
+
+    evict();
+    mapped->refCount = 1;
+    mapped->lastUse = ++m_useCounter;
+    m_mappings[id] = mapped;
+    m_stats.maps++;
+    mapping = mapped;
+    return mapping->mmap.data();
+}
+
+void ResourceLoader::releaseFile(Mapping* mapping){
+    if (!mapping)
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (mapping->refCount > 0)
+        mapping->refCount--;
+
+    // invalidated while it was being read
+    if (mapping->refCount > 0)
+        return;
+    for (uint32 i = 0; i < m_retired.size(); i++){
+        if (m_retired[i] != mapping)
+            continue;
+        mapping->mmap.unmap();
+        delete mapping;
+        m_retired[i] = m_retired.back();
+        m_retired.pop_back();
+        m_stats.unmaps++;
         return;
     }
+}
+
+bool ResourceLoader::mountArchive(const std::string& path, uint64 manifestHash){
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_archive->open(path, manifestHash))
+        return false;
+    if (!m_archive->isCurrent(m_pathMap)){
+        m_archive->close();
+        return false;
+    }
+    m_stats.maps++;
+    return true;
+}
+
+void ResourceLoader::evict(){
+    while (m_mappings.size() >= m_maxMappings){
+        uint32 lruId = 0;
+        Mapping* lru = nullptr;
+        for (auto& [id, mapping] : m_mappings){
+            if (mapping->refCount == 0 && (!lru || mapping->lastUse < lru->lastUse)){
+                lruId = id;
+                lru = mapping;
+            }
+        }
+
+        // everything is referenced, go over budget
+        if (!lru)
+            return;
+
+        lru->mmap.unmap();
+        delete lru;
+        m_mappings.erase(lruId);
+        m_stats.unmaps++;
+    }
+}
+
+void ResourceLoader::invalidate(uint32 id){
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_unpacked.insert(id);
+
+    auto itr = m_mappings.find(id);
+    if (itr == m_mappings.end())
+        return;
 
-    if (m_mappedId != id){
-        m_mmap.unmap();
-        m_mmap.map(m_pathMap[id], m_error);
-        m_mappedId = id;
+    Mapping* mapping = itr->second;
+    m_mappings.erase(itr);
+    if (mapping->refCount > 0){
+        m_retired.push_back(mapping);
         return;
     }
+    mapping->mmap.unmap();
+    delete mapping;
+    m_stats.unmaps++;
+}
+
+template <>
+void ResourceLoader::unload<Buffer>(Buffer& buffer){
+    const char* data = (const char*)buffer.data.data();
+    auto inMapping = [data](Mapping* mapping){
+        return data >= mapping->mmap.data() && data < mapping->mmap.data() + mapping->mmap.size();
+    };
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto itr = m_mappings.find(buffer.parentId);
+    if (itr != m_mappings.end() && inMapping(itr->second)){
+        if (itr->second->refCount > 0)
+            itr->second->refCount--;
+        return;
+    }
+
+    // loaded before its file was invalidated
+    for (uint32 i = 0; i < m_retired.size(); i++){
+        Mapping* mapping = m_retired[i];
+        if (!inMapping(mapping))
+            continue;
+        if (--mapping->refCount == 0){
+            mapping->mmap.unmap();
+            delete mapping;
+            m_retired[i] = m_retired.back();
+            m_retired.pop_back();
+            m_stats.unmaps++;
+        }
+        return;
+    }
+}
+
+template <>
+void ResourceLoader::prefault<Buffer>(Buffer& buffer){
+    // one read per page, the buffer holds a reference so
+    // its mapping can't go away underneath
+    volatile uint8 sink = 0;
+    for (uint32 offset = 0; offset < buffer.data.size(); offset += 4096){
+        sink = sink + buffer.data.data()[offset];
+    }
+}
+
+void ResourceLoader::releaseAll(){
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& [id, mapping] : m_mappings){
+        mapping->refCount = 0;
+    }
+    for (Mapping* mapping : m_retired){
+        mapping->mmap.unmap();
+        delete mapping;
+        m_stats.unmaps++;
+    }
+    m_retired.clear();
 }
 
 void ResourceLoader::disable(){
-    if (m_mmap.is_mapped()){
-        m_mmap.unmap();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_archive->isOpen()){
+        m_archive->close();
+        m_stats.unmaps++;
+    }
+    for (auto& [id, mapping] : m_mappings){
+        mapping->mmap.unmap();
+        delete mapping;
+        m_stats.unmaps++;
+    }
+    m_mappings.clear();
+    for (Mapping* mapping : m_retired){
+        mapping->mmap.unmap();
+        delete mapping;
+        m_stats.unmaps++;
     }
+    m_retired.clear();
+}
+
+uint32 ResourceLoader::childId(uint32 parentId, uint32 slot){
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint32& id = m_childIds[((uint64)parentId << 32) | slot];
+    if (id == 0)
+        id = ++m_id;
+    return id;
+}
+
+MappingStats ResourceLoader::getMappingStats(){
+    std::lock_guard<std::mutex> lock(m_mutex);
+    MappingStats stats = m_stats;
+    stats.live = m_mappings.size() + m_retired.size() + (m_archive->isOpen() ? 1 : 0);
+    return stats;
 }
 
 
@@ -42,17 +247,20 @@ void ResourceLoader::disable(){
 // ------------------------------------------------------------------------- //
 template <>
 void ResourceLoader::loadFromMetadata<Model>(MetadataMap& metadataMap, ResourceMetadata& metadata, Model& model){
-    checkMapping(metadata.parentId);
+    Mapping* mapping;
+    const char* file = getFile(metadata.parentId, mapping);
+    if (!file)
+        return;
 
-    ModelHeader& modelHeader = ((ModelHeader*)(m_mmap.data() + 0))[0];
-    spr::Span<MeshLayout> meshLayouts = {(MeshLayout*) (m_mmap.data() + modelHeader.meshBufferOffset), modelHeader.meshCount};
+    ModelHeader& modelHeader = ((ModelHeader*)(file + 0))[0];
+    spr::Span<MeshLayout> meshLayouts = {(MeshLayout*) (file + modelHeader.meshBufferOffset), modelHeader.meshCount};
     
     std::vector<uint32> meshIds;
     meshIds.reserve(modelHeader.meshCount);
     uint32 meshId = 0;
     uint32 i = 0;
     for (const MeshLayout& mesh : meshLayouts){
-        meshId = ++m_id;
+        meshId = childId(metadata.resourceId, i);
         metadataMap[meshId] = {
             .resourceType = SPR_MESH,
             .resourceId = meshId,
@@ -71,6 +279,7 @@ void ResourceLoader::loadFromMetadata<Model>(MetadataMap& metadataMap, ResourceM
     model.resourceId = metadata.resourceId;
     model.meshCount = modelHeader.meshCount;
     model.meshIds = meshIds;
+    releaseFile(mapping);
 }
 
 
@@ -79,14 +288,17 @@ void ResourceLoader::loadFromMetadata<Model>(MetadataMap& metadataMap, ResourceM
 // ------------------------------------------------------------------------- //
 template <>
 void ResourceLoader::loadFromMetadata<Mesh>(MetadataMap& metadataMap, ResourceMetadata& metadata, Mesh& mesh){
-    checkMapping(metadata.parentId);
+    Mapping* mapping;
+    const char* file = getFile(metadata.parentId, mapping);
+    if (!file)
+        return;
     
-    ModelHeader& modelHeader = ((ModelHeader*)(m_mmap.data() + 0))[0];
-    MeshLayout& meshLayout = ((MeshLayout*)(m_mmap.data() + modelHeader.meshBufferOffset))[metadata.index];    
+    ModelHeader& modelHeader = ((ModelHeader*)(file + 0))[0];
+    MeshLayout& meshLayout = ((MeshLayout*)(file + modelHeader.meshBufferOffset))[metadata.index];    
     
-    MaterialLayout& material = ((MaterialLayout*)(m_mmap.data() + modelHeader.materialBufferOffset))[meshLayout.materialIndex];
+    MaterialLayout& material = ((MaterialLayout*)(file + modelHeader.materialBufferOffset))[meshLayout.materialIndex];
     uint32 materialFlags = material.materialFlags;
-    uint32 materialId = ++m_id;
+    uint32 materialId = childId(metadata.resourceId, 0);
     metadataMap[materialId] = {
         .resourceType = SPR_MATERIAL,
         .resourceId = materialId,
@@ -96,8 +308,8 @@ void ResourceLoader::loadFromMetadata<Mesh>(MetadataMap& metadataMap, ResourceMe
         .index = meshLayout.materialIndex
     };
 
-    BlobHeader& blob = ((BlobHeader*)(m_mmap.data() + modelHeader.blobHeaderOffset))[0];
-    uint32 indexBufferId = ++m_id;
+    BlobHeader& blob = ((BlobHeader*)(file + modelHeader.blobHeaderOffset))[0];
+    uint32 indexBufferId = childId(metadata.resourceId, 1);
     metadataMap[indexBufferId] = {
         .resourceType = SPR_BUFFER,
         .resourceId = indexBufferId,
@@ -107,7 +319,7 @@ void ResourceLoader::loadFromMetadata<Mesh>(MetadataMap& metadataMap, ResourceMe
         .index = 0
     };
 
-    uint32 positionBufferId = ++m_id;
+    uint32 positionBufferId = childId(metadata.resourceId, 2);
     metadataMap[positionBufferId] = {
         .resourceType = SPR_BUFFER,
         .resourceId = positionBufferId,
@@ -117,7 +329,7 @@ void ResourceLoader::loadFromMetadata<Mesh>(MetadataMap& metadataMap, ResourceMe
         .index = 0
     };
 
-    uint32 attributesBufferId = ++m_id;
+    uint32 attributesBufferId = childId(metadata.resourceId, 3);
     metadataMap[attributesBufferId] = {
         .resourceType = SPR_BUFFER,
         .resourceId = attributesBufferId,
@@ -134,6 +346,41 @@ void ResourceLoader::loadFromMetadata<Mesh>(MetadataMap& metadataMap, ResourceMe
     mesh.positionBufferId = positionBufferId;
     mesh.attributesBufferId = attributesBufferId;
     mesh.materialFlags = materialFlags;
+
+    // float vertices unless the file says otherwise (version 2)
+    bool hasHeader = modelHeader.meshBufferOffset >= sizeof(ModelHeader);
+    mesh.vertexFormat = SPR_VERTEX_FORMAT_FLOAT;
+    if (hasHeader && modelHeader.version >= 2 && modelHeader.meshDecodeBufferOffset){
+        MeshDecodeLayout& decode = ((MeshDecodeLayout*)(file + modelHeader.meshDecodeBufferOffset))[metadata.index];
+        mesh.vertexFormat = decode.vertexFormat;
+        mesh.positionOffset = decode.positionOffset;
+        mesh.positionScale = decode.positionScale;
+        mesh.uvOffsetScale = decode.uvOffsetScale;
+    }
+
+    // older files have one lod, the whole index buffer
+    bool hasLods = hasHeader && modelHeader.version >= 1 && modelHeader.meshLodBufferOffset;
+    if (!hasLods){
+        mesh.lodCount = 1;
+        mesh.lods[0] = {
+            .firstIndex = 0,
+            .indexCount = meshLayout.indexDataSizeBytes / (uint32)sizeof(uint32),
+            .error = 0.f
+        };
+        releaseFile(mapping);
+        return;
+    }
+
+    MeshLodLayout& lodLayout = ((MeshLodLayout*)(file + modelHeader.meshLodBufferOffset))[metadata.index];
+    mesh.lodCount = std::clamp(lodLayout.lodCount, 1u, SPR_MAX_MESH_LODS);
+    for (uint32 lod = 0; lod < mesh.lodCount; lod++){
+        mesh.lods[lod] = {
+            .firstIndex = lodLayout.lods[lod].firstIndex,
+            .indexCount = lodLayout.lods[lod].indexCount,
+            .error = lodLayout.lods[lod].error
+        };
+    }
+    releaseFile(mapping);
 }
 
 
@@ -142,7 +389,10 @@ void ResourceLoader::loadFromMetadata<Mesh>(MetadataMap& metadataMap, ResourceMe
 // ------------------------------------------------------------------------- //
 template <>
 void ResourceLoader::loadFromMetadata<Material>(MetadataMap& metadataMap, ResourceMetadata& metadata, Material& material){
-    checkMapping(metadata.parentId);
+    Mapping* mapping;
+    const char* file = getFile(metadata.parentId, mapping);
+    if (!file)
+        return;
     
     uint32 materialFlags = 0;
     uint32 baseColorTexId = 0;
@@ -151,8 +401,8 @@ void ResourceLoader::loadFromMetadata<Material>(MetadataMap& metadataMap, Resour
     uint32 occlusionTexId = 0;
     uint32 emissiveTexId = 0;
 
-    ModelHeader& modelHeader = ((ModelHeader*)(m_mmap.data() + 0))[0];
-    MaterialLayout& materialLayout = ((MaterialLayout*)(m_mmap.data() + modelHeader.materialBufferOffset))[metadata.index];
+    ModelHeader& modelHeader = ((ModelHeader*)(file + 0))[0];
+    MaterialLayout& materialLayout = ((MaterialLayout*)(file + modelHeader.materialBufferOffset))[metadata.index];
     materialFlags = materialLayout.materialFlags;
 
     material.parentId = metadata.parentId;
@@ -160,7 +410,7 @@ void ResourceLoader::loadFromMetadata<Material>(MetadataMap& metadataMap, Resour
     material.materialFlags = materialFlags;
 
     if (materialFlags & 0b1){ // base color
-        baseColorTexId = ++m_id;
+        baseColorTexId = childId(metadata.resourceId, 0);
         metadataMap[baseColorTexId] = {
             .resourceType = SPR_TEXTURE,
             .resourceId = baseColorTexId,
@@ -174,7 +424,7 @@ void ResourceLoader::loadFromMetadata<Material>(MetadataMap& metadataMap, Resour
         material.baseColorFactor = materialLayout.baseColorFactor;
     }
     if (materialFlags & (0b1<<1)){ // metallicroughness
-        metalRoughTexId = ++m_id;
+        metalRoughTexId = childId(metadata.resourceId, 1);
         metadataMap[metalRoughTexId] = {
             .resourceType = SPR_TEXTURE,
             .resourceId = metalRoughTexId,
@@ -189,7 +439,7 @@ void ResourceLoader::loadFromMetadata<Material>(MetadataMap& metadataMap, Resour
         material.roughnessFactor = materialLayout.roughnessFactor;
     }
     if (materialFlags & (0b1<<2)){ // normal
-        normalTexId = ++m_id;
+        normalTexId = childId(metadata.resourceId, 2);
         metadataMap[normalTexId] = {
             .resourceType = SPR_TEXTURE,
             .resourceId = normalTexId,
@@ -203,7 +453,7 @@ void ResourceLoader::loadFromMetadata<Material>(MetadataMap& metadataMap, Resour
         material.normalScale = materialLayout.normalScale;
     }
     if (materialFlags & (0b1<<3)){ // occlusion
-        occlusionTexId = ++m_id;
+        occlusionTexId = childId(metadata.resourceId, 3);
         metadataMap[occlusionTexId] = {
             .resourceType = SPR_TEXTURE,
             .resourceId = occlusionTexId,
@@ -217,7 +467,7 @@ void ResourceLoader::loadFromMetadata<Material>(MetadataMap& metadataMap, Resour
         material.occlusionStrength = materialLayout.occlusionStrength;
     }
     if (materialFlags & (0b1<<4)){ // emissive
-        emissiveTexId = ++m_id;
+        emissiveTexId = childId(metadata.resourceId, 4);
         metadataMap[emissiveTexId] = {
             .resourceType = SPR_TEXTURE,
             .resourceId = emissiveTexId,
@@ -237,6 +487,7 @@ void ResourceLoader::loadFromMetadata<Material>(MetadataMap& metadataMap, Resour
     if (materialFlags & (0b1<<6)){ // double-sided
         material.doubleSided = true;
     }
+    releaseFile(mapping);
 }
 
 
@@ -245,19 +496,22 @@ void ResourceLoader::loadFromMetadata<Material>(MetadataMap& metadataMap, Resour
 // ------------------------------------------------------------------------- //
 template <>
 void ResourceLoader::loadFromMetadata<Texture>(MetadataMap& metadataMap, ResourceMetadata& metadata, Texture& texture){
-    checkMapping(metadata.parentId);
+    Mapping* mapping;
+    const char* file = getFile(metadata.parentId, mapping);
+    if (!file)
+        return;
     
-    ModelHeader& modelHeader = ((ModelHeader*)(m_mmap.data()))[0];
+    ModelHeader& modelHeader = ((ModelHeader*)(file))[0];
     uint32 layoutOffset = 0;
     if (metadata.sub){
         layoutOffset = modelHeader.textureBufferOffset;
     }
-    TextureLayout& textureLayout = ((TextureLayout*)(m_mmap.data() + layoutOffset))[metadata.index];
+    TextureLayout& textureLayout = ((TextureLayout*)(file + layoutOffset))[metadata.index];
 
-    uint32 bufferId = ++m_id;
+    uint32 bufferId = childId(metadata.resourceId, 0);
     uint32 offset = 0;
     if (metadata.sub){
-        BlobHeader& blob = ((BlobHeader*)(m_mmap.data() + modelHeader.blobHeaderOffset))[0];
+        BlobHeader& blob = ((BlobHeader*)(file + modelHeader.blobHeaderOffset))[0];
         offset = blob.textureRegionOffset + textureLayout.dataOffset;
     } else {
         offset = sizeof(TextureLayout);
@@ -279,6 +533,7 @@ void ResourceLoader::loadFromMetadata<Texture>(MetadataMap& metadataMap, Resourc
     texture.height = textureLayout.height;
     texture.width = textureLayout.width;
     texture.components = textureLayout.components;
+    releaseFile(mapping);
 }
 
 
@@ -287,13 +542,19 @@ void ResourceLoader::loadFromMetadata<Texture>(MetadataMap& metadataMap, Resourc
 // ------------------------------------------------------------------------- //
 template <>
 void ResourceLoader::loadFromMetadata<Buffer>(MetadataMap& metadataMap, ResourceMetadata& metadata, Buffer& buffer){
-    checkMapping(metadata.parentId);
+    Mapping* mapping;
+    const char* file = getFile(metadata.parentId, mapping);
+    if (!file)
+        return;
 
     buffer.parentId = metadata.parentId;
     buffer.resourceId = metadata.resourceId;
     buffer.byteLength = metadata.byteLength;
     buffer.byteOffset = metadata.byteOffset;
-    buffer.data = {(uint8*)m_mmap.data() + metadata.byteOffset, metadata.byteLength};
+    buffer.data = {(uint8*)file + metadata.byteOffset, metadata.byteLength};
+
+    // span points into the mapping, getFile's reference keeps
+    // it mapped (the archive stays mapped regardless)
 }
 
 // ----------------------------------------------------------------------------
@@ -6,37 +6,121 @@
 #include <filesystem>
 #include <string>
 #include <vector>
+#include <mutex>
+#include <memory>
 #include "ResourceTypes.h"
 #include "data/asset_ids.h"
 #include "external/mio/mio.h"
+#include "external/flat_hash_map/flat_hash_map.hpp"
 
 namespace spr {
 
+class AssetArchive;
+
 typedef ska::flat_hash_map<uint32, ResourceMetadata> MetadataMap;
 typedef ska::flat_hash_map<uint32, std::string> PathMap;
 
+// mapped files kept around when nothing points into them
+static const uint32 SPR_MAX_MAPPINGS = 16;
+
+// a mapped asset file. buffers loaded from it point into the mapping,
+// so it's only unmapped once none are left (and it's least recently used)
+typedef struct {
+    mio::mmap_source mmap;
+    uint32 refCount;
+    uint64 lastUse;
+} Mapping;
+
+typedef struct {
+    uint32 maps;
+    uint32 unmaps;
+    uint32 hits;
+    uint32 live;
+} MappingStats;
+
+// safe to use from several threads at once, files are mapped
+// outside the lock so loads of different assets overlap
 class ResourceLoader {
 public:
-    ResourceLoader();
+    ResourceLoader(uint32 maxMappings = SPR_MAX_MAPPINGS);
 
-    ~ResourceLoader(){}
+    ~ResourceLoader();
 
     template <typename T>
     void loadFromMetadata(MetadataMap& metadataMap, ResourceMetadata& metadata, T& data);
 
-    void checkMapping(uint32 id);
+    // drop the reference a loaded resource holds on its file
+    template <typename T>
+    void unload(T& data){}
+
+    // read the pages a loaded resource points into, so the first
+    // real access doesn't stall on the disk
+    template <typename T>
+    void prefault(T& data){}
+
+    // all loaded buffers were destroyed at once
+    void releaseAll();
+
+    // start of asset id's file, from the archive if it's packed (mapping
+    // is nullptr then) or its own mapping otherwise. nullptr on failure.
+    // the mapping is referenced (kept mapped) until releaseFile
+    const char* getFile(uint32 id, Mapping*& mapping);
+    void releaseFile(Mapping* mapping);
+
+    // resolve packed assets from archive instead of loose files, if
+    // it's valid, was packed from the manifest with manifestHash, and
+    // none of the loose files (updatePaths) changed since
+    bool mountArchive(const std::string& path, uint64 manifestHash);
+
+    // asset id's file changed on disk, later loads map it again (loose,
+    // even if it's packed). buffers into the old mapping keep it alive
+    void invalidate(uint32 id);
+
+    // unmap everything, buffer spans are invalid afterwards
     void disable();
 
+    MappingStats getMappingStats();
+
     void updateId(uint32 id){ m_id = id; }
     void updatePaths(PathMap pathMap){ m_pathMap = pathMap; }
 
+    // set once at init, read only afterwards
+    const PathMap& getPaths(){ return m_pathMap; }
+
 private:
+    // guards everything below
+    std::mutex m_mutex;
     uint32 m_id = 0;
 
-    std::error_code m_error;
-    mio::mmap_source m_mmap;
-    uint32 m_mappedId = 0;
+    ska::flat_hash_map<uint32, Mapping*> m_mappings;
+    uint32 m_maxMappings;
+    uint64 m_useCounter = 0;
+    MappingStats m_stats = {0, 0, 0, 0};
 
     PathMap m_pathMap;
+    std::unique_ptr<AssetArchive> m_archive;
+
+    // invalidated mappings buffers still point into, and
+    // packed assets that changed since the archive was built
+    std::vector<Mapping*> m_retired;
+    ska::flat_hash_set<uint32> m_unpacked;
+
+    // ids of subresources registered while loading, by parent resource id
+    // and slot. reloads (after cache eviction) reuse them, so handles and
+    // ids held elsewhere stay valid and metadata doesn't grow
+    ska::flat_hash_map<uint64, uint32> m_childIds;
+
+    // unmap least recently used unreferenced files until
+    // there's room, m_mutex held
+    void evict();
+
+    uint32 childId(uint32 parentId, uint32 slot);
 };
+
+template <>
+void ResourceLoader::unload<Buffer>(Buffer& buffer);
+
+template <>
+void ResourceLoader::prefault<Buffer>(Buffer& buffer);
+
 }
\ No newline at end of file
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include <utility>
+#include "core/spruce_core.h"
+#include "core/memory/Handle.h"
+
+namespace spr {
+
+template <typename T>
+class ReleaseQueue;
+
+// one per referenced resource, owned by its cache. every
+// ResourceRef to the resource shares (and counts on) it
+template <typename T>
+struct RefCount {
+    std::atomic<uint32> count = 0;
+    uint32 id = 0;
+    Handle<T> handle;           // main thread only
+    ReleaseQueue<T>* queue = nullptr;
+    bool queued = false;        // guarded by the queue's mutex
+};
+
+// resources whose last ref dropped, any thread pushes,
+// the main thread takes them at a safe point
+template <typename T>
+class ReleaseQueue {
+public:
+    // drop a ref that may be the last one. the count reaches zero and
+    // is queued under the same lock, so take() + isUnused() never see
+    // a zero count whose push is still to come (and free it first)
+    void release(RefCount<T>* refs){
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (refs->count.fetch_sub(1, std::memory_order_acq_rel) != 1 || refs->queued)
+            return;
+        refs->queued = true;
+        m_released.push_back(refs);
+    }
+
+    // no refs left and not queued again since take(), safe to free
+    bool isUnused(RefCount<T>* refs){
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return refs->count.load(std::memory_order_acquire) == 0 && !refs->queued;
+    }
+
+    void take(std::vector<RefCount<T>*>& out){
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (RefCount<T>* refs : m_released){
+            refs->queued = false;
+        }
+        out.swap(m_released);
+        m_released.clear();
+    }
+
+private:
+    std::mutex m_mutex;
+    std::vector<RefCount<T>*> m_released;
+};
+
+// counted reference to a loaded resource, from SprResourceManager::acquire.
+// referenced resources are never evicted. once the last ref drops the
+// resource is queued and unloaded by the next releaseUnused(), unless
+// it's acquired again first. refs can be copied and dropped on any
+// thread, but must not outlive the resource manager
+template <typename T>
+class ResourceRef {
+public:
+    ResourceRef() = default;
+
+    explicit ResourceRef(RefCount<T>* refs) : m_refs(refs) {
+        if (m_refs)
+            m_refs->count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    ResourceRef(const ResourceRef& other) : ResourceRef(other.m_refs) {}
+
+    ResourceRef(ResourceRef&& other) noexcept : m_refs(other.m_refs) {
+        other.m_refs = nullptr;
+    }
+
+    ResourceRef& operator=(ResourceRef other){
+        std::swap(m_refs, other.m_refs);
+        return *this;
+    }
+
+    ~ResourceRef(){
+        reset();
+    }
+
+    void reset(){
+        if (!m_refs)
+            return;
+
+        // not the last ref, no lock needed
+        uint32 count = m_refs->count.load(std::memory_order_relaxed);
+        while (count > 1){
+            if (m_refs->count.compare_exchange_weak(count, count - 1, std::memory_order_acq_rel)){
+                m_refs = nullptr;
+                return;
+            }
+        }
+        m_refs->queue->release(m_refs);
+        m_refs = nullptr;
+    }
+
+    bool isValid() const { return m_refs != nullptr; }
+
+    uint32 getId() const {
+        return m_refs ? m_refs->id : 0;
+    }
+
+    // cache handle, read it on the main thread
+    Handle<T> getHandle() const {
+        return m_refs ? m_refs->handle : Handle<T>();
+    }
+
+    // refs to the resource, including this one
+    uint32 getCount() const {
+        return m_refs ? m_refs->count.load(std::memory_order_relaxed) : 0;
+    }
+
+private:
+    RefCount<T>* m_refs = nullptr;
+};
+
+}
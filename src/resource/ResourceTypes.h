@@ -4,8 +4,10 @@
 #include <typeindex>
 #include <typeinfo>
 #include <vector>
+#include <algorithm>
 #include "core/spruce_core.h"
 #include "core/util/Span.h"
+#include "LodLayout.h"
 
 namespace spr {
     
@@ -93,12 +95,56 @@ struct Model : ResourceInstance {
 
 
 // mesh
+enum VertexFormat : uint32 {
+    SPR_VERTEX_FORMAT_FLOAT = 0,        // VertexPosition, VertexAttributes
+    SPR_VERTEX_FORMAT_QUANTIZED = 1     // VertexPositionQ, VertexAttributesQ
+};
+
+// one level of detail, a range of the mesh's index buffer
+struct MeshLod {
+    uint32 firstIndex = 0;
+    uint32 indexCount = 0;
+    float error       = 0.f;  // object space deviation from lod 0
+};
+
+// projScale = viewport height / (2 * tan(fovy / 2)), pixels per unit at distance 1
+inline float getLodScreenError(const MeshLod& lod, float distance, float projScale){
+    return lod.error * projScale / std::max(distance, 1e-4f);
+}
+
+// coarsest of lods that stays within maxErrorPixels
+inline uint32 selectLod(const MeshLod* lods, uint32 lodCount, float distance, float projScale, float maxErrorPixels){
+    uint32 lod = lodCount > 0 ? lodCount - 1 : 0;
+    while (lod > 0 && getLodScreenError(lods[lod], distance, projScale) > maxErrorPixels){
+        lod--;
+    }
+    return lod;
+}
+
 struct Mesh : ResourceInstance {
     uint32 materialId         = 0;
     uint32 indexBufferId      = 0;
     uint32 positionBufferId   = 0;
     uint32 attributesBufferId = 0;
     uint32 materialFlags      = 0;
+
+    // quantized vertices decode to offset + q * scale, see MeshDecodeLayout
+    uint32 vertexFormat      = SPR_VERTEX_FORMAT_FLOAT;
+    glm::vec4 positionOffset = glm::vec4(0.f);
+    glm::vec4 positionScale  = glm::vec4(1.f);
+    glm::vec4 uvOffsetScale  = glm::vec4(0.f, 0.f, 1.f, 1.f);
+
+    // lod 0 is the full mesh, coarser ones follow
+    uint32 lodCount = 1;
+    MeshLod lods[SPR_MAX_MESH_LODS];
+
+    float getScreenError(uint32 lod, float distance, float projScale){
+        return getLodScreenError(lods[lod], distance, projScale);
+    }
+
+    uint32 selectLod(float distance, float projScale, float maxErrorPixels){
+        return spr::selectLod(lods, lodCount, distance, projScale, maxErrorPixels);
+    }
 };
 
 
@@ -216,6 +262,14 @@ public:
 // ║                                   ║
 // ║      Texture[]                    ║ 
 // ║                                   ║ 
+// ╠───────────────────────────────────╣<─ meshLodBufferOffset (version 1)
+// ║                                   ║
+// ║      MeshLod[]                    ║ 
+// ║                                   ║ 
+// ╠───────────────────────────────────╣<─ meshDecodeBufferOffset (version 2)
+// ║                                   ║
+// ║      MeshDecode[]                 ║ 
+// ║                                   ║ 
 // ╠═══ BLOB ══════════════════════════╣<─ blobHeaderOffset
 // ║      BlobHeader                   ║ 
 // ╠═════ DATA REGIONS ════════════════╣<─ blobDataOffset
@@ -275,8 +329,19 @@ struct ModelHeader {
 
     uint32 blobHeaderOffset;
     uint32 blobDataOffset;
+
+    // not in files older than version 1, their mesh
+    // buffer starts here (meshBufferOffset < sizeof(ModelHeader))
+    uint32 version;
+    uint32 meshLodBufferOffset;
+    uint32 meshDecodeBufferOffset;  // version 2
+    uint32 pad0;
 };
 
+// 1: MeshLodLayout[] after the textures
+// 2: MeshDecodeLayout[] after those, quantized vertices
+static const uint32 SPR_MODEL_VERSION = 2;
+
 struct MeshLayout {
     // index of mesh's material in
     // .smdl Material buffer
@@ -296,6 +361,19 @@ struct MeshLayout {
     uint32 attributeDataOffset;
 };
 
+// MeshLayout extension (version 2), how MeshLayout[i]'s vertices are stored
+struct MeshDecodeLayout {
+    uint32 vertexFormat;
+    uint32 pad0;
+    uint32 pad1;
+    uint32 pad2;
+
+    // quantized q (0..1) decodes to offset + q * scale
+    glm::vec4 positionOffset;
+    glm::vec4 positionScale;
+    glm::vec4 uvOffsetScale;     // [ offset.uv | scale.uv ]
+};
+
 struct MaterialLayout {
     uint32 materialFlags;
     
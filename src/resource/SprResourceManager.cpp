@@ -1,4 +1,6 @@
 #include "SprResourceManager.h"
+#include "AssetArchive.h"
+#include <filesystem>
 
 namespace spr{
 
@@ -6,26 +8,23 @@ SprResourceManager::SprResourceManager(){
     init();
 }
 
-SprResourceManager::~SprResourceManager(){
-    // delete model cache
-    ModelCache* modelCache = ((ModelCache*) m_resourceMap[typeid(Model)]);
-    delete modelCache;
-
-    // delete mesh cache
-    MeshCache* meshCache = ((MeshCache*) m_resourceMap[typeid(Mesh)]);
-    delete meshCache;
+SprResourceManager::SprResourceManager(const std::string& directory){
+    std::vector<ResourceMetadata> resourceMetadata;
 
-    // delete material cache
-    MaterialCache* materialCache = ((MaterialCache*) m_resourceMap[typeid(Material)]);
-    delete materialCache;
+    AssetLoader assetLoader;
+    assetLoader.loadDirectory(directory, resourceMetadata, m_modelIds, m_textureIds);
+    init(assetLoader, resourceMetadata);
+}
 
-    // delete texture cache
-    TextureCache* textureCache = ((TextureCache*) m_resourceMap[typeid(Texture)]);
-    delete textureCache;
+SprResourceManager::~SprResourceManager(){
+    // workers may still be loading
+    m_asyncLoader.stop();
 
-    // delete buffer cache
-    BufferCache* bufferCache = ((BufferCache*) m_resourceMap[typeid(Buffer)]);
-    delete bufferCache;
+    delete m_modelCache;
+    delete m_meshCache;
+    delete m_materialCache;
+    delete m_textureCache;
+    delete m_bufferCache;
 }
 
 void SprResourceManager::init(){
@@ -34,7 +33,15 @@ void SprResourceManager::init(){
 
     AssetLoader assetLoader;
     assetLoader.loadMetadata(resourceMetadata, m_modelIds, m_textureIds);
+    init(assetLoader, resourceMetadata);
+
+    // packed assets (tools/pack_assets), loose files are still used for
+    // anything the archive doesn't have, or all of it if it's out of date
+    if (std::filesystem::exists(SPR_ASSET_ARCHIVE))
+        m_resourceLoader.mountArchive(SPR_ASSET_ARCHIVE, AssetArchive::hashFile(SPR_ARCHIVE_MANIFEST));
+}
 
+void SprResourceManager::init(AssetLoader& assetLoader, std::vector<ResourceMetadata>& resourceMetadata){
     // register resources with metadata
     for (auto & metadata : resourceMetadata){
         registerResource(metadata);
@@ -46,6 +53,152 @@ void SprResourceManager::init(){
     m_resourceLoader.updatePaths(assetLoader.getPaths());
 }
 
+// watcher and registered paths have to agree on a spelling
+static std::string normalPath(const std::string& path){
+    std::error_code error;
+    std::filesystem::path normal = std::filesystem::weakly_canonical(path, error);
+    return error ? std::filesystem::path(path).lexically_normal().string() : normal.string();
+}
+
+bool SprResourceManager::enableHotReload(){
+    m_watcher = std::make_unique<FileWatcher>();
+    if (!m_watcher->isOpen()){
+        m_watcher.reset();
+        return false;
+    }
+
+    ska::flat_hash_set<std::string> directories;
+    {
+        std::lock_guard<std::mutex> lock(m_loadMutex);
+        for (auto& [id, path] : m_resourceLoader.getPaths()){
+            std::string normal = normalPath(path);
+            m_watchedPaths[normal] = id;
+            directories.insert(std::filesystem::path(normal).parent_path().string());
+        }
+    }
+
+    for (const std::string& directory : directories){
+        if (!m_watcher->watch(directory)){
+            m_watcher.reset();
+            m_watchedPaths.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+void SprResourceManager::checkReloads(){
+    m_changedPaths.clear();
+    m_watcher->poll(m_changedPaths);
+    for (const std::string& path : m_changedPaths){
+        // temp files of atomic saves, new assets etc.
+        auto itr = m_watchedPaths.find(normalPath(path));
+        if (itr != m_watchedPaths.end())
+            reloadAsset(itr->second);
+    }
+}
+
+void SprResourceManager::reloadAsset(uint32 assetId){
+    // loader was stopped (disableLoader), a reload would restart it
+    // against unmapped files. leave the current data and generation be
+    if (m_asyncLoader.isStopped()){
+        SprLog::warn("[SprResourceManager] [reloadAsset] loader stopped, dropping reload of asset " + std::to_string(assetId));
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_loadMutex);
+        m_resourceLoader.invalidate(assetId);
+    }
+
+    auto reload = std::make_shared<AssetReload>();
+    reload->assetId = assetId;
+    reload->generation = ++m_reloadGenerations[assetId];
+    collectReload<Model>(assetId, reload->models);
+    collectReload<Mesh>(assetId, reload->meshes);
+    collectReload<Material>(assetId, reload->materials);
+    collectReload<Texture>(assetId, reload->textures);
+    collectReload<Buffer>(assetId, reload->buffers);
+
+    m_asyncLoader.submit(SPR_LOAD_PRIORITY_HIGH, [this, reload](bool run){
+        if (!run){
+            m_asyncLoader.complete([]{});
+            return;
+        }
+
+        refreshMetadata(reload->assetId);
+        loadReload<Model>(reload->models);
+        loadReload<Mesh>(reload->meshes);
+        loadReload<Material>(reload->materials);
+        loadReload<Texture>(reload->textures);
+        loadReload<Buffer>(reload->buffers);
+        for (ResourceReload<Buffer>& buffer : reload->buffers){
+            m_resourceLoader.prefault<Buffer>(buffer.data);
+        }
+
+        // frame boundary, swap everything at once
+        m_asyncLoader.complete([this, reload]{
+            bool current = m_reloadGenerations[reload->assetId] == reload->generation;
+            {
+                std::lock_guard<std::mutex> lock(m_loadMutex);
+                swapReload<Model>(reload->models, current);
+                swapReload<Mesh>(reload->meshes, current);
+                swapReload<Material>(reload->materials, current);
+                swapReload<Texture>(reload->textures, current);
+                swapReload<Buffer>(reload->buffers, current);
+                enforceBudget();
+            }
+            if (current && m_reloadCallback)
+                m_reloadCallback(reload->assetId);
+        });
+    });
+}
+
+void SprResourceManager::refreshMetadata(uint32 assetId){
+    ResourceMetadata metadata;
+    {
+        std::lock_guard<std::mutex> lock(m_loadMutex);
+        auto itr = m_metadata.find(assetId);
+        if (itr == m_metadata.end())
+            return;
+        metadata = itr->second;
+    }
+
+    // children are read back from what this refresh registered,
+    // everything is merged into m_metadata at the end
+    MetadataMap fresh;
+    if (metadata.resourceType != SPR_MODEL){
+        Texture texture;
+        m_resourceLoader.loadFromMetadata<Texture>(fresh, metadata, texture);
+    } else {
+        Model model;
+        m_resourceLoader.loadFromMetadata<Model>(fresh, metadata, model);
+        for (uint32 meshId : model.meshIds){
+            Mesh mesh;
+            metadata = fresh[meshId];
+            m_resourceLoader.loadFromMetadata<Mesh>(fresh, metadata, mesh);
+
+            Material material;
+            metadata = fresh[mesh.materialId];
+            m_resourceLoader.loadFromMetadata<Material>(fresh, metadata, material);
+
+            uint32 textureIds[] = {material.baseColorTexId, material.metalRoughTexId,
+                                   material.normalTexId, material.occlusionTexId, material.emissiveTexId};
+            for (uint32 textureId : textureIds){
+                if (textureId == 0)
+                    continue;
+                Texture texture;
+                metadata = fresh[textureId];
+                m_resourceLoader.loadFromMetadata<Texture>(fresh, metadata, texture);
+            }
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(m_loadMutex);
+    for (auto& [id, child] : fresh){
+        m_metadata[id] = child;
+    }
+}
 
 
 }
\ No newline at end of file
@@ -1,7 +1,13 @@
 #pragma once
 
+#include <mutex>
+#include <memory>
+#include <functional>
 #include "ResourceCache.h"
 #include "AssetLoader.h"
+#include "AsyncLoader.h"
+#include "FileWatcher.h"
+#include "debug/SprLog.h"
 #include "external/flat_hash_map/flat_hash_map.hpp"
 
 
@@ -15,52 +21,295 @@ class MaterialCache : public TypedResourceCache<Material>{};
 class TextureCache : public TypedResourceCache<Texture>{};
 class BufferCache : public TypedResourceCache<Buffer>{};
 
+// a loaded resource of a changed asset, reloaded in the background
+template <typename U>
+struct ResourceReload {
+    uint32 id;
+    Handle<U> handle;
+    U data;
+};
+
+// everything loaded from one changed asset file, swapped in at once
+struct AssetReload {
+    uint32 assetId;
+    uint32 generation;
+    std::vector<ResourceReload<Model>> models;
+    std::vector<ResourceReload<Mesh>> meshes;
+    std::vector<ResourceReload<Material>> materials;
+    std::vector<ResourceReload<Texture>> textures;
+    std::vector<ResourceReload<Buffer>> buffers;
+};
+
 class SprResourceManager {
 public:
     SprResourceManager();
+
+    // headless, registers every .smdl/.stex in directory
+    // instead of reading the asset manifest
+    SprResourceManager(const std::string& directory);
     ~SprResourceManager();
 
+    // typed cache, resolved at compile time
+    // U := ResourceType
+    template <typename U>
+    TypedResourceCache<U>* getCache(){
+        if constexpr (std::is_same_v<U, Model>)
+            return m_modelCache;
+        else if constexpr (std::is_same_v<U, Mesh>)
+            return m_meshCache;
+        else if constexpr (std::is_same_v<U, Material>)
+            return m_materialCache;
+        else if constexpr (std::is_same_v<U, Texture>)
+            return m_textureCache;
+        else {
+            static_assert(std::is_same_v<U, Buffer>, "not a resource type");
+            return m_bufferCache;
+        }
+    }
 
     // U := ResourceType
     template <typename U>
     Handle<U> getHandle(uint32 id){
-        auto resourceCache = m_resourceMap[typeid(U)];
-        auto typedCache = dynamic_cast<TypedResourceCache<U>*>(resourceCache);
-        return typedCache->getHandle(id, m_resourceLoader, m_metadata);
+        auto typedCache = getCache<U>();
+        std::lock_guard<std::mutex> lock(m_loadMutex);
+        Handle<U> handle = typedCache->getHandle(id, m_resourceLoader, m_metadata);
+        enforceBudget();
+        return handle;
     }
 
+    // locked like loads, a lookup touches the cache's lru state
     // U := ResourceType
     template <typename U>
     U* getData(Handle<U> handle){
-        auto resourceCache = m_resourceMap[typeid(U)];
-        auto typedCache = dynamic_cast<TypedResourceCache<U>*>(resourceCache);
+        auto typedCache = getCache<U>();
+        std::lock_guard<std::mutex> lock(m_loadMutex);
         return typedCache->getData(handle);
     }
 
     // U := ResourceType
     template <typename U>
     U* getData(uint32 id){
-        auto resourceCache = m_resourceMap[typeid(U)];
-        auto typedCache = dynamic_cast<TypedResourceCache<U>*>(resourceCache);
-        auto handle = typedCache->getHandle(id, m_resourceLoader, m_metadata);
-        return typedCache->getData(handle);
+        return getData<U>(getHandle<U>(id));
+    }
+
+    // data of every id into out (ids.size() long), loading what isn't
+    // loaded under one lock. with a budget set, pointers stay valid until
+    // the next load of the type (the batch can go over it until then)
+    // U := ResourceType
+    template <typename U>
+    void getData(Span<uint32> ids, U** out){
+        auto typedCache = getCache<U>();
+        std::lock_guard<std::mutex> lock(m_loadMutex);
+        typedCache->getData(ids, out, m_resourceLoader, m_metadata);
     }
 
     // U := ResourceType
     template <typename U>
     void deleteData(uint32 id){
-        auto resourceCache = m_resourceMap[typeid(U)];
-        auto typedCache = dynamic_cast<TypedResourceCache<U>*>(resourceCache);
-        auto handle = typedCache->getHandle(id, m_resourceLoader, m_metadata);
-        return typedCache->deleteData(handle);
+        deleteData<U>(getHandle<U>(id));
     }
 
     // U := ResourceType
     template <typename U>
     void deleteData(Handle<U> handle){
-        auto resourceCache = m_resourceMap[typeid(U)];
-        auto typedCache = dynamic_cast<TypedResourceCache<U>*>(resourceCache);
-        return typedCache->deleteData(handle);
+        auto typedCache = getCache<U>();
+        std::lock_guard<std::mutex> lock(m_loadMutex);
+
+        // release its file mapping
+        U* data = typedCache->getData(handle);
+        if (data)
+            m_resourceLoader.unload<U>(*data);
+        typedCache->deleteData(handle);
+    }
+
+    // counted reference to id, loaded if it isn't. keeps it loaded (and
+    // out of budget eviction) until every copy is dropped and the next
+    // releaseUnused() runs. invalid if id couldn't be loaded
+    // U := ResourceType
+    template <typename U>
+    ResourceRef<U> acquire(uint32 id){
+        auto typedCache = getCache<U>();
+        std::lock_guard<std::mutex> lock(m_loadMutex);
+        if (m_metadata.count(id) == 0){
+            SprLog::error("[SprResourceManager] [acquire] unknown resource id: " + std::to_string(id), false);
+            return ResourceRef<U>();
+        }
+
+        Handle<U> handle = typedCache->getHandle(id, m_resourceLoader, m_metadata);
+        U* data = typedCache->getData(handle);
+        if (!data || data->resourceId != id){
+            enforceBudget();
+            return ResourceRef<U>();
+        }
+
+        // referenced before the budget is enforced, so it isn't evicted
+        ResourceRef<U> ref = typedCache->acquire(id, handle);
+        enforceBudget();
+        return ref;
+    }
+
+    // U := ResourceType
+    template <typename U>
+    U* getData(const ResourceRef<U>& ref){
+        return getData<U>(ref.getHandle());
+    }
+
+    // unload everything whose last ref dropped since the last call,
+    // once per frame where nothing holds raw pointers into the caches
+    uint32 releaseUnused(){
+        std::lock_guard<std::mutex> lock(m_loadMutex);
+        uint32 released = 0;
+        for (auto& [type, cache] : m_resourceMap){
+            released += cache->releaseUnused(m_resourceLoader);
+        }
+        return released;
+    }
+
+    // load id on a worker thread. the returned handle is pending until
+    // a poll() after the load finished, then ready (or failed). requests
+    // for an id that's loaded or already in flight share its state
+    // U := ResourceType
+    template <typename U>
+    AsyncHandle<U> requestAsync(uint32 id, SprLoadPriority priority = SPR_LOAD_PRIORITY_NORMAL){
+        auto typedCache = getCache<U>();
+
+        auto request = typedCache->m_requests.find(id);
+        if (request != typedCache->m_requests.end())
+            return AsyncHandle<U>(request->second);
+
+        auto load = std::make_shared<AsyncLoad<U>>();
+        load->id = id;
+
+        Handle<U> handle = typedCache->findHandle(id);
+        if (handle.isValid()){
+            load->handle = handle;
+            load->state = SPR_LOAD_READY;
+            return AsyncHandle<U>(load);
+        }
+
+        typedCache->m_requests[id] = load;
+        m_asyncLoader.submit(priority, [this, typedCache, load](bool run){
+            U data;
+            bool loaded = run && !load->cancelled && loadAsync<U>(load->id, data);
+
+            // back on the main thread
+            m_asyncLoader.complete([this, typedCache, load, data, loaded]() mutable {
+                typedCache->m_requests.erase(load->id);
+
+                // dropped by a stopping loader counts as failed
+                if (load->cancelled || !loaded){
+                    if (loaded)
+                        unloadAsync<U>(data);
+                    load->state = load->cancelled ? SPR_LOAD_CANCELLED : SPR_LOAD_FAILED;
+                    return;
+                }
+
+                // loaded synchronously in the meantime
+                Handle<U> existing = typedCache->findHandle(load->id);
+                if (existing.isValid()){
+                    unloadAsync<U>(data);
+                    load->handle = existing;
+                } else {
+                    std::lock_guard<std::mutex> lock(m_loadMutex);
+                    load->handle = typedCache->insert(load->id, data, m_resourceLoader);
+                    enforceBudget();
+                }
+                load->state = SPR_LOAD_READY;
+            });
+        });
+        return AsyncHandle<U>(load);
+    }
+
+    // a pending request is dropped (before loading if it hasn't started)
+    // and reports cancelled, finished requests are left alone
+    template <typename U>
+    void cancel(AsyncHandle<U>& handle){
+        if (handle.m_load && handle.isPending())
+            handle.m_load->cancelled = true;
+    }
+
+    // finish completed async loads (and hot reloads), call once
+    // per frame from the main thread. returns how many finished
+    uint32 poll(){
+        if (m_watcher)
+            checkReloads();
+        return m_asyncLoader.poll();
+    }
+
+    // watch the directories of every registered asset. changed .smdl/.stex
+    // files are reloaded in the background and swapped in by a later poll().
+    // handles stay valid, data pointers into a changed asset don't
+    bool enableHotReload();
+
+    bool isHotReloadEnabled(){
+        return m_watcher != nullptr;
+    }
+
+    // called by poll() after a changed asset's resources were swapped in
+    void setReloadCallback(std::function<void(uint32 assetId)> callback){
+        m_reloadCallback = callback;
+    }
+
+    // async requests not finished by poll yet
+    uint32 getPendingLoads(){
+        return m_asyncLoader.getPendingCount();
+    }
+
+    // cpu memory budget for one resource type, least recently used
+    // data past it is unloaded and reloaded by the next getHandle.
+    // 0 (default) for unlimited
+    // U := ResourceType
+    template <typename U>
+    void setBudget(uint64 bytes){
+        auto typedCache = getCache<U>();
+        std::lock_guard<std::mutex> lock(m_loadMutex);
+        typedCache->setBudget(bytes);
+        while (bytes > 0 && typedCache->getStats().residentBytes > bytes && typedCache->evictOldest(m_resourceLoader));
+    }
+
+    // budget across every type, evicts whichever entry was used least recently
+    void setBudget(uint64 bytes){
+        std::lock_guard<std::mutex> lock(m_loadMutex);
+        m_budgetBytes = bytes;
+        enforceBudget();
+    }
+
+    // keep loaded regardless of budgets until unpinned. handles and
+    // data pointers of evicted resources go stale, pin what you hold
+    // U := ResourceType
+    template <typename U>
+    void pin(Handle<U> handle){
+        auto typedCache = getCache<U>();
+        std::lock_guard<std::mutex> lock(m_loadMutex);
+        typedCache->pin(handle);
+    }
+
+    // U := ResourceType
+    template <typename U>
+    void unpin(Handle<U> handle){
+        auto typedCache = getCache<U>();
+        std::lock_guard<std::mutex> lock(m_loadMutex);
+        typedCache->unpin(handle);
+    }
+
+    // U := ResourceType
+    template <typename U>
+    CacheStats getCacheStats(){
+        return getCache<U>()->getStats();
+    }
+
+    // summed over every type, budgetBytes is the global budget
+    CacheStats getCacheStats(){
+        CacheStats total = {0, m_budgetBytes, 0, 0, 0, 0};
+        for (auto& [type, cache] : m_resourceMap){
+            CacheStats stats = cache->getStats();
+            total.residentBytes += stats.residentBytes;
+            total.resident += stats.resident;
+            total.loads += stats.loads;
+            total.evictions += stats.evictions;
+            total.reloads += stats.reloads;
+        }
+        return total;
     }
 
     void getName(uint32 id, std::string& out){
@@ -70,16 +319,33 @@ public:
             out = "no-name";
     }
 
+    // file of an asset (model or texture), empty if there's none
+    std::string getPath(uint32 assetId){
+        std::lock_guard<std::mutex> lock(m_loadMutex);
+        const PathMap& paths = m_resourceLoader.getPaths();
+        auto itr = paths.find(assetId);
+        return itr != paths.end() ? itr->second : std::string();
+    }
+
     void destroyBuffers(){
-        m_resourceMap[typeid(Buffer)]->destroy();
+        m_bufferCache->destroy();
+        std::lock_guard<std::mutex> lock(m_loadMutex);
+        m_resourceLoader.releaseAll();
     }
 
     void disableLoader(){
+        m_asyncLoader.stop();
+        std::lock_guard<std::mutex> lock(m_loadMutex);
         m_resourceLoader.disable();
     }
 
+    MappingStats getMappingStats(){
+        std::lock_guard<std::mutex> lock(m_loadMutex);
+        return m_resourceLoader.getMappingStats();
+    }
+
     uint32 getSize(){
-        return m_resourceMap[typeid(Buffer)]->getSize();
+        return m_bufferCache->getSize();
     }
 
     std::vector<uint32>& getModelIds(){
@@ -95,22 +361,165 @@ private:
     MetadataMap m_metadata;
     ResourceLoader m_resourceLoader;
 
+    // guards the metadata and the caches' lru and budget state. the loader locks
+    // itself, so workers only take this to read metadata and merge the
+    // child metadata a load registers, never around the load itself
+    std::mutex m_loadMutex;
+    AsyncLoader m_asyncLoader;
+
+    ModelCache* m_modelCache = new ModelCache;
+    MeshCache* m_meshCache = new MeshCache;
+    MaterialCache* m_materialCache = new MaterialCache;
+    TextureCache* m_textureCache = new TextureCache;
+    BufferCache* m_bufferCache = new BufferCache;
+
+    // for going over every cache, typed access goes through getCache
     CacheMap m_resourceMap {
-        {typeid(Model), new ModelCache},
-        {typeid(Mesh), new MeshCache},
-        {typeid(Material), new MaterialCache},
-        {typeid(Texture), new TextureCache},
-        {typeid(Buffer), new BufferCache},
+        {typeid(Model), m_modelCache},
+        {typeid(Mesh), m_meshCache},
+        {typeid(Material), m_materialCache},
+        {typeid(Texture), m_textureCache},
+        {typeid(Buffer), m_bufferCache},
     };
 
     std::vector<uint32> m_modelIds;
     std::vector<uint32> m_textureIds;
     uint32 m_id = 0;
+    uint64 m_budgetBytes = 0;
+
+    // hot reload, main thread only
+    std::unique_ptr<FileWatcher> m_watcher;
+    ska::flat_hash_map<std::string, uint32> m_watchedPaths;
+    ska::flat_hash_map<uint32, uint32> m_reloadGenerations;
+    std::function<void(uint32)> m_reloadCallback;
+    std::vector<std::string> m_changedPaths;
 
     void init();
+    void init(AssetLoader& assetLoader, std::vector<ResourceMetadata>& resourceMetadata);
 
     void registerResource(ResourceMetadata& metadata){
         m_metadata[metadata.resourceId] = metadata;
     }
+
+    // evict across caches down to the global budget,
+    // call with m_loadMutex held
+    void enforceBudget(){
+        if (m_budgetBytes == 0)
+            return;
+
+        uint64 resident = 0;
+        for (auto& [type, cache] : m_resourceMap){
+            resident += cache->getStats().residentBytes;
+        }
+
+        while (resident > m_budgetBytes){
+            ResourceCache* oldest = nullptr;
+            uint64 oldestUse = UINT64_MAX;
+            for (auto& [type, cache] : m_resourceMap){
+                uint64 use = cache->getOldestUse();
+                if (use < oldestUse){
+                    oldest = cache;
+                    oldestUse = use;
+                }
+            }
+            if (!oldest)
+                return;
+
+            uint64 before = oldest->getStats().residentBytes;
+            oldest->evictOldest(m_resourceLoader);
+            resident -= before - oldest->getStats().residentBytes;
+        }
+    }
+
+    void checkReloads();
+    void reloadAsset(uint32 assetId);
+
+    // reload the asset's model, meshes, materials and textures so child
+    // metadata (buffer offsets etc.) matches the new file. worker
+    void refreshMetadata(uint32 assetId);
+
+    // load outside m_loadMutex, child metadata it registers is merged under it
+    template <typename U>
+    void loadUnlocked(ResourceMetadata metadata, U& data){
+        MetadataMap children;
+        m_resourceLoader.loadFromMetadata<U>(children, metadata, data);
+
+        std::lock_guard<std::mutex> lock(m_loadMutex);
+        for (auto& [id, child] : children){
+            m_metadata[id] = child;
+        }
+    }
+
+    // loaded resources of asset, main thread
+    template <typename U>
+    void collectReload(uint32 assetId, std::vector<ResourceReload<U>>& reloads){
+        auto typedCache = getCache<U>();
+        for (auto& [id, handle] : typedCache->m_handles){
+            U* data = typedCache->m_data.get(handle);
+            if (data && data->parentId == assetId)
+                reloads.push_back({id, handle, U()});
+        }
+    }
+
+    // worker
+    template <typename U>
+    void loadReload(std::vector<ResourceReload<U>>& reloads){
+        for (ResourceReload<U>& reload : reloads){
+            ResourceMetadata metadata;
+            {
+                std::lock_guard<std::mutex> lock(m_loadMutex);
+                metadata = m_metadata[reload.id];
+            }
+            loadUnlocked<U>(metadata, reload.data);
+        }
+    }
+
+    // main thread, m_loadMutex held. stale reloads (superseded by a
+    // newer one) and those of unloaded resources are dropped
+    template <typename U>
+    void swapReload(std::vector<ResourceReload<U>>& reloads, bool current){
+        auto typedCache = getCache<U>();
+        for (ResourceReload<U>& reload : reloads){
+            // couldn't be read (mid save?), keep the old data
+            if (reload.data.resourceId != reload.id)
+                continue;
+
+            if (current && typedCache->m_data.get(reload.handle))
+                typedCache->replace(reload.handle, reload.data, m_resourceLoader);
+            else
+                m_resourceLoader.unload<U>(reload.data);
+        }
+    }
+
+    // worker side of requestAsync
+    template <typename U>
+    bool loadAsync(uint32 id, U& data){
+        ResourceMetadata metadata;
+        {
+            std::lock_guard<std::mutex> lock(m_loadMutex);
+            auto itr = m_metadata.find(id);
+            if (itr == m_metadata.end()){
+                SprLog::error("[SprResourceManager] [requestAsync] unknown resource id: " + std::to_string(id), false);
+                return false;
+            }
+            metadata = itr->second;
+        }
+
+        // mapping and paging in run alongside other workers' loads
+        loadUnlocked<U>(metadata, data);
+
+        // loaders leave data untouched if the file couldn't be mapped
+        if (data.resourceId != id)
+            return false;
+
+        m_resourceLoader.prefault<U>(data);
+        return true;
+    }
+
+    template <typename U>
+    void unloadAsync(U& data){
+        std::lock_guard<std::mutex> lock(m_loadMutex);
+        m_resourceLoader.unload<U>(data);
+    }
 };
 }
\ No newline at end of file
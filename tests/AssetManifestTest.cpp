@@ -0,0 +1,203 @@
+#include <vector>
+#include <string>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <filesystem>
+#include "gtest/gtest.h"
+#include "../external/json/json.hpp"
+#include "../src/resource/AssetLoader.h"
+#include "../src/resource/AssetManifest.h"
+
+using namespace spr;
+
+static const uint32 TEST_MODELS = 12000;
+static const uint32 TEST_TEXTURES = 8000;
+
+static std::vector<ManifestEntry> makeEntries(uint32 count, uint32 firstId, ResourceType type, const std::string& prefix){
+    std::vector<ManifestEntry> entries;
+    for (uint32 i = 0; i < count; i++){
+        uint32 id = firstId + i * 7;
+        entries.push_back({
+            .name = prefix + std::to_string(i),
+            .resourceId = id,
+            .parentId = id,
+            .sizeTotal = 1024 * i + 17,
+            .resourceType = type
+        });
+    }
+    return entries;
+}
+
+// same layout register_assets writes
+static void writeJson(const std::string& path, std::vector<ManifestEntry>& models, std::vector<ManifestEntry>& textures){
+    nlohmann::json manifest;
+    manifest["date"] = "00-00-0000 00:00:00";
+    manifest["modelCount"] = models.size();
+    manifest["models"] = nlohmann::json::array();
+    for (ManifestEntry& entry : models){
+        manifest["models"].push_back({
+            {"id", entry.resourceId}, {"parentId", entry.parentId}, {"name", entry.name},
+            {"sizeTotal", entry.sizeTotal}, {"type", ResourceTypes::typeToString((ResourceType)entry.resourceType)}
+        });
+    }
+    manifest["nonSubresourceTextureCount"] = textures.size();
+    manifest["nonSubresourceTextures"] = nlohmann::json::array();
+    for (ManifestEntry& entry : textures){
+        manifest["nonSubresourceTextures"].push_back({
+            {"id", entry.resourceId}, {"parentId", entry.parentId}, {"name", entry.name},
+            {"sizeTotal", entry.sizeTotal}, {"type", ResourceTypes::typeToString((ResourceType)entry.resourceType)}
+        });
+    }
+    std::ofstream f(path);
+    f << std::setw(4) << manifest << std::endl;
+}
+
+
+TEST(AssetManifestTest, BinaryMatchesJson) {
+    std::string dir = std::filesystem::temp_directory_path().string() + "/";
+    std::string jsonPath = dir + "spr_asset_manifest_test.json";
+    std::string binaryPath = dir + "spr_asset_manifest_test.bin";
+
+    std::vector<ManifestEntry> models = makeEntries(TEST_MODELS, 3, SPR_MODEL, "model_");
+    std::vector<ManifestEntry> textures = makeEntries(TEST_TEXTURES, 4, SPR_TEXTURE, "texture_");
+    writeJson(jsonPath, models, textures);
+    ASSERT_TRUE(AssetManifest::write(binaryPath, models, textures));
+
+    std::vector<ResourceMetadata> jsonMetadata, binaryMetadata;
+    std::vector<uint32> jsonModels, jsonTextures, binaryModels, binaryTextures;
+
+    AssetLoader jsonLoader;
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(jsonLoader.loadJsonManifest(jsonPath, jsonMetadata, jsonModels, jsonTextures));
+    auto jsonEnd = std::chrono::steady_clock::now();
+
+    AssetLoader binaryLoader;
+    ASSERT_TRUE(binaryLoader.loadBinaryManifest(binaryPath, binaryMetadata, binaryModels, binaryTextures));
+    auto binaryEnd = std::chrono::steady_clock::now();
+
+    std::cout << "[manifest] " << TEST_MODELS + TEST_TEXTURES << " entries json: "
+              << std::chrono::duration<double, std::milli>(jsonEnd - start).count() << " ms, binary: "
+              << std::chrono::duration<double, std::milli>(binaryEnd - jsonEnd).count() << " ms" << std::endl;
+
+    // identical metadata, ids, paths and names
+    ASSERT_EQ(jsonMetadata.size(), binaryMetadata.size());
+    for (uint32 i = 0; i < jsonMetadata.size(); i++){
+        EXPECT_EQ(jsonMetadata[i].resourceType, binaryMetadata[i].resourceType);
+        EXPECT_EQ(jsonMetadata[i].resourceId, binaryMetadata[i].resourceId);
+        EXPECT_EQ(jsonMetadata[i].parentId, binaryMetadata[i].parentId);
+        EXPECT_EQ(jsonMetadata[i].sizeTotal, binaryMetadata[i].sizeTotal);
+        EXPECT_EQ(jsonMetadata[i].byteOffset, binaryMetadata[i].byteOffset);
+        EXPECT_EQ(jsonMetadata[i].byteLength, binaryMetadata[i].byteLength);
+        EXPECT_EQ(jsonMetadata[i].index, binaryMetadata[i].index);
+        EXPECT_EQ(jsonMetadata[i].sub, binaryMetadata[i].sub);
+    }
+    EXPECT_EQ(jsonModels, binaryModels);
+    EXPECT_EQ(jsonTextures, binaryTextures);
+
+    PathMap jsonPaths = jsonLoader.getPaths();
+    PathMap binaryPaths = binaryLoader.getPaths();
+    NameMap jsonNames = jsonLoader.getNames();
+    NameMap binaryNames = binaryLoader.getNames();
+    EXPECT_EQ(jsonPaths.size(), binaryPaths.size());
+    for (auto& [id, path] : jsonPaths){
+        EXPECT_EQ(path, binaryPaths[id]);
+        EXPECT_EQ(jsonNames[id], binaryNames[id]);
+    }
+
+    // hash index finds every record
+    AssetManifest manifest;
+    ASSERT_TRUE(manifest.open(binaryPath));
+    for (ManifestEntry& entry : textures){
+        const ManifestRecord* record = manifest.find(entry.resourceId);
+        ASSERT_NE(record, nullptr);
+        EXPECT_EQ(record->sizeTotal, entry.sizeTotal);
+        EXPECT_EQ(manifest.getName(*record), entry.name);
+    }
+    EXPECT_EQ(manifest.find(0), nullptr);
+    EXPECT_EQ(manifest.find(5), nullptr);
+
+    std::filesystem::remove(jsonPath);
+    std::filesystem::remove(binaryPath);
+}
+
+
+TEST(AssetManifestTest, RejectsCorruptFiles) {
+    std::string path = std::filesystem::temp_directory_path().string() + "/spr_asset_manifest_corrupt.bin";
+    std::vector<ManifestEntry> models = makeEntries(5, 3, SPR_MODEL, "model_");
+    std::vector<ManifestEntry> textures = makeEntries(3, 4, SPR_TEXTURE, "texture_");
+    ASSERT_TRUE(AssetManifest::write(path, models, textures));
+
+    std::vector<char> bytes;
+    {
+        std::ifstream file(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(file), {});
+    }
+    ManifestHeader header;
+    memcpy(&header, bytes.data(), sizeof(ManifestHeader));
+
+    // applies edit to a copy of the good file, writes it, and opens it
+    auto openEdited = [&](AssetManifest& manifest, auto edit){
+        std::vector<char> edited = bytes;
+        edit(edited);
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(edited.data(), edited.size());
+        file.close();
+        return manifest.open(path);
+    };
+    auto editHeader = [&](auto edit){
+        return [=](std::vector<char>& data){
+            ManifestHeader* edited = (ManifestHeader*)data.data();
+            edit(*edited);
+        };
+    };
+
+    AssetManifest manifest;
+    ASSERT_TRUE(openEdited(manifest, [](std::vector<char>&){}));
+
+    // cut off inside the records
+    EXPECT_FALSE(openEdited(manifest, [&](std::vector<char>& data){ data.resize(header.recordOffset + sizeof(ManifestRecord)); }));
+    EXPECT_FALSE(manifest.isOpen());
+
+    // sections past the end of the file
+    EXPECT_FALSE(openEdited(manifest, editHeader([](ManifestHeader& h){ h.recordCount = 1u << 30; })));
+    EXPECT_FALSE(openEdited(manifest, editHeader([](ManifestHeader& h){ h.slotCount = 1u << 30; })));
+
+    // slot counts find can't probe
+    EXPECT_FALSE(openEdited(manifest, editHeader([](ManifestHeader& h){ h.slotCount = 0; })));
+    EXPECT_FALSE(openEdited(manifest, editHeader([](ManifestHeader& h){ h.slotCount = 3; })));
+
+    // a slot pointing past the records, a name past the strings
+    EXPECT_FALSE(openEdited(manifest, [&](std::vector<char>& data){
+        ManifestSlot* slots = (ManifestSlot*)(data.data() + header.slotOffset);
+        for (uint32 i = 0; i < header.slotCount; i++){
+            if (slots[i].id != 0)
+                slots[i].record = header.recordCount;
+        }
+    }));
+    EXPECT_FALSE(openEdited(manifest, [&](std::vector<char>& data){
+        ManifestRecord* records = (ManifestRecord*)(data.data() + header.recordOffset);
+        records[header.recordCount - 1].nameOffset = header.stringBytes;
+    }));
+
+    // no empty slot, a missing id still ends the probe
+    ASSERT_TRUE(openEdited(manifest, [&](std::vector<char>& data){
+        ManifestSlot* slots = (ManifestSlot*)(data.data() + header.slotOffset);
+        for (uint32 i = 0; i < header.slotCount; i++){
+            if (slots[i].id == 0)
+                slots[i] = {1, 0};
+        }
+    }));
+    EXPECT_EQ(manifest.find(5), nullptr);
+    EXPECT_NE(manifest.find(3), nullptr);
+
+    manifest.close();
+    std::filesystem::remove(path);
+}
+
+
+int main() {
+::testing::InitGoogleTest();
+  return RUN_ALL_TESTS();
+}
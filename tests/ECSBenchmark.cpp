@@ -0,0 +1,301 @@
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <typeindex>
+#include <unordered_map>
+#include "gtest/gtest.h"
+#include "../src/ecs/SprECS.h"
+
+typedef struct {
+    float position[3];
+    float rotation[4];
+    float scale[3];
+} BenchTransform;
+
+using namespace spr;
+
+class TransformC : public TypedComponent<BenchTransform>{};
+class ModelC : public TypedComponent<uint32>{};
+
+class NullSystem : public System {
+public:
+    void update(float dt){}
+};
+
+static const uint32 BENCH_ENTITIES = 100000;
+static const uint32 BENCH_FRAMES = 20;
+
+static BenchTransform makeTransform(uint32 i){
+    return BenchTransform{
+        .position = {(float)i, 0.f, 0.f},
+        .rotation = {0.f, 0.f, 0.f, 1.f},
+        .scale = {1.f, 1.f, 1.f}};
+}
+
+static double msSince(std::chrono::high_resolution_clock::time_point start){
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+
+TEST(ECSBenchmark, SparseIteration) {
+    SprECS ecs;
+    TransformC transformC;
+    ModelC modelC;
+    ecs.createComponent<TransformC>(transformC, true);
+    ecs.createComponent<ModelC>(modelC, true);
+
+    for (uint32 i = 0; i < BENCH_ENTITIES; i++){
+        ecs.createEntity(
+            ecs.add<ModelC>(i),
+            ecs.add<TransformC>(makeTransform(i)));
+    }
+    NullSystem renderSystem;
+    ecs.setRenderSystem(renderSystem);
+    ecs.update(0.f);
+
+    // current path: gather entities from the trie, then look up each component
+    auto start = std::chrono::high_resolution_clock::now();
+    float sum = 0.f;
+    for (uint32 frame = 0; frame < BENCH_FRAMES; frame++){
+        std::vector<Entity> entities;
+        ecs.getEntities<TransformC, ModelC>(entities);
+        for (Entity& entity : entities){
+            BenchTransform& transform = ecs.get<TransformC>(entity);
+            transform.position[1] += 1.f;
+            sum += transform.position[0] + ecs.get<ModelC>(entity);
+        }
+    }
+    double ms = msSince(start);
+    std::cout << "[sparse]    " << BENCH_ENTITIES << " entities: " << ms / BENCH_FRAMES << " ms/frame (" << sum << ")" << std::endl;
+
+    EXPECT_EQ(ecs.get<TransformC>(BENCH_ENTITIES - 1).position[1], (float)BENCH_FRAMES);
+}
+
+TEST(ECSBenchmark, ArchetypeIteration) {
+    SprECS ecs(SPR_STORAGE_ARCHETYPE);
+    TransformC transformC;
+    ModelC modelC;
+    ecs.createComponent<TransformC>(transformC, true);
+    ecs.createComponent<ModelC>(modelC, true);
+
+    for (uint32 i = 0; i < BENCH_ENTITIES; i++){
+        ecs.createEntity(
+            ecs.add<ModelC>(i),
+            ecs.add<TransformC>(makeTransform(i)));
+    }
+    NullSystem renderSystem;
+    ecs.setRenderSystem(renderSystem);
+    ecs.update(0.f);
+
+    // archetype path: linear walk over packed chunk columns
+    auto start = std::chrono::high_resolution_clock::now();
+    float sum = 0.f;
+    for (uint32 frame = 0; frame < BENCH_FRAMES; frame++){
+        ecs.forEachChunk<TransformC, ModelC>([&](uint32 count, uint32* ids, BenchTransform* transforms, uint32* models){
+            for (uint32 i = 0; i < count; i++){
+                transforms[i].position[1] += 1.f;
+                sum += transforms[i].position[0] + models[i];
+            }
+        });
+    }
+    double ms = msSince(start);
+    std::cout << "[archetype] " << BENCH_ENTITIES << " entities: " << ms / BENCH_FRAMES << " ms/frame (" << sum << ")" << std::endl;
+
+    EXPECT_EQ(ecs.get<TransformC>(BENCH_ENTITIES - 1).position[1], (float)BENCH_FRAMES);
+}
+
+TEST(ECSBenchmark, QueryIteration) {
+    SprECS ecs;
+    TransformC transformC;
+    ModelC modelC;
+    ecs.createComponent<TransformC>(transformC, true);
+    ecs.createComponent<ModelC>(modelC, true);
+
+    for (uint32 i = 0; i < BENCH_ENTITIES; i++){
+        ecs.createEntity(
+            ecs.add<ModelC>(i),
+            ecs.add<TransformC>(makeTransform(i)));
+    }
+    NullSystem renderSystem;
+    ecs.setRenderSystem(renderSystem);
+    ecs.update(0.f);
+
+    // no entity vector, references handed out directly
+    auto start = std::chrono::high_resolution_clock::now();
+    for (uint32 frame = 0; frame < BENCH_FRAMES; frame++){
+        ecs.query<TransformC, const ModelC>().forEach([](Entity& entity, BenchTransform& transform, const uint32& model){
+            transform.position[1] += 1.f;
+        });
+        ecs.update(0.f);
+    }
+    double ms = msSince(start);
+
+    start = std::chrono::high_resolution_clock::now();
+    for (uint32 frame = 0; frame < BENCH_FRAMES; frame++){
+        ecs.query<TransformC, const ModelC>().parallelForEach([](Entity& entity, BenchTransform& transform, const uint32& model){
+            transform.position[1] += 1.f;
+        });
+        ecs.update(0.f);
+    }
+    double parallelMs = msSince(start);
+
+    std::cout << "[query]     " << BENCH_ENTITIES << " entities: forEach " << ms / BENCH_FRAMES << " ms/frame, parallelForEach "
+              << parallelMs / BENCH_FRAMES << " ms/frame (" << ecs.getThreadPool().getThreadCount() << " threads)" << std::endl;
+
+    EXPECT_EQ(ecs.get<TransformC>(BENCH_ENTITIES - 1).position[1], (float)(2 * BENCH_FRAMES));
+}
+
+TEST(ECSBenchmark, SpawnDespawn) {
+    SprECS ecs;
+    TransformC transformC;
+    ModelC modelC;
+    ecs.createComponent<TransformC>(transformC, true);
+    ecs.createComponent<ModelC>(modelC, true);
+    NullSystem renderSystem;
+    ecs.setRenderSystem(renderSystem);
+
+    // a full world spawned and despawned every frame
+    std::vector<Entity> entities(BENCH_ENTITIES);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (uint32 frame = 0; frame < 5; frame++){
+        for (uint32 i = 0; i < BENCH_ENTITIES; i++){
+            entities[i] = ecs.createEntity(
+                ecs.add<ModelC>(i),
+                ecs.add<TransformC>(makeTransform(i)));
+        }
+        ecs.update(0.f);
+        EXPECT_EQ((ecs.getEntities<TransformC, ModelC>().size()), BENCH_ENTITIES);
+
+        // destroy in a scattered order
+        for (uint32 i = 0; i < BENCH_ENTITIES; i++){
+            ecs.destroyEntity(entities[(i * 7919) % BENCH_ENTITIES]);
+        }
+        ecs.update(0.f);
+        EXPECT_EQ((ecs.getEntities<TransformC, ModelC>().size()), 0u);
+    }
+    double ms = msSince(start);
+    std::cout << "[churn]     " << BENCH_ENTITIES << " entities spawned + despawned: " << ms / 5 << " ms/frame" << std::endl;
+
+    std::vector<Entity> remaining;
+    ecs.getEntities<TransformC>(remaining);
+    EXPECT_EQ(remaining.size(), 0u);
+}
+
+TEST(ECSBenchmark, ComponentLookup) {
+    SprECS ecs;
+    TransformC transformC;
+    ModelC modelC;
+    ecs.createComponent<TransformC>(transformC, true);
+    ecs.createComponent<ModelC>(modelC);
+
+    std::vector<Entity> entities;
+    for (uint32 i = 0; i < 1000; i++){
+        entities.push_back(ecs.createEntity(
+            ecs.add<ModelC>(i),
+            ecs.add<TransformC>(makeTransform(i))));
+    }
+    const uint32 lookups = 1000000;
+
+    // previous path: type_index hash + dynamic_cast per access
+    std::unordered_map<std::type_index, uint32> typeMap;
+    std::vector<Component*> components = {&transformC, &modelC};
+    typeMap[typeid(TransformC)] = 0;
+    typeMap[typeid(ModelC)] = 1;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    float sum = 0.f;
+    for (uint32 i = 0; i < lookups; i++){
+        uint32 index = typeMap[typeid(TransformC)];
+        TransformC* comp = ((TransformC*) dynamic_cast<TransformC*>(components.at(index)));
+        sum += comp->get(entities[i % 1000]).position[0];
+    }
+    double rttiMs = msSince(start);
+
+    // static type id + static_cast
+    start = std::chrono::high_resolution_clock::now();
+    float staticSum = 0.f;
+    for (uint32 i = 0; i < lookups; i++){
+        staticSum += ecs.get<TransformC>(entities[i % 1000]).position[0];
+    }
+    double staticMs = msSince(start);
+
+    std::cout << "[get<TransformC>] " << lookups << " calls: rtti " << rttiMs << " ms, static " << staticMs << " ms" << std::endl;
+    EXPECT_EQ(sum, staticSum);
+    EXPECT_NE(getComponentTypeId<TransformC>(), getComponentTypeId<ModelC>());
+    EXPECT_EQ((getComponentTypeMask<TransformC, ModelC>()), (1LL << getComponentTypeId<TransformC>()) | (1LL << getComponentTypeId<ModelC>()));
+}
+
+TEST(ECSBenchmark, SnapshotLoad) {
+    const uint32 count = 500000;
+    std::string path = "/tmp/spr_bench_snapshot.bin";
+    {
+        SprECS ecs(SPR_STORAGE_ARCHETYPE);
+        TransformC transformC;
+        ModelC modelC;
+        ecs.createComponent<TransformC>(transformC, true);
+        ecs.createComponent<ModelC>(modelC);
+        NullSystem renderSystem;
+        ecs.setRenderSystem(renderSystem);
+
+        for (uint32 i = 0; i < count; i++){
+            ecs.createEntity(
+                ecs.add<ModelC>(i),
+                ecs.add<TransformC>(makeTransform(i)));
+        }
+        ecs.update(0.f);
+        ASSERT_TRUE(ecs.saveSnapshot(path));
+    }
+
+    for (SprStorageType storage : {SPR_STORAGE_SPARSE, SPR_STORAGE_ARCHETYPE}){
+        // rebuilding entity by entity
+        double createMs = 0.0;
+        {
+            SprECS ecs(storage);
+            TransformC transformC;
+            ModelC modelC;
+            ecs.createComponent<TransformC>(transformC, true);
+            ecs.createComponent<ModelC>(modelC);
+            NullSystem renderSystem;
+            ecs.setRenderSystem(renderSystem);
+
+            auto start = std::chrono::high_resolution_clock::now();
+            for (uint32 i = 0; i < count; i++){
+                ecs.createEntity(
+                    ecs.add<ModelC>(i),
+                    ecs.add<TransformC>(makeTransform(i)));
+            }
+            ecs.update(0.f);
+            createMs = msSince(start);
+        }
+
+        // mapped snapshot
+        SprECS ecs(storage);
+        TransformC transformC;
+        ModelC modelC;
+        ecs.createComponent<TransformC>(transformC, true);
+        ecs.createComponent<ModelC>(modelC);
+        NullSystem renderSystem;
+        ecs.setRenderSystem(renderSystem);
+
+        auto start = std::chrono::high_resolution_clock::now();
+        ASSERT_TRUE(ecs.loadSnapshot(path));
+        double loadMs = msSince(start);
+        ecs.update(0.f);
+        double totalMs = msSince(start);
+
+        // both include the first update (trie inserts)
+        std::cout << "[snapshot]  " << count << " entities (" << (storage == SPR_STORAGE_SPARSE ? "sparse" : "archetype")
+                  << "): createEntity " << createMs << " ms, loadSnapshot " << totalMs << " ms (" << loadMs << " ms before update)" << std::endl;
+
+        EXPECT_EQ((ecs.getEntities<TransformC, ModelC>().size()), count);
+        EXPECT_EQ(ecs.get<ModelC>(count - 1), count - 1);
+        EXPECT_EQ(ecs.get<TransformC>(count - 1).position[0], (float)(count - 1));
+    }
+}
+
+
+int main() {
+::testing::InitGoogleTest();
+  return RUN_ALL_TESTS();
+}
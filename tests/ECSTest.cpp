@@ -0,0 +1,861 @@
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <fstream>
+#include <cstring>
+#include "gtest/gtest.h"
+#include "../src/ecs/SprECS.h"
+#include "../src/core/util/ThreadPool.h"
+
+using namespace spr;
+
+class PositionC : public TypedComponent<float>{};
+class VelocityC : public TypedComponent<float>{};
+class HealthC : public TypedComponent<uint32>{};
+
+class NullSystem : public System {
+public:
+    void update(float dt){}
+};
+
+// sleeps, then records the order it finished in
+class SleepSystem : public System {
+public:
+    SleepSystem(SystemAccess systemAccess, std::atomic<uint32>* counter, uint32 sleepMs)
+        : m_access(systemAccess), m_counter(counter), m_sleepMs(sleepMs) {}
+
+    void update(float dt){
+        std::this_thread::sleep_for(std::chrono::milliseconds(m_sleepMs));
+        order = (*m_counter)++;
+        threadId = std::this_thread::get_id();
+    }
+
+    SystemAccess access(){
+        return m_access;
+    }
+
+    uint32 order = 0;
+    std::thread::id threadId;
+
+private:
+    SystemAccess m_access;
+    std::atomic<uint32>* m_counter;
+    uint32 m_sleepMs;
+};
+
+// records entity creation through its thread's command buffer
+class SpawnSystem : public System {
+public:
+    SpawnSystem(SprECS& ecs, uint32 base, uint32 sleepMs) : m_ecs(ecs), m_base(base), m_sleepMs(sleepMs) {}
+
+    void update(float dt){
+        std::this_thread::sleep_for(std::chrono::milliseconds(m_sleepMs));
+        for (uint32 i = 0; i < 50; i++){
+            m_ecs.commands().createEntity<HealthC>(m_base + i);
+        }
+    }
+
+    SystemAccess access(){
+        return SystemAccess().reads<HealthC>();
+    }
+
+private:
+    SprECS& m_ecs;
+    uint32 m_base;
+    uint32 m_sleepMs;
+};
+
+
+TEST(ThreadPoolTest, SubmitWait) {
+    ThreadPool pool(4);
+    std::atomic<uint32> sum = 0;
+
+    for (uint32 i = 0; i < 10000; i++){
+        pool.submit([&sum, i]{ sum += i; });
+    }
+    pool.wait();
+    EXPECT_EQ(sum, 49995000u);
+
+    // tasks submitting tasks
+    sum = 0;
+    for (uint32 i = 0; i < 100; i++){
+        pool.submit([&pool, &sum]{
+            for (uint32 j = 0; j < 100; j++)
+                pool.submit([&sum]{ sum++; });
+        });
+    }
+    pool.wait();
+    EXPECT_EQ(sum, 10000u);
+}
+
+TEST(SystemSchedulerTest, AccessConflicts) {
+    SystemAccess readPos = SystemAccess().reads<PositionC>();
+    SystemAccess writePos = SystemAccess().writes<PositionC>();
+    SystemAccess writeVel = SystemAccess().reads<PositionC>().writes<VelocityC>();
+    SystemAccess exclusive;
+
+    EXPECT_FALSE(readPos.conflicts(readPos));
+    EXPECT_TRUE(readPos.conflicts(writePos));
+    EXPECT_TRUE(writePos.conflicts(writeVel));
+    EXPECT_FALSE(readPos.conflicts(writeVel));
+    EXPECT_TRUE(exclusive.conflicts(readPos));
+}
+
+TEST(SystemSchedulerTest, ParallelRespectsConflicts) {
+    SprECS ecs;
+    NullSystem renderSystem;
+    std::atomic<uint32> counter = 0;
+
+    // a and b touch different components, c writes what a reads
+    SleepSystem a(SystemAccess().reads<PositionC>(), &counter, 50);
+    SleepSystem b(SystemAccess().writes<HealthC>(), &counter, 50);
+    SleepSystem c(SystemAccess().writes<PositionC>(), &counter, 10);
+    ecs.createSystem(a);
+    ecs.createSystem(b);
+    ecs.createSystem(c);
+    ecs.setRenderSystem(renderSystem);
+    ecs.setScheduleMode(SPR_SCHEDULE_PARALLEL, 4);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    ecs.update(0.f);
+    auto end = std::chrono::high_resolution_clock::now();
+    float ms = std::chrono::duration<float, std::milli>(end - start).count();
+
+    // a and b overlap, c waits for a
+    EXPECT_LT(ms, 100.f);
+    EXPECT_GT(c.order, a.order);
+
+    std::vector<float>& timings = ecs.getSystemTimings();
+    ASSERT_EQ(timings.size(), 3u);
+    EXPECT_GE(timings[0], 45.f);
+    EXPECT_GE(timings[2], 5.f);
+}
+
+TEST(SystemSchedulerTest, ExclusiveRunsOnCallingThread) {
+    SprECS ecs;
+    NullSystem renderSystem;
+    std::atomic<uint32> counter = 0;
+
+    SleepSystem a(SystemAccess().reads<PositionC>(), &counter, 1);
+    SleepSystem b(SystemAccess(), &counter, 1);
+    SleepSystem c(SystemAccess().reads<PositionC>(), &counter, 1);
+    ecs.createSystem(a);
+    ecs.createSystem(b);
+    ecs.createSystem(c);
+    ecs.setRenderSystem(renderSystem);
+
+    ecs.update(0.f);
+    EXPECT_EQ(a.order, 0u);
+    EXPECT_EQ(b.order, 1u);
+    EXPECT_EQ(c.order, 2u);
+    EXPECT_EQ(b.threadId, std::this_thread::get_id());
+}
+
+TEST(SystemSchedulerTest, SequentialIsDeterministic) {
+    SprECS ecs;
+    NullSystem renderSystem;
+    std::atomic<uint32> counter = 0;
+
+    SleepSystem a(SystemAccess().reads<PositionC>(), &counter, 20);
+    SleepSystem b(SystemAccess().writes<HealthC>(), &counter, 1);
+    SleepSystem c(SystemAccess().writes<VelocityC>(), &counter, 1);
+    ecs.createSystem(a);
+    ecs.createSystem(b);
+    ecs.createSystem(c);
+    ecs.setRenderSystem(renderSystem);
+    ecs.setScheduleMode(SPR_SCHEDULE_SEQUENTIAL);
+
+    for (uint32 frame = 0; frame < 3; frame++){
+        counter = 0;
+        ecs.update(0.f);
+        EXPECT_EQ(a.order, 0u);
+        EXPECT_EQ(b.order, 1u);
+        EXPECT_EQ(c.order, 2u);
+        EXPECT_EQ(a.threadId, std::this_thread::get_id());
+        EXPECT_EQ(c.threadId, std::this_thread::get_id());
+    }
+}
+
+TEST(QueryTest, ForEach) {
+    for (SprStorageType storage : {SPR_STORAGE_SPARSE, SPR_STORAGE_ARCHETYPE}){
+        SprECS ecs(storage);
+        PositionC positionC;
+        VelocityC velocityC;
+        HealthC healthC;
+        NullSystem renderSystem;
+        ecs.createComponent<PositionC>(positionC, true);
+        ecs.createComponent<VelocityC>(velocityC);
+        ecs.createComponent<HealthC>(healthC);
+        ecs.setRenderSystem(renderSystem);
+
+        for (uint32 i = 0; i < 1000; i++){
+            if (i % 2 == 0)
+                ecs.createEntity(ecs.add<PositionC>((float)i), ecs.add<VelocityC>(1.f));
+            else
+                ecs.createEntity(ecs.add<PositionC>((float)i), ecs.add<HealthC>(i));
+        }
+        ecs.update(0.f);
+
+        // only entities with both components, data passed by reference
+        uint32 visited = 0;
+        ecs.query<PositionC, const VelocityC>().forEach([&](Entity& entity, float& position, const float& velocity){
+            EXPECT_EQ(entity.id % 2, 0u);
+            EXPECT_EQ(position, (float)entity.id);
+            position += velocity;
+            visited++;
+        });
+        EXPECT_EQ(visited, 500u);
+        EXPECT_EQ(ecs.get<PositionC>(10), 11.f);
+        EXPECT_EQ(ecs.get<PositionC>(11), 11.f);
+
+        // writes flag dirty, untouched entities stay clean
+        std::vector<uint32>& dirty = ecs.getDirtyEntityIds<PositionC>();
+        EXPECT_EQ(dirty.size(), 500u);
+        ecs.update(0.f);
+
+        ecs.query<PositionC>().forEach([&](Entity& entity, float& position){
+            if (entity.id == 3)
+                position = 0.f;
+        });
+        dirty = ecs.getDirtyEntityIds<PositionC>();
+        ASSERT_EQ(dirty.size(), 1u);
+        EXPECT_EQ(dirty[0], 3u);
+    }
+}
+
+TEST(QueryTest, ParallelForEach) {
+    for (SprStorageType storage : {SPR_STORAGE_SPARSE, SPR_STORAGE_ARCHETYPE}){
+        SprECS ecs(storage);
+        PositionC positionC;
+        VelocityC velocityC;
+        NullSystem renderSystem;
+        ecs.createComponent<PositionC>(positionC, true);
+        ecs.createComponent<VelocityC>(velocityC);
+        ecs.setRenderSystem(renderSystem);
+        ecs.setScheduleMode(SPR_SCHEDULE_PARALLEL, 4);
+
+        const uint32 count = 20000;
+        for (uint32 i = 0; i < count; i++){
+            ecs.createEntity(ecs.add<PositionC>((float)i), ecs.add<VelocityC>((float)(i % 3)));
+        }
+        ecs.update(0.f);
+
+        std::atomic<uint32> visited = 0;
+        ecs.query<PositionC, const VelocityC>().parallelForEach([&](Entity& entity, float& position, const float& velocity){
+            position += velocity;
+            visited++;
+        }, 256);
+        EXPECT_EQ(visited, count);
+
+        // only moved entities are dirty, merged in iteration order
+        std::vector<uint32>& dirty = ecs.getDirtyEntityIds<PositionC>();
+        EXPECT_EQ(dirty.size(), count - (count + 2) / 3);
+        for (uint32 id : dirty){
+            EXPECT_NE(id % 3, 0u);
+            EXPECT_EQ(ecs.get<PositionC>(id), (float)(id + id % 3));
+        }
+        if (storage == SPR_STORAGE_SPARSE){
+            EXPECT_TRUE(std::is_sorted(dirty.begin(), dirty.end()));
+        }
+    }
+}
+
+TEST(ComponentTest, SwapRemoveKeepsData) {
+    SprECS ecs;
+    PositionC positionC;
+    VelocityC velocityC;
+    NullSystem renderSystem;
+    ecs.createComponent<PositionC>(positionC);
+    ecs.createComponent<VelocityC>(velocityC);
+    ecs.setRenderSystem(renderSystem);
+
+    std::vector<Entity> entities;
+    for (uint32 i = 0; i < 1000; i++){
+        entities.push_back(ecs.createEntity(ecs.add<PositionC>((float)i), ecs.add<VelocityC>(-(float)i)));
+    }
+    ecs.update(0.f);
+
+    // remove every third entity, and a component from every fifth
+    for (uint32 i = 0; i < 1000; i += 3)
+        ecs.destroyEntity(entities[i]);
+    for (uint32 i = 1; i < 1000; i += 5){
+        if (i % 3 != 0)
+            ecs.remove<VelocityC>(entities[i]);
+    }
+    ecs.update(0.f);
+    ecs.update(0.f);
+
+    std::vector<Entity> alive;
+    ecs.getEntities<PositionC>(alive);
+    EXPECT_EQ(alive.size(), 666u);
+    for (Entity& entity : alive){
+        EXPECT_EQ(ecs.get<PositionC>(entity), (float)entity.id);
+        if (entity.contains(getComponentTypeMask<VelocityC>())){
+            EXPECT_EQ(ecs.get<VelocityC>(entity), -(float)entity.id);
+        }
+    }
+}
+
+TEST(ComponentTest, MissingAndRepeatedComponents) {
+    for (SprStorageType storage : {SPR_STORAGE_SPARSE, SPR_STORAGE_ARCHETYPE}){
+        SprECS ecs(storage);
+        PositionC positionC;
+        HealthC healthC;
+        NullSystem renderSystem;
+        ecs.createComponent<PositionC>(positionC);
+        ecs.createComponent<HealthC>(healthC);
+        ecs.setRenderSystem(renderSystem);
+
+        std::vector<Entity> entities;
+        for (uint32 i = 0; i < 10; i++){
+            if (i < 5)
+                entities.push_back(ecs.createEntity(ecs.add<PositionC>((float)i), ecs.add<HealthC>(i)));
+            else
+                entities.push_back(ecs.createEntity(ecs.add<PositionC>((float)i)));
+        }
+        ecs.update(0.f);
+
+        // removing a component the entity doesn't have changes nothing
+        ecs.remove<HealthC>(entities[7]);
+        ecs.update(0.f);
+        EXPECT_EQ((ecs.getEntities<PositionC, HealthC>().size()), 5u);
+        for (uint32 i = 0; i < 5; i++)
+            EXPECT_EQ(ecs.get<HealthC>(entities[i]), i);
+
+        // adding one it already has only sets it
+        ecs.add<HealthC>(entities[2], 99u);
+        ecs.update(0.f);
+        EXPECT_EQ((ecs.getEntities<PositionC, HealthC>().size()), 5u);
+        EXPECT_EQ((ecs.getEntities<PositionC>().size()), 10u);
+        EXPECT_EQ(ecs.get<HealthC>(entities[2]), 99u);
+    }
+
+    // absent ids are -1, however far past the registry's size
+    Registry registry(4);
+    registry.addItem(10, 3);
+    EXPECT_EQ(registry.getIndex(10), 3);
+    EXPECT_EQ(registry.getIndex(5), -1);
+    EXPECT_EQ(registry.getIndex(100), -1);
+
+    // the trie keeps one entry per entity
+    EntityNode node;
+    Entity entity(3, 0b101);
+    node.add(entity);
+    node.add(entity);
+    EXPECT_EQ(node.get(0b101).vector().size(), 1u);
+    node.remove(entity);
+    EXPECT_EQ(node.get(0b101).vector().size(), 0u);
+}
+
+TEST(ComponentTest, ArchetypeGetSet) {
+    SprECS ecs(SPR_STORAGE_ARCHETYPE);
+    PositionC positionC;
+    VelocityC velocityC;
+    HealthC healthC;
+    NullSystem renderSystem;
+    ecs.createComponent<PositionC>(positionC, true);
+    ecs.createComponent<HealthC>(healthC);
+    ecs.createComponent<VelocityC>(velocityC);
+    ecs.setRenderSystem(renderSystem);
+
+    std::vector<Entity> entities;
+    for (uint32 i = 0; i < 1000; i++){
+        entities.push_back(ecs.createEntity(
+            ecs.add<HealthC>(i),
+            ecs.add<PositionC>((float)i)));
+    }
+
+    for (uint32 i = 0; i < 1000; i++){
+        EXPECT_EQ(ecs.get<HealthC>(entities[i]), i);
+        EXPECT_EQ(ecs.get<PositionC>(entities[i]), (float)i);
+    }
+
+    // set marks dirty
+    ecs.set<PositionC>(entities[10], 5000.f);
+    EXPECT_EQ(ecs.get<PositionC>(entities[10]), 5000.f);
+    EXPECT_TRUE(ecs.isDirty<PositionC>(entities[10]));
+
+    // adding/removing a component keeps existing data
+    ecs.add<VelocityC>(entities[20], 7.f);
+    EXPECT_EQ(ecs.get<VelocityC>(entities[20]), 7.f);
+    EXPECT_EQ(ecs.get<HealthC>(entities[20]), 20u);
+    EXPECT_EQ(ecs.get<HealthC>(entities[999]), 999u);
+    ecs.remove<VelocityC>(entities[20]);
+    EXPECT_EQ(ecs.get<PositionC>(entities[20]), 20.f);
+
+    // destroyed rows are backfilled without disturbing others
+    for (uint32 i = 0; i < 1000; i += 3)
+        ecs.destroyEntity(entities[i]);
+    ecs.update(0.f);
+    ecs.update(0.f);
+
+    uint32 visited = 0;
+    ecs.forEachChunk<HealthC, PositionC>([&](uint32 count, uint32* ids, uint32* healths, float* positions){
+        for (uint32 i = 0; i < count; i++){
+            EXPECT_NE(ids[i] % 3, 0u);
+            EXPECT_EQ(healths[i], ids[i]);
+            if (ids[i] != 10)
+                EXPECT_EQ(positions[i], (float)ids[i]);
+        }
+        visited += count;
+    });
+    EXPECT_EQ(visited, 666u);
+}
+
+TEST(EntityAllocatorTest, RecyclesIds) {
+    SprECS ecs;
+    PositionC positionC;
+    NullSystem renderSystem;
+    ecs.createComponent<PositionC>(positionC, true);
+    ecs.setRenderSystem(renderSystem);
+
+    // projectile-style churn, ids stay bounded by the live count
+    std::vector<Entity> live;
+    uint32 maxId = 0;
+    for (uint32 frame = 0; frame < 100; frame++){
+        for (uint32 i = 0; i < 100; i++){
+            live.push_back(ecs.createEntity(ecs.add<PositionC>((float)frame)));
+            maxId = std::max(maxId, live.back().id);
+        }
+        if (live.size() > 500){
+            for (uint32 i = 0; i < 100; i++){
+                ecs.destroyEntity(live[i]);
+            }
+            live.erase(live.begin(), live.begin() + 100);
+        }
+        ecs.update(0.f);
+    }
+    EXPECT_LT(maxId, 700u);
+
+    std::vector<Entity> entities;
+    ecs.getEntities<PositionC>(entities);
+    EXPECT_EQ(entities.size(), live.size());
+    for (Entity& entity : live){
+        EXPECT_TRUE(ecs.isAlive(entity));
+    }
+}
+
+TEST(EntityAllocatorTest, StaleEntities) {
+    SprECS ecs;
+    PositionC positionC;
+    NullSystem renderSystem;
+    ecs.createComponent<PositionC>(positionC);
+    ecs.setRenderSystem(renderSystem);
+
+    Entity a = ecs.createEntity(ecs.add<PositionC>(1.f));
+    ecs.update(0.f);
+    ecs.destroyEntity(a);
+    EXPECT_FALSE(ecs.isAlive(a));
+
+    // id isn't reused until the destroy has been processed
+    Entity b = ecs.createEntity(ecs.add<PositionC>(2.f));
+    EXPECT_NE(a.id, b.id);
+    ecs.update(0.f);
+
+    Entity c = ecs.createEntity(ecs.add<PositionC>(3.f));
+    EXPECT_EQ(c.id, a.id);
+    EXPECT_NE(c.generation, a.generation);
+    EXPECT_FALSE(ecs.isAlive(a));
+    EXPECT_TRUE(ecs.isAlive(c));
+
+    // destroying a stale copy doesn't touch the new entity
+    ecs.destroyEntity(a);
+    ecs.update(0.f);
+    EXPECT_TRUE(ecs.isAlive(c));
+    EXPECT_EQ(ecs.get<PositionC>(c), 3.f);
+    EXPECT_EQ((ecs.getEntities<PositionC>().size()), 2u);
+}
+
+TEST(QueryCacheTest, MatchesTrieUnderChurn) {
+    // the cache only depends on entity masks, not on component storage
+    SprECS ecs(SPR_STORAGE_ARCHETYPE);
+    PositionC positionC;
+    VelocityC velocityC;
+    HealthC healthC;
+    NullSystem renderSystem;
+    ecs.createComponent<PositionC>(positionC);
+    ecs.createComponent<VelocityC>(velocityC);
+    ecs.createComponent<HealthC>(healthC);
+    ecs.setRenderSystem(renderSystem);
+
+    std::vector<Entity> entities;
+    for (uint32 i = 0; i < 500; i++){
+        entities.push_back(ecs.createEntity(ecs.add<PositionC>((float)i), ecs.add<VelocityC>(0.f)));
+    }
+    ecs.update(0.f);
+
+    auto sortedIds = [](const std::vector<Entity>& in){
+        std::vector<uint32> ids;
+        for (const Entity& entity : in)
+            ids.push_back(entity.id);
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    };
+
+    EXPECT_EQ((ecs.getEntities<PositionC, VelocityC>().size()), 500u);
+    EXPECT_EQ(ecs.getEntities<HealthC>().size(), 0u);
+
+    for (uint32 frame = 0; frame < 20; frame++){
+        // structural churn: add/remove components, destroy, create
+        for (uint32 i = frame; i < entities.size(); i += 7){
+            if (!ecs.isAlive(entities[i]))
+                continue;
+            if (entities[i].contains(getComponentTypeMask<HealthC>()))
+                ecs.remove<HealthC>(entities[i]);
+            else
+                ecs.add<HealthC>(entities[i], frame);
+        }
+        ecs.destroyEntity(entities[frame * 3]);
+        entities.push_back(ecs.createEntity(ecs.add<PositionC>(0.f), ecs.add<HealthC>(frame)));
+        ecs.update(0.f);
+
+        std::vector<Entity> trie;
+        ecs.getEntities<PositionC, HealthC>(trie);
+        EXPECT_EQ((sortedIds(ecs.getEntities<PositionC, HealthC>())), sortedIds(trie));
+
+        trie.clear();
+        ecs.getEntities<PositionC, VelocityC>(trie);
+        EXPECT_EQ((sortedIds(ecs.getEntities<PositionC, VelocityC>())), sortedIds(trie));
+
+        // cached entities carry their current mask
+        for (const Entity& entity : ecs.getEntities<HealthC>())
+            EXPECT_TRUE(((Entity)entity).contains(getComponentTypeMask<HealthC>()));
+    }
+
+    QueryCacheStats stats = ecs.getQueryCacheStats();
+    EXPECT_EQ(stats.queries, 3u);
+    EXPECT_EQ(stats.misses, 3u);
+    EXPECT_EQ(stats.hits, 59u);
+}
+
+TEST(QueryCacheTest, ColdMasksFromParallelSystems) {
+    SprECS ecs;
+    PositionC positionC;
+    VelocityC velocityC;
+    HealthC healthC;
+    NullSystem renderSystem;
+    ecs.createComponent<PositionC>(positionC);
+    ecs.createComponent<VelocityC>(velocityC);
+    ecs.createComponent<HealthC>(healthC);
+    ecs.setRenderSystem(renderSystem);
+
+    for (uint32 i = 0; i < 300; i++){
+        if (i % 3 == 0)
+            ecs.createEntity(ecs.add<PositionC>(0.f));
+        else if (i % 3 == 1)
+            ecs.createEntity(ecs.add<PositionC>(0.f), ecs.add<VelocityC>(0.f));
+        else
+            ecs.createEntity(ecs.add<PositionC>(0.f), ecs.add<VelocityC>(0.f), ecs.add<HealthC>(0u));
+    }
+    ecs.update(0.f);
+
+    // every thread asks for every mask first time round
+    std::atomic<uint32> wrong = 0;
+    std::vector<std::thread> threads;
+    for (uint32 t = 0; t < 8; t++){
+        threads.emplace_back([&](){
+            for (uint32 repeat = 0; repeat < 50; repeat++){
+                wrong += ecs.getEntities<PositionC>().size() != 300;
+                wrong += ecs.getEntities<PositionC, VelocityC>().size() != 200;
+                wrong += ecs.getEntities<VelocityC, HealthC>().size() != 100;
+                wrong += ecs.getEntities<HealthC>().size() != 100;
+            }
+        });
+    }
+    for (std::thread& thread : threads){
+        thread.join();
+    }
+
+    EXPECT_EQ(wrong, 0u);
+    QueryCacheStats stats = ecs.getQueryCacheStats();
+    EXPECT_EQ(stats.queries, 4u);
+    EXPECT_EQ(stats.misses, 4u);
+    EXPECT_EQ(stats.hits, 8u * 50u * 4u - 4u);
+}
+
+TEST(CommandBufferTest, MergesInSystemOrder) {
+    SprECS ecs;
+    HealthC healthC;
+    NullSystem renderSystem;
+    ecs.createComponent<HealthC>(healthC);
+    ecs.setRenderSystem(renderSystem);
+    ecs.setScheduleMode(SPR_SCHEDULE_PARALLEL, 4);
+
+    // later systems finish first, application order must not care
+    SpawnSystem a(ecs, 0, 30);
+    SpawnSystem b(ecs, 100, 20);
+    SpawnSystem c(ecs, 200, 10);
+    ecs.createSystem(a);
+    ecs.createSystem(b);
+    ecs.createSystem(c);
+
+    ecs.update(0.f);
+    EXPECT_EQ(ecs.getEntities<HealthC>().size(), 0u);
+
+    // recorded outside of systems, applied after them
+    ecs.commands().createEntity<HealthC>(1000u);
+
+    ecs.setScheduleMode(SPR_SCHEDULE_SEQUENTIAL);
+    ecs.update(0.f);
+    EXPECT_EQ(ecs.getEntities<HealthC>().size(), 151u);
+    for (uint32 i = 0; i < 150; i++){
+        EXPECT_EQ(ecs.get<HealthC>(i), (i / 50) * 100 + i % 50);
+    }
+    EXPECT_EQ(ecs.get<HealthC>(150), 1000u);
+}
+
+TEST(CommandBufferTest, DeferredFromParallelForEach) {
+    for (SprStorageType storage : {SPR_STORAGE_SPARSE, SPR_STORAGE_ARCHETYPE}){
+        SprECS ecs(storage);
+        PositionC positionC;
+        VelocityC velocityC;
+        HealthC healthC;
+        NullSystem renderSystem;
+        ecs.createComponent<PositionC>(positionC);
+        ecs.createComponent<VelocityC>(velocityC);
+        ecs.createComponent<HealthC>(healthC);
+        ecs.setRenderSystem(renderSystem);
+        ecs.setScheduleMode(SPR_SCHEDULE_PARALLEL, 4);
+
+        const uint32 count = 4000;
+        for (uint32 i = 0; i < count; i++){
+            ecs.createEntity(ecs.add<PositionC>((float)i));
+        }
+        ecs.update(0.f);
+
+        // structural changes while iterating are recorded, not applied
+        ecs.query<const PositionC>().parallelForEach([&](Entity& entity, const float& position){
+            CommandBuffer& commands = ecs.commands();
+            if (entity.id % 4 == 0){
+                commands.destroyEntity(entity);
+                return;
+            }
+            // both adds see the current mask, not the recorded copy's
+            commands.add<VelocityC>(entity, 1.f);
+            commands.add<HealthC>(entity, entity.id);
+            if (entity.id % 4 == 1)
+                commands.remove<VelocityC>(entity);
+        }, 128);
+        EXPECT_EQ(ecs.getEntities<PositionC>().size(), count);
+
+        ecs.update(0.f);
+        EXPECT_EQ(ecs.getEntities<PositionC>().size(), count - count / 4);
+        EXPECT_EQ((ecs.getEntities<PositionC, HealthC>().size()), count - count / 4);
+        EXPECT_EQ((ecs.getEntities<PositionC, VelocityC>().size()), count / 2);
+        for (const Entity& entity : ecs.getEntities<HealthC>()){
+            EXPECT_EQ(ecs.get<HealthC>(entity.id), entity.id);
+            EXPECT_EQ(ecs.get<PositionC>(entity.id), (float)entity.id);
+        }
+    }
+}
+
+TEST(ChangeTickTest, ConsumersAtDifferentRates) {
+    for (SprStorageType storage : {SPR_STORAGE_SPARSE, SPR_STORAGE_ARCHETYPE}){
+        SprECS ecs(storage);
+        PositionC positionC;
+        NullSystem renderSystem;
+        ecs.createComponent<PositionC>(positionC, true);
+        ecs.setRenderSystem(renderSystem);
+
+        std::vector<Entity> entities;
+        for (uint32 i = 0; i < 100; i++){
+            entities.push_back(ecs.createEntity(ecs.add<PositionC>((float)i)));
+        }
+        ecs.update(0.f);
+
+        uint32 everyFrame = ecs.getChangeTick();
+        uint32 everyTenth = ecs.getChangeTick();
+        std::vector<uint32> ids;
+        for (uint32 frame = 0; frame < 400; frame++){
+            // same entity set twice in a frame is reported once
+            Entity& entity = entities[frame % 100];
+            ecs.set<PositionC>(entity, (float)frame);
+            ecs.set<PositionC>(entity, (float)frame + 0.5f);
+            EXPECT_EQ(ecs.getDirtyEntityIds<PositionC>().size(), 1u);
+            EXPECT_TRUE(ecs.isDirty<PositionC>(entity));
+
+            ids.clear();
+            everyFrame = ecs.getChangedEntityIds<PositionC>(everyFrame, ids);
+            ASSERT_EQ(ids.size(), 1u);
+            EXPECT_EQ(ids[0], entity.id);
+
+            // nothing new until something changes again
+            ids.clear();
+            everyFrame = ecs.getChangedEntityIds<PositionC>(everyFrame, ids);
+            EXPECT_EQ(ids.size(), 0u);
+
+            if (frame % 10 == 9){
+                ids.clear();
+                everyTenth = ecs.getChangedEntityIds<PositionC>(everyTenth, ids);
+                EXPECT_EQ(ids.size(), 10u);
+            }
+            ecs.update(0.f);
+            EXPECT_FALSE(ecs.isDirty<PositionC>(entity));
+        }
+
+        // older than the change log, answered by scanning
+        ids.clear();
+        ecs.getChangedEntityIds<PositionC>(0, ids);
+        EXPECT_EQ(ids.size(), 100u);
+
+        // destroyed entities drop out
+        ecs.destroyEntity(entities[99]);
+        ecs.update(0.f);
+        ids.clear();
+        ecs.getChangedEntityIds<PositionC>(0, ids);
+        EXPECT_EQ(ids.size(), 99u);
+    }
+}
+
+TEST(WorldSnapshotTest, RoundTrip) {
+    for (SprStorageType storage : {SPR_STORAGE_SPARSE, SPR_STORAGE_ARCHETYPE}){
+        std::string path = "/tmp/spr_world_snapshot.bin";
+        std::vector<Entity> entities;
+        uint32 changedTick = 0;
+        {
+            SprECS ecs(storage);
+            PositionC positionC;
+            VelocityC velocityC;
+            HealthC healthC;
+            NullSystem renderSystem;
+            ecs.createComponent<PositionC>(positionC, true);
+            ecs.createComponent<VelocityC>(velocityC);
+            ecs.createComponent<HealthC>(healthC);
+            ecs.setRenderSystem(renderSystem);
+
+            for (uint32 i = 0; i < 3000; i++){
+                if (i % 3 == 0)
+                    entities.push_back(ecs.createEntity(ecs.add<PositionC>((float)i), ecs.add<HealthC>(i)));
+                else
+                    entities.push_back(ecs.createEntity(ecs.add<PositionC>((float)i), ecs.add<VelocityC>(-(float)i)));
+            }
+            for (uint32 i = 0; i < 3000; i += 10){
+                ecs.destroyEntity(entities[i]);
+            }
+            ecs.update(0.f);
+
+            changedTick = ecs.getChangeTick();
+            ecs.set<PositionC>(entities[5], 0.5f);
+            ecs.set<PositionC>(entities[7], 0.5f);
+
+            // not at a sync point
+            ecs.destroyEntity(entities[1]);
+            EXPECT_FALSE(ecs.saveSnapshot(path));
+            ecs.update(0.f);
+            ASSERT_TRUE(ecs.saveSnapshot(path));
+        }
+
+        SprECS ecs(storage);
+        PositionC positionC;
+        VelocityC velocityC;
+        HealthC healthC;
+        NullSystem renderSystem;
+        ecs.createComponent<PositionC>(positionC, true);
+        ecs.createComponent<VelocityC>(velocityC);
+        ecs.createComponent<HealthC>(healthC);
+        ecs.setRenderSystem(renderSystem);
+        ASSERT_TRUE(ecs.loadSnapshot(path));
+        EXPECT_FALSE(ecs.loadSnapshot(path));
+        ecs.update(0.f);
+
+        EXPECT_EQ((ecs.getEntities<PositionC>().size()), 3000u - 300u - 1u);
+        EXPECT_EQ((ecs.getEntities<PositionC, HealthC>().size()), 900u);
+        EXPECT_FALSE(ecs.isAlive(entities[0]));
+        EXPECT_FALSE(ecs.isAlive(entities[1]));
+        for (const Entity& entity : ecs.getEntities<PositionC>()){
+            Entity original = entities[entity.id];
+            EXPECT_TRUE(ecs.isAlive(original));
+            EXPECT_EQ(entity.components, original.components);
+            if (entity.id == 5 || entity.id == 7)
+                EXPECT_EQ(ecs.get<PositionC>(entity.id), 0.5f);
+            else
+                EXPECT_EQ(ecs.get<PositionC>(entity.id), (float)entity.id);
+            if (entity.id % 3 == 0)
+                EXPECT_EQ(ecs.get<HealthC>(entity.id), entity.id);
+            else
+                EXPECT_EQ(ecs.get<VelocityC>(entity.id), -(float)entity.id);
+        }
+
+        // change state carries over
+        std::vector<uint32> ids;
+        ecs.getChangedEntityIds<PositionC>(changedTick, ids);
+        EXPECT_EQ(ids, (std::vector<uint32>{5, 7}));
+
+        // freed ids are recycled with bumped generations
+        Entity entity = ecs.createEntity(ecs.add<PositionC>(1.f));
+        EXPECT_EQ(entity.id, 1u);
+        EXPECT_NE(entity.generation, entities[1].generation);
+    }
+}
+
+
+TEST(WorldSnapshotTest, RejectsCorruptFiles) {
+    std::string path = "/tmp/spr_world_snapshot_corrupt.bin";
+    std::vector<uint8> bytes;
+    {
+        SprECS ecs;
+        PositionC positionC;
+        HealthC healthC;
+        NullSystem renderSystem;
+        ecs.createComponent<PositionC>(positionC, true);
+        ecs.createComponent<HealthC>(healthC);
+        ecs.setRenderSystem(renderSystem);
+        for (uint32 i = 0; i < 1000; i++){
+            if (i % 2 == 0)
+                ecs.createEntity(ecs.add<PositionC>((float)i));
+            else
+                ecs.createEntity(ecs.add<PositionC>((float)i), ecs.add<HealthC>(i));
+        }
+        ecs.update(0.f);
+        ASSERT_TRUE(ecs.saveSnapshot(path));
+
+        std::ifstream file(path, std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(file), {});
+    }
+    auto write = [&](const std::vector<uint8>& data){
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write((const char*)data.data(), data.size());
+    };
+
+    SprECS ecs;
+    PositionC positionC;
+    HealthC healthC;
+    NullSystem renderSystem;
+    ecs.createComponent<PositionC>(positionC, true);
+    ecs.createComponent<HealthC>(healthC);
+    ecs.setRenderSystem(renderSystem);
+
+    // cut off halfway through the groups
+    write(std::vector<uint8>(bytes.begin(), bytes.begin() + bytes.size() * 3 / 4));
+    EXPECT_FALSE(ecs.loadSnapshot(path));
+
+    // first group's first id past the capacity
+    SnapshotHeader header;
+    memcpy(&header, bytes.data(), sizeof(SnapshotHeader));
+    auto align = [](uint64 offset){ return (offset + 15) & ~15ull; };
+    uint64 offset = align(sizeof(SnapshotHeader));
+    offset = align(offset + header.componentCount * sizeof(SnapshotComponent));
+    offset = align(offset + header.entityCapacity * sizeof(uint32));
+    offset = align(offset + header.entityCapacity * sizeof(uint64));
+    offset = align(offset + header.freeCount * sizeof(uint32));
+    offset = align(offset + sizeof(SnapshotGroup));
+    std::vector<uint8> corrupt = bytes;
+    uint32 badId = 1u << 30;
+    memcpy(corrupt.data() + offset, &badId, sizeof(uint32));
+    write(corrupt);
+    EXPECT_FALSE(ecs.loadSnapshot(path));
+
+    // nothing was applied, the world still takes a good snapshot
+    write(bytes);
+    ASSERT_TRUE(ecs.loadSnapshot(path));
+    ecs.update(0.f);
+    EXPECT_EQ((ecs.getEntities<PositionC>().size()), 1000u);
+    EXPECT_EQ((ecs.getEntities<PositionC, HealthC>().size()), 500u);
+}
+
+int main() {
+::testing::InitGoogleTest();
+  return RUN_ALL_TESTS();
+}
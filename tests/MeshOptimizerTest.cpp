@@ -0,0 +1,312 @@
+#include <vector>
+#include <array>
+#include <random>
+#include <cmath>
+#include <algorithm>
+#include "gtest/gtest.h"
+#include "glm/glm.hpp"
+#include "../tools/gltf/MeshOptimizer.h"
+
+using namespace spr;
+using namespace spr::tools;
+
+typedef std::array<float, 9> TrianglePositions;
+
+// (n+1)^2 vertices of a unit sphere (xyzw), 2n^2 triangles in random order
+static void shuffledSphere(uint32 n, std::vector<float>& positions, std::vector<uint32>& indices){
+    positions.clear();
+    for (uint32 y = 0; y <= n; y++){
+        for (uint32 x = 0; x <= n; x++){
+            float u = x * 6.2831853f / n;
+            float v = y * 3.1415926f / n;
+            positions.insert(positions.end(), {std::cos(u) * std::sin(v), std::cos(v), std::sin(u) * std::sin(v), 1.f});
+        }
+    }
+
+    std::vector<uint32> grid;
+    for (uint32 y = 0; y < n; y++){
+        for (uint32 x = 0; x < n; x++){
+            uint32 a = y * (n + 1) + x;
+            uint32 b = a + 1;
+            uint32 c = a + n + 1;
+            uint32 d = c + 1;
+            grid.insert(grid.end(), {a, c, b, b, c, d});
+        }
+    }
+
+    std::vector<uint32> order(grid.size() / 3);
+    for (uint32 i = 0; i < order.size(); i++){
+        order[i] = i;
+    }
+    std::mt19937 rng(1);
+    std::shuffle(order.begin(), order.end(), rng);
+
+    indices.clear();
+    for (uint32 triangle : order){
+        indices.insert(indices.end(), grid.begin() + triangle * 3, grid.begin() + triangle * 3 + 3);
+    }
+}
+
+// triangles by their corner positions, rotated to start at the smallest
+// corner (which keeps the winding) and sorted, so only order is ignored
+static std::vector<TrianglePositions> triangleSet(const std::vector<uint32>& indices, const std::vector<float>& positions){
+    std::vector<TrianglePositions> triangles;
+    for (uint32 t = 0; t < indices.size() / 3; t++){
+        std::array<std::array<float, 3>, 3> corners;
+        for (uint32 k = 0; k < 3; k++){
+            for (uint32 j = 0; j < 3; j++){
+                corners[k][j] = positions[indices[t * 3 + k] * 4 + j];
+            }
+        }
+
+        uint32 first = std::min_element(corners.begin(), corners.end()) - corners.begin();
+        TrianglePositions triangle;
+        for (uint32 k = 0; k < 3; k++){
+            for (uint32 j = 0; j < 3; j++){
+                triangle[k * 3 + j] = corners[(first + k) % 3][j];
+            }
+        }
+        triangles.push_back(triangle);
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+// unit sphere with shared poles, the u = 0 column is split
+// (same positions, as for a uv seam) but nothing else is
+static void closedSphere(uint32 n, std::vector<float>& positions, std::vector<uint32>& indices){
+    positions.clear();
+    indices.clear();
+    for (uint32 y = 0; y <= n; y++){
+        for (uint32 x = 0; x <= n; x++){
+            float u = x == n ? 0.f : x * 6.2831853f / n;
+            float v = y * 3.1415926f / n;
+            float radius = (y == 0 || y == n) ? 0.f : std::sin(v);
+            float height = y == 0 ? 1.f : y == n ? -1.f : std::cos(v);
+            positions.insert(positions.end(), {std::cos(u) * radius, height, std::sin(u) * radius, 1.f});
+        }
+    }
+    for (uint32 y = 0; y < n; y++){
+        for (uint32 x = 0; x < n; x++){
+            uint32 a = y * (n + 1) + x;
+            uint32 b = a + 1;
+            uint32 c = a + n + 1;
+            uint32 d = c + 1;
+            if (y != 0)
+                indices.insert(indices.end(), {a, b, c});
+            if (y != n - 1)
+                indices.insert(indices.end(), {b, d, c});
+        }
+    }
+}
+
+static glm::vec3 getPosition(const std::vector<float>& positions, uint32 vertex){
+    return glm::vec3(positions[vertex * 4], positions[vertex * 4 + 1], positions[vertex * 4 + 2]);
+}
+
+TEST(MeshOptimizerTest, PreservesTriangles) {
+    std::vector<float> positions;
+    std::vector<uint32> indices;
+    shuffledSphere(64, positions, indices);
+    uint32 vertexCount = positions.size() / 4;
+    std::vector<TrianglePositions> before = triangleSet(indices, positions);
+
+    // every pass gltfparser runs
+    MeshOptimizer::optimizeVertexCache(indices.data(), indices.size(), vertexCount);
+    MeshOptimizer::optimizeOverdraw(indices.data(), indices.size(), (uint8*)positions.data(), 4 * sizeof(float), vertexCount, 1.05f);
+    std::vector<uint32> remap;
+    uint32 usedVertexCount = MeshOptimizer::optimizeVertexFetch(indices.data(), indices.size(), vertexCount, remap);
+    std::vector<uint8_t> vertices((uint8_t*)positions.data(), (uint8_t*)(positions.data() + positions.size()));
+    MeshOptimizer::remapVertices(vertices, 4 * sizeof(float), remap, usedVertexCount);
+    std::vector<float> remapped((float*)vertices.data(), (float*)(vertices.data() + vertices.size()));
+
+    // same triangles, same winding
+    ASSERT_EQ(before.size() * 3, indices.size());
+    ASSERT_EQ(before, triangleSet(indices, remapped));
+}
+
+TEST(MeshOptimizerTest, ImprovesVertexCache) {
+    std::vector<float> positions;
+    std::vector<uint32> indices;
+    shuffledSphere(64, positions, indices);
+    uint32 vertexCount = positions.size() / 4;
+
+    VertexCacheStats before = MeshOptimizer::analyzeVertexCache(indices.data(), indices.size(), vertexCount);
+    MeshOptimizer::optimizeVertexCache(indices.data(), indices.size(), vertexCount);
+    VertexCacheStats optimized = MeshOptimizer::analyzeVertexCache(indices.data(), indices.size(), vertexCount);
+    MeshOptimizer::optimizeOverdraw(indices.data(), indices.size(), (uint8*)positions.data(), 4 * sizeof(float), vertexCount, 1.05f);
+    VertexCacheStats overdraw = MeshOptimizer::analyzeVertexCache(indices.data(), indices.size(), vertexCount);
+
+    // shuffled, nearly every vertex misses. a grid can get close to 0.5
+    ASSERT_GT(before.acmr, 2.f);
+    ASSERT_LT(optimized.acmr, 0.8f);
+    ASSERT_LT(optimized.atvr, before.atvr);
+
+    // overdraw gives up at most its threshold
+    ASSERT_LE(overdraw.acmr, optimized.acmr * 1.05f + 1e-4f);
+}
+
+TEST(MeshOptimizerTest, FetchRemapKeepsPositions) {
+    std::vector<float> positions;
+    std::vector<uint32> indices;
+    shuffledSphere(32, positions, indices);
+    uint32 vertexCount = positions.size() / 4;
+
+    // an unused vertex, dropped by the remap
+    positions.insert(positions.end(), {9.f, 9.f, 9.f, 1.f});
+    vertexCount++;
+
+    std::vector<uint32> original = indices;
+    std::vector<uint32> remap;
+    uint32 usedVertexCount = MeshOptimizer::optimizeVertexFetch(indices.data(), indices.size(), vertexCount, remap);
+    std::vector<uint8_t> vertices((uint8_t*)positions.data(), (uint8_t*)(positions.data() + positions.size()));
+    MeshOptimizer::remapVertices(vertices, 4 * sizeof(float), remap, usedVertexCount);
+    const float* remapped = (const float*)vertices.data();
+
+    ASSERT_EQ(usedVertexCount, vertexCount - 1);
+    ASSERT_EQ(vertices.size(), usedVertexCount * 4 * sizeof(float));
+    ASSERT_EQ(remap[vertexCount - 1], UINT32_MAX);
+
+    // every index points at the same position as before, and
+    // vertices are numbered in order of first use
+    uint32 nextVertex = 0;
+    for (uint32 i = 0; i < indices.size(); i++){
+        ASSERT_EQ(remap[original[i]], indices[i]);
+        ASSERT_LE(indices[i], nextVertex);
+        nextVertex = std::max(nextVertex, indices[i] + 1);
+        for (uint32 j = 0; j < 4; j++){
+            ASSERT_EQ(remapped[indices[i] * 4 + j], positions[original[i] * 4 + j]);
+        }
+    }
+}
+
+TEST(MeshOptimizerTest, SimplifyReachesTarget) {
+    std::vector<float> positions;
+    std::vector<uint32> indices;
+    closedSphere(32, positions, indices);
+    uint32 vertexCount = positions.size() / 4;
+    uint32 target = indices.size() / 4 / 3 * 3;
+
+    std::vector<uint32> out;
+    float error;
+    uint32 indexCount = MeshOptimizer::simplify(out, indices.data(), indices.size(), (uint8*)positions.data(), 4 * sizeof(float), vertexCount, target, 1.f, error);
+
+    ASSERT_EQ(indexCount, out.size());
+    ASSERT_EQ(indexCount % 3, 0u);
+    ASSERT_LE(indexCount, target);
+    ASSERT_GT(indexCount, target / 2);
+    ASSERT_LE(error, 1.f);
+
+    // existing vertices only, no collapsed triangles left
+    for (uint32 i = 0; i < indexCount; i += 3){
+        ASSERT_LT(out[i], vertexCount);
+        ASSERT_LT(out[i + 1], vertexCount);
+        ASSERT_LT(out[i + 2], vertexCount);
+        ASSERT_NE(out[i], out[i + 1]);
+        ASSERT_NE(out[i + 1], out[i + 2]);
+        ASSERT_NE(out[i + 2], out[i]);
+    }
+}
+
+TEST(MeshOptimizerTest, SimplifyRespectsError) {
+    std::vector<float> positions;
+    std::vector<uint32> indices;
+    closedSphere(64, positions, indices);
+    uint32 vertexCount = positions.size() / 4;
+
+    uint32 previousCount = indices.size();
+    for (float maxError : {0.001f, 0.01f, 0.05f}){
+        std::vector<uint32> out;
+        float error;
+        uint32 indexCount = MeshOptimizer::simplify(out, indices.data(), indices.size(), (uint8*)positions.data(), 4 * sizeof(float), vertexCount, 0, maxError, error);
+
+        // as far as the error allows, more error is fewer triangles
+        ASSERT_LE(error, maxError);
+        ASSERT_LT(indexCount, previousCount);
+        previousCount = indexCount;
+
+        // the error is measured at the vertices, the middle of a
+        // triangle on a curved surface can sag a bit further
+        for (uint32 i = 0; i < indexCount; i += 3){
+            ASSERT_LT(out[i], vertexCount);
+            ASSERT_LT(out[i + 1], vertexCount);
+            ASSERT_LT(out[i + 2], vertexCount);
+            glm::vec3 center = (getPosition(positions, out[i]) + getPosition(positions, out[i + 1]) + getPosition(positions, out[i + 2])) / 3.f;
+            ASSERT_LE(std::fabs(1.f - glm::length(center)), 3.f * maxError);
+        }
+    }
+}
+
+TEST(MeshOptimizerTest, SimplifyKeepsSeamsAndBorders) {
+    // flat unit square, the right half uses its own copies of the
+    // middle column (a uv seam). interior vertices are free to collapse
+    const uint32 n = 32;
+    std::vector<float> positions;
+    for (uint32 y = 0; y <= n; y++){
+        for (uint32 x = 0; x <= n; x++){
+            positions.insert(positions.end(), {x / (float)n, 0.f, y / (float)n, 1.f});
+        }
+    }
+    uint32 gridVertexCount = positions.size() / 4;
+    std::vector<uint32> seamCopy(gridVertexCount, UINT32_MAX);
+    for (uint32 y = 0; y <= n; y++){
+        uint32 vertex = y * (n + 1) + n / 2;
+        seamCopy[vertex] = positions.size() / 4;
+        positions.insert(positions.end(), {positions[vertex * 4], 0.f, positions[vertex * 4 + 2], 1.f});
+    }
+    uint32 vertexCount = positions.size() / 4;
+
+    std::vector<uint32> indices;
+    for (uint32 y = 0; y < n; y++){
+        for (uint32 x = 0; x < n; x++){
+            uint32 a = y * (n + 1) + x;
+            uint32 b = a + 1;
+            uint32 c = a + n + 1;
+            uint32 d = c + 1;
+            if (x == n / 2){
+                a = seamCopy[a];
+                c = seamCopy[c];
+            }
+            indices.insert(indices.end(), {a, c, b, b, c, d});
+        }
+    }
+
+    std::vector<uint32> out;
+    float error;
+    uint32 indexCount = MeshOptimizer::simplify(out, indices.data(), indices.size(), (uint8*)positions.data(), 4 * sizeof(float), vertexCount, 0, 0.01f, error);
+    ASSERT_LT(indexCount, indices.size() / 4);
+
+    std::vector<bool> used(vertexCount, false);
+    for (uint32 i = 0; i < indexCount; i++){
+        ASSERT_LT(out[i], vertexCount);
+        used[out[i]] = true;
+    }
+
+    // both sides of the seam are still there
+    for (uint32 vertex = 0; vertex < gridVertexCount; vertex++){
+        if (seamCopy[vertex] == UINT32_MAX)
+            continue;
+        ASSERT_TRUE(used[vertex]);
+        ASSERT_TRUE(used[seamCopy[vertex]]);
+    }
+
+    // corners stay, borders stay on the square's edges and nothing
+    // folds over, so the triangles still cover exactly the square
+    ASSERT_TRUE(used[0]);
+    ASSERT_TRUE(used[n]);
+    ASSERT_TRUE(used[n * (n + 1)]);
+    ASSERT_TRUE(used[n * (n + 1) + n]);
+    float area = 0.f;
+    for (uint32 i = 0; i < indexCount; i += 3){
+        glm::vec3 a = getPosition(positions, out[i]);
+        glm::vec3 normal = glm::cross(getPosition(positions, out[i + 1]) - a, getPosition(positions, out[i + 2]) - a);
+        ASSERT_GT(normal.y, 0.f);
+        area += normal.y * 0.5f;
+    }
+    ASSERT_NEAR(area, 1.f, 1e-4f);
+}
+
+int main() {
+    ::testing::InitGoogleTest();
+    return RUN_ALL_TESTS();
+}
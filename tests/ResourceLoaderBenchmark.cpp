@@ -0,0 +1,114 @@
+#include <vector>
+#include <string>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+#include "gtest/gtest.h"
+#include "../src/resource/ResourceLoader.h"
+#include "../src/resource/AssetArchive.h"
+
+using namespace spr;
+
+static const uint32 BENCH_ASSETS = 10000;
+
+static uint32 assetBytes(uint32 id){
+    return 1024 + (id % 4) * 512;
+}
+
+static void writeAssets(const std::string& dir, PathMap& paths, MetadataMap& metadata){
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    std::vector<uint8> bytes;
+    for (uint32 id = 1; id <= BENCH_ASSETS; id++){
+        bytes.resize(assetBytes(id));
+        for (uint32 i = 0; i < bytes.size(); i++){
+            bytes[i] = (uint8)(id + i);
+        }
+
+        std::string path = dir + std::to_string(id) + ".stex";
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write((const char*)bytes.data(), bytes.size());
+        paths[id] = path;
+
+        ResourceMetadata& entry = metadata[id];
+        entry.resourceType = SPR_BUFFER;
+        entry.resourceId = id;
+        entry.parentId = id;
+        entry.byteOffset = 0;
+        entry.byteLength = bytes.size();
+    }
+}
+
+// best effort cold start: ask the kernel to drop the files' cached pages
+static void dropCache(const std::string& path){
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+    fdatasync(fd);
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    close(fd);
+}
+
+// load and read every asset once, returns ms
+static double loadAll(ResourceLoader& loader, MetadataMap& metadata, uint64& checksum){
+    auto start = std::chrono::steady_clock::now();
+    for (uint32 id = 1; id <= BENCH_ASSETS; id++){
+        Buffer buffer;
+        loader.loadFromMetadata<Buffer>(metadata, metadata[id], buffer);
+        for (uint8 byte : buffer.data){
+            checksum += byte;
+        }
+        loader.unload(buffer);
+    }
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+TEST(ResourceLoaderBenchmark, LooseVsPacked) {
+    std::string dir = std::filesystem::temp_directory_path().string() + "/spr_resource_loader_bench/";
+    std::string archivePath = dir + "assets.spak";
+    PathMap paths;
+    MetadataMap metadata;
+    writeAssets(dir, paths, metadata);
+    ASSERT_TRUE(AssetArchive::pack(paths, archivePath, 0));
+
+    // loose, one mapping per file
+    for (auto& [id, path] : paths){
+        dropCache(path);
+    }
+    uint64 looseChecksum = 0;
+    ResourceLoader loose;
+    loose.updatePaths(paths);
+    double looseMs = loadAll(loose, metadata, looseChecksum);
+    MappingStats looseStats = loose.getMappingStats();
+
+    // packed, one mapping for everything
+    dropCache(archivePath);
+    uint64 packedChecksum = 0;
+    ResourceLoader packed;
+    packed.updatePaths(paths);
+    ASSERT_TRUE(packed.mountArchive(archivePath, 0));
+    double packedMs = loadAll(packed, metadata, packedChecksum);
+    MappingStats packedStats = packed.getMappingStats();
+
+    std::cout << "[archive] " << BENCH_ASSETS << " assets loose:  " << looseMs << " ms, "
+              << looseStats.maps << " mmap, " << looseStats.unmaps << " munmap" << std::endl;
+    std::cout << "[archive] " << BENCH_ASSETS << " assets packed: " << packedMs << " ms, "
+              << packedStats.maps << " mmap, " << packedStats.unmaps << " munmap" << std::endl;
+
+    EXPECT_EQ(looseChecksum, packedChecksum);
+    EXPECT_EQ(looseStats.maps, BENCH_ASSETS);
+    EXPECT_EQ(packedStats.maps, 1u);
+
+    std::filesystem::remove_all(dir);
+}
+
+
+int main() {
+::testing::InitGoogleTest();
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,331 @@
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include "gtest/gtest.h"
+#include "../src/resource/ResourceCache.h"
+#include "../src/resource/ResourceLoader.h"
+#include "../src/resource/AssetArchive.h"
+
+using namespace spr;
+
+static const uint32 TEST_FILES = 40;
+static const uint32 TEST_BUFFERS_PER_FILE = 8;
+static const uint32 TEST_BUFFER_BYTES = 512;
+static const uint64 TEST_MANIFEST_HASH = 0x5350414b;
+
+// one mesh with lods (version 1), one material
+struct TestLodModelLayout {
+    ModelHeader header;
+    MeshLayout mesh;
+    MaterialLayout material;
+    MeshLodLayout lods;
+    BlobHeader blob;
+};
+
+static uint8 testByte(uint32 file, uint32 offset){
+    return (uint8)(file * 31 + offset * 7);
+}
+
+// files of known bytes, with buffer metadata pointing into them
+static void writeTestFiles(PathMap& paths, MetadataMap& metadata){
+    std::string dir = std::filesystem::temp_directory_path().string() + "/spr_resource_loader_test/";
+    std::filesystem::create_directories(dir);
+
+    uint32 id = 1000;
+    for (uint32 file = 1; file <= TEST_FILES; file++){
+        std::string path = dir + std::to_string(file) + ".smdl";
+        std::vector<uint8> bytes(TEST_BUFFERS_PER_FILE * TEST_BUFFER_BYTES);
+        for (uint32 i = 0; i < bytes.size(); i++){
+            bytes[i] = testByte(file, i);
+        }
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write((const char*)bytes.data(), bytes.size());
+        out.close();
+        paths[file] = path;
+
+        for (uint32 buffer = 0; buffer < TEST_BUFFERS_PER_FILE; buffer++){
+            ResourceMetadata& entry = metadata[id + (file - 1) * TEST_BUFFERS_PER_FILE + buffer];
+            entry.resourceType = SPR_BUFFER;
+            entry.resourceId = id + (file - 1) * TEST_BUFFERS_PER_FILE + buffer;
+            entry.parentId = file;
+            entry.byteOffset = buffer * TEST_BUFFER_BYTES;
+            entry.byteLength = TEST_BUFFER_BYTES;
+        }
+    }
+}
+
+// interleaved order: buffer 0 of every file, then buffer 1 of every file ...
+static uint32 interleavedId(uint32 i){
+    uint32 file = i % TEST_FILES;
+    uint32 buffer = i / TEST_FILES;
+    return 1000 + file * TEST_BUFFERS_PER_FILE + buffer;
+}
+
+// version 0 files leave out the lod buffer
+static void writeLodModel(const std::string& path, uint32 version, const std::vector<LodLayout>& lods, uint32 indexCount){
+    uint32 indexBytes = indexCount * sizeof(uint32);
+    TestLodModelLayout layout = {};
+    layout.header.meshCount = 1;
+    layout.header.meshBufferOffset = offsetof(TestLodModelLayout, mesh);
+    layout.header.materialCount = 1;
+    layout.header.materialBufferOffset = offsetof(TestLodModelLayout, material);
+    layout.header.textureBufferOffset = offsetof(TestLodModelLayout, lods);
+    layout.header.blobHeaderOffset = offsetof(TestLodModelLayout, blob);
+    layout.header.blobDataOffset = sizeof(TestLodModelLayout);
+    layout.header.version = version;
+    layout.header.meshLodBufferOffset = version >= 1 ? offsetof(TestLodModelLayout, lods) : 0;
+    layout.mesh.indexDataSizeBytes = indexBytes;
+    layout.lods.lodCount = lods.size();
+    for (uint32 lod = 0; lod < lods.size(); lod++){
+        layout.lods.lods[lod] = lods[lod];
+    }
+    layout.blob.sizeBytes = indexBytes;
+    layout.blob.indexRegionSizeBytes = indexBytes;
+    layout.blob.indexRegionOffset = sizeof(TestLodModelLayout);
+
+    std::vector<uint8> indices(indexBytes, 0);
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write((const char*)&layout, sizeof(layout));
+    out.write((const char*)indices.data(), indices.size());
+}
+
+static bool bufferValid(Buffer* buffer){
+    for (uint32 i = 0; i < buffer->byteLength; i++){
+        if (buffer->data.data()[i] != testByte(buffer->parentId, buffer->byteOffset + i))
+            return false;
+    }
+    return true;
+}
+
+
+TEST(ResourceLoaderTest, SpansStayValid) {
+    PathMap paths;
+    MetadataMap metadata;
+    writeTestFiles(paths, metadata);
+
+    ResourceLoader loader(8);
+    loader.updatePaths(paths);
+    TypedResourceCache<Buffer> buffers;
+
+    // every buffer of the first 30 files stays loaded,
+    // so none of those files may be unmapped
+    std::vector<Handle<Buffer>> handles;
+    for (uint32 i = 0; i < TEST_FILES * TEST_BUFFERS_PER_FILE; i++){
+        uint32 id = interleavedId(i);
+        if (metadata[id].parentId <= 30)
+            handles.push_back(buffers.getHandle(id, loader, metadata));
+    }
+    for (Handle<Buffer> handle : handles){
+        EXPECT_TRUE(bufferValid(buffers.getData(handle)));
+    }
+
+    MappingStats stats = loader.getMappingStats();
+    EXPECT_EQ(stats.maps, 30u);
+    EXPECT_EQ(stats.unmaps, 0u);
+    EXPECT_EQ(stats.live, 30u);
+
+    // release the buffers of files 1-15
+    for (uint32 i = 0; i < handles.size(); i++){
+        Buffer* buffer = buffers.getData(handles[i]);
+        if (buffer->parentId > 15)
+            continue;
+        loader.unload(*buffer);
+        buffers.deleteData(handles[i]);
+    }
+
+    // mapping another file evicts the released ones, the rest stay valid
+    ResourceMetadata& extra = metadata[1000 + 30 * TEST_BUFFERS_PER_FILE];
+    Buffer reloaded;
+    loader.loadFromMetadata<Buffer>(metadata, extra, reloaded);
+    stats = loader.getMappingStats();
+    EXPECT_EQ(stats.unmaps, 15u);
+    EXPECT_EQ(stats.live, 16u);
+    EXPECT_TRUE(bufferValid(&reloaded));
+
+    uint32 valid = 0;
+    for (Handle<Buffer> handle : handles){
+        Buffer* buffer = buffers.getData(handle);
+        if (buffer){
+            EXPECT_TRUE(bufferValid(buffer));
+            valid++;
+        }
+    }
+    EXPECT_EQ(valid, 15 * TEST_BUFFERS_PER_FILE);
+}
+
+TEST(ResourceLoaderTest, MappingSyscalls) {
+    PathMap paths;
+    MetadataMap metadata;
+    writeTestFiles(paths, metadata);
+
+    // transient loads interleaved across files, a single mapping
+    // (previous behaviour) vs the default sized cache
+    for (uint32 maxMappings : {1u, 8u, SPR_MAX_MAPPINGS, TEST_FILES}){
+        ResourceLoader loader(maxMappings);
+        loader.updatePaths(paths);
+
+        uint32 loads = 0;
+        for (uint32 pass = 0; pass < 4; pass++){
+            for (uint32 i = 0; i < TEST_FILES * TEST_BUFFERS_PER_FILE; i++){
+                // working set of 12 files
+                uint32 id = interleavedId(i);
+                if (metadata[id].parentId > 12)
+                    continue;
+                Buffer buffer;
+                loader.loadFromMetadata<Buffer>(metadata, metadata[id], buffer);
+                EXPECT_TRUE(bufferValid(&buffer));
+                loader.unload(buffer);
+                loads++;
+            }
+        }
+
+        MappingStats stats = loader.getMappingStats();
+        std::cout << "[mappings] max " << maxMappings << ": " << loads << " loads, "
+                  << stats.maps << " mmap, " << stats.unmaps << " munmap, " << stats.hits << " hits" << std::endl;
+        if (maxMappings >= 12)
+            EXPECT_EQ(stats.maps, 12u);
+        else
+            EXPECT_EQ(stats.maps, loads);
+    }
+}
+
+TEST(ResourceLoaderTest, ArchiveRoundTrip) {
+    PathMap paths;
+    MetadataMap metadata;
+    writeTestFiles(paths, metadata);
+
+    std::string archivePath = std::filesystem::temp_directory_path().string() + "/spr_resource_loader_test.spak";
+    ASSERT_TRUE(AssetArchive::pack(paths, archivePath, TEST_MANIFEST_HASH));
+
+    // every file byte for byte, 4KB aligned, found by id
+    AssetArchive archive;
+    ASSERT_TRUE(archive.open(archivePath, TEST_MANIFEST_HASH));
+    EXPECT_EQ(archive.getEntryCount(), TEST_FILES);
+    for (auto& [id, path] : paths){
+        const ArchiveEntry* entry = archive.find(id);
+        ASSERT_NE(entry, nullptr);
+        EXPECT_EQ(entry->offset % SPR_ARCHIVE_ALIGNMENT, 0u);
+        EXPECT_EQ(entry->sizeBytes, std::filesystem::file_size(path));
+
+        const uint8* data = (const uint8*)archive.getData(id);
+        for (uint32 i = 0; i < entry->sizeBytes; i++){
+            ASSERT_EQ(data[i], testByte(id, i));
+        }
+    }
+    EXPECT_EQ(archive.find(0), nullptr);
+    EXPECT_EQ(archive.find(TEST_FILES + 1), nullptr);
+
+    // loader resolves packed assets from the one mapping
+    ResourceLoader loader;
+    loader.updatePaths(paths);
+    ASSERT_TRUE(loader.mountArchive(archivePath, TEST_MANIFEST_HASH));
+    for (uint32 i = 0; i < TEST_FILES * TEST_BUFFERS_PER_FILE; i++){
+        Buffer buffer;
+        loader.loadFromMetadata<Buffer>(metadata, metadata[interleavedId(i)], buffer);
+        EXPECT_TRUE(bufferValid(&buffer));
+        loader.unload(buffer);
+    }
+    MappingStats stats = loader.getMappingStats();
+    EXPECT_EQ(stats.maps, 1u);
+    EXPECT_EQ(stats.live, 1u);
+
+    std::filesystem::remove(archivePath);
+}
+
+TEST(ResourceLoaderTest, ArchiveRejected) {
+    PathMap paths;
+    MetadataMap metadata;
+    writeTestFiles(paths, metadata);
+
+    std::string archivePath = std::filesystem::temp_directory_path().string() + "/spr_resource_loader_test.spak";
+    ASSERT_TRUE(AssetArchive::pack(paths, archivePath, TEST_MANIFEST_HASH));
+
+    // packed from another manifest, loose files are used instead
+    AssetArchive archive;
+    EXPECT_FALSE(archive.open(archivePath, TEST_MANIFEST_HASH + 1));
+    EXPECT_FALSE(archive.isOpen());
+    ResourceLoader loader;
+    EXPECT_FALSE(loader.mountArchive(archivePath, TEST_MANIFEST_HASH + 1));
+    EXPECT_EQ(loader.getMappingStats().live, 0u);
+
+    // a loose file reconverted after packing, same manifest
+    loader.updatePaths(paths);
+    ASSERT_TRUE(loader.mountArchive(archivePath, TEST_MANIFEST_HASH));
+    {
+        std::ofstream file(paths.begin()->second, std::ios::binary | std::ios::app);
+        file.put(0);
+    }
+    ResourceLoader staleLoader;
+    staleLoader.updatePaths(paths);
+    EXPECT_FALSE(staleLoader.mountArchive(archivePath, TEST_MANIFEST_HASH));
+    EXPECT_EQ(staleLoader.getMappingStats().live, 0u);
+    EXPECT_TRUE(archive.open(archivePath, TEST_MANIFEST_HASH));
+    EXPECT_FALSE(archive.isCurrent(paths));
+
+    // an entry running past the end of the file
+    {
+        std::fstream file(archivePath, std::ios::binary | std::ios::in | std::ios::out);
+        ArchiveHeader header;
+        file.read((char*)&header, sizeof(header));
+        ArchiveEntry entry;
+        file.seekg(header.tocOffset + (header.entryCount - 1) * sizeof(ArchiveEntry));
+        file.read((char*)&entry, sizeof(entry));
+        entry.sizeBytes = header.sizeBytes;
+        file.seekp(header.tocOffset + (header.entryCount - 1) * sizeof(ArchiveEntry));
+        file.write((const char*)&entry, sizeof(entry));
+    }
+    EXPECT_FALSE(archive.open(archivePath, TEST_MANIFEST_HASH));
+    EXPECT_FALSE(archive.isOpen());
+
+    std::filesystem::remove(archivePath);
+}
+
+TEST(ResourceLoaderTest, MeshLods) {
+    std::string dir = std::filesystem::temp_directory_path().string() + "/spr_mesh_lod_test/";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    std::vector<LodLayout> lods = {{0, 3000, 0.f, 0}, {3000, 900, 0.01f, 0}, {3900, 240, 0.05f, 0}};
+    writeLodModel(dir + "old.smdl", 0, {}, 4140);
+    writeLodModel(dir + "lods.smdl", SPR_MODEL_VERSION, lods, 4140);
+
+    PathMap paths;
+    paths[1] = dir + "old.smdl";
+    paths[2] = dir + "lods.smdl";
+    MetadataMap metadata;
+    ResourceLoader loader;
+    loader.updatePaths(paths);
+
+    // older files are one lod of the whole index buffer
+    Mesh oldMesh;
+    ResourceMetadata oldMetadata = {.resourceType = SPR_MESH, .resourceId = 100, .parentId = 1, .index = 0};
+    loader.loadFromMetadata<Mesh>(metadata, oldMetadata, oldMesh);
+    EXPECT_EQ(oldMesh.lodCount, 1u);
+    EXPECT_EQ(oldMesh.lods[0].firstIndex, 0u);
+    EXPECT_EQ(oldMesh.lods[0].indexCount, 4140u);
+    EXPECT_EQ(oldMesh.selectLod(1000.f, 1000.f, 1.f), 0u);
+
+    Mesh mesh;
+    ResourceMetadata lodMetadata = {.resourceType = SPR_MESH, .resourceId = 200, .parentId = 2, .index = 0};
+    loader.loadFromMetadata<Mesh>(metadata, lodMetadata, mesh);
+    ASSERT_EQ(mesh.lodCount, lods.size());
+    for (uint32 lod = 0; lod < lods.size(); lod++){
+        EXPECT_EQ(mesh.lods[lod].firstIndex, lods[lod].firstIndex);
+        EXPECT_EQ(mesh.lods[lod].indexCount, lods[lod].indexCount);
+        EXPECT_FLOAT_EQ(mesh.lods[lod].error, lods[lod].error);
+    }
+
+    // 1000 pixels per unit at distance 1, one pixel of error allowed
+    EXPECT_FLOAT_EQ(mesh.getScreenError(2, 10.f, 1000.f), 5.f);
+    EXPECT_EQ(mesh.selectLod(1.f, 1000.f, 1.f), 0u);
+    EXPECT_EQ(mesh.selectLod(20.f, 1000.f, 1.f), 1u);
+    EXPECT_EQ(mesh.selectLod(100.f, 1000.f, 1.f), 2u);
+}
+
+
+int main() {
+::testing::InitGoogleTest();
+  return RUN_ALL_TESTS();
+}
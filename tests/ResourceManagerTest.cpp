@@ -0,0 +1,626 @@
+#include <vector>
+#include <string>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <fstream>
+#include <iostream>
+#include <filesystem>
+#include "gtest/gtest.h"
+#include "../src/resource/SprResourceManager.h"
+
+using namespace spr;
+
+static const uint32 TEST_MODELS = 300;
+static const uint32 TEST_TEXTURES = 200;
+static const uint32 TEST_REGION_BYTES = 16384;
+static const uint32 TEST_TEXTURE_SIZE = 64;
+
+// one mesh, one material, no textures
+struct TestModelLayout {
+    ModelHeader header;
+    MeshLayout mesh;
+    MaterialLayout material;
+    BlobHeader blob;
+};
+
+static uint8 testByte(uint32 file, uint32 region, uint32 offset){
+    return (uint8)(file * 13 + region * 101 + offset * 7);
+}
+
+// region bytes follow testByte(file, region, offset)
+static void writeTestModel(const std::string& path, uint32 file){
+    TestModelLayout layout = {};
+    layout.header.meshCount = 1;
+    layout.header.meshBufferOffset = offsetof(TestModelLayout, mesh);
+    layout.header.materialCount = 1;
+    layout.header.materialBufferOffset = offsetof(TestModelLayout, material);
+    layout.header.textureCount = 0;
+    layout.header.textureBufferOffset = offsetof(TestModelLayout, blob);
+    layout.header.blobHeaderOffset = offsetof(TestModelLayout, blob);
+    layout.header.blobDataOffset = sizeof(TestModelLayout);
+
+    layout.mesh.indexDataSizeBytes = TEST_REGION_BYTES;
+    layout.mesh.positionDataSizeBytes = TEST_REGION_BYTES;
+    layout.mesh.attributeDataSizeBytes = TEST_REGION_BYTES;
+
+    layout.blob.sizeBytes = 3 * TEST_REGION_BYTES;
+    layout.blob.indexRegionSizeBytes = TEST_REGION_BYTES;
+    layout.blob.indexRegionOffset = sizeof(TestModelLayout);
+    layout.blob.positionRegionSizeBytes = TEST_REGION_BYTES;
+    layout.blob.positionRegionOffset = sizeof(TestModelLayout) + TEST_REGION_BYTES;
+    layout.blob.attributeRegionSizeBytes = TEST_REGION_BYTES;
+    layout.blob.attributeRegionOffset = sizeof(TestModelLayout) + 2 * TEST_REGION_BYTES;
+
+    std::vector<uint8> regions(3 * TEST_REGION_BYTES);
+    for (uint32 i = 0; i < regions.size(); i++){
+        regions[i] = testByte(file, i / TEST_REGION_BYTES, i % TEST_REGION_BYTES);
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write((const char*)&layout, sizeof(layout));
+    out.write((const char*)regions.data(), regions.size());
+}
+
+static std::string writeTestAssets(){
+    std::string dir = std::filesystem::temp_directory_path().string() + "/spr_async_load_test/";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+
+    for (uint32 file = 0; file < TEST_MODELS; file++){
+        char name[32];
+        snprintf(name, sizeof(name), "model_%03u.smdl", file);
+        writeTestModel(dir + name, file);
+    }
+
+    for (uint32 file = 0; file < TEST_TEXTURES; file++){
+        TextureLayout layout = {};
+        layout.width = TEST_TEXTURE_SIZE;
+        layout.height = TEST_TEXTURE_SIZE;
+        layout.components = 4;
+        layout.dataSizeBytes = TEST_TEXTURE_SIZE * TEST_TEXTURE_SIZE * 4;
+
+        std::vector<uint8> pixels(layout.dataSizeBytes);
+        for (uint32 i = 0; i < pixels.size(); i++){
+            pixels[i] = testByte(file, 3, i);
+        }
+
+        char name[32];
+        snprintf(name, sizeof(name), "texture_%03u.stex", file);
+        std::ofstream out(dir + name, std::ios::binary | std::ios::trunc);
+        out.write((const char*)&layout, sizeof(layout));
+        out.write((const char*)pixels.data(), pixels.size());
+    }
+    return dir;
+}
+
+// file index from the asset's name
+static uint32 fileIndex(SprResourceManager& rm, uint32 id){
+    std::string name;
+    rm.getName(id, name);
+    return std::stoul(name.substr(name.find('_') + 1));
+}
+
+static bool bufferValid(Buffer* buffer, uint32 file, uint32 region){
+    if (!buffer || buffer->data.size() == 0)
+        return false;
+    for (uint32 i = 0; i < buffer->data.size(); i++){
+        if (buffer->data.data()[i] != testByte(file, region, i))
+            return false;
+    }
+    return true;
+}
+
+// poll like a frame loop would until nothing is in flight
+static void pollAll(SprResourceManager& rm){
+    auto start = std::chrono::steady_clock::now();
+    while (rm.getPendingLoads() > 0){
+        rm.poll();
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(30));
+    }
+}
+
+
+TEST(AsyncLoaderTest, PriorityOrder) {
+    AsyncLoader loader(1);
+    std::vector<uint32> order;
+    std::atomic<bool> release = false;
+
+    // hold the only worker so the rest queue up
+    loader.submit(SPR_LOAD_PRIORITY_NORMAL, [&](bool run){
+        while (!release){
+            std::this_thread::yield();
+        }
+        loader.complete([]{});
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    uint32 priorities[] = {SPR_LOAD_PRIORITY_LOW, SPR_LOAD_PRIORITY_HIGH, SPR_LOAD_PRIORITY_NORMAL, SPR_LOAD_PRIORITY_HIGH};
+    for (uint32 i = 0; i < 4; i++){
+        loader.submit((SprLoadPriority)priorities[i], [&, i](bool run){
+            loader.complete([&, i]{ order.push_back(i); });
+        });
+    }
+    release = true;
+
+    while (loader.getPendingCount() > 0){
+        loader.poll();
+    }
+    std::vector<uint32> expected = {1, 3, 2, 0};
+    EXPECT_EQ(order, expected);
+}
+
+TEST(AsyncLoaderTest, StopFailsQueuedJobs) {
+    AsyncLoader loader(1);
+    std::vector<bool> ran(4, false);
+    std::vector<bool> completed(4, false);
+    std::atomic<bool> release = false;
+
+    for (uint32 i = 0; i < 4; i++){
+        loader.submit(SPR_LOAD_PRIORITY_NORMAL, [&, i](bool run){
+            while (i == 0 && !release){
+                std::this_thread::yield();
+            }
+            ran[i] = run;
+            loader.complete([&, i]{ completed[i] = true; });
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    // the running job finishes, the queued ones are dropped, and
+    // every completion has run once stop returns
+    std::thread releaser([&]{
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        release = true;
+    });
+    loader.stop();
+    releaser.join();
+
+    EXPECT_EQ(ran, (std::vector<bool>{true, false, false, false}));
+    EXPECT_EQ(completed, (std::vector<bool>{true, true, true, true}));
+    EXPECT_EQ(loader.getPendingCount(), 0u);
+}
+
+TEST(AsyncLoaderTest, LoadsConcurrently) {
+    std::string dir = writeTestAssets();
+    SprResourceManager rm(dir);
+    ASSERT_EQ(rm.getModelIds().size(), TEST_MODELS);
+    ASSERT_EQ(rm.getTextureIds().size(), TEST_TEXTURES);
+
+    auto start = std::chrono::steady_clock::now();
+
+    // every model and texture at once, some cancelled right away
+    std::vector<AsyncHandle<Model>> models;
+    for (uint32 i = 0; i < TEST_MODELS; i++){
+        SprLoadPriority priority = (SprLoadPriority)(i % 3);
+        models.push_back(rm.requestAsync<Model>(rm.getModelIds()[i], priority));
+        if (i % 10 == 0)
+            rm.cancel(models.back());
+    }
+    std::vector<AsyncHandle<Texture>> textures;
+    for (uint32 id : rm.getTextureIds()){
+        textures.push_back(rm.requestAsync<Texture>(id));
+    }
+    AsyncHandle<Model> missing = rm.requestAsync<Model>(99999);
+
+    // repeated requests share state
+    AsyncHandle<Model> again = rm.requestAsync<Model>(rm.getModelIds()[1]);
+    EXPECT_EQ(again.getId(), models[1].getId());
+    EXPECT_TRUE(again.isPending());
+
+    pollAll(rm);
+    EXPECT_TRUE(missing.isFailed());
+    EXPECT_TRUE(again.isReady());
+    EXPECT_EQ(again.get(), models[1].get());
+
+    // models' meshes, then their buffers, like a streaming scene would
+    std::vector<AsyncHandle<Mesh>> meshes;
+    for (uint32 i = 0; i < TEST_MODELS; i++){
+        if (i % 10 == 0){
+            EXPECT_TRUE(models[i].isCancelled());
+            continue;
+        }
+        ASSERT_TRUE(models[i].isReady());
+        Model* model = rm.getData<Model>(models[i].get());
+        ASSERT_EQ(model->meshCount, 1u);
+        meshes.push_back(rm.requestAsync<Mesh>(model->meshIds[0], SPR_LOAD_PRIORITY_HIGH));
+    }
+    pollAll(rm);
+
+    std::vector<AsyncHandle<Buffer>> buffers;
+    for (AsyncHandle<Mesh>& handle : meshes){
+        ASSERT_TRUE(handle.isReady());
+        Mesh* mesh = rm.getData<Mesh>(handle.get());
+        buffers.push_back(rm.requestAsync<Buffer>(mesh->indexBufferId));
+        buffers.push_back(rm.requestAsync<Buffer>(mesh->positionBufferId));
+        buffers.push_back(rm.requestAsync<Buffer>(mesh->attributesBufferId));
+    }
+    std::vector<AsyncHandle<Buffer>> textureBuffers;
+    for (AsyncHandle<Texture>& handle : textures){
+        ASSERT_TRUE(handle.isReady());
+        Texture* texture = rm.getData<Texture>(handle.get());
+        EXPECT_EQ(texture->width, TEST_TEXTURE_SIZE);
+        textureBuffers.push_back(rm.requestAsync<Buffer>(texture->bufferId, SPR_LOAD_PRIORITY_LOW));
+    }
+    pollAll(rm);
+
+    auto end = std::chrono::steady_clock::now();
+    uint32 requests = models.size() + textures.size() + meshes.size() + buffers.size() + textureBuffers.size();
+    std::cout << "[async] " << requests << " requests in "
+              << std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count() << " ms" << std::endl;
+
+    for (uint32 i = 0; i < buffers.size(); i++){
+        ASSERT_TRUE(buffers[i].isReady());
+        Buffer* buffer = rm.getData<Buffer>(buffers[i].get());
+        EXPECT_TRUE(bufferValid(buffer, fileIndex(rm, buffer->parentId), i % 3));
+    }
+    for (AsyncHandle<Buffer>& handle : textureBuffers){
+        ASSERT_TRUE(handle.isReady());
+        Buffer* buffer = rm.getData<Buffer>(handle.get());
+        EXPECT_TRUE(bufferValid(buffer, fileIndex(rm, buffer->parentId), 3));
+    }
+
+    // sync access sees async results
+    Handle<Buffer> handle = rm.getHandle<Buffer>(buffers[0].getId());
+    EXPECT_EQ(handle, buffers[0].get());
+}
+
+TEST(AsyncLoaderTest, DisableFailsPending) {
+    std::string dir = writeTestAssets();
+    SprResourceManager rm(dir);
+
+    std::vector<AsyncHandle<Model>> models;
+    for (uint32 id : rm.getModelIds()){
+        models.push_back(rm.requestAsync<Model>(id));
+    }
+    rm.disableLoader();
+
+    // nothing is left waiting, whatever didn't load failed
+    EXPECT_EQ(rm.getPendingLoads(), 0u);
+    for (AsyncHandle<Model>& handle : models){
+        EXPECT_TRUE(handle.isReady() || handle.isFailed());
+    }
+}
+
+TEST(ResourceCacheTest, StreamsPastBudget) {
+    std::string dir = writeTestAssets();
+    SprResourceManager rm(dir);
+
+    // every mesh buffer, ~15MB
+    std::vector<uint32> bufferIds;
+    std::vector<uint32> files;
+    for (uint32 modelId : rm.getModelIds()){
+        Model* model = rm.getData<Model>(modelId);
+        Mesh* mesh = rm.getData<Mesh>(model->meshIds[0]);
+        bufferIds.insert(bufferIds.end(), {mesh->indexBufferId, mesh->positionBufferId, mesh->attributesBufferId});
+        files.insert(files.end(), 3, fileIndex(rm, modelId));
+    }
+
+    uint64 budget = 1 << 20;
+    rm.setBudget<Buffer>(budget);
+
+    Handle<Buffer> pinned = rm.getHandle<Buffer>(bufferIds[0]);
+    rm.pin(pinned);
+
+    for (uint32 pass = 0; pass < 3; pass++){
+        for (uint32 i = 0; i < bufferIds.size(); i++){
+            Buffer* buffer = rm.getData<Buffer>(bufferIds[i]);
+            ASSERT_TRUE(bufferValid(buffer, files[i], i % 3));
+            ASSERT_LE(rm.getCacheStats<Buffer>().residentBytes, budget);
+        }
+    }
+
+    CacheStats stats = rm.getCacheStats<Buffer>();
+    std::cout << "[cache] " << stats.loads << " loads, " << stats.evictions << " evictions, "
+              << stats.reloads << " reloads, " << stats.residentBytes << " bytes resident" << std::endl;
+    EXPECT_EQ(stats.budgetBytes, budget);
+    EXPECT_GT(stats.evictions, 2 * bufferIds.size());
+    EXPECT_GT(stats.reloads, bufferIds.size());
+    EXPECT_EQ(stats.loads - stats.evictions, stats.resident);
+
+    // pinned data outlives every pass
+    EXPECT_TRUE(bufferValid(rm.getData<Buffer>(pinned), files[0], 0));
+    rm.unpin(pinned);
+}
+
+TEST(ResourceCacheTest, GlobalBudget) {
+    std::string dir = writeTestAssets();
+    SprResourceManager rm(dir);
+
+    uint64 budget = 2 << 20;
+    rm.setBudget(budget);
+
+    // models, meshes and buffers share the budget
+    for (uint32 pass = 0; pass < 2; pass++){
+        for (uint32 modelId : rm.getModelIds()){
+            Model* model = rm.getData<Model>(modelId);
+            ASSERT_NE(model, nullptr);
+            Mesh* mesh = rm.getData<Mesh>(model->meshIds[0]);
+            ASSERT_NE(mesh, nullptr);
+
+            uint32 file = fileIndex(rm, modelId);
+            EXPECT_TRUE(bufferValid(rm.getData<Buffer>(mesh->indexBufferId), file, 0));
+            EXPECT_TRUE(bufferValid(rm.getData<Buffer>(mesh->positionBufferId), file, 1));
+            EXPECT_TRUE(bufferValid(rm.getData<Buffer>(mesh->attributesBufferId), file, 2));
+            ASSERT_LE(rm.getCacheStats().residentBytes, budget);
+        }
+    }
+
+    CacheStats stats = rm.getCacheStats();
+    EXPECT_EQ(stats.budgetBytes, budget);
+    EXPECT_GT(stats.evictions, 0u);
+    EXPECT_GT(rm.getCacheStats<Buffer>().reloads, 0u);
+}
+
+TEST(ResourceCacheTest, BatchLookup) {
+    std::string dir = writeTestAssets();
+    SprResourceManager rm(dir);
+
+    // mesh ids of 50k model instances
+    std::vector<uint32> meshIds;
+    for (uint32 modelId : rm.getModelIds()){
+        meshIds.push_back(rm.getData<Model>(modelId)->meshIds[0]);
+    }
+    std::vector<uint32> instances;
+    for (uint32 i = 0; i < 50000; i++){
+        instances.push_back(meshIds[(i * 7) % meshIds.size()]);
+    }
+
+    std::vector<Mesh*> single(instances.size());
+    std::vector<Mesh*> batched(instances.size());
+    auto start = std::chrono::steady_clock::now();
+    for (uint32 i = 0; i < instances.size(); i++){
+        single[i] = rm.getData<Mesh>(instances[i]);
+    }
+    auto singleEnd = std::chrono::steady_clock::now();
+    rm.getData<Mesh>(instances, batched.data());
+    auto batchEnd = std::chrono::steady_clock::now();
+
+    std::cout << "[cache] " << instances.size() << " mesh lookups single: "
+              << std::chrono::duration<double, std::milli>(singleEnd - start).count() << " ms, batched: "
+              << std::chrono::duration<double, std::milli>(batchEnd - singleEnd).count() << " ms" << std::endl;
+    EXPECT_EQ(single, batched);
+
+    // batch larger than the budget, every pointer is still valid
+    std::vector<uint32> bufferIds;
+    std::vector<uint32> files;
+    for (uint32 modelId : rm.getModelIds()){
+        bufferIds.push_back(rm.getData<Mesh>(rm.getData<Model>(modelId)->meshIds[0])->positionBufferId);
+        files.push_back(fileIndex(rm, modelId));
+    }
+    rm.setBudget<Buffer>(1 << 18);
+    std::vector<Buffer*> buffers(bufferIds.size());
+    rm.getData<Buffer>(bufferIds, buffers.data());
+    for (uint32 i = 0; i < buffers.size(); i++){
+        ASSERT_TRUE(bufferValid(buffers[i], files[i], 1));
+    }
+
+    // and the budget applies again from the next load
+    rm.getData<Buffer>(rm.getData<Texture>(rm.getTextureIds()[0])->bufferId);
+    EXPECT_LE(rm.getCacheStats<Buffer>().residentBytes, 1u << 18);
+}
+
+TEST(ResourceCacheTest, HandleLookupsAlongsideLoads) {
+    std::string dir = writeTestAssets();
+    SprResourceManager rm(dir);
+    std::vector<uint32>& modelIds = rm.getModelIds();
+    rm.setBudget<Model>(64 * sizeof(Model));
+
+    std::vector<Handle<Model>> handles;
+    for (uint32 i = 0; i < 32; i++){
+        handles.push_back(rm.getHandle<Model>(modelIds[i]));
+    }
+
+    // handle lookups touch the lru list while loads evict from it
+    std::thread loader([&]{
+        for (uint32 pass = 0; pass < 4; pass++){
+            for (uint32 id : modelIds){
+                ASSERT_NE(rm.getData<Model>(id), nullptr);
+            }
+        }
+    });
+    for (uint32 pass = 0; pass < 200; pass++){
+        for (Handle<Model>& handle : handles){
+            rm.getData<Model>(handle);
+        }
+    }
+    loader.join();
+
+    CacheStats stats = rm.getCacheStats<Model>();
+    EXPECT_GT(stats.evictions, 0u);
+    EXPECT_EQ(stats.loads - stats.evictions, stats.resident);
+    EXPECT_LE(stats.resident, 64u);
+}
+
+TEST(ResourceRefTest, ReleasesAtSafePoint) {
+    std::string dir = writeTestAssets();
+    SprResourceManager rm(dir);
+    std::vector<uint32>& modelIds = rm.getModelIds();
+
+    ResourceRef<Model> model = rm.acquire<Model>(modelIds[0]);
+    ASSERT_TRUE(model.isValid());
+    EXPECT_EQ(rm.getData(model)->resourceId, modelIds[0]);
+    EXPECT_FALSE(rm.acquire<Model>(99999).isValid());
+
+    // repeated acquires share a count
+    ResourceRef<Model> again = rm.acquire<Model>(modelIds[0]);
+    EXPECT_EQ(again.getCount(), 2u);
+    EXPECT_EQ(again.getHandle(), model.getHandle());
+
+    // still referenced, nothing to release
+    again.reset();
+    EXPECT_EQ(rm.releaseUnused(), 0u);
+    EXPECT_EQ(rm.getCacheStats<Model>().resident, 1u);
+
+    // dropped, then acquired again before the safe point
+    model.reset();
+    model = rm.acquire<Model>(modelIds[0]);
+    EXPECT_EQ(rm.releaseUnused(), 0u);
+    EXPECT_TRUE(rm.getData(model) != nullptr);
+
+    // dropped for good, released in one batch
+    model.reset();
+    EXPECT_EQ(rm.getCacheStats<Model>().resident, 1u);
+    EXPECT_EQ(rm.releaseUnused(), 1u);
+    EXPECT_EQ(rm.getCacheStats<Model>().resident, 0u);
+
+    // pinned by hand as well, outlives its last ref until unpinned
+    model = rm.acquire<Model>(modelIds[1]);
+    Handle<Model> pinned = model.getHandle();
+    rm.pin(pinned);
+    model.reset();
+    EXPECT_EQ(rm.releaseUnused(), 0u);
+    EXPECT_EQ(rm.getData<Model>(pinned)->resourceId, modelIds[1]);
+    rm.unpin(pinned);
+    model = rm.acquire<Model>(modelIds[1]);
+    EXPECT_EQ(model.getHandle(), pinned);
+    model.reset();
+    EXPECT_EQ(rm.releaseUnused(), 1u);
+    EXPECT_EQ(rm.getCacheStats<Model>().resident, 0u);
+
+    // referenced buffers survive a budget, refs drop on other threads
+    rm.setBudget<Buffer>(1 << 18);
+    std::vector<ResourceRef<Buffer>> refs;
+    std::vector<uint32> files;
+    for (uint32 i = 0; i < 60; i++){
+        Model* data = rm.getData<Model>(modelIds[i]);
+        Mesh* mesh = rm.getData<Mesh>(data->meshIds[0]);
+        refs.push_back(rm.acquire<Buffer>(mesh->positionBufferId));
+        files.push_back(fileIndex(rm, modelIds[i]));
+    }
+    for (uint32 i = 0; i < refs.size(); i++){
+        EXPECT_TRUE(bufferValid(rm.getData(refs[i]), files[i], 1));
+    }
+    EXPECT_GT(rm.getCacheStats<Buffer>().residentBytes, 1u << 18);
+
+    std::vector<std::thread> threads;
+    for (uint32 t = 0; t < 4; t++){
+        threads.emplace_back([&refs, t]{
+            for (uint32 i = t; i < refs.size(); i += 4){
+                ResourceRef<Buffer> copy = refs[i];
+                refs[i].reset();
+            }
+        });
+    }
+    for (std::thread& thread : threads){
+        thread.join();
+    }
+    EXPECT_EQ(rm.releaseUnused(), 60u);
+    EXPECT_EQ(rm.getCacheStats<Buffer>().resident, 0u);
+}
+
+TEST(ResourceRefTest, DropsRacingSafePoints) {
+    std::string dir = writeTestAssets();
+    SprResourceManager rm(dir);
+    std::vector<uint32>& modelIds = rm.getModelIds();
+
+    // last refs drop on a worker while the main thread acquires the
+    // same ids again and releases at safe points
+    std::mutex mutex;
+    std::vector<ResourceRef<Model>> handoff;
+    std::atomic<bool> done = false;
+    std::thread dropper([&]{
+        std::vector<ResourceRef<Model>> refs;
+        while (!done){
+            refs.clear();
+            std::lock_guard<std::mutex> lock(mutex);
+            refs.swap(handoff);
+        }
+    });
+
+    for (uint32 i = 0; i < 20000; i++){
+        ResourceRef<Model> ref = rm.acquire<Model>(modelIds[i % 4]);
+        ASSERT_TRUE(ref.isValid());
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            handoff.push_back(ref);
+        }
+        ref.reset();
+        rm.releaseUnused();
+    }
+    done = true;
+    dropper.join();
+    handoff.clear();
+
+    rm.releaseUnused();
+    EXPECT_EQ(rm.getCacheStats<Model>().resident, 0u);
+}
+
+// poll until count assets reloaded
+static void waitForReloads(SprResourceManager& rm, std::vector<uint32>& reloaded, uint32 count){
+    auto start = std::chrono::steady_clock::now();
+    while (reloaded.size() < count){
+        rm.poll();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        ASSERT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(5));
+    }
+    pollAll(rm);
+}
+
+// like editors do, write next to it and rename over
+static void saveTestModel(const std::string& path, uint32 file){
+    writeTestModel(path + ".tmp", file);
+    std::filesystem::rename(path + ".tmp", path);
+}
+
+TEST(HotReloadTest, SwapsChangedAssets) {
+    std::string dir = writeTestAssets();
+    SprResourceManager rm(dir);
+    ASSERT_TRUE(rm.enableHotReload());
+
+    std::vector<uint32> reloaded;
+    rm.setReloadCallback([&](uint32 assetId){ reloaded.push_back(assetId); });
+
+    uint32 modelId = rm.getModelIds()[3];
+    Mesh* mesh = rm.getData<Mesh>(rm.getData<Model>(modelId)->meshIds[0]);
+    uint32 positionId = mesh->positionBufferId;
+    uint32 attributesId = mesh->attributesBufferId;
+    Handle<Buffer> position = rm.getHandle<Buffer>(positionId);
+    ASSERT_TRUE(bufferValid(rm.getData<Buffer>(position), 3, 1));
+
+    saveTestModel(dir + "model_003.smdl", 1003);
+    std::ofstream(dir + "notes.txt") << "not an asset";
+    waitForReloads(rm, reloaded, 1);
+    EXPECT_EQ(reloaded, std::vector<uint32>{modelId});
+
+    // same handle and ids, new data
+    EXPECT_EQ(rm.getHandle<Buffer>(positionId), position);
+    EXPECT_TRUE(bufferValid(rm.getData<Buffer>(position), 1003, 1));
+    mesh = rm.getData<Mesh>(rm.getData<Model>(modelId)->meshIds[0]);
+    EXPECT_EQ(mesh->positionBufferId, positionId);
+
+    // resources loaded afterwards come from the new file too
+    EXPECT_TRUE(bufferValid(rm.getData<Buffer>(attributesId), 1003, 2));
+
+    // saved twice, the latest save wins
+    reloaded.clear();
+    saveTestModel(dir + "model_003.smdl", 2003);
+    saveTestModel(dir + "model_003.smdl", 3003);
+    waitForReloads(rm, reloaded, 1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    rm.poll();
+    pollAll(rm);
+    EXPECT_TRUE(bufferValid(rm.getData<Buffer>(position), 3003, 1));
+    EXPECT_TRUE(bufferValid(rm.getData<Buffer>(attributesId), 3003, 2));
+
+    // other assets are left alone
+    Mesh* other = rm.getData<Mesh>(rm.getData<Model>(rm.getModelIds()[4])->meshIds[0]);
+    EXPECT_TRUE(bufferValid(rm.getData<Buffer>(other->indexBufferId), 4, 0));
+
+    // loader stopped, changes are dropped rather than restarting it
+    reloaded.clear();
+    rm.disableLoader();
+    saveTestModel(dir + "model_003.smdl", 4003);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    rm.poll();
+    EXPECT_TRUE(reloaded.empty());
+    EXPECT_EQ(rm.getPendingLoads(), 0u);
+}
+
+
+int main() {
+::testing::InitGoogleTest();
+  return RUN_ALL_TESTS();
+}
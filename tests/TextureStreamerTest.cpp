@@ -0,0 +1,389 @@
+#include <vector>
+#include <cstring>
+#include "gtest/gtest.h"
+#include "../src/render/scene/TextureStreamer.h"
+
+using namespace spr;
+using namespace spr::gfx;
+
+typedef struct {
+    uint32 texture;
+    uint32 firstMip;
+    uint32 lastMip;
+} MipRange;
+
+class FakeUploader : public TextureUploader {
+public:
+    TextureStreamer* streamer = nullptr;   // completes uploads right away if set
+    std::vector<MipRange> uploads;
+    std::vector<MipRange> evictions;
+
+    void upload(uint32 texture, uint32 firstMip, uint32 lastMip) override {
+        uploads.push_back({texture, firstMip, lastMip});
+        if (streamer)
+            streamer->completeUpload(texture, firstMip);
+    }
+
+    void evict(uint32 texture, uint32 firstMip, uint32 lastMip) override {
+        evictions.push_back({texture, firstMip, lastMip});
+    }
+};
+
+// bc7-like chain for a square texture, 16 bytes per 4x4 block
+std::vector<uint64> mipChain(uint32 size){
+    std::vector<uint64> mips;
+    for (uint32 width = size; width > 0; width /= 2){
+        uint64 blocks = std::max(1u, width / 4);
+        mips.push_back(blocks * blocks * 16);
+    }
+    return mips;
+}
+
+uint64 chainBytes(std::vector<uint64>& mips, uint32 firstMip){
+    uint64 bytes = 0;
+    for (uint32 mip = firstMip; mip < mips.size(); mip++){
+        bytes += mips[mip];
+    }
+    return bytes;
+}
+
+TEST(TextureStreamerTest, TailFirst) {
+    FakeUploader uploader;
+    TextureStreamer streamer(&uploader, 64 * 1024 * 1024);
+    uploader.streamer = &streamer;
+
+    std::vector<uint64> mips = mipChain(2048);
+    uint32 texture = streamer.addTexture(mips);
+
+    // 2048 -> 12 mips, 256x256 (64KB) and coarser are the tail
+    ASSERT_EQ(streamer.getTailMip(texture), 3);
+    ASSERT_EQ(uploader.uploads.size(), 1);
+    ASSERT_EQ(uploader.uploads[0].firstMip, 3);
+    ASSERT_EQ(uploader.uploads[0].lastMip, 11);
+    ASSERT_EQ(streamer.getResidentMip(texture), 3);
+    ASSERT_EQ(streamer.getStats().residentBytes, chainBytes(mips, 3));
+
+    // nothing requested, nothing streamed
+    streamer.update();
+    ASSERT_EQ(uploader.uploads.size(), 1);
+}
+
+TEST(TextureStreamerTest, UpgradesOneMipPerUpdate) {
+    FakeUploader uploader;
+    TextureStreamer streamer(&uploader, 64 * 1024 * 1024);
+    uploader.streamer = &streamer;
+
+    std::vector<uint64> mips = mipChain(2048);
+    uint32 texture = streamer.addTexture(mips);
+
+    for (uint32 expected = 2; expected != UINT32_MAX; expected--){
+        streamer.request(texture, 0);
+        streamer.update();
+        ASSERT_EQ(streamer.getResidentMip(texture), expected);
+    }
+    ASSERT_EQ(streamer.getStats().residentBytes, chainBytes(mips, 0));
+
+    // the finest request of an update wins
+    std::vector<uint64> small = mipChain(1024);
+    uint32 other = streamer.addTexture(small);
+    streamer.request(other, 2);
+    streamer.request(other, 1);
+    streamer.update();
+    streamer.request(other, 2);
+    streamer.request(other, 1);
+    streamer.update();
+    ASSERT_EQ(streamer.getResidentMip(other), 1);
+}
+
+TEST(TextureStreamerTest, StaysInBudget) {
+    FakeUploader uploader;
+    std::vector<uint64> mips = mipChain(2048);
+    uint64 tails = 20 * chainBytes(mips, 3);
+    uint64 budget = tails + 3 * chainBytes(mips, 0) + 1024 * 1024;
+
+    TextureStreamer streamer(&uploader, budget);
+    uploader.streamer = &streamer;
+    for (uint32 i = 0; i < 20; i++){
+        streamer.addTexture(mips);
+    }
+
+    // three fit at full resolution
+    for (uint32 update = 0; update < 8; update++){
+        for (uint32 texture = 0; texture < 3; texture++){
+            streamer.request(texture, 0);
+        }
+        streamer.update();
+        ASSERT_LE(streamer.getStats().residentBytes, budget);
+    }
+    for (uint32 texture = 0; texture < 3; texture++){
+        ASSERT_EQ(streamer.getResidentMip(texture), 0);
+    }
+    ASSERT_EQ(uploader.evictions.size(), 0);
+
+    // the view moves on, the new set displaces the old one
+    for (uint32 update = 0; update < 8; update++){
+        for (uint32 texture = 3; texture < 6; texture++){
+            streamer.request(texture, 0);
+        }
+        streamer.update();
+        ASSERT_LE(streamer.getStats().residentBytes, budget);
+    }
+    for (uint32 texture = 3; texture < 6; texture++){
+        ASSERT_EQ(streamer.getResidentMip(texture), 0);
+    }
+    for (uint32 texture = 0; texture < 3; texture++){
+        ASSERT_GT(streamer.getResidentMip(texture), 0);
+    }
+    ASSERT_GT(uploader.evictions.size(), 0);
+
+    // lowering the budget drops everything but the tails
+    streamer.setBudget(tails);
+    streamer.update();
+    StreamingStats stats = streamer.getStats();
+    ASSERT_EQ(stats.residentBytes, tails);
+    for (uint32 texture = 0; texture < 20; texture++){
+        ASSERT_EQ(streamer.getResidentMip(texture), 3);
+    }
+}
+
+TEST(TextureStreamerTest, EvictsExcessMipsFirst) {
+    FakeUploader uploader;
+    std::vector<uint64> mips = mipChain(2048);
+    uint64 budget = 3 * chainBytes(mips, 3) + 2 * (chainBytes(mips, 0) - chainBytes(mips, 3)) + 16 * 1024;
+
+    TextureStreamer streamer(&uploader, budget);
+    uploader.streamer = &streamer;
+    uint32 near = streamer.addTexture(mips);
+    uint32 next = streamer.addTexture(mips);
+    uint32 old = streamer.addTexture(mips);
+
+    for (uint32 update = 0; update < 3; update++){
+        streamer.request(old, 0);
+        streamer.update();
+    }
+    for (uint32 update = 0; update < 3; update++){
+        streamer.request(near, 0);
+        streamer.update();
+    }
+    ASSERT_EQ(streamer.getResidentMip(old), 0);
+    ASSERT_EQ(streamer.getResidentMip(near), 0);
+
+    // near only needs mip 2 now, its mip 0 goes before old's
+    streamer.request(near, 2);
+    streamer.request(next, 0);
+    streamer.update();
+    ASSERT_EQ(uploader.evictions.size(), 1);
+    ASSERT_EQ(uploader.evictions[0].texture, near);
+    ASSERT_EQ(uploader.evictions[0].firstMip, 0);
+    ASSERT_EQ(streamer.getResidentMip(old), 0);
+    ASSERT_EQ(streamer.getResidentMip(next), 2);
+}
+
+TEST(TextureStreamerTest, UploadBandwidth) {
+    FakeUploader uploader;
+    TextureStreamer streamer(&uploader, 64 * 1024 * 1024, 1024 * 1024);
+    uploader.streamer = &streamer;
+
+    std::vector<uint64> mips = mipChain(2048);
+    uint32 first = streamer.addTexture(mips);
+    uint32 second = streamer.addTexture(mips);
+
+    // two 256KB mips fit, then only one of the 1MB mips
+    streamer.request(first, 0);
+    streamer.request(second, 0);
+    streamer.update();
+    ASSERT_EQ(streamer.getResidentMip(first), 2);
+    ASSERT_EQ(streamer.getResidentMip(second), 2);
+
+    streamer.request(first, 0);
+    streamer.request(second, 0);
+    streamer.update();
+    ASSERT_EQ(streamer.getResidentMip(first) + streamer.getResidentMip(second), 3);
+
+    // 4MB mips are over the limit but still stream, one per update
+    for (uint32 update = 0; update < 4; update++){
+        streamer.request(first, 0);
+        streamer.request(second, 0);
+        streamer.update();
+    }
+    ASSERT_EQ(streamer.getResidentMip(first), 0);
+    ASSERT_EQ(streamer.getResidentMip(second), 0);
+}
+
+TEST(TextureStreamerTest, DelayedCompletion) {
+    FakeUploader uploader;
+    TextureStreamer streamer(&uploader, 64 * 1024 * 1024);
+
+    std::vector<uint64> mips = mipChain(2048);
+    uint32 texture = streamer.addTexture(mips);
+    ASSERT_EQ(streamer.getResidentMip(texture), mips.size());
+    ASSERT_EQ(streamer.getStats().pendingBytes, chainBytes(mips, 3));
+    streamer.completeUpload(texture, 3);
+    ASSERT_EQ(streamer.getStats().pendingBytes, 0);
+
+    streamer.request(texture, 0);
+    streamer.update();
+    ASSERT_EQ(uploader.uploads.size(), 2);
+    ASSERT_EQ(streamer.getStats().pendingBytes, mips[2]);
+
+    // in flight, no more uploads until it lands
+    streamer.request(texture, 0);
+    streamer.update();
+    ASSERT_EQ(uploader.uploads.size(), 2);
+    ASSERT_EQ(streamer.getResidentMip(texture), 3);
+
+    streamer.completeUpload(texture, 2);
+    ASSERT_EQ(streamer.getResidentMip(texture), 2);
+    ASSERT_EQ(streamer.getStats().pendingBytes, 0);
+    ASSERT_EQ(streamer.getStats().residentBytes, chainBytes(mips, 2));
+
+    streamer.request(texture, 0);
+    streamer.update();
+    ASSERT_EQ(uploader.uploads.size(), 3);
+    ASSERT_EQ(uploader.uploads[2].firstMip, 1);
+}
+
+TEST(TextureStreamerTest, ReadsKtx2LevelIndex) {
+    static const uint8 identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+    std::vector<MipLevel> expected = {
+        {.byteOffset = 1024, .byteLength = 4096, .uncompressedByteLength = 4096},
+        {.byteOffset = 512, .byteLength = 1024, .uncompressedByteLength = 1024},
+        {.byteOffset = 256, .byteLength = 256, .uncompressedByteLength = 256}
+    };
+
+    std::vector<uint8> file(80 + expected.size() * sizeof(MipLevel), 0);
+    uint32 levelCount = expected.size();
+    memcpy(file.data(), identifier, sizeof(identifier));
+    memcpy(file.data() + 40, &levelCount, sizeof(uint32));
+    memcpy(file.data() + 80, expected.data(), expected.size() * sizeof(MipLevel));
+
+    std::vector<MipLevel> levels;
+    ASSERT_TRUE(TextureStreamer::readMipLevels(file.data(), file.size(), levels));
+    ASSERT_EQ(levels.size(), expected.size());
+    for (uint32 i = 0; i < levels.size(); i++){
+        ASSERT_EQ(levels[i].byteOffset, expected[i].byteOffset);
+        ASSERT_EQ(levels[i].byteLength, expected[i].byteLength);
+    }
+
+    // truncated level index
+    ASSERT_FALSE(TextureStreamer::readMipLevels(file.data(), file.size() - 1, levels));
+
+    file[1] = 'X';
+    ASSERT_FALSE(TextureStreamer::readMipLevels(file.data(), file.size(), levels));
+}
+
+// 2d ktx2 file of levels 8x8 and coarser, level data filled with the
+// level's number. dfd/kvd/sgd are placeholder bytes of the given lengths
+std::vector<uint8> ktx2File(uint32 scheme, uint32 bytesPlane0, std::vector<uint8> sgd){
+    static const uint8 identifier[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+    const uint32 levelCount = 4;
+    std::vector<uint8> dfd(44, 0xDF);
+    dfd[20] = bytesPlane0;
+    std::vector<uint8> kvd(12, 0xCD);
+
+    std::vector<uint8> file(80 + levelCount * sizeof(MipLevel), 0);
+    uint32 header[13] = {9, 1, 8, 8, 0, 0, 1, levelCount, scheme, 0, (uint32)dfd.size(), 0, (uint32)kvd.size()};
+    header[9] = file.size();
+    file.insert(file.end(), dfd.begin(), dfd.end());
+    header[11] = file.size();
+    file.insert(file.end(), kvd.begin(), kvd.end());
+    file.resize((file.size() + 7) / 8 * 8, 0);
+    uint64 sgdRange[2] = {sgd.empty() ? 0 : file.size(), sgd.size()};
+    file.insert(file.end(), sgd.begin(), sgd.end());
+
+    MipLevel levels[levelCount];
+    for (uint32 mip = levelCount; mip-- > 0;){
+        uint32 width = 8 >> mip;
+        file.resize((file.size() + 3) / 4 * 4, 0);
+        levels[mip] = {file.size(), width * width, width * width};
+        file.insert(file.end(), width * width, (uint8)mip);
+    }
+
+    memcpy(file.data(), identifier, sizeof(identifier));
+    memcpy(file.data() + 12, header, sizeof(header));
+    memcpy(file.data() + 64, sgdRange, sizeof(sgdRange));
+    memcpy(file.data() + 80, levels, sizeof(levels));
+    return file;
+}
+
+TEST(TextureStreamerTest, ExtractsKtx2Mips) {
+    std::vector<uint8> file = ktx2File(0, 3, {});
+    std::vector<uint8> mips;
+    ASSERT_TRUE(TextureStreamer::extractMips(file.data(), file.size(), 1, 2, mips));
+
+    uint32 header[13];
+    memcpy(header, mips.data() + 12, sizeof(header));
+    ASSERT_EQ(header[2], 4);    // width
+    ASSERT_EQ(header[3], 4);    // height
+    ASSERT_EQ(header[7], 2);    // levels
+    ASSERT_EQ(memcmp(mips.data() + header[9], file.data() + 80 + 4 * sizeof(MipLevel), header[10]), 0);
+
+    std::vector<MipLevel> levels;
+    ASSERT_TRUE(TextureStreamer::readMipLevels(mips.data(), mips.size(), levels));
+    ASSERT_EQ(levels.size(), 2);
+    for (uint32 i = 0; i < levels.size(); i++){
+        uint32 width = 4 >> i;
+        ASSERT_EQ(levels[i].byteLength, width * width);
+        ASSERT_EQ(levels[i].byteOffset % 12, 0);    // lcm of the 3 byte texel and 4
+        for (uint32 byte = 0; byte < levels[i].byteLength; byte++){
+            ASSERT_EQ(mips[levels[i].byteOffset + byte], i + 1);
+        }
+    }
+    // coarsest first
+    ASSERT_LT(levels[1].byteOffset, levels[0].byteOffset);
+
+    ASSERT_FALSE(TextureStreamer::extractMips(file.data(), file.size(), 2, 4, mips));
+    ASSERT_FALSE(TextureStreamer::extractMips(file.data(), file.size(), 2, 1, mips));
+}
+
+TEST(TextureStreamerTest, ExtractsBasisLzImageDescs) {
+    // header, one image desc per level, then 8 bytes of codebooks
+    std::vector<uint8> sgd(20 + 4 * 20 + 8, 0xCB);
+    for (uint32 mip = 0; mip < 4; mip++){
+        memset(sgd.data() + 20 + mip * 20, mip, 20);
+    }
+    std::vector<uint8> file = ktx2File(1, 0, sgd);
+
+    std::vector<uint8> mips;
+    ASSERT_TRUE(TextureStreamer::extractMips(file.data(), file.size(), 2, 3, mips));
+
+    uint64 sgdRange[2];
+    memcpy(sgdRange, mips.data() + 64, sizeof(sgdRange));
+    ASSERT_EQ(sgdRange[0] % 8, 0);
+    ASSERT_EQ(sgdRange[1], 20 + 2 * 20 + 8);
+    const uint8* sgdOut = mips.data() + sgdRange[0];
+    ASSERT_EQ(memcmp(sgdOut, sgd.data(), 20), 0);
+    ASSERT_EQ(sgdOut[20], 2);
+    ASSERT_EQ(sgdOut[40], 3);
+    ASSERT_EQ(memcmp(sgdOut + 60, sgd.data() + 100, 8), 0);
+
+    std::vector<MipLevel> levels;
+    ASSERT_TRUE(TextureStreamer::readMipLevels(mips.data(), mips.size(), levels));
+    ASSERT_EQ(levels.size(), 2);
+    ASSERT_EQ(mips[levels[0].byteOffset], 2);
+    ASSERT_EQ(mips[levels[1].byteOffset], 3);
+
+    // an sgd without every level's image desc isn't basis lz
+    sgd.resize(20 + 3 * 20);
+    file = ktx2File(1, 0, sgd);
+    ASSERT_FALSE(TextureStreamer::extractMips(file.data(), file.size(), 2, 3, mips));
+}
+
+TEST(TextureStreamerTest, TailOverride) {
+    FakeUploader uploader;
+    TextureStreamer streamer(&uploader, 64 * 1024 * 1024);
+    uploader.streamer = &streamer;
+
+    // a tail loaded before the exact sizes were known
+    std::vector<uint64> mips = mipChain(2048);
+    ASSERT_EQ(TextureStreamer::getTailMip(mips), 3);
+    uint32 texture = streamer.addTexture(mips, 4);
+    ASSERT_EQ(streamer.getTailMip(texture), 4);
+    ASSERT_EQ(uploader.uploads[0].firstMip, 4);
+    ASSERT_EQ(streamer.getStats().residentBytes, chainBytes(mips, 4));
+}
+
+int main() {
+    ::testing::InitGoogleTest();
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,139 @@
+#include <vector>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <memory>
+#include <fstream>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <iterator>
+#include <algorithm>
+#include <filesystem>
+#include "gtest/gtest.h"
+#include "../src/render/vulkan/TextureTranscoder.h"
+
+using namespace spr;
+using namespace spr::gfx;
+
+// directory of .ktx2 files, SPR_KTX2_DIR or the repo's textures
+static std::vector<std::vector<uint8>> loadKtx2Files(){
+    const char* env = std::getenv("SPR_KTX2_DIR");
+    std::string dir = env ? env : "../data/textures/";
+
+    std::vector<std::filesystem::path> paths;
+    std::error_code error;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(dir, error)){
+        if (entry.is_regular_file() && entry.path().extension() == ".ktx2")
+            paths.push_back(entry.path());
+    }
+    std::sort(paths.begin(), paths.end());
+
+    std::vector<std::vector<uint8>> files;
+    for (const auto& path : paths){
+        std::ifstream in(path, std::ios::binary);
+        files.emplace_back(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+    return files;
+}
+
+static uint64 hashBytes(const uint8* data, uint32 size){
+    uint64 value = 14695981039346656037ull;
+    for (uint32 i = 0; i < size; i++){
+        value ^= data[i];
+        value *= 1099511628211ull;
+    }
+    return value;
+}
+
+// transcode every file with threadCount threads (caller included),
+// returns ms and a hash per file so thread counts can be compared
+static double transcodeAll(TextureTranscoder& transcoder, std::vector<std::vector<uint8>>& files,
+                           uint32 threadCount, std::vector<uint64>& hashes){
+    std::unique_ptr<ThreadPool> pool;
+    if (threadCount > 1)
+        pool = std::make_unique<ThreadPool>(threadCount - 1);
+
+    std::vector<TranscodeJob> jobs(files.size());
+    for (uint32 i = 0; i < files.size(); i++){
+        jobs[i].data = files[i].data();
+        jobs[i].size = files[i].size();
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    transcoder.transcode(jobs.data(), jobs.size(), pool.get());
+    auto end = std::chrono::steady_clock::now();
+
+    hashes.resize(files.size());
+    for (uint32 i = 0; i < jobs.size(); i++){
+        TranscodeResult& result = jobs[i].result;
+        EXPECT_EQ(result.error, KTX_SUCCESS) << "file " << i << ": " << ktxErrorString(result.error);
+        if (result.error != KTX_SUCCESS){
+            hashes[i] = 0;
+            continue;
+        }
+        hashes[i] = hashBytes(ktxTexture_GetData(ktxTexture(result.texture)), result.sizeBytes);
+        transcoder.destroyTexture(result);
+    }
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+TEST(TextureTranscodeBenchmark, ThreadScaling) {
+    std::vector<std::vector<uint8>> files = loadKtx2Files();
+    if (files.empty())
+        GTEST_SKIP() << "no .ktx2 files, set SPR_KTX2_DIR";
+
+    uint32 maxThreads = std::max(1u, std::thread::hardware_concurrency());
+
+    struct Target {
+        const char* name;
+        ktx_texture_transcode_fmt_e format;
+    };
+    Target targets[] = {
+        {"BC7", KTX_TTF_BC7_RGBA},
+        {"ASTC", KTX_TTF_ASTC_4x4_RGBA},
+    };
+
+    for (Target& target : targets){
+        TextureTranscoder transcoder(target.format, target.format);
+
+        std::vector<uint64> expected;
+        double serialMs = transcodeAll(transcoder, files, 1, expected);
+        std::cout << "[transcode] " << target.name << " " << files.size() << " files, 1 thread: "
+                  << serialMs << " ms" << std::endl;
+
+        for (uint32 threads = 2; threads <= maxThreads; threads *= 2){
+            std::vector<uint64> hashes;
+            double ms = transcodeAll(transcoder, files, threads, hashes);
+            std::cout << "[transcode] " << target.name << " " << files.size() << " files, " << threads
+                      << " threads: " << ms << " ms (" << serialMs / ms << "x)" << std::endl;
+
+            // same output in the same slots regardless of thread count
+            EXPECT_EQ(hashes, expected);
+        }
+    }
+}
+
+TEST(TextureTranscodeBenchmark, CorruptInputReportsError) {
+    TextureTranscoder transcoder(KTX_TTF_BC7_RGBA, KTX_TTF_BC7_RGBA);
+    ThreadPool pool(2);
+
+    // bad input fails its own job only, on a worker, without aborting
+    std::vector<uint8> garbage(256, 0xAB);
+    std::vector<TranscodeJob> jobs(8);
+    for (TranscodeJob& job : jobs){
+        job.data = garbage.data();
+        job.size = garbage.size();
+    }
+    transcoder.transcode(jobs.data(), jobs.size(), &pool);
+
+    for (TranscodeJob& job : jobs){
+        EXPECT_NE(job.result.error, KTX_SUCCESS);
+        EXPECT_EQ(job.result.texture, nullptr);
+    }
+}
+
+int main() {
+::testing::InitGoogleTest();
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,188 @@
+#include <vector>
+#include <random>
+#include <cmath>
+#include "gtest/gtest.h"
+#include "../src/render/scene/VertexQuantization.h"
+
+using namespace spr;
+using namespace spr::gfx;
+
+// random vertices within bounds, unit normals
+static void randomVertices(uint32 count, glm::vec3 minPosition, glm::vec3 maxPosition, std::vector<VertexPosition>& positions, std::vector<VertexAttributes>& attributes){
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    std::normal_distribution<float> gaussian;
+
+    positions.resize(count);
+    attributes.resize(count);
+    for (uint32 i = 0; i < count; i++){
+        glm::vec3 position = minPosition + glm::vec3(unit(rng), unit(rng), unit(rng)) * (maxPosition - minPosition);
+        glm::vec3 normal = glm::normalize(glm::vec3(gaussian(rng), gaussian(rng), gaussian(rng)));
+        glm::vec2 uv = glm::vec2(unit(rng) * 4.f - 1.f, unit(rng) * 2.f);
+        positions[i].vertexPos = glm::vec4(position, 1.f);
+        attributes[i].normal3_u1 = glm::vec4(normal, uv.x);
+        attributes[i].color3_v1 = glm::vec4(unit(rng), unit(rng), unit(rng), uv.y);
+    }
+}
+
+TEST(VertexQuantizationTest, HalvesVertexSize) {
+    uint32 floatBytes = sizeof(VertexPosition) + sizeof(VertexAttributes);
+    uint32 quantizedBytes = sizeof(VertexPositionQ) + sizeof(VertexAttributesQ);
+    ASSERT_EQ(floatBytes, 48);
+    ASSERT_EQ(quantizedBytes, 20);
+    ASSERT_GT(floatBytes, 2 * quantizedBytes);
+}
+
+TEST(VertexQuantizationTest, RoundTrip) {
+    const uint32 count = 10000;
+    glm::vec3 minPosition = glm::vec3(-12.f, 0.5f, -3.f);
+    glm::vec3 maxPosition = glm::vec3(20.f, 1.5f, 40.f);
+    std::vector<VertexPosition> positions;
+    std::vector<VertexAttributes> attributes;
+    randomVertices(count, minPosition, maxPosition, positions, attributes);
+
+    VertexDecode decode = VertexQuantization::computeDecode(positions.data(), attributes.data(), count);
+    std::vector<VertexPositionQ> quantizedPositions(count);
+    std::vector<VertexAttributesQ> quantizedAttributes(count);
+    VertexQuantization::quantizePositions(positions.data(), count, decode, quantizedPositions.data());
+    VertexQuantization::quantizeAttributes(attributes.data(), count, decode, quantizedAttributes.data());
+
+    std::vector<VertexPosition> outPositions(count);
+    std::vector<VertexAttributes> outAttributes(count);
+    VertexQuantization::dequantizePositions(quantizedPositions.data(), count, decode, outPositions.data());
+    VertexQuantization::dequantizeAttributes(quantizedAttributes.data(), count, decode, outAttributes.data());
+
+    // half a step of each axis' range, plus float rounding
+    glm::vec3 positionError = glm::vec3(decode.positionScale) / 65535.f * 0.5f + 1e-5f;
+    glm::vec2 uvError = glm::vec2(decode.uvOffsetScale.z, decode.uvOffsetScale.w) / 65535.f * 0.5f + 1e-6f;
+    float maxAngle = 0.f;
+    for (uint32 i = 0; i < count; i++){
+        for (uint32 axis = 0; axis < 3; axis++){
+            ASSERT_NEAR(outPositions[i].vertexPos[axis], positions[i].vertexPos[axis], positionError[axis]);
+        }
+        ASSERT_EQ(outPositions[i].vertexPos.w, 1.f);
+
+        glm::vec3 normal = glm::vec3(outAttributes[i].normal3_u1);
+        ASSERT_NEAR(glm::length(normal), 1.f, 1e-5f);
+        glm::vec3 expected = glm::vec3(attributes[i].normal3_u1);
+        float angle = std::atan2(glm::length(glm::cross(normal, expected)), glm::dot(normal, expected));
+        maxAngle = std::max(maxAngle, angle);
+
+        ASSERT_NEAR(outAttributes[i].normal3_u1.w, attributes[i].normal3_u1.w, uvError.x);
+        ASSERT_NEAR(outAttributes[i].color3_v1.w, attributes[i].color3_v1.w, uvError.y);
+        for (uint32 c = 0; c < 3; c++){
+            ASSERT_NEAR(outAttributes[i].color3_v1[c], attributes[i].color3_v1[c], 0.5f / 255.f + 1e-6f);
+        }
+    }
+
+    // 16 bit octahedral is well under a hundredth of a degree off
+    ASSERT_LT(maxAngle, glm::radians(0.01f));
+}
+
+TEST(VertexQuantizationTest, OctahedralEdges) {
+    std::vector<glm::vec3> normals = {
+        { 1.f, 0.f, 0.f}, {-1.f, 0.f, 0.f},
+        { 0.f, 1.f, 0.f}, { 0.f,-1.f, 0.f},
+        { 0.f, 0.f, 1.f}, { 0.f, 0.f,-1.f},
+        glm::normalize(glm::vec3( 1.f,-1.f,-1.f)),
+        glm::normalize(glm::vec3(-1.f, 1.f,-1.f)),
+        glm::normalize(glm::vec3(-1.f,-1.f,-0.001f))
+    };
+    for (glm::vec3 normal : normals){
+        glm::vec2 encoded = VertexQuantization::encodeOctahedral(normal);
+        ASSERT_LE(std::fabs(encoded.x), 1.f);
+        ASSERT_LE(std::fabs(encoded.y), 1.f);
+        glm::vec3 decoded = VertexQuantization::decodeOctahedral(encoded);
+        ASSERT_NEAR(glm::dot(decoded, normal), 1.f, 1e-5f);
+    }
+
+    // missing normals decode to +z
+    glm::vec3 decoded = VertexQuantization::decodeOctahedral(VertexQuantization::encodeOctahedral(glm::vec3(0.f)));
+    ASSERT_EQ(decoded, glm::vec3(0.f, 0.f, 1.f));
+}
+
+TEST(VertexQuantizationTest, FlatBounds) {
+    // a quad in the xy plane, one uv for every vertex
+    std::vector<VertexPosition> positions = {
+        {{-1.f, -1.f, 2.f, 1.f}}, {{1.f, -1.f, 2.f, 1.f}}, {{1.f, 1.f, 2.f, 1.f}}, {{-1.f, 1.f, 2.f, 1.f}}
+    };
+    std::vector<VertexAttributes> attributes(4, {{0.f, 0.f, 1.f, 0.25f}, {1.f, 1.f, 1.f, 0.75f}});
+
+    VertexDecode decode = VertexQuantization::computeDecode(positions.data(), attributes.data(), 4);
+    ASSERT_EQ(decode.positionScale.z, 0.f);
+    ASSERT_EQ(decode.uvOffsetScale.z, 0.f);
+
+    std::vector<VertexPositionQ> quantizedPositions(4);
+    std::vector<VertexAttributesQ> quantizedAttributes(4);
+    VertexQuantization::quantizePositions(positions.data(), 4, decode, quantizedPositions.data());
+    VertexQuantization::quantizeAttributes(attributes.data(), 4, decode, quantizedAttributes.data());
+
+    std::vector<VertexPosition> outPositions(4);
+    std::vector<VertexAttributes> outAttributes(4);
+    VertexQuantization::dequantizePositions(quantizedPositions.data(), 4, decode, outPositions.data());
+    VertexQuantization::dequantizeAttributes(quantizedAttributes.data(), 4, decode, outAttributes.data());
+    for (uint32 i = 0; i < 4; i++){
+        ASSERT_EQ(outPositions[i].vertexPos, positions[i].vertexPos);
+        ASSERT_EQ(outAttributes[i].normal3_u1.w, 0.25f);
+        ASSERT_EQ(outAttributes[i].color3_v1.w, 0.75f);
+    }
+}
+
+TEST(VertexQuantizationTest, TangentRoundTrip) {
+    const uint32 count = 10000;
+    std::vector<VertexPosition> positions;
+    std::vector<VertexAttributes> attributes;
+    randomVertices(count, glm::vec3(-1.f), glm::vec3(1.f), positions, attributes);
+
+    // unit tangents with either handedness
+    std::mt19937 rng(11);
+    std::normal_distribution<float> gaussian;
+    std::vector<glm::vec4> tangents(count);
+    for (uint32 i = 0; i < count; i++){
+        glm::vec3 tangent = glm::normalize(glm::vec3(gaussian(rng), gaussian(rng), gaussian(rng)));
+        tangents[i] = glm::vec4(tangent, i % 2 ? -1.f : 1.f);
+    }
+
+    VertexDecode decode = VertexQuantization::computeDecode(positions.data(), attributes.data(), count);
+    std::vector<VertexPositionQ> quantizedPositions(count);
+    std::vector<VertexAttributesQ> quantizedAttributes(count);
+    VertexQuantization::quantizePositions(positions.data(), count, decode, quantizedPositions.data());
+    VertexQuantization::quantizeAttributes(attributes.data(), count, decode, quantizedAttributes.data());
+
+    // none until they're added
+    std::vector<glm::vec4> outTangents(count);
+    VertexQuantization::dequantizeTangents(quantizedPositions.data(), quantizedAttributes.data(), count, outTangents.data());
+    for (uint32 i = 0; i < count; i++){
+        ASSERT_EQ(outTangents[i].w, 0.f);
+    }
+
+    VertexQuantization::quantizeTangents(tangents.data(), count, quantizedPositions.data(), quantizedAttributes.data());
+    VertexQuantization::dequantizeTangents(quantizedPositions.data(), quantizedAttributes.data(), count, outTangents.data());
+
+    // tangents share the position's 8 bytes, the position itself is unchanged
+    std::vector<VertexPosition> outPositions(count);
+    VertexQuantization::dequantizePositions(quantizedPositions.data(), count, decode, outPositions.data());
+    glm::vec3 positionError = glm::vec3(decode.positionScale) / 65535.f * 0.5f + 1e-5f;
+
+    float maxAngle = 0.f;
+    for (uint32 i = 0; i < count; i++){
+        for (uint32 axis = 0; axis < 3; axis++){
+            ASSERT_NEAR(outPositions[i].vertexPos[axis], positions[i].vertexPos[axis], positionError[axis]);
+        }
+
+        glm::vec3 tangent = glm::vec3(outTangents[i]);
+        ASSERT_NEAR(glm::length(tangent), 1.f, 1e-5f);
+        ASSERT_EQ(outTangents[i].w, tangents[i].w);
+        glm::vec3 expected = glm::vec3(tangents[i]);
+        float angle = std::atan2(glm::length(glm::cross(tangent, expected)), glm::dot(tangent, expected));
+        maxAngle = std::max(maxAngle, angle);
+    }
+
+    // 8 bit octahedral stays within about a degree
+    ASSERT_LT(maxAngle, glm::radians(1.f));
+}
+
+int main() {
+    ::testing::InitGoogleTest();
+    return RUN_ALL_TESTS();
+}
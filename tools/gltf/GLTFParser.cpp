@@ -1,6 +1,12 @@
 #include <cstring>
+#include <cfloat>
 #include <fstream>
+#include <memory>
+#include <cmath>
+#include <iomanip>
 #include "GLTFParser.h"
+#include "core/util/ThreadPool.h"
+#include "render/scene/VertexQuantization.h"
 #include <stdio.h>
 #include "Resources.h"
 #include "glm/gtc/matrix_inverse.hpp"
@@ -19,7 +25,19 @@
 #include "../../external/ktx/lib/vk_format.h"
 namespace spr::tools{
 
-GLTFParser::GLTFParser(){}
+GLTFParser::GLTFParser(uint32 jobCount, TextureSettings textureSettings, MeshSettings meshSettings){
+    m_jobCount = std::max(jobCount, 1u);
+    m_textureSettings = textureSettings;
+    m_meshSettings = meshSettings;
+}
+
+TextureEncoding GLTFParser::getEncoding(BufferData dataType){
+    if (dataType == SPR_TEXTURE_COLOR)
+        return m_textureSettings.color;
+    if (dataType == SPR_TEXTURE_NORMAL)
+        return m_textureSettings.normal;
+    return m_textureSettings.other;
+}
 
 OffsetSpan GLTFParser::writeBufferFile(const unsigned char* data, uint32 byteLength, DataRegion dataRegion){
     OffsetSpan offsetSpan;
@@ -179,17 +197,16 @@ void GLTFParser::createMip(
     stbir_resize_uint8(in, inExtent, inExtent, 0, mipOut, outExtent, outExtent, 0, 4);
 }
 
-void GLTFParser::compressImageData(
+bool GLTFParser::compressImageData(
         unsigned char* data,
         uint32 dataSize,
-        unsigned char** outData,
-        uint32& outDataSize,
+        std::vector<uint8_t>& out,
         BufferData dataType,
         uint32 width,
         uint32 height,
         uint32 components)
 {
-    ktxTexture2* texture;
+    ktxTexture2* texture = nullptr;
     ktxTextureCreateInfo createInfo;
     KTX_error_code result;
     ktx_uint32_t level, layer, faceSlice;
@@ -197,7 +214,8 @@ void GLTFParser::compressImageData(
     ktx_size_t outSize;
     ktxBasisParams params = {0};
     params.structSize = sizeof(params);
-    params.threadCount = 8;
+    params.threadCount = 1;     // already one texture per job thread
+    out.clear();
     
     createInfo.glInternalformat = 0; 
     createInfo.vkFormat = dataType == SPR_TEXTURE_COLOR ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
@@ -210,14 +228,29 @@ void GLTFParser::compressImageData(
     createInfo.numFaces = 1;
     createInfo.isArray = KTX_FALSE;
     createInfo.generateMipmaps = KTX_FALSE;
-    
-    result = ktxTexture2_Create(&createInfo, KTX_TEXTURE_CREATE_ALLOC_STORAGE, &texture);
-    if (result) {
-        std::cerr << "Failed to create KTX2 texture, code: " << ktxErrorString(result) << std::endl;
-    }
 
     uint32 levels = createInfo.numLevels;
     uint32 maxExtent = std::max(width, height);
+    std::vector<unsigned char*> mipData(levels > 0 ? levels - 1 : 0, nullptr);
+
+    // every failure drops the texture, a partly written one would be
+    // (silently) uncompressed or missing mips
+    auto fail = [&](const char* step){
+        std::cerr << "Failed to " << step << " (" << width << "x" << height << "), code: " << ktxErrorString(result) << std::endl;
+        if (texture)
+            ktxTexture_Destroy(ktxTexture(texture));
+        for (unsigned char* mip : mipData){
+            free(mip);
+        }
+        out.clear();
+        return false;
+    };
+
+    result = ktxTexture2_Create(&createInfo, KTX_TEXTURE_CREATE_ALLOC_STORAGE, &texture);
+    if (result) {
+        texture = nullptr;
+        return fail("create KTX2 texture");
+    }
 
     // base level
     srcSize = width*height*components;
@@ -226,11 +259,10 @@ void GLTFParser::compressImageData(
     faceSlice = 0;                           
     result = ktxTexture_SetImageFromMemory(ktxTexture(texture), level, layer, faceSlice, data, srcSize);
     if (result) {
-        std::cerr << "Failed to set image from memory, code: " << ktxErrorString(result) << std::endl;
+        return fail("set image from memory");
     }
 
     // mip chain
-    unsigned char* mipData[levels-1];
     if (width == height){
         for (uint32 i = 1; i < levels; i++){
             uint32 levelExtent = std::max(maxExtent / (1 << i), 1u);
@@ -249,7 +281,7 @@ void GLTFParser::compressImageData(
             createMip(i == 1 ? data : mipData[i-2], prevSize, prevExtent, mipData[i-1], currSize, currExtent);
             result = ktxTexture_SetImageFromMemory(ktxTexture(texture), level, layer, faceSlice, mipData[i-1], currSize);
             if (result) {
-                std::cerr << "Failed to set (mip) image from memory, code: " << ktxErrorString(result) << std::endl;
+                return fail("set (mip) image from memory");
             }
 
             prevExtent = currExtent;
@@ -261,33 +293,45 @@ void GLTFParser::compressImageData(
     }
     
     // BasisU encode
-    if (dataType == SPR_TEXTURE_NORMAL){
-        params.normalMap = KTX_TRUE;
+    TextureEncoding encoding = getEncoding(dataType);
+    params.normalMap = dataType == SPR_TEXTURE_NORMAL ? KTX_TRUE : KTX_FALSE;
+    if (encoding == SPR_ENCODE_UASTC){
         params.uastc = KTX_TRUE;
-        params.uastcFlags = KTX_PACK_UASTC_LEVEL_DEFAULT;
-        params.compressionLevel = KTX_ETC1S_DEFAULT_COMPRESSION_LEVEL;
+        params.uastcFlags = m_textureSettings.uastcLevel;
     } else {
         params.uastc = KTX_FALSE;
-        params.normalMap = KTX_FALSE;
-        params.compressionLevel = KTX_ETC1S_DEFAULT_COMPRESSION_LEVEL;        
+        params.compressionLevel = KTX_ETC1S_DEFAULT_COMPRESSION_LEVEL;
+        params.qualityLevel = m_textureSettings.etc1sQuality;
+    }
+    if (encoding != SPR_ENCODE_RGBA){
+        result = ktxTexture2_CompressBasisEx(texture, &params);
+        if (result) {
+            return fail(encoding == SPR_ENCODE_UASTC ? "compress texture (uastc)" : "compress texture (etc1s)");
+        }
+    }
+
+    // etc1s is supercompressed already (basis lz)
+    if (encoding != SPR_ENCODE_ETC1S && m_textureSettings.zstdLevel > 0){
+        result = ktxTexture2_DeflateZstd(texture, m_textureSettings.zstdLevel);
+        if (result) {
+            return fail("supercompress texture (zstd)");
+        }
     }
-    //result = ktxTexture2_CompressBasisEx(texture, &params);
-    // if (result) {
-    //     std::cerr << "Failed to compress texture, code: " << ktxErrorString(result) << std::endl;
-    // }
 
     // cleanup
-    result = ktxTexture_WriteToMemory((ktxTexture*)(texture), outData, &outSize);
-    if (result) {
-        std::cerr << "Failed to write KTX texture to memory, code: " << ktxErrorString(result) << std::endl;
+    unsigned char* outData = nullptr;
+    result = ktxTexture_WriteToMemory((ktxTexture*)(texture), &outData, &outSize);
+    if (result || !outData || outSize == 0) {
+        free(outData);
+        return fail("write KTX texture to memory");
     }
-    outDataSize = (uint32)outSize;
+    out.assign(outData, outData + outSize);
+    free(outData);
     ktxTexture_Destroy(ktxTexture(texture));
-    if (width == height){
-        for (uint32 i = 1; i < levels; i++){
-            free(mipData[i-1]);
-        }
+    for (unsigned char* mip : mipData){
+        free(mip);
     }
+    return true;
 }
 
 OffsetSpan GLTFParser::handleTextureBuffer(
@@ -313,16 +357,17 @@ OffsetSpan GLTFParser::handleTextureBuffer(
         data[i] = bufferData[i+byteOffset];
     }
 
-    unsigned char* ktxTextureData = nullptr;
-    uint32 ktxTextureDataSize;
-
     // generate mips + compress
-    compressImageData(data, byteLength, &ktxTextureData, ktxTextureDataSize, dataType, width, height, 4);
-
-    OffsetSpan offsetSpan = writeBufferFile(ktxTextureData, ktxTextureDataSize, SPR_DR_TEXTURE);
-
-    free(ktxTextureData);
+    std::vector<uint8_t> ktxTextureData;
+    compressImageData(data, byteLength, ktxTextureData, dataType, width, height, 4);
     delete[] data;
+
+    OffsetSpan offsetSpan {0, 0};
+    if (writeToFile){
+        offsetSpan = writeBufferFile(ktxTextureData.data(), ktxTextureData.size(), SPR_DR_TEXTURE);
+    } else {
+        out.swap(ktxTextureData);
+    }
     
     return offsetSpan;
 }
@@ -336,6 +381,8 @@ OffsetSpan GLTFParser::handleMIMEImageBuffer(
         uint32 elementCount,
         uint32 elementType, 
         uint32 componentType,
+        std::vector<uint8_t>& out,
+        bool writeToFile,
         BufferData dataType){
 
     // buffer data
@@ -350,6 +397,11 @@ OffsetSpan GLTFParser::handleMIMEImageBuffer(
         &numChannels,
         STBI_rgb_alpha
     );
+    if (!pixels){
+        std::cerr << "Failed to decode image: " << stbi_failure_reason() << std::endl;
+        out.clear();
+        return {0, 0};
+    }
 
     byteLength = width * height * STBI_rgb_alpha;
     
@@ -358,16 +410,17 @@ OffsetSpan GLTFParser::handleMIMEImageBuffer(
         data[i] = pixels[i];
     free(pixels);
 
-    unsigned char* ktxTextureData = nullptr;
-    uint32 ktxTextureDataSize;
-
-    compressImageData(data, byteLength, &ktxTextureData, ktxTextureDataSize, dataType, width, height, 4); 
-
-    OffsetSpan offsetSpan = writeBufferFile(ktxTextureData, ktxTextureDataSize, SPR_DR_TEXTURE);
-
-    free(ktxTextureData);
+    std::vector<uint8_t> ktxTextureData;
+    compressImageData(data, byteLength, ktxTextureData, dataType, width, height, 4); 
     delete[] data;
 
+    OffsetSpan offsetSpan {0, 0};
+    if (writeToFile){
+        offsetSpan = writeBufferFile(ktxTextureData.data(), ktxTextureData.size(), SPR_DR_TEXTURE);
+    } else {
+        out.swap(ktxTextureData);
+    }
+
     return offsetSpan;
 }
 
@@ -435,7 +488,7 @@ OffsetSpan GLTFParser::handleBufferView(
         if (!association.compare("sbuf")){ // normal case
             return handleBuffer(buffer, association, adjustedByteOffset, byteLength, bytesPerElement, elementCount, elementType, componentType, out, writeToFile, dataType, transform, region);
         }else{  // handle buffer that contains MIME image data
-            return handleMIMEImageBuffer(buffer, association, adjustedByteOffset, byteLength, bytesPerElement, elementCount, elementType, componentType, dataType);
+            return handleMIMEImageBuffer(buffer, association, adjustedByteOffset, byteLength, bytesPerElement, elementCount, elementType, componentType, out, writeToFile, dataType);
         }
     } else{
         return handleBufferInterleaved(buffer, association, adjustedByteOffset, byteLength, byteStride, bytesPerElement, elementType, componentType, out, writeToFile, region);
@@ -458,52 +511,45 @@ OffsetSpan GLTFParser::handleAccessor(const tinygltf::Accessor& accessor, std::v
 }
 
 uint32 GLTFParser::handleTexture(const tinygltf::Texture& tex, BufferData dataType){
-    std::vector<uint8_t> out;
-    // get image and sampler
+    // get image
     int32 sourceIndex = tex.source;
-    int32 samplerIndex = tex.sampler;
-    int32 minFilter;
-    tinygltf::Image image;
-    tinygltf::Sampler sampler;
     if (sourceIndex == -1)
         return 0;
-    if (samplerIndex == -1)
-        minFilter = TINYGLTF_TEXTURE_FILTER_LINEAR_MIPMAP_LINEAR;
-    else {
-        sampler = model.samplers[samplerIndex];
-        minFilter = sampler.minFilter;
-    }
-
-    // create masked id (id + filter)
-    //uint32 maskedTexId = (texId & 0xFFFF) | (minFilter << 16);
-
-    // get image
-    image = model.images[sourceIndex];
+    const tinygltf::Image& image = model.images[sourceIndex];
 
     // get image components
     uint32 components = image.component;
     if (components == 0)
         components = 4;
 
-    // tex already written to buffer
-    // write tex file but not buffer
-    if (m_sourceBuffIdMap.count(sourceIndex) > 0){
-        // write texture to file
+    // tex already queued, reuse its id
+    if (m_sourceTexIdMap.count(sourceIndex) > 0){
         return m_sourceTexIdMap[sourceIndex]; 
     }
 
-    // get min filter
-    minFilter = sampler.minFilter;
+    // converted and written later, in id order
+    uint32 textureIndex = m_textureJobs.size();
+    m_sourceTexIdMap[sourceIndex] = textureIndex;
+    m_textureJobs.push_back({
+        .sourceIndex = sourceIndex,
+        .dataType = dataType,
+        .components = components
+    });
 
-    // get data and write to buffer
+    return textureIndex;
+}
+
+void GLTFParser::convertTexture(TextureJob& job){
+    const tinygltf::Image& image = model.images[job.sourceIndex];
+
+    // get data, decode + mips + ktx2 into job.data
     int32 elementType = TINYGLTF_TYPE_VEC4;
     int32 componentType = TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT;
     glm::mat4 temp;
 
-    OffsetSpan textureOffset;
     if (image.bufferView >= 0){ // bufferview
         int32 elementCount = image.width * image.height * image.component;
-        textureOffset = handleBufferView(model.bufferViews[image.bufferView], std::string("stex"), 0, 1, elementCount, elementType, componentType, out, true, dataType, temp, SPR_DR_TEXTURE);
+        handleBufferView(model.bufferViews[image.bufferView], std::string("stex"), 0, 1, elementCount, elementType, componentType, job.data, false, job.dataType, temp, SPR_DR_TEXTURE);
     } else { // direct buffer
         tinygltf::Buffer buffer;
         int32 elementCount = image.image.size();
@@ -511,10 +557,75 @@ uint32 GLTFParser::handleTexture(const tinygltf::Texture& tex, BufferData dataTy
         int32 componentType = TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
         buffer.data = image.image;
         uint32 bytesPerElement = tinygltf::GetNumComponentsInType(elementType) * tinygltf::GetComponentSizeInBytes(componentType);
-        textureOffset = handleTextureBuffer(buffer, std::string("stex"), 0, bytesPerElement*elementCount, bytesPerElement, elementCount, elementType, componentType, out, true, dataType, image.width, image.height, components);
+        handleTextureBuffer(buffer, std::string("stex"), 0, bytesPerElement*elementCount, bytesPerElement, elementCount, elementType, componentType, job.data, false, job.dataType, image.width, image.height, job.components);
+    }
+
+    // written empty (the runtime substitutes it), counted by writeTexture
+    if (job.data.empty()){
+        std::cerr << "Failed to convert image " << job.sourceIndex << (image.name.empty() ? "" : " (" + image.name + ")") << std::endl;
+        return;
+    }
+
+    if (m_textureSettings.report)
+        measureTexture(job);
+}
+
+void GLTFParser::measureTexture(TextureJob& job){
+    const tinygltf::Image& image = model.images[job.sourceIndex];
+    job.rawBytes = 0;
+    job.psnr = 0;
+
+    // source pixels, decoded the same way as for encoding
+    const unsigned char* pixels = image.image.data();
+    unsigned char* decoded = nullptr;
+    int width = image.width;
+    int height = image.height;
+    if (image.bufferView >= 0){
+        const tinygltf::BufferView& bufferView = model.bufferViews[image.bufferView];
+        const unsigned char* bufferData = model.buffers[bufferView.buffer].data.data() + bufferView.byteOffset;
+        int numChannels;
+        decoded = stbi_load_from_memory(bufferData, bufferView.byteLength, &width, &height, &numChannels, STBI_rgb_alpha);
+        pixels = decoded;
+    }
+
+    // back to rgba, as the runtime would see it
+    ktxTexture2* texture;
+    KTX_error_code result = ktxTexture2_CreateFromMemory(job.data.data(), job.data.size(), KTX_TEXTURE_CREATE_LOAD_IMAGE_DATA_BIT, &texture);
+    if (result == KTX_SUCCESS && ktxTexture2_NeedsTranscoding(texture))
+        result = ktxTexture2_TranscodeBasis(texture, KTX_TTF_RGBA32, 0);
+    if (result != KTX_SUCCESS || !pixels){
+        std::cerr << "Failed to measure texture, code: " << ktxErrorString(result) << std::endl;
+        if (result == KTX_SUCCESS)
+            ktxTexture_Destroy(ktxTexture(texture));
+        free(decoded);
+        return;
+    }
+
+    // psnr of the base level over rgb
+    ktx_size_t offset;
+    ktxTexture_GetImageOffset(ktxTexture(texture), 0, 0, 0, &offset);
+    const unsigned char* transcoded = ktxTexture_GetData(ktxTexture(texture)) + offset;
+    double squaredError = 0;
+    for (uint64 i = 0; i < (uint64)width * height * 4; i++){
+        if (i % 4 == 3)
+            continue;
+        double difference = (double)transcoded[i] - pixels[i];
+        squaredError += difference * difference;
     }
-    m_sourceTexIdMap[sourceIndex] = m_textureIndex;
-    m_sourceBuffIdMap[sourceIndex] = sourceIndex;
+    double meanSquaredError = squaredError / ((double)width * height * 3);
+    job.psnr = meanSquaredError == 0 ? INFINITY : 10.0 * std::log10(255.0 * 255.0 / meanSquaredError);
+    job.rawBytes = ktxTexture_GetDataSize(ktxTexture(texture));
+
+    ktxTexture_Destroy(ktxTexture(texture));
+    free(decoded);
+}
+
+void GLTFParser::writeTexture(TextureJob& job){
+    const tinygltf::Image& image = model.images[job.sourceIndex];
+    if (job.data.empty())
+        m_failedTextureCount++;
+    OffsetSpan textureOffset = writeBufferFile(job.data.data(), job.data.size(), SPR_DR_TEXTURE);
+    std::vector<uint8_t>().swap(job.data);
 
     // write texture to file
     TextureLayout texture {
@@ -522,10 +633,30 @@ uint32 GLTFParser::handleTexture(const tinygltf::Texture& tex, BufferData dataTy
         textureOffset.offset, 
         (uint32)image.height, 
         (uint32)image.width, 
-        components
+        job.components
     };
-
-    return writeTextureFile(texture);
+    uint32 textureIndex = writeTextureFile(texture);
+
+    if (m_textureSettings.report){
+        static const char* roles[] = {"color", "normal", "other"};
+        static const char* encodings[] = {"rgba", "etc1s", "uastc"};
+        TextureEncoding encoding = getEncoding(job.dataType);
+        bool zstd = encoding != SPR_ENCODE_ETC1S && m_textureSettings.zstdLevel > 0;
+        double ratio = textureOffset.sizeBytes ? (double)job.rawBytes / textureOffset.sizeBytes : 0;
+
+        std::cout << "texture " << textureIndex << " (" << roles[job.dataType - SPR_TEXTURE_COLOR] << ", "
+                  << encodings[encoding] << (zstd ? "+zstd" : "") << ") "
+                  << image.width << "x" << image.height << ": "
+                  << job.rawBytes << " -> " << textureOffset.sizeBytes << " bytes ("
+                  << std::fixed << std::setprecision(2) << ratio << "x), psnr ";
+        if (std::isinf(job.psnr))
+            std::cout << "lossless" << std::endl;
+        else
+            std::cout << job.psnr << " dB" << std::endl;
+        std::cout.unsetf(std::ios::fixed);
+
+        m_rawTextureBytes += job.rawBytes;
+    }
 }
 
 uint32 GLTFParser::handleTexture(const tinygltf::TextureInfo& texInfo, BufferData dataType){
@@ -649,14 +780,14 @@ uint32 GLTFParser::handleMaterial(const tinygltf::Material& material, uint32& ou
     return writeMaterialFile(materialWrite);
 }
 
-OffsetSpan GLTFParser::interleaveVertexAttributes(
+void GLTFParser::interleaveVertexAttributes(
         uint32 vertexCount,
         std::vector<uint8_t>& normalBuffer,
         std::vector<uint8_t>& tangentBuffer,
         std::vector<uint8_t>& texCoordBuffer,
         std::vector<uint8_t>& colorBuffer,
         glm::mat4& transform,
-        DataRegion region){
+        std::vector<uint8_t>& out){
     uint32 bytesPerNormal = 12;
     uint32 bytesPerColor = 12;
     uint32 bytesPerTexCoord = 8;
@@ -684,7 +815,8 @@ OffsetSpan GLTFParser::interleaveVertexAttributes(
     }
 
     // interleave into attributes buffer
-    std::vector<uint8_t> result(vertexCount*bytesPerVertex);
+    std::vector<uint8_t>& result = out;
+    result.resize(vertexCount*bytesPerVertex);
     // for each vertex, manually copy into 'result' such that it takes the form:
     //
     //      [ vec3 | vec2.x ]    OR    [ normal | texCoord.U ]
@@ -718,16 +850,31 @@ OffsetSpan GLTFParser::interleaveVertexAttributes(
         offset += bytesPerTexCoord/2;
         
     }
-
-    // write to buffer
-    return writeBufferFile(result.data(), vertexCount*bytesPerVertex, region);
 }
 
 uint32 GLTFParser::handlePrimitive(const tinygltf::Primitive& primitive, glm::mat4& transform){
-    std::vector<uint8_t> tempOut;
-
-    // material
+    // handle material, its textures are queued
     int32 materialIndexGLTF = primitive.material;
+    uint32 materialIndex = 0;
+    uint32 materialFlags = 0;
+    if (materialIndexGLTF >= 0){
+        materialIndex = handleMaterial(model.materials[materialIndexGLTF], materialFlags);
+    }
+
+    // buffers are converted and written later, in id order
+    m_meshJobs.push_back({
+        .primitive = &primitive,
+        .transform = transform,
+        .materialIndex = materialIndex,
+        .materialFlags = materialFlags
+    });
+    return m_meshJobs.size() - 1;
+}
+
+void GLTFParser::convertMesh(MeshJob& job){
+    const tinygltf::Primitive& primitive = *job.primitive;
+    glm::mat4& transform = job.transform;
+    std::vector<uint8_t> tempOut;
 
     // attributes (accessor indices)
     int32 indicesAccessorIndex = primitive.indices;
@@ -754,57 +901,197 @@ uint32 GLTFParser::handlePrimitive(const tinygltf::Primitive& primitive, glm::ma
 
     // handle accessors
     // indices
-    OffsetSpan indicesOffset = handleAccessor(model.accessors[indicesAccessorIndex], tempOut, true, SPR_INDICES, transform, SPR_DR_INDEX);
+    handleAccessor(model.accessors[indicesAccessorIndex], job.indices, false, SPR_INDICES, transform, SPR_DR_INDEX);
     
     // position
-    OffsetSpan positionOffset;
     uint32 vertexCount = 0;
     if (positionAccessorIndex >= 0){
         vertexCount = model.accessors[positionAccessorIndex].count;
-        positionOffset = handleAccessor(model.accessors[positionAccessorIndex], tempOut, true, SPR_POSITION, transform, SPR_DR_POSITION);
+        handleAccessor(model.accessors[positionAccessorIndex], job.positions, false, SPR_POSITION, transform, SPR_DR_POSITION);
     }
 
     // normal
-    OffsetSpan normalOffset;
     std::vector<uint8_t> outNormal;
     if (normalAccessorIndex >= 0){
-        normalOffset = handleAccessor(model.accessors[normalAccessorIndex], outNormal, false, SPR_NORMALS, transform, SPR_DR_ATTRIBUTE);
+        handleAccessor(model.accessors[normalAccessorIndex], outNormal, false, SPR_NORMALS, transform, SPR_DR_ATTRIBUTE);
     }
 
-    // tangent
-    OffsetSpan tangentOffset;
+    // tangent, only quantized vertices have room for it
     std::vector<uint8_t> outTangent;
     if (tangentAccessorIndex >= 0){
-        tangentOffset = handleAccessor(model.accessors[tangentAccessorIndex], outTangent, false, SPR_TANGENTS, transform, SPR_DR_ATTRIBUTE);
+        handleAccessor(model.accessors[tangentAccessorIndex], outTangent, false, SPR_TANGENTS, transform, SPR_DR_ATTRIBUTE);
+    }
+    if (m_meshSettings.quantize && vertexCount > 0 && outTangent.size() == (uint64)vertexCount * sizeof(glm::vec4)){
+        glm::vec4* tangents = (glm::vec4*)outTangent.data();
+        for (uint32 i = 0; i < vertexCount; i++){
+            glm::vec3 tangent = glm::mat3(transform) * glm::vec3(tangents[i]);
+            float length = glm::length(tangent);
+            tangents[i] = glm::vec4(length > 0.f ? tangent / length : tangent, tangents[i].w);
+        }
+        job.tangents.swap(outTangent);
     }
 
     // texcoords
-    OffsetSpan texCoordOffset;
     std::vector<uint8_t> outTexCoord;
     if (texcoordAccessorIndex >= 0) {
-        texCoordOffset = handleAccessor(model.accessors[texcoordAccessorIndex], outTexCoord, false, SPR_UV, transform, SPR_DR_ATTRIBUTE);
+        handleAccessor(model.accessors[texcoordAccessorIndex], outTexCoord, false, SPR_UV, transform, SPR_DR_ATTRIBUTE);
     }
 
     // colors
-    OffsetSpan colorOffset;
     std::vector<uint8_t> outColor;
     if (colorAccessorIndex >= 0) {
-        colorOffset = handleAccessor(model.accessors[colorAccessorIndex], outColor, false, SPR_COLOR, transform, SPR_DR_ATTRIBUTE);
+        handleAccessor(model.accessors[colorAccessorIndex], outColor, false, SPR_COLOR, transform, SPR_DR_ATTRIBUTE);
     }
 
-    OffsetSpan attributesOffset = interleaveVertexAttributes(vertexCount, outNormal, outTangent, outTexCoord, outColor, transform, SPR_DR_ATTRIBUTE);
+    interleaveVertexAttributes(vertexCount, outNormal, outTangent, outTexCoord, outColor, transform, job.attributes);
 
-    // handle material
-    uint32 materialIndex = 0;
-    uint32 materialFlags = 0;
-    if (materialIndexGLTF >= 0){
-        materialIndex = handleMaterial(model.materials[materialIndexGLTF], materialFlags);
+    // only uint32 triangle lists that stay within the vertices are reordered or simplified
+    uint32* indices = (uint32*)job.indices.data();
+    uint32 indexCount = job.indices.size() / sizeof(uint32);
+    bool valid = vertexCount > 0 && indexCount % 3 == 0 &&
+                 model.accessors[indicesAccessorIndex].componentType != TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE &&
+                 job.positions.size() % vertexCount == 0;
+    for (uint32 i = 0; i < indexCount && valid; i++){
+        valid = indices[i] < vertexCount;
+    }
+    bool optimize = m_meshSettings.optimize && valid;
+
+    if (m_meshSettings.report && optimize)
+        job.before = MeshOptimizer::analyzeVertexCache(indices, indexCount, vertexCount);
+
+    if (optimize){
+        uint32 positionStride = job.positions.size() / vertexCount;
+        MeshOptimizer::optimizeVertexCache(indices, indexCount, vertexCount);
+        MeshOptimizer::optimizeOverdraw(indices, indexCount, job.positions.data(), positionStride, vertexCount, m_meshSettings.overdrawThreshold);
+    }
+
+    job.lods = {};
+    job.lods.lodCount = 1;
+    job.lods.lods[0] = {.firstIndex = 0, .indexCount = indexCount, .error = 0.f};
+    if (valid)
+        generateLods(job, vertexCount);
+
+    // every lod uses lod 0's vertices, so they go first
+    indices = (uint32*)job.indices.data();
+    if (optimize){
+        uint32 positionStride = job.positions.size() / vertexCount;
+        std::vector<uint32> remap;
+        uint32 usedVertexCount = MeshOptimizer::optimizeVertexFetch(indices, job.indices.size() / sizeof(uint32), vertexCount, remap);
+        MeshOptimizer::remapVertices(job.positions, positionStride, remap, usedVertexCount);
+        MeshOptimizer::remapVertices(job.attributes, job.attributes.size() / vertexCount, remap, usedVertexCount);
+        if (!job.tangents.empty())
+            MeshOptimizer::remapVertices(job.tangents, sizeof(glm::vec4), remap, usedVertexCount);
+        vertexCount = usedVertexCount;
+    }
+
+    job.decode = {
+        .vertexFormat = SPR_VERTEX_FORMAT_FLOAT,
+        .positionOffset = vec4(0.f),
+        .positionScale = vec4(1.f),
+        .uvOffsetScale = vec4(0.f, 0.f, 1.f, 1.f)
+    };
+    if (m_meshSettings.quantize && vertexCount > 0)
+        quantizeVertices(job, vertexCount);
+
+    job.vertexCount = vertexCount;
+    if (m_meshSettings.report && optimize)
+        job.after = MeshOptimizer::analyzeVertexCache(indices, indexCount, vertexCount);
+    else if (m_meshSettings.report)
+        job.before = job.after = {0.f, 0.f};
+}
+
+void GLTFParser::generateLods(MeshJob& job, uint32 vertexCount){
+    const uint32* indices = (uint32*)job.indices.data();
+    uint32 indexCount = job.indices.size() / sizeof(uint32);
+    uint32 positionStride = job.positions.size() / vertexCount;
+
+    // errors are relative to the mesh's size
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+    for (uint32 i = 0; i < indexCount; i++){
+        glm::vec3 position;
+        memcpy(&position, job.positions.data() + (uint64)indices[i] * positionStride, sizeof(glm::vec3));
+        min = glm::min(min, position);
+        max = glm::max(max, position);
+    }
+    float extent = glm::length(max - min);
+
+    // each lod is simplified from lod 0 (its quadrics are the most accurate),
+    // the chain ends once the error limit keeps a lod from getting smaller
+    std::vector<uint32> lodIndices;
+    std::vector<uint32> lod;
+    uint32 lodCount = std::min((uint32)m_meshSettings.lodErrors.size() + 1, SPR_MAX_MESH_LODS);
+    uint32 previousCount = indexCount;
+    float previousError = 0.f;
+    for (uint32 level = 1; level < lodCount; level++){
+        uint32 targetCount = (uint32)(previousCount * m_meshSettings.lodRatio) / 3 * 3;
+        float maxError = m_meshSettings.lodErrors[level - 1] * extent;
+        float error;
+        uint32 count = MeshOptimizer::simplify(lod, indices, indexCount, job.positions.data(), positionStride, vertexCount, targetCount, maxError, error);
+        if (count == 0 || count > previousCount * 0.8f)
+            break;
+
+        if (m_meshSettings.optimize)
+            MeshOptimizer::optimizeVertexCache(lod.data(), count, vertexCount);
+
+        // coarser lods never claim to be more accurate
+        previousError = std::max(previousError, error);
+        job.lods.lods[level] = {
+            .firstIndex = indexCount + (uint32)lodIndices.size(),
+            .indexCount = count,
+            .error = previousError
+        };
+        job.lods.lodCount++;
+        lodIndices.insert(lodIndices.end(), lod.begin(), lod.end());
+        previousCount = count;
+    }
+
+    job.indices.insert(job.indices.end(), (uint8_t*)lodIndices.data(), (uint8_t*)(lodIndices.data() + lodIndices.size()));
+}
+
+void GLTFParser::quantizeVertices(MeshJob& job, uint32 vertexCount){
+    using namespace spr::gfx;
+    if (job.positions.size() != (uint64)vertexCount * sizeof(VertexPosition) ||
+        job.attributes.size() != (uint64)vertexCount * sizeof(VertexAttributes))
+        return;
+
+    const VertexPosition* positions = (VertexPosition*)job.positions.data();
+    const VertexAttributes* attributes = (VertexAttributes*)job.attributes.data();
+    VertexDecode decode = VertexQuantization::computeDecode(positions, attributes, vertexCount);
+
+    std::vector<uint8_t> quantizedPositions(vertexCount * sizeof(VertexPositionQ));
+    std::vector<uint8_t> quantizedAttributes(vertexCount * sizeof(VertexAttributesQ));
+    VertexQuantization::quantizePositions(positions, vertexCount, decode, (VertexPositionQ*)quantizedPositions.data());
+    VertexQuantization::quantizeAttributes(attributes, vertexCount, decode, (VertexAttributesQ*)quantizedAttributes.data());
+    if (job.tangents.size() == (uint64)vertexCount * sizeof(glm::vec4))
+        VertexQuantization::quantizeTangents((glm::vec4*)job.tangents.data(), vertexCount, (VertexPositionQ*)quantizedPositions.data(), (VertexAttributesQ*)quantizedAttributes.data());
+    std::vector<uint8_t>().swap(job.tangents);
+    job.positions.swap(quantizedPositions);
+    job.attributes.swap(quantizedAttributes);
+
+    job.decode = {
+        .vertexFormat = SPR_VERTEX_FORMAT_QUANTIZED,
+        .positionOffset = decode.positionOffset,
+        .positionScale = decode.positionScale,
+        .uvOffsetScale = decode.uvOffsetScale
+    };
+}
+
+void GLTFParser::writeMesh(MeshJob& job){
+    OffsetSpan indicesOffset = writeBufferFile(job.indices.data(), job.indices.size(), SPR_DR_INDEX);
+    OffsetSpan positionOffset;
+    if (!job.positions.empty()){
+        positionOffset = writeBufferFile(job.positions.data(), job.positions.size(), SPR_DR_POSITION);
     }
+    OffsetSpan attributesOffset = writeBufferFile(job.attributes.data(), job.attributes.size(), SPR_DR_ATTRIBUTE);
+    std::vector<uint8_t>().swap(job.indices);
+    std::vector<uint8_t>().swap(job.positions);
+    std::vector<uint8_t>().swap(job.attributes);
 
     // write prim (mesh) to file
     MeshLayout meshWrite {
-        materialIndex,
-        materialFlags,
+        job.materialIndex,
+        job.materialFlags,
 
         indicesOffset.sizeBytes,
         indicesOffset.offset,
@@ -815,7 +1102,38 @@ uint32 GLTFParser::handlePrimitive(const tinygltf::Primitive& primitive, glm::ma
         attributesOffset.sizeBytes,
         attributesOffset.offset
     };
-    return writeMeshFile(meshWrite);
+    uint32 meshIndex = writeMeshFile(meshWrite);
+    m_meshLods.push_back(job.lods);
+    m_meshDecodes.push_back(job.decode);
+    m_floatVertexBytes += (uint64)job.vertexCount * (sizeof(spr::gfx::VertexPosition) + sizeof(spr::gfx::VertexAttributes));
+
+    uint32 triangleCount = job.lods.lods[0].indexCount / 3;
+    m_triangleCount += triangleCount;
+    for (uint32 lod = 1; lod < job.lods.lodCount; lod++){
+        m_lodTriangleCount += job.lods.lods[lod].indexCount / 3;
+    }
+
+    if (m_meshSettings.report){
+        std::cout << "mesh " << meshIndex << ": " << triangleCount << " triangles, " << job.vertexCount << " vertices, ";
+        if (job.lods.lodCount > 1){
+            std::cout << "lods";
+            for (uint32 lod = 1; lod < job.lods.lodCount; lod++){
+                std::cout << " " << job.lods.lods[lod].indexCount / 3;
+            }
+            std::cout << ", ";
+        }
+        if (job.after.acmr == 0.f){
+            std::cout << "not optimized" << std::endl;
+            return;
+        }
+        std::cout << std::fixed << std::setprecision(3)
+                  << "acmr " << job.before.acmr << " -> " << job.after.acmr << ", "
+                  << "atvr " << job.before.atvr << " -> " << job.after.atvr << std::endl;
+        std::cout.unsetf(std::ios::fixed);
+
+        m_missesBefore += job.before.acmr * triangleCount;
+        m_missesAfter += job.after.acmr * triangleCount;
+    }
 }
 
 void GLTFParser::handleMesh(const tinygltf::Mesh& mesh, std::vector<uint32> &meshIds, glm::mat4& transform){
@@ -892,7 +1210,7 @@ void GLTFParser::parseNode(const tinygltf::Node& node, std::vector<uint32> &mesh
     }
 }
 
-void GLTFParser::parse(){
+bool GLTFParser::parse(){
     init();
 
     // assume one scene
@@ -907,8 +1225,81 @@ void GLTFParser::parse(){
         parseNode(currNode, meshIds, identity);
     }
 
+    convert();
+    reportMeshes();
+    reportTextures();
     consolidate();
     cleanup();
+
+    if (m_failedTextureCount > 0){
+        std::cerr << m_failedTextureCount << " of " << m_textureJobs.size() << " textures failed to convert and were written empty" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void GLTFParser::convert(){
+    // textures first, they take the longest
+    uint32 textureCount = m_textureJobs.size();
+    uint32 jobCount = textureCount + m_meshJobs.size();
+    auto run = [this, textureCount](uint32 job){
+        if (job < textureCount)
+            convertTexture(m_textureJobs[job]);
+        else
+            convertMesh(m_meshJobs[job - textureCount]);
+    };
+    auto write = [this, textureCount](uint32 job){
+        if (job < textureCount)
+            writeTexture(m_textureJobs[job]);
+        else
+            writeMesh(m_meshJobs[job - textureCount]);
+    };
+
+    if (m_jobCount == 1){
+        for (uint32 i = 0; i < jobCount; i++){
+            run(i);
+            write(i);
+        }
+        return;
+    }
+
+    // jobs finish in any order but are written in order, so the .smdl
+    // doesn't depend on the thread count. only a window of jobs is
+    // in flight, so finished textures don't pile up in memory
+    ThreadPool pool(m_jobCount - 1);
+    uint32 window = 2 * m_jobCount;
+    std::unique_ptr<std::atomic<uint32>[]> groups(new std::atomic<uint32>[jobCount]);
+    uint32 submitted = 0;
+    for (uint32 i = 0; i < jobCount; i++){
+        for (; submitted < std::min(jobCount, i + window); submitted++){
+            groups[submitted] = 0;
+            pool.submit([&run, submitted]{ run(submitted); }, &groups[submitted]);
+        }
+
+        // this thread helps out until job i is done
+        pool.wait(groups[i]);
+        write(i);
+    }
+}
+
+void GLTFParser::reportMeshes(){
+    if (!m_meshSettings.report || m_triangleCount == 0)
+        return;
+
+    std::cout << m_meshCount << " meshes: " << m_triangleCount << " triangles (" << m_lodTriangleCount << " more in lods), acmr "
+              << std::fixed << std::setprecision(3) << m_missesBefore / m_triangleCount << " -> " << m_missesAfter / m_triangleCount << std::endl;
+    std::cout.unsetf(std::ios::fixed);
+    std::cout << "vertices: " << m_positionOffset + m_attributesOffset << " bytes (" << m_floatVertexBytes << " as floats)" << std::endl;
+}
+
+void GLTFParser::reportTextures(){
+    if (!m_textureSettings.report || m_textureCount == 0)
+        return;
+
+    double ratio = m_textureDataOffset ? (double)m_rawTextureBytes / m_textureDataOffset : 0;
+    std::cout << m_textureCount << " textures: " << m_rawTextureBytes << " -> " << m_textureDataOffset << " bytes ("
+              << std::fixed << std::setprecision(2) << ratio << "x)" << std::endl;
+    std::cout.unsetf(std::ios::fixed);
 }
 
 void GLTFParser::init(){
@@ -935,7 +1326,10 @@ void GLTFParser::consolidate(){
         .textureCount = m_textureCount,
         .textureBufferOffset = 0,
         .blobHeaderOffset = 0,
-        .blobDataOffset = 0
+        .blobDataOffset = 0,
+        .version = SPR_MODEL_VERSION,
+        .meshLodBufferOffset = 0,
+        .meshDecodeBufferOffset = 0
     };
     for (uint32 i = 0; i < 32; i++){
         modelHeader.name[i] = modelName[i];
@@ -943,7 +1337,9 @@ void GLTFParser::consolidate(){
     modelHeader.meshBufferOffset = sizeof(ModelHeader);
     modelHeader.materialBufferOffset = modelHeader.meshBufferOffset + m_meshCount * sizeof(MeshLayout);
     modelHeader.textureBufferOffset = modelHeader.materialBufferOffset + m_materialCount * sizeof(MaterialLayout);
-    modelHeader.blobHeaderOffset = modelHeader.textureBufferOffset + m_textureCount * sizeof(TextureLayout);
+    modelHeader.meshLodBufferOffset = modelHeader.textureBufferOffset + m_textureCount * sizeof(TextureLayout);
+    modelHeader.meshDecodeBufferOffset = modelHeader.meshLodBufferOffset + m_meshCount * sizeof(MeshLodLayout);
+    modelHeader.blobHeaderOffset = modelHeader.meshDecodeBufferOffset + m_meshCount * sizeof(MeshDecodeLayout);
     modelHeader.blobDataOffset = modelHeader.blobHeaderOffset + sizeof(BlobHeader);
     m_modelStream.write((char*)&modelHeader, sizeof(ModelHeader));
 
@@ -984,6 +1380,8 @@ void GLTFParser::consolidate(){
     m_outputStream << m_meshStreamI.rdbuf();
     m_outputStream << m_materialStreamI.rdbuf();
     m_outputStream << m_textureStreamI.rdbuf();
+    m_outputStream.write((char*)m_meshLods.data(), m_meshLods.size() * sizeof(MeshLodLayout));
+    m_outputStream.write((char*)m_meshDecodes.data(), m_meshDecodes.size() * sizeof(MeshDecodeLayout));
     m_outputStream.write((char*)&blobHeader, sizeof(BlobHeader));
     m_outputStream << m_indexDataStreamI.rdbuf();
     m_outputStream << m_positionDataStreamI.rdbuf();
@@ -1014,17 +1412,19 @@ void GLTFParser::cleanup(){
 }
 
 // parse .gltf file
-void GLTFParser::parseJson(std::string path){
+bool GLTFParser::parseJson(std::string path){
     bool ret = loader.LoadASCIIFromFile(&model, &err, &warn, path);
 
     if (!warn.empty()) {
+        std::cerr << "Warning: " << warn << std::endl;
     }
 
     if (!err.empty()) {
+        std::cerr << "Error: " << err << std::endl;
     }
 
     if (!ret) {
-        return;
+        return false;
     }
 
     m_path = std::filesystem::path(path).parent_path().concat("/");
@@ -1032,21 +1432,23 @@ void GLTFParser::parseJson(std::string path){
     m_extension = std::filesystem::path(path).extension();
 
 
-    parse();
+    return parse();
 }
 
 // parse .glb file
-void GLTFParser::parseBinary(std::string path){
+bool GLTFParser::parseBinary(std::string path){
     bool ret = loader.LoadBinaryFromFile(&model, &err, &warn, path);
 
     if (!warn.empty()) {
+        std::cerr << "Warning: " << warn << std::endl;
     }
 
     if (!err.empty()) {
+        std::cerr << "Error: " << err << std::endl;
     }
 
     if (!ret) {
-        return;
+        return false;
     }   
 
     m_path = std::filesystem::path(path).parent_path().concat("/");
@@ -1054,7 +1456,7 @@ void GLTFParser::parseBinary(std::string path){
     m_extension = std::filesystem::path(path).extension();
 
 
-    parse();
+    return parse();
 }
 
 }
\ No newline at end of file
@@ -10,6 +10,7 @@
 #include "glm/gtx/quaternion.hpp"
 #include <glm/gtc/matrix_inverse.hpp>
 #include "Resources.h"
+#include "MeshOptimizer.h"
 
 typedef std::unordered_map<uint32_t, uint32_t> IdMap;
 
@@ -35,18 +36,85 @@ enum BufferData {
     SPR_TEXTURE_OTHER = 9,
 };
 
+enum TextureEncoding {
+    SPR_ENCODE_RGBA = 0,    // uncompressed
+    SPR_ENCODE_ETC1S = 1,   // basis lz, smallest, fine for color
+    SPR_ENCODE_UASTC = 2    // bigger, keeps normals and packed data intact
+};
+
+// basis universal encoding per texture role
+struct TextureSettings {
+    TextureEncoding color = SPR_ENCODE_ETC1S;
+    TextureEncoding normal = SPR_ENCODE_UASTC;
+    TextureEncoding other = SPR_ENCODE_UASTC;   // metal/rough, occlusion, emissive
+    uint32 etc1sQuality = 128;                  // 1..255
+    uint32 uastcLevel = 2;                      // KTX_PACK_UASTC_LEVEL_DEFAULT, 0..4
+    uint32 zstdLevel = 18;                      // uastc/rgba supercompression, 0 is off
+    bool report = false;                        // print size and psnr per texture
+};
+
+// mesh optimisation before the buffers are written
+struct MeshSettings {
+    bool optimize = true;               // vertex cache, overdraw, vertex fetch
+    float overdrawThreshold = 1.05f;    // acmr given up for less overdraw
+    bool report = false;                // print cache stats per mesh
+
+    // error limit of each lod past 0, relative to the mesh's size (bounding
+    // box diagonal), up to SPR_MAX_MESH_LODS - 1. empty for no lods
+    std::vector<float> lodErrors = {0.002f, 0.005f, 0.01f, 0.02f};
+    float lodRatio = 0.5f;              // triangles of a lod, of the one before
+
+    // 16 bit positions/uvs/normals, 8 bit tangents/colors, 20 bytes per vertex
+    // instead of 48. positions are off by up to 1/65535 of the mesh's size
+    bool quantize = false;
+};
+
 struct OffsetSpan {
     uint32_t sizeBytes = 0;
     uint32_t offset = 0;
 };
 
+// one primitive's buffers, converted on any thread
+struct MeshJob {
+    const tinygltf::Primitive* primitive;
+    glm::mat4 transform;
+    uint32 materialIndex;
+    uint32 materialFlags;
+    std::vector<uint8_t> indices;
+    std::vector<uint8_t> positions;
+    std::vector<uint8_t> attributes;
+    std::vector<uint8_t> tangents;      // vec4 per vertex, --quantize only
+    MeshLodLayout lods;
+    MeshDecodeLayout decode;
+
+    // --report only
+    uint32 vertexCount;
+    VertexCacheStats before;
+    VertexCacheStats after;
+};
+
+// one source image: decode, mips and ktx2, converted on any thread
+struct TextureJob {
+    int32 sourceIndex;
+    BufferData dataType;
+    uint32 components;
+    std::vector<uint8_t> data;
+
+    // --report only
+    uint64 rawBytes;
+    double psnr;
+};
+
 class GLTFParser {
 public:
-    GLTFParser();
+    // jobCount threads convert meshes and textures, the output
+    // is identical for any count
+    GLTFParser(uint32 jobCount = 1, TextureSettings textureSettings = {}, MeshSettings meshSettings = {});
     ~GLTFParser(){}
 
-    void parseJson(std::string path);
-    void parseBinary(std::string path);
+    // false if the file couldn't be loaded or a texture failed to convert
+    bool parseJson(std::string path);
+    bool parseBinary(std::string path);
 private:
     tinygltf::Model model;
     tinygltf::TinyGLTF loader;
@@ -56,7 +124,9 @@ private:
     std::string m_name;
     std::string m_extension;
     uint32_t m_id = 0;
-    IdMap m_sourceBuffIdMap;
+    uint32 m_jobCount;
+    TextureSettings m_textureSettings;
+    MeshSettings m_meshSettings;
     IdMap m_sourceTexIdMap;
 
     std::ofstream m_outputStream;
@@ -85,27 +155,53 @@ private:
     uint32 m_meshCount = 0;
     uint32 m_materialCount = 0;
     uint32 m_textureCount = 0;
+    uint32 m_failedTextureCount = 0;
 
     uint32 m_indicesOffset = 0;
     uint32 m_positionOffset = 0;
     uint32 m_attributesOffset = 0;
     uint32 m_textureDataOffset = 0;
+    uint64 m_rawTextureBytes = 0;
+    uint32 m_triangleCount = 0;
+    uint32 m_lodTriangleCount = 0;
+    uint64 m_floatVertexBytes = 0;
+    float m_missesBefore = 0;
+    float m_missesAfter = 0;
+
+    // gathered while walking the scene, indices are mesh/texture ids
+    std::vector<MeshJob> m_meshJobs;
+    std::vector<TextureJob> m_textureJobs;
 
-    void parse();
+    // written after the textures, in mesh order
+    std::vector<MeshLodLayout> m_meshLods;
+    std::vector<MeshDecodeLayout> m_meshDecodes;
+
+    bool parse();
     void init();
+    void convert();
+    void convertMesh(MeshJob& job);
+    void generateLods(MeshJob& job, uint32 vertexCount);
+    void quantizeVertices(MeshJob& job, uint32 vertexCount);
+    void convertTexture(TextureJob& job);
+    void writeMesh(MeshJob& job);
+    void writeTexture(TextureJob& job);
+    void measureTexture(TextureJob& job);
+    void reportTextures();
+    void reportMeshes();
+    TextureEncoding getEncoding(BufferData dataType);
     void consolidate();
     void cleanup();
     void parseNode(const tinygltf::Node& node, std::vector<uint32_t> &meshIds, glm::mat4& transform);
     void handleMesh(const tinygltf::Mesh& mesh, std::vector<uint32_t> &meshIds, glm::mat4& transform);
     uint32_t handlePrimitive(const tinygltf::Primitive& primitive, glm::mat4& transform);
-    OffsetSpan interleaveVertexAttributes(
+    void interleaveVertexAttributes(
         uint32_t vertexCount,
         std::vector<uint8_t>& normalBuffer,
         std::vector<uint8_t>& tangentBuffer,
         std::vector<uint8_t>& texCoordBuffer,
         std::vector<uint8_t>& colorBuffer,
         glm::mat4& transform,
-        DataRegion region);
+        std::vector<uint8_t>& out);
     uint32 handleMaterial(const tinygltf::Material& material, uint32_t& outMaterialFlags);
     uint32 handleTexture(const tinygltf::TextureInfo& texInfo, BufferData dataType);
     uint32 handleTexture(const tinygltf::NormalTextureInfo& texInfo);
@@ -167,6 +263,8 @@ private:
         uint32_t elementCount,
         uint32_t elementType, 
         uint32_t componentType,
+        std::vector<uint8_t>& out,
+        bool writeToFile,
         BufferData dataType);
     void createMip(
         unsigned char* in, 
@@ -175,11 +273,11 @@ private:
         unsigned char* mipOut, 
         uint32_t outSizeBytes, 
         uint32_t outExtent);
-    void compressImageData(
+    // false (and out empty) if any libktx step failed, reported on stderr
+    bool compressImageData(
         unsigned char* data,
         uint32_t dataSize,
-        unsigned char** outData,
-        uint32_t& outDataSize,
+        std::vector<uint8_t>& out,
         BufferData dataType,
         uint32_t width,
         uint32_t height,
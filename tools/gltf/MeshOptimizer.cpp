@@ -0,0 +1,605 @@
+#include "MeshOptimizer.h"
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+#include "glm/glm.hpp"
+
+namespace spr::tools {
+
+// forsyth's scoring, see "linear-speed vertex cache optimisation"
+static const uint32 s_lruCacheSize = 32;
+static const float s_cacheDecayPower = 1.5f;
+static const float s_lastTriangleScore = 0.75f;
+static const float s_valenceBoostScale = 2.0f;
+static const float s_valenceBoostPower = 0.5f;
+
+// border edges count this much more than the surface next to them
+static const double s_borderWeight = 10.0;
+
+static float vertexScore(int32 cachePosition, uint32 valence){
+    if (valence == 0)
+        return -1.f;
+
+    float score = 0.f;
+    if (cachePosition >= 0){
+        // the last triangle's vertices score the same, so it's not favored by order
+        if (cachePosition < 3){
+            score = s_lastTriangleScore;
+        } else {
+            float scale = 1.f / (s_lruCacheSize - 3);
+            score = std::pow(1.f - (cachePosition - 3) * scale, s_cacheDecayPower);
+        }
+    }
+
+    // vertices with few triangles left go first, so they don't linger
+    return score + s_valenceBoostScale * std::pow((float)valence, -s_valenceBoostPower);
+}
+
+// fifo cache misses of triangles [first, last), from an empty cache
+static uint32 countMisses(const uint32* indices, uint32 first, uint32 last, std::vector<uint32>& cacheTime, uint32& time){
+    time += SPR_VERTEX_CACHE_SIZE + 1;
+    uint32 misses = 0;
+    for (uint32 i = first * 3; i < last * 3; i++){
+        uint32 vertex = indices[i];
+        if (time - cacheTime[vertex] > SPR_VERTEX_CACHE_SIZE){
+            cacheTime[vertex] = time++;
+            misses++;
+        }
+    }
+    return misses;
+}
+
+VertexCacheStats MeshOptimizer::analyzeVertexCache(const uint32* indices, uint32 indexCount, uint32 vertexCount){
+    std::vector<uint32> cacheTime(vertexCount, 0);
+    std::vector<bool> used(vertexCount, false);
+    uint32 time = 0;
+    uint32 misses = countMisses(indices, 0, indexCount / 3, cacheTime, time);
+
+    uint32 usedCount = 0;
+    for (uint32 i = 0; i < indexCount; i++){
+        if (!used[indices[i]]){
+            used[indices[i]] = true;
+            usedCount++;
+        }
+    }
+
+    return {
+        .acmr = indexCount ? (float)misses / (indexCount / 3) : 0.f,
+        .atvr = usedCount ? (float)misses / usedCount : 0.f
+    };
+}
+
+void MeshOptimizer::optimizeVertexCache(uint32* indices, uint32 indexCount, uint32 vertexCount){
+    uint32 triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+        return;
+
+    // triangles of each vertex, packed
+    std::vector<uint32> valence(vertexCount, 0);
+    for (uint32 i = 0; i < indexCount; i++){
+        valence[indices[i]]++;
+    }
+    std::vector<uint32> adjacencyOffset(vertexCount + 1, 0);
+    for (uint32 i = 0; i < vertexCount; i++){
+        adjacencyOffset[i + 1] = adjacencyOffset[i] + valence[i];
+    }
+    std::vector<uint32> adjacency(indexCount);
+    std::vector<uint32> adjacencyCount(vertexCount, 0);
+    for (uint32 i = 0; i < indexCount; i++){
+        uint32 vertex = indices[i];
+        adjacency[adjacencyOffset[vertex] + adjacencyCount[vertex]++] = i / 3;
+    }
+
+    std::vector<int32> cachePosition(vertexCount, -1);
+    std::vector<float> score(vertexCount);
+    for (uint32 i = 0; i < vertexCount; i++){
+        score[i] = vertexScore(-1, valence[i]);
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+    std::vector<float> triangleScore(triangleCount);
+    uint32 best = 0;
+    for (uint32 i = 0; i < triangleCount; i++){
+        triangleScore[i] = score[indices[i * 3]] + score[indices[i * 3 + 1]] + score[indices[i * 3 + 2]];
+        if (triangleScore[i] > triangleScore[best])
+            best = i;
+    }
+
+    std::vector<uint32> result(indexCount);
+    std::vector<uint32> cache;
+    std::vector<uint32> nextCache;
+    cache.reserve(s_lruCacheSize + 3);
+    nextCache.reserve(s_lruCacheSize + 3);
+    uint32 cursor = 0;
+
+    for (uint32 output = 0; output < triangleCount; output++){
+        const uint32* triangle = indices + best * 3;
+        memcpy(result.data() + output * 3, triangle, 3 * sizeof(uint32));
+        emitted[best] = true;
+
+        // drop the triangle from its vertices
+        for (uint32 corner = 0; corner < 3; corner++){
+            uint32 vertex = triangle[corner];
+            uint32* triangles = adjacency.data() + adjacencyOffset[vertex];
+            uint32* end = triangles + valence[vertex];
+            *std::find(triangles, end, best) = *(end - 1);
+            valence[vertex]--;
+        }
+
+        // its vertices move to the front of the cache
+        nextCache.clear();
+        for (uint32 corner = 0; corner < 3; corner++){
+            if (std::find(nextCache.begin(), nextCache.end(), triangle[corner]) == nextCache.end())
+                nextCache.push_back(triangle[corner]);
+        }
+        for (uint32 vertex : cache){
+            if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+                nextCache.push_back(vertex);
+        }
+        for (uint32 i = s_lruCacheSize; i < nextCache.size(); i++){
+            cachePosition[nextCache[i]] = -1;
+            score[nextCache[i]] = vertexScore(-1, valence[nextCache[i]]);
+        }
+        nextCache.resize(std::min((uint32)nextCache.size(), s_lruCacheSize));
+        cache.swap(nextCache);
+
+        for (uint32 i = 0; i < cache.size(); i++){
+            cachePosition[cache[i]] = i;
+            score[cache[i]] = vertexScore(i, valence[cache[i]]);
+        }
+
+        // next is the best triangle touching the cache
+        bool found = false;
+        float bestScore = 0.f;
+        for (uint32 vertex : cache){
+            const uint32* triangles = adjacency.data() + adjacencyOffset[vertex];
+            for (uint32 i = 0; i < valence[vertex]; i++){
+                uint32 candidate = triangles[i];
+                const uint32* corners = indices + candidate * 3;
+                float candidateScore = score[corners[0]] + score[corners[1]] + score[corners[2]];
+                if (!found || candidateScore > bestScore || (candidateScore == bestScore && candidate < best)){
+                    best = candidate;
+                    bestScore = candidateScore;
+                    found = true;
+                }
+            }
+        }
+
+        // dead end, continue with the next triangle in input order
+        if (!found){
+            while (cursor < triangleCount && emitted[cursor]){
+                cursor++;
+            }
+            best = cursor;
+        }
+    }
+
+    memcpy(indices, result.data(), indexCount * sizeof(uint32));
+}
+
+void MeshOptimizer::optimizeOverdraw(uint32* indices, uint32 indexCount, const uint8* positions, uint32 positionStride, uint32 vertexCount, float threshold){
+    uint32 triangleCount = indexCount / 3;
+    if (triangleCount == 0)
+        return;
+
+    // hard boundaries: the cache restarted (three misses in a triangle)
+    std::vector<uint32> cacheTime(vertexCount, 0);
+    uint32 time = 0;
+    std::vector<uint32> hardClusters;
+    time += SPR_VERTEX_CACHE_SIZE + 1;
+    for (uint32 i = 0; i < triangleCount; i++){
+        uint32 misses = 0;
+        for (uint32 corner = 0; corner < 3; corner++){
+            uint32 vertex = indices[i * 3 + corner];
+            if (time - cacheTime[vertex] > SPR_VERTEX_CACHE_SIZE){
+                cacheTime[vertex] = time++;
+                misses++;
+            }
+        }
+        if (i == 0 || misses == 3)
+            hardClusters.push_back(i);
+    }
+    hardClusters.push_back(triangleCount);
+
+    // soft boundaries: split a hard cluster once the triangles so far
+    // are within threshold of its acmr, each piece still caches well
+    std::vector<uint32> clusters;
+    for (uint32 c = 0; c + 1 < hardClusters.size(); c++){
+        uint32 start = hardClusters[c];
+        uint32 end = hardClusters[c + 1];
+        float clusterThreshold = threshold * countMisses(indices, start, end, cacheTime, time) / (end - start);
+
+        clusters.push_back(start);
+        uint32 first = start;
+        time += SPR_VERTEX_CACHE_SIZE + 1;
+        uint32 misses = 0;
+        for (uint32 i = start; i < end; i++){
+            for (uint32 corner = 0; corner < 3; corner++){
+                uint32 vertex = indices[i * 3 + corner];
+                if (time - cacheTime[vertex] > SPR_VERTEX_CACHE_SIZE){
+                    cacheTime[vertex] = time++;
+                    misses++;
+                }
+            }
+
+            if (i + 1 < end && (float)misses / (i + 1 - first) <= clusterThreshold){
+                clusters.push_back(i + 1);
+                first = i + 1;
+                misses = 0;
+                time += SPR_VERTEX_CACHE_SIZE + 1;
+            }
+        }
+    }
+    uint32 clusterCount = clusters.size();
+    clusters.push_back(triangleCount);
+
+    auto position = [positions, positionStride](uint32 vertex){
+        float xyz[3];
+        memcpy(xyz, positions + (uint64)vertex * positionStride, sizeof(xyz));
+        return glm::vec3(xyz[0], xyz[1], xyz[2]);
+    };
+
+    glm::vec3 meshCentroid = glm::vec3(0.f);
+    for (uint32 i = 0; i < indexCount; i++){
+        meshCentroid += position(indices[i]);
+    }
+    meshCentroid /= (float)indexCount;
+
+    // clusters far out along their (area weighted) normal are likely
+    // in front of the rest, draw those first
+    std::vector<float> sortKey(clusterCount);
+    for (uint32 c = 0; c < clusterCount; c++){
+        glm::vec3 centroid = glm::vec3(0.f);
+        glm::vec3 normal = glm::vec3(0.f);
+        float area = 0.f;
+        for (uint32 i = clusters[c]; i < clusters[c + 1]; i++){
+            glm::vec3 p0 = position(indices[i * 3]);
+            glm::vec3 p1 = position(indices[i * 3 + 1]);
+            glm::vec3 p2 = position(indices[i * 3 + 2]);
+            glm::vec3 cross = glm::cross(p1 - p0, p2 - p0);
+            float triangleArea = glm::length(cross);
+
+            centroid += (p0 + p1 + p2) * (triangleArea / 3.f);
+            normal += cross;
+            area += triangleArea;
+        }
+
+        float normalLength = glm::length(normal);
+        centroid = area > 0.f ? centroid / area : position(indices[clusters[c] * 3]);
+        sortKey[c] = normalLength > 0.f ? glm::dot(centroid - meshCentroid, normal / normalLength) : 0.f;
+    }
+
+    std::vector<uint32> order(clusterCount);
+    for (uint32 c = 0; c < clusterCount; c++){
+        order[c] = c;
+    }
+    std::stable_sort(order.begin(), order.end(), [&sortKey](uint32 a, uint32 b){
+        return sortKey[a] > sortKey[b];
+    });
+
+    std::vector<uint32> result;
+    result.reserve(indexCount);
+    for (uint32 c : order){
+        result.insert(result.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+    }
+    memcpy(indices, result.data(), indexCount * sizeof(uint32));
+}
+
+uint32 MeshOptimizer::optimizeVertexFetch(uint32* indices, uint32 indexCount, uint32 vertexCount, std::vector<uint32>& remap){
+    remap.assign(vertexCount, UINT32_MAX);
+    uint32 usedVertexCount = 0;
+    for (uint32 i = 0; i < indexCount; i++){
+        uint32& vertex = remap[indices[i]];
+        if (vertex == UINT32_MAX)
+            vertex = usedVertexCount++;
+        indices[i] = vertex;
+    }
+    return usedVertexCount;
+}
+
+void MeshOptimizer::remapVertices(std::vector<uint8_t>& vertices, uint32 vertexStride, const std::vector<uint32>& remap, uint32 usedVertexCount){
+    std::vector<uint8_t> result((uint64)usedVertexCount * vertexStride);
+    for (uint32 i = 0; i < remap.size(); i++){
+        if (remap[i] != UINT32_MAX)
+            memcpy(result.data() + (uint64)remap[i] * vertexStride, vertices.data() + (uint64)i * vertexStride, vertexStride);
+    }
+    vertices.swap(result);
+}
+
+// sum of squared distances to planes, error(p) = p'Ap + 2b'p + c
+typedef struct {
+    double a00, a01, a02, a11, a12, a22;
+    double b0, b1, b2;
+    double c;
+    double weight;
+} Quadric;
+
+enum VertexKind : uint8 {
+    SPR_VERTEX_INTERIOR = 0,
+    SPR_VERTEX_BORDER = 1,      // collapses along border edges only
+    SPR_VERTEX_LOCKED = 2       // seams, non-manifold
+};
+
+typedef struct {
+    uint32 from;    // representative
+    uint32 to;      // vertex
+    double cost;
+} Collapse;
+
+static void addPlane(Quadric& quadric, glm::dvec3 normal, double distance, double weight){
+    quadric.a00 += weight * normal.x * normal.x;
+    quadric.a01 += weight * normal.x * normal.y;
+    quadric.a02 += weight * normal.x * normal.z;
+    quadric.a11 += weight * normal.y * normal.y;
+    quadric.a12 += weight * normal.y * normal.z;
+    quadric.a22 += weight * normal.z * normal.z;
+    quadric.b0 += weight * normal.x * distance;
+    quadric.b1 += weight * normal.y * distance;
+    quadric.b2 += weight * normal.z * distance;
+    quadric.c += weight * distance * distance;
+}
+
+static void addQuadric(Quadric& quadric, const Quadric& other){
+    quadric.a00 += other.a00;
+    quadric.a01 += other.a01;
+    quadric.a02 += other.a02;
+    quadric.a11 += other.a11;
+    quadric.a12 += other.a12;
+    quadric.a22 += other.a22;
+    quadric.b0 += other.b0;
+    quadric.b1 += other.b1;
+    quadric.b2 += other.b2;
+    quadric.c += other.c;
+    quadric.weight += other.weight;
+}
+
+// squared distance, averaged over the planes' area
+static double quadricError(const Quadric& quadric, glm::dvec3 p){
+    double error = quadric.a00 * p.x * p.x + quadric.a11 * p.y * p.y + quadric.a22 * p.z * p.z
+                 + 2.0 * (quadric.a01 * p.x * p.y + quadric.a02 * p.x * p.z + quadric.a12 * p.y * p.z)
+                 + 2.0 * (quadric.b0 * p.x + quadric.b1 * p.y + quadric.b2 * p.z)
+                 + quadric.c;
+    return std::fabs(error) / std::max(quadric.weight, 1e-20);
+}
+
+static uint64 edgeKey(uint32 a, uint32 b){
+    return ((uint64)a << 32) | b;
+}
+
+uint32 MeshOptimizer::simplify(std::vector<uint32>& out, const uint32* indices, uint32 indexCount, const uint8* positions, uint32 positionStride, uint32 vertexCount, uint32 targetIndexCount, float maxError, float& error){
+    out.assign(indices, indices + indexCount);
+    error = 0.f;
+    if (indexCount < 3)
+        return indexCount;
+
+    auto position = [positions, positionStride](uint32 vertex){
+        float xyz[3];
+        memcpy(xyz, positions + (uint64)vertex * positionStride, sizeof(xyz));
+        return glm::dvec3(xyz[0], xyz[1], xyz[2]);
+    };
+
+    // vertices at the same position (split for their attributes) are one
+    // vertex to the topology, the first of them stands in for the rest
+    std::vector<bool> used(vertexCount, false);
+    std::vector<uint32> order;
+    for (uint32 i = 0; i < indexCount; i++){
+        if (!used[indices[i]]){
+            used[indices[i]] = true;
+            order.push_back(indices[i]);
+        }
+    }
+    std::sort(order.begin(), order.end(), [positions, positionStride](uint32 a, uint32 b){
+        int32 compare = memcmp(positions + (uint64)a * positionStride, positions + (uint64)b * positionStride, 3 * sizeof(float));
+        return compare != 0 ? compare < 0 : a < b;
+    });
+
+    std::vector<uint32> representative(vertexCount);
+    std::vector<uint8> kind(vertexCount, SPR_VERTEX_INTERIOR);
+    for (uint32 i = 0; i < order.size();){
+        uint32 first = i;
+        for (i++; i < order.size() && memcmp(positions + (uint64)order[first] * positionStride, positions + (uint64)order[i] * positionStride, 3 * sizeof(float)) == 0; i++){
+            representative[order[i]] = order[first];
+        }
+        representative[order[first]] = order[first];
+
+        // an attribute seam, moving it would tear the surface
+        if (i - first > 1)
+            kind[order[first]] = SPR_VERTEX_LOCKED;
+    }
+
+    // edges of one triangle only are borders, edges of more aren't manifold
+    std::unordered_map<uint64, uint32> edges;
+    for (uint32 i = 0; i < indexCount; i += 3){
+        for (uint32 corner = 0; corner < 3; corner++){
+            uint32 a = representative[indices[i + corner]];
+            uint32 b = representative[indices[i + (corner + 1) % 3]];
+            if (a != b)
+                edges[edgeKey(a, b)]++;
+        }
+    }
+    auto isBorder = [&edges](uint32 a, uint32 b){
+        return edges.find(edgeKey(b, a)) == edges.end() && edges.find(edgeKey(a, b)) != edges.end();
+    };
+
+    // borders that aren't a simple chain through the vertex are locked too
+    std::vector<uint32> bordersOut(vertexCount, 0);
+    std::vector<uint32> bordersIn(vertexCount, 0);
+    for (auto& [key, count] : edges){
+        uint32 a = key >> 32;
+        uint32 b = key & UINT32_MAX;
+        if (count > 1){
+            kind[a] = kind[b] = SPR_VERTEX_LOCKED;
+        } else if (isBorder(a, b)){
+            bordersOut[a]++;
+            bordersIn[b]++;
+        }
+    }
+    for (uint32 vertex : order){
+        if (kind[vertex] == SPR_VERTEX_LOCKED || bordersOut[vertex] + bordersIn[vertex] == 0)
+            continue;
+        kind[vertex] = bordersOut[vertex] == 1 && bordersIn[vertex] == 1 ? SPR_VERTEX_BORDER : SPR_VERTEX_LOCKED;
+    }
+
+    // planes of the triangles around each vertex, weighted by area
+    std::vector<Quadric> quadrics(vertexCount, Quadric{});
+    for (uint32 i = 0; i < indexCount; i += 3){
+        uint32 corners[3] = {representative[indices[i]], representative[indices[i + 1]], representative[indices[i + 2]]};
+        glm::dvec3 p0 = position(corners[0]);
+        glm::dvec3 cross = glm::cross(position(corners[1]) - p0, position(corners[2]) - p0);
+        double length = glm::length(cross);
+        if (length == 0.0)
+            continue;
+
+        glm::dvec3 normal = cross / length;
+        for (uint32 corner = 0; corner < 3; corner++){
+            Quadric& quadric = quadrics[corners[corner]];
+            addPlane(quadric, normal, -glm::dot(normal, p0), length * 0.5);
+            quadric.weight += length * 0.5;
+
+            // keep borders in place with a plane through the edge, along the normal
+            uint32 next = corners[(corner + 1) % 3];
+            if (!isBorder(corners[corner], next))
+                continue;
+            glm::dvec3 edge = position(next) - position(corners[corner]);
+            glm::dvec3 edgeNormal = glm::cross(edge, normal);
+            double edgeLength = glm::length(edgeNormal);
+            if (edgeLength == 0.0)
+                continue;
+            edgeNormal /= edgeLength;
+            double distance = -glm::dot(edgeNormal, position(next));
+            addPlane(quadrics[corners[corner]], edgeNormal, distance, s_borderWeight * edgeLength * edgeLength);
+            addPlane(quadrics[next], edgeNormal, distance, s_borderWeight * edgeLength * edgeLength);
+        }
+    }
+
+    std::vector<uint32> collapseTo(vertexCount, UINT32_MAX);
+    std::vector<bool> touched(vertexCount);
+    std::vector<uint32> adjacencyOffset(vertexCount + 1);
+    std::vector<uint32> adjacency;
+    std::vector<Collapse> collapses;
+    double maxCost = (double)maxError * maxError;
+    double passError = 0.0;
+    uint32 targetTriangles = targetIndexCount / 3;
+
+    // passes of independent collapses, cheapest first, until
+    // the target is reached or the rest are too expensive
+    while (out.size() / 3 > targetTriangles){
+        uint32 triangleCount = out.size() / 3;
+
+        // triangles around each representative
+        std::fill(adjacencyOffset.begin(), adjacencyOffset.end(), 0);
+        for (uint32 i = 0; i < out.size(); i++){
+            adjacencyOffset[representative[out[i]] + 1]++;
+        }
+        for (uint32 i = 0; i < vertexCount; i++){
+            adjacencyOffset[i + 1] += adjacencyOffset[i];
+        }
+        adjacency.resize(out.size());
+        std::vector<uint32> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+        for (uint32 i = 0; i < out.size(); i++){
+            adjacency[fill[representative[out[i]]]++] = i / 3;
+        }
+
+        collapses.clear();
+        auto addCollapse = [&](uint32 from, uint32 to){
+            uint32 target = representative[to];
+            if (kind[from] == SPR_VERTEX_LOCKED || (kind[from] == SPR_VERTEX_BORDER && !isBorder(from, target) && !isBorder(target, from)))
+                return;
+            Quadric quadric = quadrics[from];
+            addQuadric(quadric, quadrics[target]);
+            collapses.push_back({from, to, quadricError(quadric, position(target))});
+        };
+        for (uint32 i = 0; i < out.size(); i++){
+            uint32 a = out[i];
+            uint32 b = out[i - i % 3 + (i + 1) % 3];
+            if (representative[a] == representative[b])
+                continue;
+            addCollapse(representative[a], b);
+            addCollapse(representative[b], a);
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b){
+            if (a.cost != b.cost)
+                return a.cost < b.cost;
+            return a.from != b.from ? a.from < b.from : a.to < b.to;
+        });
+
+        std::fill(touched.begin(), touched.end(), false);
+        uint32 removable = triangleCount - targetTriangles;
+        uint32 removed = 0;
+        for (const Collapse& collapse : collapses){
+            if (collapse.cost > maxCost || removed >= removable)
+                break;
+
+            uint32 from = collapse.from;
+            uint32 target = representative[collapse.to];
+            if (touched[from] || touched[target])
+                continue;
+
+            // triangles that stay can't flip
+            glm::dvec3 moved = position(target);
+            bool flips = false;
+            for (uint32 i = adjacencyOffset[from]; i < adjacencyOffset[from + 1] && !flips; i++){
+                const uint32* triangle = out.data() + adjacency[i] * 3;
+                uint32 corners[3] = {representative[triangle[0]], representative[triangle[1]], representative[triangle[2]]};
+                if (corners[0] == target || corners[1] == target || corners[2] == target)
+                    continue;
+
+                glm::dvec3 p[3] = {position(corners[0]), position(corners[1]), position(corners[2])};
+                glm::dvec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                for (uint32 corner = 0; corner < 3; corner++){
+                    if (corners[corner] == from)
+                        p[corner] = moved;
+                }
+                glm::dvec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+                flips = glm::dot(before, after) <= 0.0;
+            }
+            if (flips)
+                continue;
+
+            // the neighborhood changes, later collapses
+            // around it wait for the next pass
+            for (uint32 i = adjacencyOffset[from]; i < adjacencyOffset[from + 1]; i++){
+                const uint32* triangle = out.data() + adjacency[i] * 3;
+                for (uint32 corner = 0; corner < 3; corner++){
+                    touched[representative[triangle[corner]]] = true;
+                }
+            }
+            touched[target] = true;
+
+            collapseTo[from] = collapse.to;
+            addQuadric(quadrics[target], quadrics[from]);
+            passError = std::max(passError, collapse.cost);
+            removed += kind[from] == SPR_VERTEX_BORDER ? 1 : 2;
+        }
+        if (removed == 0)
+            break;
+
+        // move the collapsed corners, drop what's degenerate now
+        uint32 count = 0;
+        for (uint32 i = 0; i < out.size(); i += 3){
+            uint32 triangle[3];
+            for (uint32 corner = 0; corner < 3; corner++){
+                uint32 vertex = out[i + corner];
+                triangle[corner] = collapseTo[vertex] != UINT32_MAX ? collapseTo[vertex] : vertex;
+            }
+            uint32 r0 = representative[triangle[0]];
+            uint32 r1 = representative[triangle[1]];
+            uint32 r2 = representative[triangle[2]];
+            if (r0 == r1 || r1 == r2 || r0 == r2)
+                continue;
+            memcpy(out.data() + count, triangle, sizeof(triangle));
+            count += 3;
+        }
+        out.resize(count);
+
+        for (const Collapse& collapse : collapses){
+            collapseTo[collapse.from] = UINT32_MAX;
+        }
+    }
+
+    error = (float)std::sqrt(passError);
+    return out.size();
+}
+
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <vector>
+#include "Resources.h"
+
+namespace spr::tools {
+
+// fifo post-transform cache used for the stats and overdraw clusters,
+// about what current gpus behave like
+static const uint32 SPR_VERTEX_CACHE_SIZE = 16;
+
+typedef struct {
+    float acmr;     // cache misses per triangle, 3 at worst, ~0.5 at best
+    float atvr;     // cache misses per used vertex, 1 at best
+} VertexCacheStats;
+
+// reorders uint32 triangle lists before they're written. every pass but
+// simplify keeps the triangles (and their winding), only their order and
+// vertex ids change
+class MeshOptimizer {
+public:
+    static VertexCacheStats analyzeVertexCache(const uint32* indices, uint32 indexCount, uint32 vertexCount);
+
+    // triangle order for the post-transform cache, forsyth's linear-speed
+    // vertex cache optimisation (lru scoring, so it fits any cache size)
+    static void optimizeVertexCache(uint32* indices, uint32 indexCount, uint32 vertexCount);
+
+    // splits cache optimized triangles into clusters and draws outward facing
+    // ones first, trading at most threshold (1.05 = 5%) acmr for less overdraw.
+    // positions are float xyz, positionStride bytes apart
+    static void optimizeOverdraw(uint32* indices, uint32 indexCount, const uint8* positions, uint32 positionStride, uint32 vertexCount, float threshold);
+
+    // renumbers vertices in order of first use, so fetches walk the vertex
+    // buffers forward. remap is old -> new (UINT32_MAX if unused), returns
+    // the used vertex count
+    static uint32 optimizeVertexFetch(uint32* indices, uint32 indexCount, uint32 vertexCount, std::vector<uint32>& remap);
+
+    // moves vertexStride sized vertices to their remapped slots, drops unused ones
+    static void remapVertices(std::vector<uint8_t>& vertices, uint32 vertexStride, const std::vector<uint32>& remap, uint32 usedVertexCount);
+
+    // lod of a triangle list, edges are collapsed onto existing vertices (quadric
+    // error) so every lod shares the vertex buffers. stops at targetIndexCount
+    // or once a collapse would move the surface more than maxError (position
+    // units). vertices on attribute seams stay, borders only move along themselves.
+    // returns the index count, error is the largest deviation
+    static uint32 simplify(std::vector<uint32>& out, const uint32* indices, uint32 indexCount, const uint8* positions, uint32 positionStride, uint32 vertexCount, uint32 targetIndexCount, float maxError, float& error);
+};
+
+}
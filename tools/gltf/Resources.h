@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../../src/core/spruce_core.h"
+#include "../../src/resource/LodLayout.h"
 using namespace glm;
 
 namespace spr::tools {
@@ -19,6 +20,14 @@ namespace spr::tools {
 // ║                                   ║
 // ║      TextureLayout[]              ║ 
 // ║                                   ║ 
+// ╠───────────────────────────────────╣<─ meshLodBufferOffset (version 1)
+// ║                                   ║
+// ║      MeshLodLayout[]              ║ 
+// ║                                   ║ 
+// ╠───────────────────────────────────╣<─ meshDecodeBufferOffset (version 2)
+// ║                                   ║
+// ║      MeshDecodeLayout[]           ║ 
+// ║                                   ║ 
 // ╠═══ BLOB ══════════════════════════╣<─ blobHeaderOffset
 // ║      BlobHeader                   ║ 
 // ╠═════ DATA REGIONS ════════════════╣<─ blobDataOffset
@@ -78,8 +87,24 @@ struct ModelHeader {
 
     uint32 blobHeaderOffset;
     uint32 blobDataOffset;
+
+    // not in files older than version 1, their mesh
+    // buffer starts here (meshBufferOffset < sizeof(ModelHeader))
+    uint32 version;
+    uint32 meshLodBufferOffset;
+    uint32 meshDecodeBufferOffset;  // version 2
+    uint32 pad0;
 };
 
+// 1: MeshLodLayout[] after the textures
+// 2: MeshDecodeLayout[] after those, quantized vertices
+static const uint32 SPR_MODEL_VERSION = 2;
+
+// shared with the engine's loader
+using spr::SPR_MAX_MESH_LODS;
+using spr::LodLayout;
+using spr::MeshLodLayout;
+
 struct MeshLayout {
     // index of mesh's material in
     // .smdl Material buffer
@@ -99,6 +124,24 @@ struct MeshLayout {
     uint32 attributeDataOffset;
 };
 
+enum VertexFormat : uint32 {
+    SPR_VERTEX_FORMAT_FLOAT = 0,        // VertexPosition, VertexAttributes
+    SPR_VERTEX_FORMAT_QUANTIZED = 1     // VertexPositionQ, VertexAttributesQ
+};
+
+// MeshLayout extension (version 2), how MeshLayout[i]'s vertices are stored
+struct MeshDecodeLayout {
+    uint32 vertexFormat;
+    uint32 pad0;
+    uint32 pad1;
+    uint32 pad2;
+
+    // quantized q (0..1) decodes to offset + q * scale
+    vec4 positionOffset;
+    vec4 positionScale;
+    vec4 uvOffsetScale;     // [ offset.uv | scale.uv ]
+};
+
 struct MaterialLayout {
     uint32 materialFlags;
     
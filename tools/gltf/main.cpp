@@ -1,4 +1,6 @@
 #include <stdlib.h>
+#include <thread>
+#include <sstream>
 #include "GLTFParser.h"
 
 // parses gltf file into:
@@ -10,19 +12,123 @@
 //
 // each file references the ids of associated components
 // everything decomposes into buffers
+//
+// --jobs N converts meshes and textures on N threads (default: all
+// cores), the output is byte-identical for any N
+//
+// textures are basis universal encoded per role, --color/--normal/--other
+// take rgba, etc1s or uastc (default etc1s/uastc/uastc). --zstd L sets
+// the uastc/rgba supercompression level (0 is off, default 18), --quality Q
+// the etc1s quality (1..255, default 128). --report prints the size and
+// psnr of every texture
+//
+// triangles are reordered for the vertex cache and overdraw, vertices for
+// fetch locality, --no-optimize writes them as given. --report also prints
+// the cache stats (acmr/atvr) of every mesh
+//
+// every mesh gets lods of about half the triangles of the one before, while
+// their error stays under the limits of --lods E1,E2,.. (relative to the mesh
+// size, default 0.002,0.005,0.01,0.02, at most 7). --no-lods writes lod 0 only
+//
+// --quantize stores vertices as 16 bit positions, normals (octahedral) and
+// uvs and 8 bit tangents (octahedral) and colors, 20 instead of 48 bytes.
+// positions and uvs are relative to each mesh's bounds, which go in the .smdl.
+// the vertices stay quantized on the gpu, the vertex shaders decode them
+//
+// exits with 1 if the file can't be loaded or any texture fails to convert,
+// failed textures are written empty (the runtime shows them magenta)
 
 using namespace spr::tools;
 
+bool parseEncoding(const std::string& name, TextureEncoding& encoding){
+    if (name == "rgba")
+        encoding = SPR_ENCODE_RGBA;
+    else if (name == "etc1s")
+        encoding = SPR_ENCODE_ETC1S;
+    else if (name == "uastc")
+        encoding = SPR_ENCODE_UASTC;
+    else
+        return false;
+    return true;
+}
+
+bool parseErrors(const std::string& list, std::vector<float>& errors){
+    errors.clear();
+    std::stringstream stream(list);
+    std::string value;
+    while (std::getline(stream, value, ',')){
+        float error = atof(value.c_str());
+        if (error <= 0.f || errors.size() + 1 >= SPR_MAX_MESH_LODS)
+            return false;
+        errors.push_back(error);
+    }
+    return !errors.empty();
+}
+
 int main(int argc, char **argv){
-    // verify only one paremeter
-    if (argc != 2){
-        std::cout << "Incorrect number of arguments" << std::endl;
-        std::cout << "usage: ./gltfparser <path-to-file>" << std::endl;
+    // verify parameters
+    uint32 jobCount = std::max(std::thread::hardware_concurrency(), 1u);
+    TextureSettings textureSettings;
+    MeshSettings meshSettings;
+    bool validArgs = argc >= 2;
+    for (int32 i = 1; i < argc - 1 && validArgs; i++){
+        std::string option(argv[i]);
+        if (option == "--report"){
+            textureSettings.report = true;
+            meshSettings.report = true;
+            continue;
+        }
+        if (option == "--no-optimize"){
+            meshSettings.optimize = false;
+            continue;
+        }
+        if (option == "--no-lods"){
+            meshSettings.lodErrors.clear();
+            continue;
+        }
+        if (option == "--quantize"){
+            meshSettings.quantize = true;
+            continue;
+        }
+        if (i + 1 >= argc - 1){
+            validArgs = false;
+            break;
+        }
+
+        std::string value(argv[++i]);
+        if (option == "--jobs"){
+            int32 jobs = atoi(value.c_str());
+            validArgs = jobs > 0;
+            jobCount = jobs;
+        } else if (option == "--color"){
+            validArgs = parseEncoding(value, textureSettings.color);
+        } else if (option == "--normal"){
+            validArgs = parseEncoding(value, textureSettings.normal);
+        } else if (option == "--other"){
+            validArgs = parseEncoding(value, textureSettings.other);
+        } else if (option == "--zstd"){
+            int32 level = atoi(value.c_str());
+            validArgs = level >= 0 && level <= 22;
+            textureSettings.zstdLevel = level;
+        } else if (option == "--quality"){
+            int32 quality = atoi(value.c_str());
+            validArgs = quality >= 1 && quality <= 255;
+            textureSettings.etc1sQuality = quality;
+        } else if (option == "--lods"){
+            validArgs = parseErrors(value, meshSettings.lodErrors);
+        } else {
+            validArgs = false;
+        }
+    }
+    if (!validArgs){
+        std::cout << "Incorrect arguments" << std::endl;
+        std::cout << "usage: ./gltfparser [--jobs N] [--color|--normal|--other rgba|etc1s|uastc] [--zstd L] [--quality Q] [--no-optimize] [--lods E1,E2,..|--no-lods] [--quantize] [--report] <path-to-file>" << std::endl;
         return -1;
     }
+    std::string filename(argv[argc - 1]);
 
     // verify valid extension
-    std::string ext = std::filesystem::path(argv[1]).extension();
+    std::string ext = std::filesystem::path(filename).extension();
     if (ext != ".gltf" && ext != ".glb"){
         std::cout << "Extension not supported" << std::endl;
         std::cout << "Expected: .glb .gltf" << std::endl;
@@ -30,13 +136,13 @@ int main(int argc, char **argv){
         return -1;
     }
 
-    std::string filename(argv[1]);
-
     // parse file
-    GLTFParser parser = GLTFParser();
+    GLTFParser parser = GLTFParser(jobCount, textureSettings, meshSettings);
+    bool parsed;
     if (ext == ".gltf"){
-        parser.parseJson(filename);
+        parsed = parser.parseJson(filename);
     } else { // .glb
-        parser.parseBinary(filename);
+        parsed = parser.parseBinary(filename);
     }
-}
\ No newline at end of file
+    return parsed ? 0 : 1;
+}
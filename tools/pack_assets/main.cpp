@@ -0,0 +1,42 @@
+#include <iostream>
+#include <fstream>
+#include "resource/AssetArchive.h"
+#include "resource/ResourceTypes.h"
+#include "external/json/json.hpp"
+
+using namespace spr;
+
+// packs every asset in asset_manifest.json (run register_assets
+// first) into one archive:
+//      assets.spak - 4KB aligned assets with a toc sorted by id
+//
+// usage: ./pack_assets [<manifest> <archive>]
+
+int main(int argc, char **argv){
+    std::string manifestPath = argc > 2 ? argv[1] : SPR_ARCHIVE_MANIFEST;
+    std::string archivePath = argc > 2 ? argv[2] : SPR_ASSET_ARCHIVE;
+
+    std::ifstream f(manifestPath);
+    if (!f){
+        std::cout << "Can't read manifest: " << manifestPath << std::endl;
+        return -1;
+    }
+    nlohmann::json manifest = nlohmann::json::parse(f);
+
+    // same paths AssetLoader resolves loose files with
+    PathMap paths;
+    for (const auto& model : manifest["models"]){
+        paths[model["parentId"]] = ResourceTypes::path(SPR_MODEL, model["name"], 0);
+    }
+    for (const auto& texture : manifest["nonSubresourceTextures"]){
+        paths[texture["parentId"]] = ResourceTypes::path(SPR_TEXTURE, texture["name"], 0);
+    }
+
+    // the runtime only mounts the archive while this manifest and the
+    // packed files (sizes, write times) are current
+    if (!AssetArchive::pack(paths, archivePath, AssetArchive::hashFile(manifestPath)))
+        return -1;
+
+    std::cout << "Packed " << paths.size() << " assets into " << archivePath << std::endl;
+    return 0;
+}
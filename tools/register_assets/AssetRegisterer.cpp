@@ -1,6 +1,7 @@
 #include "AssetRegisterer.h"
 #include "json.hpp"
 #include "debug/SprLog.h"
+#include "resource/AssetManifest.h"
 #include "../../external/mio/mio.h"
 #include "../gltf/Resources.h"
 #include <sys/types.h>
@@ -340,6 +341,33 @@ void AssetRegisterer::writeManifest(int totalBytes){
     f.close();
 }
 
+void AssetRegisterer::writeBinaryManifest(){
+    // same entries, in the same order, as the json manifest
+    std::vector<ManifestEntry> models;
+    for (std::pair<std::string, ResourceMetadata> metadata : m_modelMetadataMap){
+        models.push_back({
+            .name = metadata.first,
+            .resourceId = metadata.second.resourceId,
+            .parentId = metadata.second.parentId,
+            .sizeTotal = metadata.second.sizeTotal,
+            .resourceType = metadata.second.resourceType
+        });
+    }
+
+    std::vector<ManifestEntry> textures;
+    for (std::pair<std::string, ResourceMetadata> metadata : m_nonSubresourceTextureMap){
+        textures.push_back({
+            .name = metadata.first,
+            .resourceId = metadata.second.resourceId,
+            .parentId = metadata.second.parentId,
+            .sizeTotal = metadata.second.sizeTotal,
+            .resourceType = metadata.second.resourceType
+        });
+    }
+
+    AssetManifest::write(SPR_ASSET_MANIFEST, models, textures);
+}
+
 void AssetRegisterer::registerDirectory(std::string dir){
     int totalSizeBytes = 0;
     
@@ -387,6 +415,9 @@ void AssetRegisterer::registerDirectory(std::string dir){
 
     // write asset_manifest.h
     writeManifest(totalSizeBytes);
+
+    // write asset_manifest.bin
+    writeBinaryManifest();
 }
 
 }
\ No newline at end of file
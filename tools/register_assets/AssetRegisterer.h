@@ -68,6 +68,7 @@ public:
     int loadBuffer(std::string path, ResourceMetadata& modelData, mio::mmap_source& file, ModelHeader& model, uint32 offset, uint32 length);
     void writeHeader();
     void writeManifest(int totalBytes);
+    void writeBinaryManifest();
 
     static std::string typeToString(ResourceType resourceType){
         return resourceTypeStrings[resourceType];